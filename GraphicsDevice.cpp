@@ -1,6 +1,7 @@
 #include <SDL/SDL.h>
 
 #include "glheaders.h"
+#include "gltypes.h"
 #include "GraphicsDevice.h"
 
 #include <iostream>
@@ -102,21 +103,13 @@ void GraphicsDevice::setAttributes() {
 
 Mat4 GraphicsDevice::getProjectionMatrix() {
 	Mat4 m;
-#if REAL_IS_DOUBLE
-	glGetDoublev(GL_PROJECTION_MATRIX, m.m);
-#else
-	glGetFloatv(GL_PROJECTION_MATRIX, m.m);
-#endif
+	get_matrix(GL_PROJECTION_MATRIX, m.m);
 	return m;
 }
 
 Mat4 GraphicsDevice::getModelViewMatrix() {
 	Mat4 m;
-#if REAL_IS_DOUBLE
-	glGetDoublev(GL_MODELVIEW_MATRIX, m.m);
-#else
-	glGetFloatv(GL_MODELVIEW_MATRIX, m.m);
-#endif
+	get_matrix(GL_MODELVIEW_MATRIX, m.m);
 	return m;
 }
 
@@ -136,6 +129,8 @@ void GraphicsDevice::initializeOpenGLExtensions() {
 	if(GLEW_OK != err) {
 		std::cerr << (const char*)glewGetErrorString(err) << std::endl;
 	}
+
+	init_vertex_formats();
 }
 
 void GraphicsDevice::resizeOpenGLViewport(const ivec2 &_dimensions,
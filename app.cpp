@@ -17,14 +17,28 @@
 #include "glheaders.h"
 #include "project.h"
 #include "scene.h"
+#include "passes.h"
+#include "occlusionquery.h"
+#include "framegraph.h"
+#include "rendertargetpool.h"
+#include "resolutiongovernor.h"
+#include "gputimer.h"
+#include "renderstats.h"
+#include "trace.h"
+#include "flightrecorder.h"
+#include "softwareocclusion.h"
 #include "timer.h"
 #include "SDLinput.h"
 #include "devil_wrapper.h"
 #include "GraphicsDevice.h"
+#include "headlessdevice.h"
+#include "headlessrun.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <vector>
 
 /* the number of array elements per color */
 #define COLOR_SIZE 4
@@ -36,7 +50,24 @@
 #define MOUSE_MIDDLE_BUTTON (1)
 #define MOUSE_RIGHT_BUTTON (2)
 
+/* file written with F4, viewable in chrome://tracing */
+#define TRACE_FILENAME "trace.json"
+
+/* frames rendered in headless mode unless given with --frames */
+#define DEFAULT_HEADLESS_FRAMES 300
+
+/* exit status of headless mode */
+enum HeadlessStatus
+{
+	HEADLESS_OK = 0,
+	HEADLESS_USAGE_FAILED = 1,
+	HEADLESS_DEVICE_FAILED = 2,
+	HEADLESS_SCENE_FAILED = 3,
+	HEADLESS_GL_ERROR = 4
+};
+
 Timer g_timer;
+FlightRecorder g_flight_recorder;
 GraphicsDevice *g_graphicsdevice = 0;
 
 /**
@@ -181,6 +212,9 @@ void app_exit()
     delete state.scene;
 	state.scene = NULL;
 
+	render_target_pool.trim();
+	gpu_timer.release();
+
     exit(0);
 }
 
@@ -366,6 +400,44 @@ static void mouse_motion_callback(int x, int y, int xrel, int yrel)
 	if(yrel != 0) { apply_control(mouse.camera_control[1], yrel); }
 }
 
+/**
+ * Prints occlusion culling statistics for the last frame of each pass which
+ * uses an occlusion culler, on the GPU or the CPU.
+ */
+static void print_occlusion_stats(void)
+{
+	int n = 0;
+
+	for(Scene::PassList::const_iterator i = state.scene->passes.begin();
+		i != state.scene->passes.end(); ++i, ++n)
+	{
+		const StandardPass * pass = dynamic_cast<const StandardPass *>((*i).get());
+
+		if(pass && pass->occlusion_culler) {
+			std::cout << "pass " << n << ": " << pass->occlusion_culler->get_stats() << std::endl;
+		} else if(pass && pass->software_culler) {
+			std::cout << "pass " << n << ": " << pass->software_culler->get_stats() << std::endl;
+		}
+	}
+}
+
+/**
+ * Prints the frame graph's statistics for the last frame, the memory held
+ * by render targets, the resolution they are drawn at, and GPU timings.
+ */
+static void print_frame_graph_stats(void)
+{
+	std::cout << "last frame: " << render_stats.get_last_frame() << std::endl;
+	std::cout << "frame graph: " << state.scene->frame_graph->get_stats() << std::endl;
+	std::cout << "render targets: " << render_target_pool.get_stats() << std::endl;
+
+	if(state.scene->resolution_governor) {
+		std::cout << "resolution: " << state.scene->resolution_governor->get_stats() << std::endl;
+	}
+
+	gpu_timer.print(std::cout);
+}
+
 static void key_press(SDLKey key)
 {
 	switch(key)
@@ -377,6 +449,22 @@ static void key_press(SDLKey key)
 	case SDLK_SPACE:
 		app_reload_scene();
 		break;
+
+	case SDLK_F2:
+		print_frame_graph_stats();
+		print_occlusion_stats();
+		break;
+
+	case SDLK_F3:
+		gpu_timer.draw_timing = !gpu_timer.draw_timing;
+		std::cout << "draw timing " << (gpu_timer.draw_timing ? "on" : "off") << std::endl;
+		break;
+
+	case SDLK_F4:
+		if(trace_write_chrome_json(TRACE_FILENAME)) {
+			std::cout << "wrote " << TRACE_FILENAME << std::endl;
+		}
+		break;
 	}
 }
 
@@ -392,8 +480,22 @@ static void print_usage(const char* progname)
         "\t\tLoads the given scene number as the initial scene.\n" \
         "\t-o / --output [FILENAME]\n" \
         "\t\tSets the filename used for screenshots.\n" \
+        "\t--headless\n" \
+        "\t\tRenders the scene into an offscreen framebuffer without\n" \
         "\t\tloading a window. This is useful for tracing scenes in the\n" \
         "\t\tbackground or on machines without a display available.\n" \
+        "\t\tFrames are rendered as fast as possible, then per-frame CPU\n" \
+        "\t\tand GPU times are printed to stdout as JSON. Other messages\n" \
+        "\t\tgo to stderr. Exits with 0 on success, 2 if no OpenGL context\n" \
+        "\t\tcould be created, 3 if the scene failed to load, or 4 if\n" \
+        "\t\tOpenGL reported errors. Needs EGL, e.g. Mesa's llvmpipe.\n" \
+        "\t--frames [COUNT]\n" \
+        "\t\tNumber of frames rendered in headless mode. The default is 300.\n" \
+        "\t--size [WIDTH]x[HEIGHT]\n" \
+        "\t\tFramebuffer size in headless mode. The default is 800x600.\n" \
+        "\t-spike / --spike-threshold [MULTIPLE]\n" \
+        "\t\tWrites a trace when a frame takes longer than MULTIPLE times\n" \
+        "\t\tthe average frame time. 0 disables. The default is 2.\n" \
         "\t-gldebug\n\t\tAfter processing callbacks and/or events, check if\n" \
         "\t\tthere are any OpenGL errors by calling  glGetError. If an error\n" \
         "\t\tis reported, print out a warning by looking up the error code\n" \
@@ -401,20 +503,6 @@ static void print_usage(const char* progname)
         "\t\tOpenGL run-time errors.\n";
 }
 
-/**
- * If any of optv are contained in argv, returns the index into argv. Otherwise
- * returns -1.
- */
-static int getarg(int argc, char *argv[], int optc, const char* optv[])
-{
-    for (int i=1; i < argc; i++)
-        for (int j=0; j < optc; j++)
-            if (strcmp(optv[j], argv[i]) == 0)
-                return i;
-
-    return -1;
-}
-
 // the command line options
 const char* OPT_HP[] = { "-h", "--help" };
 #define OPTLEN_HP 2
@@ -422,6 +510,77 @@ const char* OPT_SN[] = { "-s", "--scene" };
 #define OPTLEN_SN 2
 const char* OPT_OP[] = { "-o", "--output" };
 #define OPTLEN_OP 2
+const char* OPT_SP[] = { "-spike", "--spike-threshold" };
+#define OPTLEN_SP 2
+const char* OPT_HL[] = { "-headless", "--headless" };
+#define OPTLEN_HL 2
+
+/**
+ * Renders the current scene for a fixed number of frames into an offscreen
+ * framebuffer, as fast as possible, and prints frame time statistics as
+ * JSON. Returns the exit status.
+ */
+static int run_headless(int frames, const ivec2 &dimensions)
+{
+	// Only the JSON goes to stdout, so it can be piped straight into a parser
+	std::streambuf * stdout_buffer = std::cout.rdbuf(std::clog.rdbuf());
+
+	SDL_Init(SDL_INIT_TIMER);
+
+	state.width = dimensions.x;
+	state.height = dimensions.y;
+	state.scene_state = SCENE_PLAYING;
+	state.render_state = RENDER_GL;
+	state.period = 1.0/DEFAULT_WINDOW_FPS; // simulate at the usual rate
+
+	HeadlessDevice device(dimensions);
+
+	if(!device.is_valid()) {
+		std::cout.rdbuf(stdout_buffer);
+		return HEADLESS_DEVICE_FAILED;
+	}
+
+	devil_init();
+
+	state.scene = new Scene();
+	if (!load_scene(state.scene, state.scene_index)) {
+		std::cerr << "Error: scene load failed.\n";
+		std::cout.rdbuf(stdout_buffer);
+		return HEADLESS_SCENE_FAILED;
+	}
+	update_camera_aspect();
+
+	prj_initialize(state.scene);
+
+	HeadlessFrames result;
+	render_headless_frames(state.scene, 0, frames, state.period, 0, result);
+
+	std::cout.rdbuf(stdout_buffer);
+
+	std::cout << "{\"scene\": " << state.scene_index
+	          << ", \"frames\": " << frames
+	          << ", \"width\": " << dimensions.x
+	          << ", \"height\": " << dimensions.y
+	          << ", \"renderer\": \"" << (const char*)glGetString(GL_RENDERER) << "\""
+	          << ", \"gpu_timing\": " << (gpu_timer.is_supported() ? "true" : "false")
+	          << ", \"gpu_frames_dropped\": " << gpu_timer.get_frames_dropped()
+	          << ", \"gl_errors\": " << result.gl_errors
+	          << ",\n \"cpu_ms\": " << FrameStats(result.cpu_ms)
+	          << ",\n \"gpu_ms\": " << FrameStats(result.gpu_ms)
+	          << ",\n \"cpu_frame_ms\": ";
+	print_json_array(std::cout, result.cpu_ms);
+	std::cout << ",\n \"gpu_frame_ms\": ";
+	print_json_array(std::cout, result.gpu_ms);
+	std::cout << "}" << std::endl;
+
+	delete state.scene;
+	state.scene = NULL;
+
+	render_target_pool.trim();
+	gpu_timer.release();
+
+	return result.gl_errors ? HEADLESS_GL_ERROR : HEADLESS_OK;
+}
 
 /**
  * Initialize the application.
@@ -461,6 +620,29 @@ static void app_initialize(int argc, char *argv[],
         }
     }
 
+    // search for spike threshold argument
+    if ((index = getarg(argc, argv, OPTLEN_SP, OPT_SP)) != -1) {
+        if (index >= argc - 1 ||
+                sscanf(argv[index+1], "%lf", &g_flight_recorder.threshold) != 1) {
+            std::cerr << "Error: cannot parse spike threshold.\n";
+            goto FAIL;
+        }
+    }
+
+    // search for headless mode, which renders a fixed number of frames
+    // without a window and exits
+    if (getarg(argc, argv, OPTLEN_HL, OPT_HL) != -1) {
+        int frames = DEFAULT_HEADLESS_FRAMES;
+        ivec2 dimensions(width, height);
+
+        if (!parse_headless_options(argc, argv, frames, dimensions)) {
+            print_usage(argv[0]);
+            exit(HEADLESS_USAGE_FAILED);
+        }
+
+        exit(run_headless(frames, dimensions));
+    }
+
     // initialize SDL
 	SDL_Init(SDL_INIT_EVERYTHING);
 
@@ -505,24 +687,41 @@ static void app_initialize(int argc, char *argv[],
     state.period = 1.0/fps;
 
 	while(true) {
+		TRACE_ZONE("frame");
+
 		assert(state.scene);
 		assert(state.input);
 
 		// poll for input events
-		state.input->poll();
+		{
+			TRACE_ZONE("poll input");
+			state.input->poll();
+		}
 
 		if (state.scene_state == SCENE_PLAYING) {
 			// invoke user scene update function
+			TRACE_ZONE("prj_update");
 			prj_update(state.scene, state.period);
 		}
 
 		// render all passes and swap buffers
 		state.scene->render();
 
+		{
+			TRACE_ZONE("SwapBuffers");
+			SDL_GL_SwapBuffers();
+		}
+
 		// Finish processing and possibly stall to maintain constant rate
-		while (g_timer.getElapsedTimeMS() < state.period);
+		{
+			TRACE_ZONE("wait");
+			while (g_timer.getElapsedTimeMS() < state.period);
+		}
 
 		g_timer.update();
+
+		// Write a trace if this frame took much longer than usual
+		g_flight_recorder.end_frame();
 	}
 
 FAIL:
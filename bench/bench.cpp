@@ -0,0 +1,426 @@
+/**
+ * @file bench.cpp
+ * @brief Renders each scene headless and compares frame times against a
+ *  stored baseline
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#include <SDL/SDL.h>
+#include "glheaders.h"
+#include "project.h"
+#include "scene.h"
+#include "rendertargetpool.h"
+#include "gputimer.h"
+#include "renderstats.h"
+#include "trace.h"
+#include "headlessdevice.h"
+#include "headlessrun.h"
+#include "devil_wrapper.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* exit status */
+enum BenchStatus
+{
+	BENCH_OK = 0,
+	BENCH_REGRESSED = 1,
+	BENCH_DEVICE_FAILED = 2,
+	BENCH_SCENE_FAILED = 3,
+	BENCH_USAGE_FAILED = 4
+};
+
+/* settings, all of which can be changed on the command line */
+struct BenchOptions
+{
+	int frames;
+	int warmup;
+	ivec2 dimensions;
+	int scene; // -1 for all scenes
+	real_t threshold;
+	std::string baseline_filename;
+	std::string save_filename;
+
+	BenchOptions()
+	: frames(300),
+	  warmup(60),
+	  dimensions(DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT),
+	  scene(-1),
+	  threshold(0.1) {}
+};
+
+/* results for one scene */
+struct BenchResult
+{
+	int scene;
+	int frames;
+
+	/* wall time between the ends of consecutive frames */
+	double p50_ms, p95_ms, p99_ms, max_ms;
+
+	/* GPU time of the frame, from gpu_timer. Zero if unsupported. */
+	double gpu_p50_ms, gpu_p95_ms;
+
+	/* per-frame averages, from render_stats */
+	double draw_calls;
+	double bytes_uploaded;
+
+	BenchResult()
+	: scene(-1),
+	  frames(0),
+	  p50_ms(0), p95_ms(0), p99_ms(0), max_ms(0),
+	  gpu_p50_ms(0), gpu_p95_ms(0),
+	  draw_calls(0),
+	  bytes_uploaded(0) {}
+};
+
+/* the scene is simulated at the windowed frame rate, whatever the speed */
+static const double PERIOD = 1.0 / DEFAULT_WINDOW_FPS;
+
+/**
+ * Loads a scene, renders the warm-up frames with the camera still, then
+ * renders the measured frames while the camera orbits its focus once.
+ * Returns false if the scene failed to load.
+ */
+static bool run_scene(int num, const BenchOptions &options, BenchResult &result)
+{
+	Scene * scene = new Scene();
+
+	if(!ldr_load_scene(scene, num)) {
+		std::cerr << "ERROR: scene " << num << " failed to load" << std::endl;
+		delete scene;
+		return false;
+	}
+
+	prj_initialize(scene);
+
+	HeadlessFrames frames;
+	render_headless_frames(scene, options.warmup, options.frames, PERIOD, 2 * PI, frames);
+
+	const FrameStats frame_stats(frames.frame_ms);
+	const FrameStats gpu_stats(frames.gpu_ms);
+
+	result.scene = num;
+	result.frames = options.frames;
+	result.p50_ms = frame_stats.p50;
+	result.p95_ms = frame_stats.p95;
+	result.p99_ms = frame_stats.p99;
+	result.max_ms = frame_stats.max;
+	result.gpu_p50_ms = gpu_stats.p50;
+	result.gpu_p95_ms = gpu_stats.p95;
+	result.draw_calls = frames.draw_calls;
+	result.bytes_uploaded = frames.bytes_uploaded;
+
+	delete scene;
+
+	return true;
+}
+
+/**
+ * Writes results in the baseline file format: a comment naming the
+ * columns, then one line per scene.
+ */
+static void write_results(std::ostream &o, const std::vector<BenchResult> &results)
+{
+	o << "# scene frames p50_ms p95_ms p99_ms max_ms gpu_p50_ms gpu_p95_ms"
+	     " draw_calls bytes_uploaded" << std::endl;
+
+	o << std::fixed;
+
+	for(size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchResult &r = results[i];
+
+		o << r.scene << " " << r.frames << std::setprecision(3)
+		  << " " << r.p50_ms << " " << r.p95_ms
+		  << " " << r.p99_ms << " " << r.max_ms
+		  << " " << r.gpu_p50_ms << " " << r.gpu_p95_ms
+		  << std::setprecision(1)
+		  << " " << r.draw_calls << " " << r.bytes_uploaded << std::endl;
+	}
+}
+
+/**
+ * Reads results written by write_results. Returns false if the file could
+ * not be opened.
+ */
+static bool read_results(const std::string &filename, std::vector<BenchResult> &results)
+{
+	std::ifstream file(filename.c_str());
+
+	if(!file) {
+		std::cerr << "ERROR: cannot open baseline " << filename << std::endl;
+		return false;
+	}
+
+	std::string line;
+
+	while(std::getline(file, line))
+	{
+		if(line.empty() || line[0] == '#')
+			continue;
+
+		BenchResult r;
+		std::istringstream s(line);
+
+		s >> r.scene >> r.frames
+		  >> r.p50_ms >> r.p95_ms >> r.p99_ms >> r.max_ms
+		  >> r.gpu_p50_ms >> r.gpu_p95_ms
+		  >> r.draw_calls >> r.bytes_uploaded;
+
+		if(!s) {
+			std::cerr << "WARNING: skipping malformed baseline line: " << line << std::endl;
+			continue;
+		}
+
+		results.push_back(r);
+	}
+
+	return true;
+}
+
+/**
+ * Reports one measurement which grew past the threshold. Returns true if
+ * it did.
+ */
+static bool check(int scene, const char * name, double baseline, double value, real_t threshold)
+{
+	if(value <= baseline * (1 + threshold))
+		return false;
+
+	std::cout << "REGRESSION: scene " << scene << " " << name << " "
+	          << baseline << " -> " << value;
+
+	if(baseline > 0) {
+		std::cout << " (+" << (int)floor((value / baseline - 1) * 100 + 0.5) << "%)";
+	}
+
+	std::cout << std::endl;
+
+	return true;
+}
+
+/**
+ * Compares results against a baseline. Scenes missing from either are
+ * skipped. Returns true if any scene regressed.
+ */
+static bool compare_results(const std::vector<BenchResult> &baseline,
+                            const std::vector<BenchResult> &results,
+                            real_t threshold)
+{
+	bool regressed = false;
+
+	for(size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchResult &r = results[i];
+
+		for(size_t j = 0; j < baseline.size(); ++j)
+		{
+			const BenchResult &b = baseline[j];
+
+			if(b.scene != r.scene)
+				continue;
+
+			// Check every measurement, so all of them are reported
+			regressed = check(r.scene, "p50_ms", b.p50_ms, r.p50_ms, threshold) || regressed;
+			regressed = check(r.scene, "p95_ms", b.p95_ms, r.p95_ms, threshold) || regressed;
+			regressed = check(r.scene, "gpu_p50_ms", b.gpu_p50_ms, r.gpu_p50_ms, threshold) || regressed;
+			regressed = check(r.scene, "draw_calls", b.draw_calls, r.draw_calls, threshold) || regressed;
+			regressed = check(r.scene, "bytes_uploaded", b.bytes_uploaded, r.bytes_uploaded, threshold) || regressed;
+		}
+	}
+
+	return regressed;
+}
+
+/**
+ * Prints program usage.
+ */
+static void print_usage(const char* progname)
+{
+	std::cout << "Usage: " << progname << " [OPTIONS]...\nOptions:\n" \
+		"\t-h / --help\n" \
+		"\t\tPrint usage information and exit.\n" \
+		"\t-s / --scene [SCENE NUMBER]\n" \
+		"\t\tBenchmarks only the given scene. By default every scene is run.\n" \
+		"\t--frames [COUNT]\n" \
+		"\t\tFrames measured per scene. The default is 300.\n" \
+		"\t--warmup [COUNT]\n" \
+		"\t\tFrames rendered before measuring. The default is 60.\n" \
+		"\t--size [WIDTH]x[HEIGHT]\n" \
+		"\t\tFramebuffer size. The default is 800x600.\n" \
+		"\t--baseline [FILENAME]\n" \
+		"\t\tCompares the results against a file written by --save, and\n" \
+		"\t\texits with 1 if any scene regressed.\n" \
+		"\t--threshold [FRACTION]\n" \
+		"\t\tA measurement regresses if it grows by more than FRACTION.\n" \
+		"\t\tThe default is 0.1.\n" \
+		"\t--save [FILENAME]\n" \
+		"\t\tWrites the results as a new baseline.\n" \
+		"\tScenes are rendered into an offscreen framebuffer as fast as\n" \
+		"\tpossible, with the camera orbiting its focus once while measuring.\n" \
+		"\tExits with 2 if no OpenGL context could be created and 3 if a\n" \
+		"\tscene failed to load.\n";
+}
+
+// the command line options
+const char* OPT_HP[] = { "-h", "--help" };
+#define OPTLEN_HP 2
+const char* OPT_SN[] = { "-s", "--scene" };
+#define OPTLEN_SN 2
+const char* OPT_WU[] = { "-warmup", "--warmup" };
+#define OPTLEN_WU 2
+const char* OPT_BL[] = { "-baseline", "--baseline" };
+#define OPTLEN_BL 2
+const char* OPT_TH[] = { "-threshold", "--threshold" };
+#define OPTLEN_TH 2
+const char* OPT_SV[] = { "-save", "--save" };
+#define OPTLEN_SV 2
+
+/**
+ * Parses the command line. Returns false if it could not be parsed.
+ */
+static bool parse_options(int argc, char *argv[], BenchOptions &options)
+{
+	int index;
+
+	if ((index = getarg(argc, argv, OPTLEN_SN, OPT_SN)) != -1) {
+		if (index >= argc - 1 ||
+				sscanf(argv[index+1], "%d", &options.scene) != 1 ||
+				options.scene < 0 || options.scene >= NUM_SCENES) {
+			std::cerr << "Error: cannot parse scene number.\n";
+			return false;
+		}
+	}
+
+	if (!parse_headless_options(argc, argv, options.frames, options.dimensions)) {
+		return false;
+	}
+
+	if ((index = getarg(argc, argv, OPTLEN_WU, OPT_WU)) != -1) {
+		if (index >= argc - 1 ||
+				sscanf(argv[index+1], "%d", &options.warmup) != 1 || options.warmup < 0) {
+			std::cerr << "Error: cannot parse warm-up frame count.\n";
+			return false;
+		}
+	}
+
+	if ((index = getarg(argc, argv, OPTLEN_TH, OPT_TH)) != -1) {
+		double threshold;
+		if (index >= argc - 1 ||
+				sscanf(argv[index+1], "%lf", &threshold) != 1 || threshold < 0) {
+			std::cerr << "Error: cannot parse threshold.\n";
+			return false;
+		}
+		options.threshold = threshold;
+	}
+
+	if ((index = getarg(argc, argv, OPTLEN_BL, OPT_BL)) != -1) {
+		if (index >= argc - 1) {
+			std::cerr << "Error: cannot parse baseline filename.\n";
+			return false;
+		}
+		options.baseline_filename = argv[index+1];
+	}
+
+	if ((index = getarg(argc, argv, OPTLEN_SV, OPT_SV)) != -1) {
+		if (index >= argc - 1) {
+			std::cerr << "Error: cannot parse output filename.\n";
+			return false;
+		}
+		options.save_filename = argv[index+1];
+	}
+
+	return true;
+}
+
+/**
+ * Benchmark entry point.
+ */
+int main(int argc, char *argv[])
+{
+	BenchOptions options;
+
+	if (getarg(argc, argv, OPTLEN_HP, OPT_HP) != -1) {
+		print_usage(argv[0]);
+		return BENCH_OK;
+	}
+
+	if (!parse_options(argc, argv, options)) {
+		print_usage(argv[0]);
+		return BENCH_USAGE_FAILED;
+	}
+
+	// Read the baseline first, so a typo fails before the long run
+	std::vector<BenchResult> baseline;
+	if (!options.baseline_filename.empty() &&
+	    !read_results(options.baseline_filename, baseline)) {
+		return BENCH_USAGE_FAILED;
+	}
+
+	// Only the results go to stdout
+	std::streambuf * stdout_buffer = std::cout.rdbuf(std::clog.rdbuf());
+
+	SDL_Init(SDL_INIT_TIMER);
+
+	HeadlessDevice device(options.dimensions);
+
+	if (!device.is_valid()) {
+		std::cout.rdbuf(stdout_buffer);
+		return BENCH_DEVICE_FAILED;
+	}
+
+	devil_init();
+
+	std::vector<BenchResult> results;
+	bool failed = false;
+
+	for (int num = 0; num < NUM_SCENES; ++num) {
+		if (options.scene >= 0 && num != options.scene)
+			continue;
+
+		std::clog << "benchmarking scene " << num << std::endl;
+
+		BenchResult result;
+		if (run_scene(num, options, result)) {
+			results.push_back(result);
+		} else {
+			failed = true;
+		}
+	}
+
+	render_target_pool.trim();
+	gpu_timer.release();
+
+	std::cout.rdbuf(stdout_buffer);
+
+	write_results(std::cout, results);
+
+	if (!options.save_filename.empty()) {
+		std::ofstream file(options.save_filename.c_str());
+		write_results(file, results);
+
+		if (!file) {
+			std::cerr << "ERROR: cannot write " << options.save_filename << std::endl;
+		}
+	}
+
+	if (failed) {
+		return BENCH_SCENE_FAILED;
+	}
+
+	if (!baseline.empty() && compare_results(baseline, results, options.threshold)) {
+		return BENCH_REGRESSED;
+	}
+
+	return BENCH_OK;
+}
@@ -0,0 +1,1867 @@
+/**
+ * @file microbench.cpp
+ * @brief Times the hottest CPU kernels in isolation, at several sizes
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#include "glheaders.h"
+#include "scene.h"
+#include "gltypes.h"
+#include "trace.h"
+#include "headlessdevice.h"
+#include "headlessrun.h"
+#include "softwareocclusion.h"
+#include "vec/mat.h"
+#include "vec/affine.h"
+#include "vec/batch.h"
+#include "vec/cpu.h"
+#include "vec/fastmath.h"
+#include "vec/frustum.h"
+#include "vec/quat.h"
+#include "vec/wide.h"
+#include "geom/mesh.h"
+#include "geom/sphere.h"
+#include "geom/trianglesoup.h"
+#include "geom/watersurface.h"
+#include "geom/waterkernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define HAVE_CYCLE_COUNTER 1
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <x86intrin.h>
+#define HAVE_CYCLE_COUNTER 1
+#else
+#define HAVE_CYCLE_COUNTER 0
+#endif
+
+/**
+ * Reads the time stamp counter. It ticks at a constant reference rate on
+ * current CPUs, which may differ from the core clock under turbo or power
+ * saving, so cycle counts are comparable between runs on one machine only.
+ */
+static inline unsigned long long read_cycles()
+{
+#if HAVE_CYCLE_COUNTER
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/* results are written here so the compiler cannot discard the work */
+static volatile real_t sink;
+
+/* deterministic inputs, so runs are comparable */
+static unsigned int random_state = 1;
+
+static real_t random_real(real_t lo, real_t hi)
+{
+	random_state = random_state * 1103515245 + 12345;
+	return lo + (hi - lo) * ((random_state >> 8) & 0xffff) / (real_t)0xffff;
+}
+
+static Vec3 random_vec3()
+{
+	return Vec3(random_real(-1, 1), random_real(-1, 1), random_real(-1, 1));
+}
+
+static Quat random_quat()
+{
+	return Quat(random_vec3().normalize(), random_real(0, 2 * PI));
+}
+
+static Mat4 random_mat4()
+{
+	// An invertible affine transform, like the ones in the scenes
+	Mat4 m = random_quat().to_matrix();
+	m(3,0) = random_real(-10, 10);
+	m(3,1) = random_real(-10, 10);
+	m(3,2) = random_real(-10, 10);
+	return m;
+}
+
+/**
+ * A kernel to time. setup() prepares inputs for one size, then run() is
+ * called many times and must do the same work each time.
+ */
+class Kernel
+{
+public:
+	/** Sizes to run at, in elements, or e.g. levels for the sphere */
+	std::vector<int> sizes;
+
+	virtual ~Kernel() { /* Do Nothing */ }
+
+	virtual const char * get_name() const = 0;
+
+	/** Returns true if the kernel creates buffer objects */
+	virtual bool needs_gl() const { return false; }
+
+	/** Prepares the inputs and returns the elements processed per run */
+	virtual size_t setup(int size) = 0;
+
+	virtual void run() = 0;
+
+	/** Releases what setup() created */
+	virtual void teardown() { /* Do Nothing */ }
+};
+
+class Mat4MultiplyKernel : public Kernel
+{
+public:
+	Mat4MultiplyKernel(bool _scalar) : scalar(_scalar) { sizes.push_back(64); sizes.push_back(1024); sizes.push_back(16384); }
+
+	const char * get_name() const { return scalar ? "mat4_multiply_scalar" : "mat4_multiply"; }
+
+	size_t setup(int size)
+	{
+		a.resize(size); b.resize(size); out.resize(size);
+		for(int i = 0; i < size; ++i) { a[i] = random_mat4(); b[i] = random_mat4(); }
+		return size;
+	}
+
+	void run()
+	{
+		if(scalar) {
+			for(size_t i = 0; i < out.size(); ++i) out[i] = a[i].multiply_scalar(b[i]);
+		} else {
+			for(size_t i = 0; i < out.size(); ++i) out[i] = a[i] * b[i];
+		}
+		sink = out.back()(3,0);
+	}
+
+private:
+	bool scalar;
+	std::vector<Mat4> a, b, out;
+};
+
+class Mat4InverseKernel : public Kernel
+{
+public:
+	Mat4InverseKernel(bool _scalar) : scalar(_scalar) { sizes.push_back(64); sizes.push_back(1024); sizes.push_back(16384); }
+
+	const char * get_name() const { return scalar ? "mat4_inverse_scalar" : "mat4_inverse"; }
+
+	size_t setup(int size)
+	{
+		in.resize(size); out.resize(size);
+		for(int i = 0; i < size; ++i) in[i] = random_mat4();
+		return size;
+	}
+
+	void run()
+	{
+		if(scalar) {
+			for(size_t i = 0; i < out.size(); ++i) out[i] = in[i].inverse_scalar();
+		} else {
+			for(size_t i = 0; i < out.size(); ++i) out[i] = in[i].inverse();
+		}
+		sink = out.back()(3,0);
+	}
+
+private:
+	bool scalar;
+	std::vector<Mat4> in, out;
+};
+
+class Mat4TransformKernel : public Kernel
+{
+public:
+	Mat4TransformKernel(bool _scalar) : scalar(_scalar) { sizes.push_back(1024); sizes.push_back(16384); sizes.push_back(262144); }
+
+	const char * get_name() const { return scalar ? "mat4_transform_point_scalar" : "mat4_transform_point"; }
+
+	size_t setup(int size)
+	{
+		m = random_mat4();
+		in.resize(size); out.resize(size);
+		for(int i = 0; i < size; ++i) in[i] = random_vec3();
+		return size;
+	}
+
+	void run()
+	{
+		if(scalar) {
+			for(size_t i = 0; i < out.size(); ++i) out[i] = m.transform_scalar(Vec4(in[i], 1)).projection();
+		} else {
+			for(size_t i = 0; i < out.size(); ++i) out[i] = m.transform_point(in[i]);
+		}
+		sink = out.back().x;
+	}
+
+private:
+	bool scalar;
+	Mat4 m;
+	std::vector<Vec3> in, out;
+};
+
+class AffineMultiplyKernel : public Kernel
+{
+public:
+	AffineMultiplyKernel() { sizes.push_back(64); sizes.push_back(1024); sizes.push_back(16384); }
+
+	const char * get_name() const { return "affine_multiply"; }
+
+	size_t setup(int size)
+	{
+		a.resize(size); b.resize(size); out.resize(size);
+		for(int i = 0; i < size; ++i) { a[i] = Affine3(random_mat4()); b[i] = Affine3(random_mat4()); }
+		return size;
+	}
+
+	void run()
+	{
+		for(size_t i = 0; i < out.size(); ++i) out[i] = a[i] * b[i];
+		sink = out.back()(3,0);
+	}
+
+private:
+	std::vector<Affine3> a, b, out;
+};
+
+class AffineInverseKernel : public Kernel
+{
+public:
+	AffineInverseKernel(bool _rigid) : rigid(_rigid) { sizes.push_back(64); sizes.push_back(1024); sizes.push_back(16384); }
+
+	const char * get_name() const { return rigid ? "affine_rigid_inverse" : "affine_inverse"; }
+
+	size_t setup(int size)
+	{
+		in.resize(size); out.resize(size);
+		for(int i = 0; i < size; ++i) in[i] = Affine3(random_mat4());
+		return size;
+	}
+
+	void run()
+	{
+		if(rigid) {
+			for(size_t i = 0; i < out.size(); ++i) out[i] = in[i].rigid_inverse();
+		} else {
+			for(size_t i = 0; i < out.size(); ++i) out[i] = in[i].inverse();
+		}
+		sink = out.back()(3,0);
+	}
+
+private:
+	bool rigid;
+	std::vector<Affine3> in, out;
+};
+
+class AffineTransformKernel : public Kernel
+{
+public:
+	AffineTransformKernel(bool _batch) : batch(_batch) { sizes.push_back(1024); sizes.push_back(16384); sizes.push_back(262144); }
+
+	const char * get_name() const { return batch ? "affine_transform_point_batch" : "affine_transform_point"; }
+
+	size_t setup(int size)
+	{
+		t = Affine3(random_mat4());
+		in.resize(size); out.resize(size);
+		for(int i = 0; i < size; ++i) in[i] = random_vec3();
+		return size;
+	}
+
+	void run()
+	{
+		if(batch) {
+			transform_points(t, &in[0], &out[0], in.size());
+		} else {
+			for(size_t i = 0; i < out.size(); ++i) out[i] = t.transform_point(in[i]);
+		}
+		sink = out.back().x;
+	}
+
+private:
+	bool batch;
+	Affine3 t;
+	std::vector<Vec3> in, out;
+};
+
+class ClipTransformKernel : public Kernel
+{
+public:
+	ClipTransformKernel(bool _batch) : batch(_batch) { sizes.push_back(1024); sizes.push_back(16384); sizes.push_back(262144); }
+
+	const char * get_name() const { return batch ? "mat4_transform_clip_batch" : "mat4_transform_clip"; }
+
+	size_t setup(int size)
+	{
+		m = Mat4::perspective(PI / 3.0, 4.0 / 3.0, 0.1, 100.0) * random_mat4();
+		in.resize(size); out.resize(size);
+		for(int i = 0; i < size; ++i) in[i] = random_vec3();
+		return size;
+	}
+
+	void run()
+	{
+		if(batch) {
+			transform_points(m, &in[0], &out[0], in.size());
+		} else {
+			for(size_t i = 0; i < out.size(); ++i) out[i] = m * Vec4(in[i], 1);
+		}
+		sink = out.back().w;
+	}
+
+private:
+	bool batch;
+	Mat4 m;
+	std::vector<Vec3> in;
+	std::vector<Vec4> out;
+};
+
+class AabbTransformKernel : public Kernel
+{
+public:
+	AabbTransformKernel(bool _batch) : batch(_batch) { sizes.push_back(64); sizes.push_back(1024); sizes.push_back(16384); }
+
+	const char * get_name() const { return batch ? "aabb_transform_batch" : "aabb_transform"; }
+
+	size_t setup(int size)
+	{
+		t.resize(size); in.resize(size); out.resize(size);
+		for(int i = 0; i < size; ++i) {
+			t[i] = Affine3(random_mat4());
+			const Vec3 center = random_vec3();
+			in[i] = AABB(center, center).expand(random_real(0.1, 1));
+		}
+		return size;
+	}
+
+	void run()
+	{
+		if(batch) {
+			transform_aabbs(&t[0], &in[0], &out[0], in.size());
+		} else {
+			for(size_t i = 0; i < out.size(); ++i) out[i] = in[i].transform(t[i]);
+		}
+		sink = out.back().max.x;
+	}
+
+private:
+	bool batch;
+	std::vector<Affine3> t;
+	std::vector<AABB> in, out;
+};
+
+class FrustumCullKernel : public Kernel
+{
+public:
+	FrustumCullKernel(bool _batch) : batch(_batch) { sizes.push_back(64); sizes.push_back(1024); sizes.push_back(16384); }
+
+	const char * get_name() const { return batch ? "frustum_cull_batch" : "frustum_cull"; }
+
+	size_t setup(int size)
+	{
+		frustum = Frustum(Mat4::perspective(PI / 3.0, 4.0 / 3.0, 0.1, 100.0) * random_mat4());
+		boxes.resize(size); visible.resize(size);
+		for(int i = 0; i < size; ++i) {
+			const Vec3 center = random_vec3() * 20;
+			boxes[i] = AABB(center, center).expand(random_real(0.1, 1));
+		}
+		return size;
+	}
+
+	void run()
+	{
+		size_t count = 0;
+		if(batch) {
+			count = frustum.cull(&boxes[0], boxes.size(), &visible[0]);
+		} else {
+			for(size_t i = 0; i < boxes.size(); ++i) {
+				if(frustum.intersects(boxes[i])) visible[count++] = i;
+			}
+		}
+		sink = count;
+	}
+
+private:
+	bool batch;
+	Frustum frustum;
+	std::vector<AABB> boxes;
+	std::vector<size_t> visible;
+};
+
+class Vec3NormalizeKernel : public Kernel
+{
+public:
+	Vec3NormalizeKernel(bool _wide) : wide(_wide) { sizes.push_back(64); sizes.push_back(1024); sizes.push_back(16384); }
+
+	const char * get_name() const { return wide ? "vec3_normalize_wide" : "vec3_normalize"; }
+
+	size_t setup(int size)
+	{
+		in.resize(size); out.resize(size);
+		for(int i = 0; i < size; ++i) in[i] = random_vec3() + Vec3(2, 0, 0);
+		return size;
+	}
+
+	void run()
+	{
+		size_t i = 0;
+		if(wide) {
+			for(; i + Vec3x8::WIDTH <= in.size(); i += Vec3x8::WIDTH) {
+				Vec3x8::load(&in[i]).unit().store(&out[i]);
+			}
+		}
+		for(; i < in.size(); ++i) out[i] = in[i].unit();
+		sink = out.back().x;
+	}
+
+private:
+	bool wide;
+	std::vector<Vec3> in, out;
+};
+
+class QuatMultiplyKernel : public Kernel
+{
+public:
+	QuatMultiplyKernel(bool _batch) : batch(_batch) { sizes.push_back(64); sizes.push_back(1024); sizes.push_back(16384); }
+
+	const char * get_name() const { return batch ? "quat_multiply_batch" : "quat_multiply"; }
+
+	size_t setup(int size)
+	{
+		a.resize(size); b.resize(size); out.resize(size);
+		for(int i = 0; i < size; ++i) { a[i] = random_quat(); b[i] = random_quat(); }
+		return size;
+	}
+
+	void run()
+	{
+		if(batch) {
+			multiply_quats(&a[0], &b[0], &out[0], out.size());
+		} else {
+			for(size_t i = 0; i < out.size(); ++i) out[i] = a[i] * b[i];
+		}
+		sink = out.back().w;
+	}
+
+private:
+	bool batch;
+	std::vector<Quat> a, b, out;
+};
+
+class QuatRotateKernel : public Kernel
+{
+public:
+	QuatRotateKernel(bool _batch) : batch(_batch) { sizes.push_back(1024); sizes.push_back(16384); sizes.push_back(262144); }
+
+	const char * get_name() const { return batch ? "quat_rotate_batch" : "quat_rotate"; }
+
+	size_t setup(int size)
+	{
+		q = random_quat();
+		in.resize(size); out.resize(size);
+		for(int i = 0; i < size; ++i) in[i] = random_vec3();
+		return size;
+	}
+
+	void run()
+	{
+		if(batch) {
+			rotate_points(q, &in[0], &out[0], out.size());
+		} else {
+			for(size_t i = 0; i < out.size(); ++i) out[i] = q * in[i];
+		}
+		sink = out.back().x;
+	}
+
+private:
+	bool batch;
+	Quat q;
+	std::vector<Vec3> in, out;
+};
+
+class QuatToMatrixKernel : public Kernel
+{
+public:
+	QuatToMatrixKernel(bool _batch) : batch(_batch) { sizes.push_back(64); sizes.push_back(1024); sizes.push_back(16384); }
+
+	const char * get_name() const { return batch ? "quat_to_matrix_batch" : "quat_to_matrix"; }
+
+	size_t setup(int size)
+	{
+		in.resize(size); out.resize(size); out3.resize(size);
+		for(int i = 0; i < size; ++i) in[i] = random_quat();
+		return size;
+	}
+
+	void run()
+	{
+		if(batch) {
+			quats_to_matrices(&in[0], &out3[0], out3.size());
+			sink = out3.back()(0,0);
+		} else {
+			for(size_t i = 0; i < out.size(); ++i) in[i].to_matrix(out[i]);
+			sink = out.back()(0,0);
+		}
+	}
+
+private:
+	bool batch;
+	std::vector<Quat> in;
+	std::vector<Mat4> out;
+	std::vector<Mat3> out3;
+};
+
+class QuatSlerpKernel : public Kernel
+{
+public:
+	enum Method { NLERP, SLERP, SLERP_FAST };
+
+	QuatSlerpKernel(Method _method) : method(_method) { sizes.push_back(64); sizes.push_back(1024); sizes.push_back(16384); }
+
+	const char * get_name() const
+	{
+		switch(method) {
+		case NLERP: return "quat_nlerp_batch";
+		case SLERP: return "quat_slerp_batch";
+		default: return "quat_slerp_fast_batch";
+		}
+	}
+
+	size_t setup(int size)
+	{
+		a.resize(size); b.resize(size); t.resize(size); out.resize(size);
+		for(int i = 0; i < size; ++i) { a[i] = random_quat(); b[i] = random_quat(); t[i] = random_real(0, 1); }
+		return size;
+	}
+
+	void run()
+	{
+		switch(method) {
+		case NLERP: nlerp_quats(&a[0], &b[0], &t[0], &out[0], out.size()); break;
+		case SLERP: slerp_quats(&a[0], &b[0], &t[0], &out[0], out.size()); break;
+		default: slerp_quats_fast(&a[0], &b[0], &t[0], &out[0], out.size()); break;
+		}
+		sink = out.back().w;
+	}
+
+private:
+	Method method;
+	std::vector<Quat> a, b, out;
+	std::vector<real_t> t;
+};
+
+class TriangleTangentKernel : public Kernel
+{
+public:
+	TriangleTangentKernel() { sizes.push_back(1024); sizes.push_back(16384); sizes.push_back(131072); }
+
+	const char * get_name() const { return "triangle_tangent"; }
+
+	size_t setup(int size)
+	{
+		faces.resize(size);
+		for(int i = 0; i < size; ++i)
+		{
+			for(int j = 0; j < 3; ++j)
+			{
+				faces[i].vertices[j] = random_vec3();
+				faces[i].normals[j] = random_vec3().normalize();
+				faces[i].tcoords[j] = Vec2(random_real(0, 1), random_real(0, 1));
+			}
+		}
+		return size;
+	}
+
+	void run()
+	{
+		for(size_t i = 0; i < faces.size(); ++i)
+		{
+			calculate_triangle_tangent(faces[i].vertices, faces[i].normals,
+			                           faces[i].tcoords, faces[i].tangents);
+		}
+		sink = faces.back().tangents[0].x;
+	}
+
+private:
+	std::vector<Face> faces;
+};
+
+/* sizes are subdivision levels, elements are the faces generated */
+class SphereSubdivideKernel : public Kernel
+{
+public:
+	SphereSubdivideKernel() { sizes.push_back(2); sizes.push_back(4); sizes.push_back(6); }
+
+	const char * get_name() const { return "sphere_subdivide"; }
+
+	size_t setup(int size)
+	{
+		divisions = size;
+		return 8 << (2 * size);
+	}
+
+	void run()
+	{
+		// A new mesh each time, as in gen_sphere
+		Mesh mesh;
+		gen_sphere_mesh(mesh, divisions);
+		sink = mesh.tcoords.back().x;
+	}
+
+private:
+	int divisions;
+};
+
+/* sizes are subdivision levels, elements are the vertices uploaded */
+class TriangleSoupCreateKernel : public Kernel
+{
+public:
+	TriangleSoupCreateKernel() { sizes.push_back(2); sizes.push_back(4); sizes.push_back(6); }
+
+	const char * get_name() const { return "triangle_soup_create"; }
+
+	bool needs_gl() const { return true; }
+
+	size_t setup(int size)
+	{
+		mesh.clear();
+		gen_sphere_mesh(mesh, size);
+		return mesh.get_num_of_vertices();
+	}
+
+	void run()
+	{
+		TriangleSoup soup(&scene, mesh);
+		sink = soup.bounds.max.x;
+	}
+
+	void teardown() { mesh.clear(); }
+
+private:
+	Scene scene;
+	Mesh mesh;
+};
+
+/* converting vertex streams to the packed element types, as on upload */
+class PackKernel : public Kernel
+{
+public:
+	enum Stream { NORMALS, TANGENTS, TCOORDS };
+
+	PackKernel(Stream _stream) : stream(_stream) { sizes.push_back(64); sizes.push_back(1024); sizes.push_back(16384); }
+
+	const char * get_name() const
+	{
+		static const char * names[] = { "pack_normals", "pack_tangents", "pack_tcoords" };
+		return names[stream];
+	}
+
+	size_t setup(int size)
+	{
+		normals.resize(size); tangents.resize(size); tcoords.resize(size);
+		packed_normals.resize(size); packed_tangents.resize(size); packed_tcoords.resize(size);
+		for(int i = 0; i < size; ++i) {
+			normals[i] = random_vec3().normalize();
+			tangents[i] = Vec4(random_vec3().normalize(), i % 2 ? 1 : -1);
+			tcoords[i] = Vec2(random_real(0, 4), random_real(0, 4));
+		}
+		return size;
+	}
+
+	void run()
+	{
+		const size_t n = normals.size();
+		switch(stream) {
+		case NORMALS:
+			convert_elements(&normals[0], &packed_normals[0], n);
+			sink = packed_normals.back().x;
+			break;
+		case TANGENTS:
+			convert_elements(&tangents[0], &packed_tangents[0], n);
+			sink = (real_t)packed_tangents.back().bits;
+			break;
+		case TCOORDS:
+			convert_elements(&tcoords[0], &packed_tcoords[0], n);
+			sink = packed_tcoords.back().x;
+			break;
+		}
+	}
+
+private:
+	Stream stream;
+	std::vector<Vec3> normals;
+	std::vector<Vec4> tangents;
+	std::vector<Vec2> tcoords;
+	std::vector<OctNormal> packed_normals;
+	std::vector<PackedTangent> packed_tangents;
+	std::vector<Half2> packed_tcoords;
+};
+
+/* the waves of the water scene */
+static WaterSurface::WavePointList water_scene_waves()
+{
+	WaterSurface::WavePointList wave_points;
+
+	WaterSurface::WavePoint p;
+	p.position = Vec2(.42,.56);
+	p.falloff = 2;
+	p.coefficient = .3;
+	p.timerate = -6*PI;
+	p.period = 16*PI;
+	wave_points.push_back(p);
+
+	p.position = Vec2(-.58,-.30);
+	p.falloff = 2;
+	p.coefficient = .3;
+	p.timerate = -8*PI;
+	p.period = 20*PI;
+	wave_points.push_back(p);
+
+	return wave_points;
+}
+
+/* sizes are the mesh resolution, elements are the vertices updated */
+class WaterSurfaceTickKernel : public Kernel
+{
+public:
+	WaterSurfaceTickKernel() : wave_points(water_scene_waves()), time(0)
+	{
+		sizes.push_back(32); sizes.push_back(120); sizes.push_back(240);
+	}
+
+	const char * get_name() const { return "water_surface_tick"; }
+
+	bool needs_gl() const { return true; }
+
+	size_t setup(int size)
+	{
+		water.reset(new WaterSurface(&scene, wave_points, size, size));
+		return (size+1) * (size+1);
+	}
+
+	void run()
+	{
+		time += 1.0 / 30.0;
+		water->tick(time);
+	}
+
+	void teardown() { water.reset(); }
+
+private:
+	Scene scene;
+	WaterSurface::WavePointList wave_points;
+	boost::shared_ptr<WaterSurface> water;
+	real_t time;
+};
+
+/* the functions of fastmath.h, for the math kernels and --verify */
+enum MathFunction { MATH_FN_EXP, MATH_FN_SIN, MATH_FN_COS, MATH_FN_ATAN2, MATH_FN_ACOS, MATH_FN_RSQRT, MATH_FN_COUNT };
+
+static const char * math_function_names[MATH_FN_COUNT] = { "exp", "sin", "cos", "atan2", "acos", "rsqrt" };
+static const char * math_accuracy_names[] = { "exact", "fast", "approx" };
+
+/* each function of x, or of (y, x) for atan2, for real_t and the wide types */
+struct MathExp { template<MathAccuracy A, typename F> static F eval(const F &, const F &x) { return math_exp<A>(x); } };
+struct MathSin { template<MathAccuracy A, typename F> static F eval(const F &, const F &x) { return math_sin<A>(x); } };
+struct MathCos { template<MathAccuracy A, typename F> static F eval(const F &, const F &x) { return math_cos<A>(x); } };
+struct MathAtan2 { template<MathAccuracy A, typename F> static F eval(const F &y, const F &x) { return math_atan2<A>(y, x); } };
+struct MathAcos { template<MathAccuracy A, typename F> static F eval(const F &, const F &x) { return math_acos<A>(x); } };
+struct MathRsqrt { template<MathAccuracy A, typename F> static F eval(const F &, const F &x) { return math_rsqrt<A>(x); } };
+
+template<MathAccuracy A, typename Function>
+static void eval_math(const real_t *y, const real_t *x, real_t *out, size_t n, bool wide)
+{
+	size_t i = 0;
+	if(wide) {
+		for(; i + Floatx8::WIDTH <= n; i += Floatx8::WIDTH) {
+			Function::template eval<A>(Floatx8::load(y + i), Floatx8::load(x + i)).store(out + i);
+		}
+	}
+	for(; i < n; ++i) out[i] = Function::template eval<A>(y[i], x[i]);
+}
+
+template<MathAccuracy A>
+static void eval_math(MathFunction f, const real_t *y, const real_t *x, real_t *out, size_t n, bool wide)
+{
+	switch(f) {
+	case MATH_FN_EXP: eval_math<A, MathExp>(y, x, out, n, wide); break;
+	case MATH_FN_SIN: eval_math<A, MathSin>(y, x, out, n, wide); break;
+	case MATH_FN_COS: eval_math<A, MathCos>(y, x, out, n, wide); break;
+	case MATH_FN_ATAN2: eval_math<A, MathAtan2>(y, x, out, n, wide); break;
+	case MATH_FN_ACOS: eval_math<A, MathAcos>(y, x, out, n, wide); break;
+	default: eval_math<A, MathRsqrt>(y, x, out, n, wide); break;
+	}
+}
+
+/* out[i] = f(x[i]) or f(y[i], x[i]), eight at a time if wide */
+static void eval_math(MathFunction f, MathAccuracy a, const real_t *y, const real_t *x, real_t *out, size_t n, bool wide)
+{
+	switch(a) {
+	case MATH_EXACT: eval_math<MATH_EXACT>(f, y, x, out, n, wide); break;
+	case MATH_FAST: eval_math<MATH_FAST>(f, y, x, out, n, wide); break;
+	default: eval_math<MATH_APPROX>(f, y, x, out, n, wide); break;
+	}
+}
+
+/* arguments spread over the range fastmath.h documents for f */
+static void random_math_args(MathFunction f, std::vector<real_t> &y, std::vector<real_t> &x)
+{
+	for(size_t i = 0; i < x.size(); ++i) {
+		// in [0, 1] with more bits than one random_real
+		const real_t u = (random_real(0, 65535) + random_real(0, 1)) / 65536;
+		y[i] = 1;
+
+		switch(f) {
+		case MATH_FN_EXP: x[i] = -87 + 175 * u; break;
+		case MATH_FN_SIN:
+		case MATH_FN_COS:
+			// mostly the first few turns
+			x[i] = i % 4 == 0 ? 16384 * u - 8192 : 8 * PI * u - 4 * PI;
+			break;
+		case MATH_FN_ATAN2:
+			y[i] = random_real(-1, 1) * exp(random_real(-10, 10));
+			x[i] = random_real(-1, 1) * exp(random_real(-10, 10));
+			break;
+		case MATH_FN_ACOS: x[i] = 2 * u - 1; break;
+		default: x[i] = exp(138 * u - 69); break;
+		}
+	}
+}
+
+/* each element is f of its arguments, timed for each accuracy */
+class MathKernel : public Kernel
+{
+public:
+	MathKernel(MathFunction _function, MathAccuracy _accuracy)
+	: function(_function),
+	  accuracy(_accuracy),
+	  name(std::string("math_") + math_function_names[_function] + "_" + math_accuracy_names[_accuracy])
+	{
+		sizes.push_back(1024); sizes.push_back(16384);
+	}
+
+	const char * get_name() const { return name.c_str(); }
+
+	size_t setup(int size)
+	{
+		y.resize(size); x.resize(size); out.resize(size);
+		random_math_args(function, y, x);
+		return size;
+	}
+
+	void run()
+	{
+		eval_math(function, accuracy, &y[0], &x[0], &out[0], out.size(), true);
+		sink = out.back();
+	}
+
+private:
+	MathFunction function;
+	MathAccuracy accuracy;
+	std::string name;
+	std::vector<real_t> y, x, out;
+};
+
+/* largest difference between two matrices, relative to the largest element */
+static double relative_error(const Mat4 &a, const Mat4 &reference)
+{
+	double error = 0, scale = 0;
+
+	for(int i = 0; i < Mat4::SIZE; ++i)
+	{
+		error = std::max(error, (double)fabs(a.m[i] - reference.m[i]));
+		scale = std::max(scale, (double)fabs(reference.m[i]));
+	}
+
+	return (scale > 0) ? error / scale : error;
+}
+
+/* distance from the identity of m times the inverse which m_inverse_t is
+   the transpose of, as returned by Mat4::inverse() */
+static double inverse_residual(const Mat4 &m, const Mat4 &m_inverse_t)
+{
+	return relative_error(m.multiply_scalar(m_inverse_t.transpose()), Mat4::Identity);
+}
+
+/**
+ * Checks the SIMD Mat4 operations against the scalar reference on random
+ * inputs. Products and transforms must agree to within a few float
+ * roundings. Inverses of affine transforms must agree closely; inverses of
+ * arbitrary matrices, which may be badly conditioned, must leave a residual
+ * within four times the scalar one. Returns false on any failure.
+ */
+static bool verify_mat4(int count)
+{
+	const double tolerance = 1e-5;
+	double multiply_error = 0, transform_error = 0, affine_error = 0;
+	int inverse_failures = 0;
+
+	for(int n = 0; n < count; ++n)
+	{
+		Mat4 a, b;
+		for(int i = 0; i < Mat4::SIZE; ++i) {
+			a.m[i] = random_real(-4, 4);
+			b.m[i] = random_real(-4, 4);
+		}
+
+		multiply_error = std::max(multiply_error, relative_error(a * b, a.multiply_scalar(b)));
+
+		const Vec4 v(random_vec3(), random_real(-1, 1));
+		const Vec4 t = a * v, t_ref = a.transform_scalar(v);
+		const Mat4 tm(t.x, 0, 0, 0, t.y, 0, 0, 0, t.z, 0, 0, 0, t.w, 0, 0, 0);
+		const Mat4 tm_ref(t_ref.x, 0, 0, 0, t_ref.y, 0, 0, 0, t_ref.z, 0, 0, 0, t_ref.w, 0, 0, 0);
+		transform_error = std::max(transform_error, relative_error(tm, tm_ref));
+
+		const Mat4 affine = random_mat4();
+		affine_error = std::max(affine_error, relative_error(affine.inverse(), affine.inverse_scalar()));
+
+		const double residual = inverse_residual(a, a.inverse());
+		const double residual_ref = inverse_residual(a, a.inverse_scalar());
+		if(!(residual <= std::max(4 * residual_ref, tolerance))) {
+			inverse_failures++;
+		}
+	}
+
+	printf("verify mat4 (%s, %d cases): multiply %g, transform %g, affine inverse %g,"
+	       " general inverse worse than scalar in %d\n",
+	       Mat4::is_simd() ? "simd" : "scalar", count,
+	       multiply_error, transform_error, affine_error, inverse_failures);
+
+	// a few badly conditioned matrices lose more digits in either order of
+	// operations, so allow one in a thousand
+	return multiply_error < tolerance &&
+	       transform_error < tolerance &&
+	       affine_error < tolerance &&
+	       inverse_failures <= count / 1000;
+}
+
+/**
+ * Checks Affine3 against the equivalent Mat4 operations, on random
+ * transforms with scale. Returns false on any failure.
+ */
+static bool verify_affine(int count)
+{
+	const double tolerance = 1e-5;
+	double multiply_error = 0, inverse_error = 0, rigid_error = 0, normal_error = 0;
+
+	for(int n = 0; n < count; ++n)
+	{
+		Mat4 a = random_mat4(), b = random_mat4();
+		const Mat4 rigid = a;
+
+		for(int i = 0; i < 3; ++i) {
+			const real_t scale = random_real(0.25, 4);
+			a(i,0) *= scale; a(i,1) *= scale; a(i,2) *= scale;
+		}
+
+		const Affine3 fa(a), fb(b);
+
+		multiply_error = std::max(multiply_error, relative_error((fa * fb).to_mat4(), a.multiply_scalar(b)));
+
+		// Mat4::inverse() returns the transpose of the inverse
+		inverse_error = std::max(inverse_error, relative_error(fa.inverse().to_mat4(), a.inverse_scalar().transpose()));
+		rigid_error = std::max(rigid_error, relative_error(Affine3(rigid).rigid_inverse().to_mat4(), rigid.inverse_scalar().transpose()));
+
+		const Vec3 normal = fa.transform_normal(Vec3::UnitY);
+		const Vec3 normal_ref = a.inverse_scalar().transform_scalar(Vec4(Vec3::UnitY, 0)).xyz();
+		const Mat4 nm(normal.x, 0, 0, 0, normal.y, 0, 0, 0, normal.z, 0, 0, 0, 0, 0, 0, 0);
+		const Mat4 nm_ref(normal_ref.x, 0, 0, 0, normal_ref.y, 0, 0, 0, normal_ref.z, 0, 0, 0, 0, 0, 0, 0);
+		normal_error = std::max(normal_error, relative_error(nm, nm_ref));
+	}
+
+	printf("verify affine (%d cases): multiply %g, inverse %g, rigid inverse %g, normal %g\n",
+	       count, multiply_error, inverse_error, rigid_error, normal_error);
+
+	return multiply_error < tolerance &&
+	       inverse_error < tolerance &&
+	       rigid_error < tolerance &&
+	       normal_error < tolerance;
+}
+
+/* largest difference between two vectors, relative to the larger of one
+   and the largest element */
+static double relative_error(const Vec3 &a, const Vec3 &reference)
+{
+	double error = 0, scale = 1;
+
+	for(int i = 0; i < 3; ++i)
+	{
+		error = std::max(error, (double)fabs(a[i] - reference[i]));
+		scale = std::max(scale, (double)fabs(reference[i]));
+	}
+
+	return error / scale;
+}
+
+/**
+ * Checks the batch transforms against transforming one value at a time.
+ * The count is not rounded to the SIMD width, so the tails are covered.
+ * Returns false on any failure.
+ */
+static bool verify_batch(int count)
+{
+	const double tolerance = 1e-5;
+	double affine_error = 0, projective_error = 0, clip_error = 0, box_error = 0;
+
+	std::vector<Vec3> in(count), out(count), normals(count);
+	std::vector<Vec4> clip(count);
+	std::vector<Affine3> transforms(count, Affine3::Identity);
+	std::vector<AABB> boxes(count), out_boxes(count);
+
+	for(int i = 0; i < count; ++i) {
+		in[i] = random_vec3() * 10;
+		transforms[i] = Affine3(random_mat4());
+		boxes[i] = AABB(in[i], in[i]).expand(random_real(0.1, 1));
+	}
+
+	Mat4 scaled = random_mat4();
+	scaled(0,0) *= 2; scaled(1,1) *= 0.5;
+	const Affine3 t(scaled);
+	const Mat4 projective = Mat4::perspective(PI / 3.0, 4.0 / 3.0, 0.1, 100.0) * scaled;
+
+	transform_points(t, &in[0], &out[0], count);
+	for(int i = 0; i < count; ++i) affine_error = std::max(affine_error, relative_error(out[i], t.transform_point(in[i])));
+	transform_vectors(t, &in[0], &out[0], count);
+	for(int i = 0; i < count; ++i) affine_error = std::max(affine_error, relative_error(out[i], t.transform_vector(in[i])));
+	transform_normals(t, &in[0], &normals[0], count);
+	for(int i = 0; i < count; ++i) affine_error = std::max(affine_error, relative_error(normals[i], t.transform_normal(in[i])));
+
+	transform_points(projective, &in[0], &out[0], count);
+	for(int i = 0; i < count; ++i) {
+		// near w = 0 the divide amplifies any difference in rounding, such
+		// as from fused multiply-adds in one tier and not another
+		if(fabs((projective * Vec4(in[i], 1)).w) < 1) continue;
+		projective_error = std::max(projective_error, relative_error(out[i], projective.transform_point(in[i])));
+	}
+	transform_points(scaled, &in[0], &out[0], count);
+	for(int i = 0; i < count; ++i) projective_error = std::max(projective_error, relative_error(out[i], scaled.transform_point(in[i])));
+
+	transform_points(projective, &in[0], &clip[0], count);
+	for(int i = 0; i < count; ++i) {
+		const Vec4 reference = projective * Vec4(in[i], 1);
+		clip_error = std::max(clip_error, relative_error(clip[i].xyz(), reference.xyz()));
+		clip_error = std::max(clip_error, relative_error(Vec3(clip[i].w, 0, 0), Vec3(reference.w, 0, 0)));
+	}
+
+	transform_aabbs(&transforms[0], &boxes[0], &out_boxes[0], count);
+	for(int i = 0; i < count; ++i) {
+		const AABB reference = boxes[i].transform(transforms[i]);
+		box_error = std::max(box_error, relative_error(out_boxes[i].min, reference.min));
+		box_error = std::max(box_error, relative_error(out_boxes[i].max, reference.max));
+	}
+	transform_aabbs(t, &boxes[0], &out_boxes[0], count);
+	for(int i = 0; i < count; ++i) {
+		const AABB reference = boxes[i].transform(t);
+		box_error = std::max(box_error, relative_error(out_boxes[i].min, reference.min));
+		box_error = std::max(box_error, relative_error(out_boxes[i].max, reference.max));
+	}
+
+	printf("verify batch (%d cases): affine %g, projective %g, clip %g, boxes %g\n",
+	       count, affine_error, projective_error, clip_error, box_error);
+
+	return affine_error < tolerance &&
+	       projective_error < tolerance &&
+	       clip_error < tolerance &&
+	       box_error < tolerance;
+}
+
+/* largest error of the Vec3 operations of one width of wide vector */
+template<typename V>
+static double verify_wide_vec3(const std::vector<Vec3> &a, const std::vector<Vec3> &b)
+{
+	double error = 0;
+	Vec3 out[V::WIDTH];
+
+	for(size_t i = 0; i + V::WIDTH <= a.size(); i += V::WIDTH)
+	{
+		const V va = V::load(&a[i]), vb = V::load(&b[i]);
+		const typename V::Mask facing = va.dot(vb) < 0;
+
+		for(int op = 0; op < 5; ++op)
+		{
+			switch(op)
+			{
+			case 0: va.cross(vb).store(out); break;
+			case 1: va.unit().store(out); break;
+			case 2: va.minimum(vb).store(out); break;
+			case 3: va.maximum(vb).store(out); break;
+			case 4: select(facing, va, -vb).store(out); break;
+			}
+
+			for(int lane = 0; lane < V::WIDTH; ++lane)
+			{
+				const Vec3 &x = a[i+lane], &y = b[i+lane];
+				const Vec3 reference = op == 0 ? x.cross(y) :
+				                       op == 1 ? x.unit() :
+				                       op == 2 ? x.minimum(y) :
+				                       op == 3 ? x.maximum(y) :
+				                       (x.dot(y) < 0 ? x : -y);
+				error = std::max(error, relative_error(out[lane], reference));
+			}
+		}
+
+		for(int lane = 0; lane < V::WIDTH; ++lane)
+		{
+			error = std::max(error, (double)fabs(va.distance(vb)[lane] - a[i+lane].distance(b[i+lane])));
+		}
+	}
+
+	for(size_t i = 0; i + 2*V::WIDTH <= a.size(); i += 2*V::WIDTH)
+	{
+		V even, odd;
+		V::load_pairs(&a[i], even, odd);
+
+		for(int lane = 0; lane < V::WIDTH; ++lane)
+		{
+			error = std::max(error, relative_error(even[lane], a[i+2*lane]));
+			error = std::max(error, relative_error(odd[lane], a[i+2*lane+1]));
+		}
+	}
+
+	return error;
+}
+
+/**
+ * Checks the wide vector types and the frustum culling built on them against
+ * the scalar operations, at both widths. Returns false on any failure.
+ */
+static bool verify_wide(int count)
+{
+	const double tolerance = 1e-5;
+
+	std::vector<Vec3> a(count, Vec3::Zero), b(count, Vec3::Zero);
+	std::vector<AABB> boxes(count, AABB::Empty);
+	std::vector<size_t> visible(count);
+
+	for(int i = 0; i < count; ++i) {
+		a[i] = random_vec3() * 10;
+		b[i] = random_vec3();
+		boxes[i] = AABB(a[i], a[i] + b[i].abs() * 3);
+		// some empty boxes, which always intersect
+		if(i % 16 == 0) std::swap(boxes[i].min, boxes[i].max);
+	}
+
+	const double error4 = verify_wide_vec3<Vec3x4>(a, b);
+	const double error8 = verify_wide_vec3<Vec3x8>(a, b);
+
+	// the batch cull must keep exactly the boxes that intersects() keeps
+	const Frustum frustum(Mat4::perspective(PI / 3.0, 4.0 / 3.0, 0.1, 100.0) * random_mat4());
+	const size_t culled = frustum.cull(&boxes[0], count, &visible[0]);
+	int cull_failures = 0;
+	size_t v = 0;
+	for(int i = 0; i < count; ++i) {
+		const bool batch = v < culled && visible[v] == (size_t)i;
+		if(batch) ++v;
+		if(batch != frustum.intersects(boxes[i])) ++cull_failures;
+	}
+
+	printf("verify wide (%d cases): x4 %g, x8 %g, cull %d failures of %d visible\n",
+	       count, error4, error8, cull_failures, (int)culled);
+
+	return error4 < tolerance && error8 < tolerance && cull_failures == 0;
+}
+
+/* largest difference between the components of two quaternions */
+static double quat_error(const Quat &a, const Quat &reference)
+{
+	return std::max(std::max(fabs(a.w - reference.w), fabs(a.x - reference.x)),
+	                std::max(fabs(a.y - reference.y), fabs(a.z - reference.z)));
+}
+
+/**
+ * Checks the batch rotations against one rotation at a time, and the fast
+ * slerp against the exact one. The fast slerp is allowed its documented
+ * 0.05 degrees. Returns false on any failure.
+ */
+static bool verify_quat(int count)
+{
+	const double tolerance = 1e-5, slerp_tolerance = 0.05;
+	double multiply_error = 0, rotate_error = 0, matrix_error = 0, nlerp_error = 0, slerp_error = 0, fast_degrees = 0;
+
+	std::vector<Quat> a(count), b(count), out(count);
+	std::vector<Vec3> in(count, Vec3::Zero), translations(count, Vec3::Zero), points(count, Vec3::Zero);
+	std::vector<Mat3> matrices(count);
+	std::vector<Affine3> transforms(count, Affine3::Identity);
+	std::vector<real_t> t(count);
+
+	for(int i = 0; i < count; ++i) {
+		a[i] = random_quat();
+		// some pairs close together, and some on opposite hemispheres
+		b[i] = i % 8 == 0 ? a[i] * Quat(random_vec3().normalize(), random_real(0, 0.01)) : random_quat();
+		if(i % 3 == 0) b[i] = Quat(-b[i].w, -b[i].x, -b[i].y, -b[i].z);
+		in[i] = random_vec3() * 10;
+		translations[i] = random_vec3() * 10;
+		t[i] = random_real(0, 1);
+	}
+	t[0] = 0; t[count-1] = 1;
+
+	multiply_quats(&a[0], &b[0], &out[0], count);
+	for(int i = 0; i < count; ++i) multiply_error = std::max(multiply_error, quat_error(out[i], a[i] * b[i]));
+
+	rotate_points(a[0], &in[0], &points[0], count);
+	for(int i = 0; i < count; ++i) rotate_error = std::max(rotate_error, relative_error(points[i], a[0] * in[i]));
+	rotate_points(&a[0], &in[0], &points[0], count);
+	for(int i = 0; i < count; ++i) rotate_error = std::max(rotate_error, relative_error(points[i], a[i] * in[i]));
+
+	quats_to_matrices(&a[0], &matrices[0], count);
+	quats_to_transforms(&a[0], &translations[0], &transforms[0], count);
+	for(int i = 0; i < count; ++i) {
+		const Mat4 reference = a[i].to_matrix();
+		for(int row = 0; row < 3; ++row) {
+			for(int col = 0; col < 3; ++col) {
+				matrix_error = std::max(matrix_error, (double)fabs(matrices[i](col,row) - reference(col,row)));
+				matrix_error = std::max(matrix_error, (double)fabs(transforms[i].rows[row][col] - reference(col,row)));
+			}
+		}
+		matrix_error = std::max(matrix_error, relative_error(transforms[i].get_translation(), translations[i]));
+	}
+
+	nlerp_quats(&a[0], &b[0], &t[0], &out[0], count);
+	for(int i = 0; i < count; ++i) nlerp_error = std::max(nlerp_error, quat_error(out[i], nlerp(a[i], b[i], t[i])));
+
+	std::vector<Quat> exact(count);
+	slerp_quats(&a[0], &b[0], &t[0], &exact[0], count);
+	slerp_quats_fast(&a[0], &b[0], &t[0], &out[0], count);
+	for(int i = 0; i < count; ++i) {
+		slerp_error = std::max(slerp_error, quat_error(exact[i], slerp(a[i], b[i], t[i])));
+		// the angle between the rotations is about four times the
+		// distance between the quaternions, as long as it is small
+		double distance = 0;
+		for(int j = 0; j < 4; ++j) distance += ((double)out[i][j] - exact[i][j]) * ((double)out[i][j] - exact[i][j]);
+		fast_degrees = std::max(fast_degrees, 4 * asin(sqrt(distance) / 2) * 180 / PI);
+	}
+
+	printf("verify quat (%d cases): multiply %g, rotate %g, matrix %g, nlerp %g, slerp %g, fast slerp %g degrees\n",
+	       count, multiply_error, rotate_error, matrix_error, nlerp_error, slerp_error, fast_degrees);
+
+	return multiply_error < tolerance &&
+	       rotate_error < tolerance &&
+	       matrix_error < tolerance &&
+	       nlerp_error < tolerance &&
+	       slerp_error == 0 &&
+	       fast_degrees < slerp_tolerance;
+}
+
+/* the angle between two directions in degrees, accurate when it is small */
+static double degrees_between(const Vec3 &a, const Vec3 &b)
+{
+	const double dx = (double)a.x / a.magnitude() - (double)b.x / b.magnitude();
+	const double dy = (double)a.y / a.magnitude() - (double)b.y / b.magnitude();
+	const double dz = (double)a.z / a.magnitude() - (double)b.z / b.magnitude();
+	return 2 * asin(std::min(sqrt(dx*dx + dy*dy + dz*dz) / 2, 1.0)) * 180 / PI;
+}
+
+/* the largest angles between unpacked normals and the originals that
+   gltypes.h documents */
+static const double octnormal_degrees = 0.004;
+static const double packed_tangent_degrees = 0.25;
+
+/**
+ * Checks the water kernels of the current tier against the scalar code of
+ * WaterSurface, on columns of every length up to 256. The normals are
+ * packed, so are checked to within the error of OctNormal. Returns false on
+ * any failure.
+ */
+static bool verify_water(int count)
+{
+	const WaterKernels *kernels = water_kernels();
+	if(!kernels) {
+		printf("verify water: no kernels at this tier\n");
+		return true;
+	}
+
+	const double tolerance = 1e-5;
+	double height_error = 0, normal_error = 0;
+	int cases = 0;
+
+	const WaterSurface::WavePointList waves = water_scene_waves();
+
+	for(int resz = 1; cases < count; resz = resz % 256 + 1) {
+		std::vector<real_t> column(resz+1), prev(resz+1), next(resz+1);
+		std::vector<PackedNormalElement> normals(resz+1, PackedNormalElement(Vec3::UnitY));
+		const real_t x = random_real(-1, 1), time = random_real(0, 10);
+
+		const int heights = kernels->heights(&waves[0], waves.size(), x, resz, time, &column[0]);
+		for(int z = 0; z < heights; ++z) {
+			// as WaterSurface::get_height
+			const Vec2 pos(x, (real_t)z/resz*2-1);
+			real_t h = 0;
+			for(size_t i = 0; i < waves.size(); ++i) {
+				const WaterSurface::WavePoint &p = waves[i];
+				real_t r = pos.distance(p.position);
+				h += p.coefficient * math_exp<MATH_FAST>(-p.falloff * r) *
+					math_sin<MATH_FAST>(p.period * r + p.timerate * time);
+			}
+			height_error = std::max(height_error, (double)fabs(column[z] - h));
+		}
+
+		for(int z = 0; z <= resz; ++z) {
+			prev[z] = random_real(-1, 1);
+			next[z] = random_real(-1, 1);
+		}
+
+		const real_t ny = 8.0 / resz;
+		const int end = kernels->normals(&prev[0], &column[0], &next[0], resz, ny, &normals[0]);
+		for(int z = 1; z < end; ++z) {
+			// as WaterSurface::compute_normal
+			const Vec3 reference = math_normalize<MATH_FAST>(Vec3(prev[z] - next[z], ny, column[z-1] - column[z+1]));
+			normal_error = std::max(normal_error, degrees_between(normals[z].to_vec(), reference));
+		}
+
+		cases += resz + 1;
+	}
+
+	printf("verify water (%d cases): heights %g, normals %g degrees\n", cases, height_error, normal_error);
+
+	return height_error < tolerance && normal_error < octnormal_degrees;
+}
+
+/**
+ * Packs normals, tangents and texture coordinates with the kernels of the
+ * current tier, and checks that they match the scalar conversions exactly
+ * and that what the shaders would unpack is within the errors documented
+ * in gltypes.h. Returns false on any failure.
+ */
+static bool verify_packing(int count)
+{
+	std::vector<Vec3> normals(count);
+	std::vector<Vec4> tangents(count);
+	std::vector<Vec2> tcoords(count);
+
+	for(int i = 0; i < count; ++i) {
+		normals[i] = random_vec3().normalize();
+		tangents[i] = Vec4(random_vec3().normalize(), random_real(-1, 1) < 0 ? -1 : 1);
+		tcoords[i] = Vec2(random_real(-8, 8), random_real(0, 1));
+	}
+
+	// the poles, the folds of the octahedron and the edges of the square
+	static const real_t special[][3] = {
+		{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+		{ 1, 1, 0 }, { -1, 1, 0 }, { 1, -1, 0 }, { -1, -1, 0 },
+		{ 1, 1, 1 }, { -1, -1, -1 }, { 1, -1, -1 }, { 1e-4, 1e-4, -1 },
+	};
+	const int num_special = std::min(count, (int)(sizeof special / sizeof special[0]));
+	for(int i = 0; i < num_special; ++i) {
+		normals[i] = Vec3(special[i][0], special[i][1], special[i][2]).normalize();
+		tangents[i] = Vec4(normals[i], -1);
+		tcoords[i] = Vec2(special[i][0], special[i][2] * 1e-5);
+	}
+
+	std::vector<OctNormal> packed_normals(count);
+	std::vector<PackedTangent> packed_tangents(count);
+	std::vector<Half2> packed_tcoords(count);
+	convert_elements(&normals[0], &packed_normals[0], count);
+	convert_elements(&tangents[0], &packed_tangents[0], count);
+	convert_elements(&tcoords[0], &packed_tcoords[0], count);
+
+	int mismatches = 0, handedness = 0;
+	double normal_degrees = 0, tangent_degrees = 0, tcoord_error = 0;
+
+	for(int i = 0; i < count; ++i) {
+		const OctNormal n(normals[i]);
+		const PackedTangent t(tangents[i]);
+		const Half2 uv(tcoords[i]);
+		if(n.x != packed_normals[i].x || n.y != packed_normals[i].y) ++mismatches;
+		if(t.bits != packed_tangents[i].bits) ++mismatches;
+		if(uv.x.bits != packed_tcoords[i].x.bits || uv.y.bits != packed_tcoords[i].y.bits) ++mismatches;
+
+		normal_degrees = std::max(normal_degrees, degrees_between(packed_normals[i].to_vec(), normals[i]));
+
+		const Vec4 tangent = packed_tangents[i].to_vec();
+		tangent_degrees = std::max(tangent_degrees, degrees_between(tangent.xyz(), tangents[i].xyz()));
+		if(tangent.w != tangents[i].w) ++handedness;
+
+		// relative to the coordinate, or to a repeat of the texture
+		const Vec2 unpacked = packed_tcoords[i].to_vec();
+		tcoord_error = std::max(tcoord_error, fabs((double)unpacked.x - tcoords[i].x) / std::max(fabs((double)tcoords[i].x), 1.0));
+		tcoord_error = std::max(tcoord_error, fabs((double)unpacked.y - tcoords[i].y) / std::max(fabs((double)tcoords[i].y), 1.0));
+	}
+
+	printf("verify packing (%d cases): %d mismatches, normals %g degrees, tangents %g degrees, %d handedness, tcoords %g\n",
+	       count, mismatches, normal_degrees, tangent_degrees, handedness, tcoord_error);
+
+	return mismatches == 0 &&
+	       handedness == 0 &&
+	       normal_degrees < octnormal_degrees &&
+	       tangent_degrees < packed_tangent_degrees &&
+	       tcoord_error <= 1.0 / 2048;
+}
+
+/**
+ * Rasterizes a wall in front of the camera with SoftwareOcclusionCuller, on
+ * the calling thread and on worker threads, and checks which boxes it
+ * reports hidden: only those entirely behind the wall, or off-screen. Boxes
+ * partly behind it, in front of it, beside it or crossing the near plane
+ * must stay visible. Returns false on any failure.
+ */
+static bool verify_occlusion()
+{
+	// 90 degrees vertically at z = -10 spans y in [-10, 10] and x in [-20, 20]
+	const Mat4 view_proj = Mat4::perspective(PI / 2, 2, 0.1, 100);
+
+	// a wall over x and y in [-5, 5] at z = -10, so it hides what lies
+	// behind it with |x| and |y| under half the distance
+	const Vec3 wall[6] = {
+		Vec3(-5, -5, -10), Vec3( 5, -5, -10), Vec3( 5,  5, -10),
+		Vec3(-5, -5, -10), Vec3( 5,  5, -10), Vec3(-5,  5, -10),
+	};
+
+	struct Case { const char *name; AABB box; bool visible; };
+	const Case cases[] = {
+		{ "behind",        AABB(Vec3(-1, -1, -22), Vec3( 1,  1, -18)), false },
+		{ "partly behind", AABB(Vec3( 6, -1, -22), Vec3(12,  1, -18)), true },
+		{ "in front",      AABB(Vec3(-1, -1,  -6), Vec3( 1,  1,  -4)), true },
+		{ "beside",        AABB(Vec3(14, -1, -22), Vec3(16,  1, -18)), true },
+		{ "near plane",    AABB(Vec3(-1, -1,  -1), Vec3( 1,  1,   1)), true },
+		{ "off-screen",    AABB(Vec3(99, -1, -22), Vec3(101, 1, -18)), false },
+		{ "empty",         AABB::Empty,                                true },
+	};
+	const int num_cases = (int)(sizeof cases / sizeof cases[0]);
+
+	SoftwareOcclusionCuller serial(256, 128, 0), threaded(256, 128, 3);
+	serial.add_occluder(wall, 6, Affine3::Identity);
+	threaded.add_occluder(wall, 6, Affine3::Identity);
+	serial.render(view_proj);
+	threaded.render(view_proj);
+
+	int failures = 0;
+
+	for(int i = 0; i < num_cases; ++i) {
+		const bool visible = serial.is_visible(cases[i].box);
+		if(visible != cases[i].visible || threaded.is_visible(cases[i].box) != visible) {
+			printf("verify occlusion: %s box is %s\n", cases[i].name, visible ? "visible" : "hidden");
+			++failures;
+		}
+	}
+
+	// the bands of the worker threads make up the same depth buffer
+	const size_t pixels = serial.get_width() * serial.get_height();
+	const bool same = std::equal(serial.get_depth_buffer(), serial.get_depth_buffer() + pixels,
+	                             threaded.get_depth_buffer());
+
+	printf("verify occlusion (%d boxes): %d failures, threaded depth %s\n",
+	       num_cases, failures, same ? "matches" : "differs");
+
+	return failures == 0 && same;
+}
+
+/* the largest errors of one function at one accuracy */
+struct MathError
+{
+	double ulp, absolute, relative;
+
+	MathError() : ulp(0), absolute(0), relative(0) {}
+
+	void add(real_t value, double exact)
+	{
+		// the spacing of floats around the exact value, or of the smallest
+		// normal floats below them
+		int exponent;
+		frexp(exact, &exponent);
+		const double spacing = ldexp(1.0, std::max(exponent, -125) - 24);
+
+		const double error = fabs(value - exact);
+		ulp = std::max(ulp, error / spacing);
+		absolute = std::max(absolute, error);
+		if(exact != 0) relative = std::max(relative, error / fabs(exact));
+	}
+};
+
+/**
+ * Measures every function of fastmath.h at every accuracy against the C
+ * library in double, scalar and wide, and checks the errors documented in
+ * fastmath.h. Returns false on any failure.
+ */
+static bool verify_fastmath(int count)
+{
+	enum Metric { ULP, ABSOLUTE, RELATIVE };
+	static const Metric fast_metric[MATH_FN_COUNT] = { ULP, ABSOLUTE, ABSOLUTE, ULP, ULP, ULP };
+	static const double fast_bound[MATH_FN_COUNT] = { 1, 8e-8, 8e-8, 4, 2, 4 };
+	static const Metric approx_metric[MATH_FN_COUNT] = { RELATIVE, ABSOLUTE, ABSOLUTE, ABSOLUTE, ABSOLUTE, RELATIVE };
+	static const double approx_bound[MATH_FN_COUNT] = { 7.5e-5, 1.6e-4, 1.6e-4, 6.1e-4, 6.8e-5, 3.7e-4 };
+
+	bool ok = true;
+	printf("verify fastmath (%d cases per function):\n", count);
+
+	for(int f = 0; f < MATH_FN_COUNT; ++f) {
+		const MathFunction function = (MathFunction)f;
+		std::vector<real_t> y(count), x(count), out(count);
+		random_math_args(function, y, x);
+
+		// the ends of the ranges, and the axes for atan2
+		static const real_t edges[][2] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 0, -1 }, { -1, 0 }, { 1, 1 }, { -1, -1 } };
+		if(function == MATH_FN_ATAN2) {
+			for(int i = 0; i < 7 && i < count; ++i) { y[i] = edges[i][0]; x[i] = edges[i][1]; }
+		} else if(function == MATH_FN_ACOS && count >= 3) {
+			x[0] = -1; x[1] = 0; x[2] = 1;
+		}
+
+		std::vector<double> exact(count);
+		for(int i = 0; i < count; ++i) {
+			switch(function) {
+			case MATH_FN_EXP: exact[i] = exp((double)x[i]); break;
+			case MATH_FN_SIN: exact[i] = sin((double)x[i]); break;
+			case MATH_FN_COS: exact[i] = cos((double)x[i]); break;
+			case MATH_FN_ATAN2: exact[i] = atan2((double)y[i], (double)x[i]); break;
+			case MATH_FN_ACOS: exact[i] = acos((double)x[i]); break;
+			default: exact[i] = 1 / sqrt((double)x[i]); break;
+			}
+		}
+
+		for(int a = MATH_EXACT; a <= MATH_APPROX; ++a) {
+			MathError error;
+			for(int wide = 0; wide < 2; ++wide) {
+				eval_math(function, (MathAccuracy)a, &y[0], &x[0], &out[0], count, wide != 0);
+				for(int i = 0; i < count; ++i) error.add(out[i], exact[i]);
+			}
+
+			printf("  %-6s %-7s %11.3g ulp %11.3g abs %11.3g rel\n", math_function_names[f],
+			       math_accuracy_names[a], error.ulp, error.absolute, error.relative);
+
+			if(a == MATH_EXACT) continue;
+
+			const Metric metric = a == MATH_FAST ? fast_metric[f] : approx_metric[f];
+			const double bound = a == MATH_FAST ? fast_bound[f] : approx_bound[f];
+			const double measured = metric == ULP ? error.ulp : metric == ABSOLUTE ? error.absolute : error.relative;
+			ok &= measured <= bound;
+		}
+	}
+
+	return ok;
+}
+
+/* settings, all of which can be changed on the command line */
+struct MicrobenchOptions
+{
+	std::string filter;
+	int samples;
+	double sample_ms;
+	double warmup_ms;
+	bool gl;
+	int verify; // random cases checked before timing, or 0
+	SimdTier simd;
+
+	MicrobenchOptions()
+	: samples(21),
+	  sample_ms(5),
+	  warmup_ms(100),
+	  gl(false),
+	  verify(0),
+	  simd(simd_tier()) {}
+};
+
+/**
+ * Times one kernel at one size and prints a row of the results table.
+ * Each sample times enough runs to take about sample_ms, after warming up
+ * the caches and branch predictors for warmup_ms.
+ */
+static void measure(Kernel &kernel, int size, const MicrobenchOptions &options)
+{
+	const size_t elements = kernel.setup(size);
+
+	// Warm up, and find how many runs fill a sample
+	int warmup_runs = 0;
+	const trace_time_t warmup_begin = trace_now();
+	trace_time_t elapsed = 0;
+
+	do {
+		kernel.run();
+		warmup_runs++;
+		elapsed = trace_now() - warmup_begin;
+	} while(elapsed < options.warmup_ms * 1000);
+
+	const double run_us = (double)elapsed / warmup_runs;
+	const int runs = std::max(1, (int)ceil(options.sample_ms * 1000 / std::max(run_us, 0.001)));
+
+	std::vector<double> ns(options.samples), cycles(options.samples);
+
+	for(int s = 0; s < options.samples; ++s)
+	{
+		const trace_time_t begin = trace_now();
+		const unsigned long long cycles_begin = read_cycles();
+
+		for(int r = 0; r < runs; ++r) {
+			kernel.run();
+		}
+
+		const unsigned long long cycles_end = read_cycles();
+		const trace_time_t end = trace_now();
+
+		ns[s] = (end - begin) * 1000.0 / runs;
+		cycles[s] = (double)(cycles_end - cycles_begin) / runs;
+	}
+
+	kernel.teardown();
+
+	double mean = 0, variance = 0;
+	for(int s = 0; s < options.samples; ++s) mean += ns[s];
+	mean /= options.samples;
+	for(int s = 0; s < options.samples; ++s) variance += (ns[s] - mean) * (ns[s] - mean);
+	const double stddev = sqrt(variance / options.samples);
+
+	std::sort(ns.begin(), ns.end());
+	std::sort(cycles.begin(), cycles.end());
+
+	const double median_ns = ns[ns.size() / 2];
+	const double median_cycles = cycles[cycles.size() / 2];
+
+	printf("%-22s %8d %9lu %12.0f %12.0f %10.2f",
+	       kernel.get_name(), size, (unsigned long)elements,
+	       median_ns, ns.front(), median_ns / elements);
+
+	if(HAVE_CYCLE_COUNTER) {
+		printf(" %12.2f", median_cycles / elements);
+	} else {
+		printf(" %12s", "n/a");
+	}
+
+	printf(" %6.1f%%\n", (mean > 0) ? 100 * stddev / mean : 0.0);
+	fflush(stdout);
+}
+
+/**
+ * Prints program usage.
+ */
+static void print_usage(const char* progname)
+{
+	std::cout << "Usage: " << progname << " [OPTIONS]...\nOptions:\n" \
+		"\t-h / --help\n" \
+		"\t\tPrint usage information and exit.\n" \
+		"\t--filter [TEXT]\n" \
+		"\t\tRuns only kernels whose names contain TEXT.\n" \
+		"\t--samples [COUNT]\n" \
+		"\t\tSamples per kernel and size. The default is 21.\n" \
+		"\t--sample-ms [MILLISECONDS]\n" \
+		"\t\tApproximate length of each sample. The default is 5.\n" \
+		"\t--warmup-ms [MILLISECONDS]\n" \
+		"\t\tTime spent running each kernel before sampling. The default\n" \
+		"\t\tis 100.\n" \
+		"\t--gl\n" \
+		"\t\tAlso runs kernels which fill buffer objects, in a headless\n" \
+		"\t\tOpenGL context. Without it no context is created.\n" \
+		"\t--verify [COUNT]\n" \
+		"\t\tFirst checks the SIMD, affine, batch, wide, quaternion and water\n" \
+		"\t\tmath against the scalar reference on COUNT random inputs, at\n" \
+		"\t\tevery SIMD tier this CPU can run, and the errors of each\n" \
+		"\t\tfunction of vec/fastmath.h, and exits with 3 if any exceeds\n" \
+		"\t\tits bound.\n" \
+		"\t--simd [TIER]\n" \
+		"\t\tRuns the kernels built for TIER: scalar, sse or avx2. The\n" \
+		"\t\tdefault is the best this CPU can run, or CRYSTAL_SIMD.\n" \
+		"\tReports the median and minimum time per run, the median time\n" \
+		"\tand time stamp counter cycles per element, and the relative\n" \
+		"\tstandard deviation of the samples.\n";
+}
+
+// the command line options
+const char* OPT_HP[] = { "-h", "--help" };
+#define OPTLEN_HP 2
+const char* OPT_FI[] = { "-filter", "--filter" };
+#define OPTLEN_FI 2
+const char* OPT_SA[] = { "-samples", "--samples" };
+#define OPTLEN_SA 2
+const char* OPT_SM[] = { "-sample-ms", "--sample-ms" };
+#define OPTLEN_SM 2
+const char* OPT_WM[] = { "-warmup-ms", "--warmup-ms" };
+#define OPTLEN_WM 2
+const char* OPT_GL[] = { "-gl", "--gl" };
+#define OPTLEN_GL 2
+const char* OPT_VE[] = { "-verify", "--verify" };
+#define OPTLEN_VE 2
+const char* OPT_SI[] = { "-simd", "--simd" };
+#define OPTLEN_SI 2
+
+/**
+ * Parses the command line. Returns false if it could not be parsed.
+ */
+static bool parse_options(int argc, char *argv[], MicrobenchOptions &options)
+{
+	int index;
+
+	if ((index = getarg(argc, argv, OPTLEN_FI, OPT_FI)) != -1) {
+		if (index >= argc - 1) {
+			std::cerr << "Error: cannot parse filter.\n";
+			return false;
+		}
+		options.filter = argv[index+1];
+	}
+
+	if ((index = getarg(argc, argv, OPTLEN_SA, OPT_SA)) != -1) {
+		if (index >= argc - 1 ||
+				sscanf(argv[index+1], "%d", &options.samples) != 1 || options.samples < 1) {
+			std::cerr << "Error: cannot parse sample count.\n";
+			return false;
+		}
+	}
+
+	if ((index = getarg(argc, argv, OPTLEN_SM, OPT_SM)) != -1) {
+		if (index >= argc - 1 ||
+				sscanf(argv[index+1], "%lf", &options.sample_ms) != 1 || options.sample_ms <= 0) {
+			std::cerr << "Error: cannot parse sample length.\n";
+			return false;
+		}
+	}
+
+	if ((index = getarg(argc, argv, OPTLEN_WM, OPT_WM)) != -1) {
+		if (index >= argc - 1 ||
+				sscanf(argv[index+1], "%lf", &options.warmup_ms) != 1 || options.warmup_ms < 0) {
+			std::cerr << "Error: cannot parse warm-up length.\n";
+			return false;
+		}
+	}
+
+	if ((index = getarg(argc, argv, OPTLEN_VE, OPT_VE)) != -1) {
+		if (index >= argc - 1 ||
+				sscanf(argv[index+1], "%d", &options.verify) != 1 || options.verify < 1) {
+			std::cerr << "Error: cannot parse verification count.\n";
+			return false;
+		}
+	}
+
+	if ((index = getarg(argc, argv, OPTLEN_SI, OPT_SI)) != -1) {
+		if (index >= argc - 1 || !simd_parse_tier(argv[index+1], &options.simd)) {
+			std::cerr << "Error: cannot parse SIMD tier.\n";
+			return false;
+		}
+		if (options.simd > simd_detect_tier()) {
+			std::cerr << "Error: this CPU cannot run " << argv[index+1] << " kernels.\n";
+			return false;
+		}
+	}
+
+	options.gl = getarg(argc, argv, OPTLEN_GL, OPT_GL) != -1;
+
+	return true;
+}
+
+/**
+ * Microbenchmark entry point.
+ */
+int main(int argc, char *argv[])
+{
+	MicrobenchOptions options;
+
+	if (getarg(argc, argv, OPTLEN_HP, OPT_HP) != -1) {
+		print_usage(argv[0]);
+		return 0;
+	}
+
+	if (!parse_options(argc, argv, options)) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	// Buffer objects need a context, which must exist before they do
+	boost::shared_ptr<HeadlessDevice> device;
+	if (options.gl) {
+		device.reset(new HeadlessDevice(ivec2(64, 64)));
+
+		if (!device->is_valid()) {
+			return 2;
+		}
+	}
+
+	// Zones would only add overhead to the kernels being timed
+	trace_enabled = false;
+
+	if (options.verify) {
+		// Run every check, so that all of the errors are reported
+		const bool mat4_ok = verify_mat4(options.verify);
+		const bool affine_ok = verify_affine(options.verify);
+		const bool fastmath_ok = verify_fastmath(options.verify);
+		bool kernels_ok = true;
+
+		// the kernels of every tier, the scalar code included
+		for (int tier = SIMD_SCALAR; tier <= simd_detect_tier(); ++tier) {
+			simd_force_tier((SimdTier)tier);
+			printf("%s kernels:\n", simd_tier_name((SimdTier)tier));
+			kernels_ok &= verify_batch(options.verify);
+			kernels_ok &= verify_wide(options.verify);
+			kernels_ok &= verify_quat(options.verify);
+			kernels_ok &= verify_water(options.verify);
+			kernels_ok &= verify_packing(options.verify);
+			kernels_ok &= verify_occlusion();
+		}
+
+		if (!mat4_ok || !affine_ok || !fastmath_ok || !kernels_ok) {
+			std::cerr << "ERROR: Optimized math disagrees with the scalar reference" << std::endl;
+			return 3;
+		}
+	}
+
+	std::vector< boost::shared_ptr<Kernel> > kernels;
+	kernels.push_back(boost::shared_ptr<Kernel>(new Mat4MultiplyKernel(false)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new Mat4MultiplyKernel(true)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new Mat4InverseKernel(false)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new Mat4InverseKernel(true)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new Mat4TransformKernel(false)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new Mat4TransformKernel(true)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new AffineMultiplyKernel()));
+	kernels.push_back(boost::shared_ptr<Kernel>(new AffineInverseKernel(false)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new AffineInverseKernel(true)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new AffineTransformKernel(false)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new AffineTransformKernel(true)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new ClipTransformKernel(false)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new ClipTransformKernel(true)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new AabbTransformKernel(false)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new AabbTransformKernel(true)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new FrustumCullKernel(false)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new FrustumCullKernel(true)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new Vec3NormalizeKernel(false)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new Vec3NormalizeKernel(true)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new QuatMultiplyKernel(false)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new QuatMultiplyKernel(true)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new QuatRotateKernel(false)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new QuatRotateKernel(true)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new QuatToMatrixKernel(false)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new QuatToMatrixKernel(true)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new QuatSlerpKernel(QuatSlerpKernel::NLERP)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new QuatSlerpKernel(QuatSlerpKernel::SLERP)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new QuatSlerpKernel(QuatSlerpKernel::SLERP_FAST)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new TriangleTangentKernel()));
+	kernels.push_back(boost::shared_ptr<Kernel>(new SphereSubdivideKernel()));
+	kernels.push_back(boost::shared_ptr<Kernel>(new TriangleSoupCreateKernel()));
+	kernels.push_back(boost::shared_ptr<Kernel>(new PackKernel(PackKernel::NORMALS)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new PackKernel(PackKernel::TANGENTS)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new PackKernel(PackKernel::TCOORDS)));
+	kernels.push_back(boost::shared_ptr<Kernel>(new WaterSurfaceTickKernel()));
+	for(int f = 0; f < MATH_FN_COUNT; ++f) {
+		for(int a = MATH_EXACT; a <= MATH_APPROX; ++a) {
+			kernels.push_back(boost::shared_ptr<Kernel>(new MathKernel((MathFunction)f, (MathAccuracy)a)));
+		}
+	}
+
+	simd_force_tier(options.simd);
+	printf("simd tier %s, this CPU can run %s\n",
+	       simd_tier_name(options.simd), simd_tier_name(simd_detect_tier()));
+
+	printf("%-22s %8s %9s %12s %12s %10s %12s %7s\n",
+	       "kernel", "size", "elements", "median_ns", "min_ns",
+	       "ns/elem", "cycles/elem", "rsd");
+
+	for (size_t i = 0; i < kernels.size(); ++i) {
+		Kernel &kernel = *kernels[i];
+
+		if (!options.filter.empty() &&
+		    std::string(kernel.get_name()).find(options.filter) == std::string::npos)
+			continue;
+
+		if (kernel.needs_gl() && !options.gl) {
+			std::cerr << "skipping " << kernel.get_name() << ", which needs --gl" << std::endl;
+			continue;
+		}
+
+		for (size_t j = 0; j < kernel.sizes.size(); ++j) {
+			measure(kernel, kernel.sizes[j], options);
+		}
+	}
+
+	// Release buffer objects while the context still exists
+	kernels.clear();
+
+	return 0;
+}
@@ -1,4 +1,8 @@
-attribute vec4 Tangent;
+attribute vec2 PackedNormal;
+attribute vec4 Tangent; // packed or four floats, see decode_tangent
+
+vec3 decode_octahedral(vec2 e);
+vec4 decode_tangent(vec4 p);
 
 varying vec3 vertex_to_light;
 varying vec3 eye_to_vertex;
@@ -21,9 +25,10 @@ void main()
 	eye_to_vertex = -vec3(vertex_in_eye_space);
 	
 	// TBN will transform from eye-space to tangent-space
-	vec3 n = vec3(gl_NormalMatrix * gl_Normal);
-	vec3 t = vec3(gl_NormalMatrix * Tangent.xyz);
-	vec3 b = cross(n, t) * Tangent.w;
+	vec4 tangent = decode_tangent(Tangent);
+	vec3 n = vec3(gl_NormalMatrix * decode_octahedral(PackedNormal));
+	vec3 t = vec3(gl_NormalMatrix * tangent.xyz);
+	vec3 b = cross(n, t) * tangent.w;
 	mat3 to_tangent_space = mat3(vec3(t.x, b.x, n.x),
 	                             vec3(t.y, b.y, n.y),
 	                             vec3(t.z, b.z, n.z)); // transpose(mat3(t, b, n));
@@ -1,3 +1,7 @@
+attribute vec2 PackedNormal;
+
+vec3 decode_octahedral(vec2 e);
+
 uniform mat4 wld_space_to_obj_space;
 varying vec3 refdir_in_wld_space;
 varying vec3 vertex_to_eye;
@@ -5,18 +9,19 @@ varying vec3 normal;
 
 void main()
 {	
+	vec3 obj_normal = decode_octahedral(PackedNormal);
 	vec3 vertex_in_eye_space, normal_in_eye_space;
 	vec3 vertex_in_wld_space, normal_in_wld_space;
 	
 ////////////////////////////////////////////////////////////	
 	
-	normal_in_wld_space = vec4(wld_space_to_obj_space * vec4(gl_Normal, 1.0)).xyz;
+	normal_in_wld_space = vec4(wld_space_to_obj_space * vec4(obj_normal, 1.0)).xyz;
 	vertex_in_wld_space = vec4(wld_space_to_obj_space * gl_Vertex).xyz;
 	refdir_in_wld_space = reflect(vertex_in_wld_space, normal_in_wld_space);
 	
 ////////////////////////////////////////////////////////////
 
-	normal_in_eye_space = normalize(gl_NormalMatrix * gl_Normal);
+	normal_in_eye_space = normalize(gl_NormalMatrix * obj_normal);
     vertex_in_eye_space = vec4(gl_ModelViewMatrix * gl_Vertex).xyz;
 	vertex_to_eye = -vertex_in_eye_space;
 	normal = normal_in_eye_space;
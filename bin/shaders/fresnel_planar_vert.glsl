@@ -0,0 +1,34 @@
+attribute vec2 PackedNormal;
+
+vec3 decode_octahedral(vec2 e);
+
+uniform mat4 obj_space_to_tex_space;
+varying vec4 reflection_coord;
+varying vec2 ripple;
+varying vec3 vertex_to_eye;
+varying vec3 normal;
+
+void main()
+{
+	vec3 obj_normal = decode_octahedral(PackedNormal);
+	vec3 vertex_in_eye_space, normal_in_eye_space;
+
+////////////////////////////////////////////////////////////
+
+	// Projective coordinates into the reflection texture
+	reflection_coord = obj_space_to_tex_space * gl_Vertex;
+
+	// Deviation of the surface normal from the plane's normal
+	ripple = obj_normal.xz;
+
+////////////////////////////////////////////////////////////
+
+	normal_in_eye_space = normalize(gl_NormalMatrix * obj_normal);
+	vertex_in_eye_space = vec4(gl_ModelViewMatrix * gl_Vertex).xyz;
+	vertex_to_eye = -vertex_in_eye_space;
+	normal = normal_in_eye_space;
+
+////////////////////////////////////////////////////////////
+
+	gl_Position = ftransform();
+}
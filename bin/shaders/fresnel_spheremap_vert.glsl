@@ -1,15 +1,20 @@
+attribute vec2 PackedNormal;
+
+vec3 decode_octahedral(vec2 e);
+
 varying vec3 vertex_to_eye;
 varying vec3 normal;
 
 void main()
 {	
+	vec3 obj_normal = decode_octahedral(PackedNormal);
 	vec3 eye, r;
 	
 	gl_Position = ftransform(); // Standard transformation to clip-coords
 
 	// Get the reflected eye-vector (eye-space)
 	eye = normalize(vec3(gl_ModelViewMatrix * gl_Vertex));
-	normal = normalize(gl_NormalMatrix * gl_Normal);
+	normal = normalize(gl_NormalMatrix * obj_normal);
 	r = reflect(eye, normal);
 	
     // Map the uv according to the sphere-mapping eqns on the handout
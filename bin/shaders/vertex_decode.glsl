@@ -0,0 +1,26 @@
+// Decodes the packed vertex attributes of gltypes.h. Linked into every
+// program; a vertex shader declares the functions it calls.
+
+// A direction stored as octahedral coordinates (see vec/octahedral.h)
+vec3 decode_octahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+
+	// unfold the corners, which hold the lower half
+	float t = max(-n.z, 0.0);
+	n.x -= (n.x >= 0.0) ? t : -t;
+	n.y -= (n.y >= 0.0) ? t : -t;
+	return normalize(n);
+}
+
+// A tangent as PackedTangent stores it: the direction in x and y, and its
+// handedness in the sign of w. PACKED_TANGENTS is defined by the program
+// loading this file, as 0 if the context stores tangents as four floats.
+vec4 decode_tangent(vec4 p)
+{
+#if PACKED_TANGENTS
+	return vec4(decode_octahedral(p.xy), (p.w < 0.0) ? -1.0 : 1.0);
+#else
+	return p;
+#endif
+}
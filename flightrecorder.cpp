@@ -0,0 +1,137 @@
+/** @file flightrecorder.cpp
+ *  @brief Writes a trace automatically when a frame takes unusually long
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#include "flightrecorder.h"
+#include "gputimer.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+/** Frames averaged before any frame can be a spike */
+static const int WARMUP_FRAMES = 30;
+
+/** Weight of the newest frame in the moving average */
+static const double AVERAGE_WEIGHT = 0.05;
+
+/** Number of zones listed per track in the summary */
+static const size_t SUMMARY_ZONES = 15;
+
+static void write_totals(std::ostream &o, const char * heading,
+                         const std::vector<TraceZoneTotal> &totals)
+{
+	o << heading << ":" << std::endl;
+
+	for(size_t i = 0; i < totals.size() && i < SUMMARY_ZONES; ++i)
+	{
+		o << "  " << totals[i].name
+		  << ": ms=" << totals[i].ms
+		  << " count=" << totals[i].count << std::endl;
+	}
+}
+
+FlightRecorder::FlightRecorder()
+: threshold(2.0),
+  min_spike_ms(10.0),
+  history_seconds(5.0),
+  cooldown_seconds(10.0),
+  max_dumps(10),
+  prefix("spike"),
+  frame_begin(0),
+  average_ms(0),
+  frames(0),
+  pending_frames(-1),
+  spike_begin(0),
+  spike_end(0),
+  spike_average_ms(0),
+  last_dump(0),
+  dumps(0)
+{
+	// Do Nothing
+}
+
+void FlightRecorder::end_frame()
+{
+	const trace_time_t now = trace_now();
+
+	if(!frame_begin || threshold <= 0 || !trace_enabled) {
+		frame_begin = now;
+		return;
+	}
+
+	// The differences below are unsigned, so a clock which went backwards
+	// would make a huge frame. Drop the frame and measure from now instead.
+	if(now < frame_begin || now < last_dump) {
+		frame_begin = now;
+		last_dump = last_dump ? now : 0;
+		return;
+	}
+
+	const double frame_ms = (now - frame_begin) / 1000.0;
+
+	if(pending_frames >= 0) {
+		// Wait for the GPU timings of the slow frame to be read back
+		if(pending_frames-- == 0) {
+			dump();
+			frame_begin = trace_now(); // don't count the time spent writing
+			return;
+		}
+	} else if(frames >= WARMUP_FRAMES &&
+	          frame_ms > average_ms * threshold &&
+	          frame_ms > min_spike_ms &&
+	          dumps < max_dumps &&
+	          (!last_dump || now - last_dump > cooldown_seconds * 1000000.0)) {
+		pending_frames = GpuTimer::FRAMES;
+		spike_begin = frame_begin;
+		spike_end = now;
+		spike_average_ms = average_ms;
+		frame_begin = now;
+		return; // spikes are kept out of the average
+	}
+
+	average_ms = (frames == 0) ? frame_ms : average_ms + (frame_ms - average_ms) * AVERAGE_WEIGHT;
+	frames++;
+	frame_begin = now;
+}
+
+void FlightRecorder::dump()
+{
+	std::ostringstream name;
+	name << prefix << "_" << dumps;
+
+	const std::string trace_filename = name.str() + ".json";
+	const std::string summary_filename = name.str() + ".txt";
+
+	const trace_time_t history = (trace_time_t)(history_seconds * 1000000.0);
+	const trace_time_t since = (spike_begin > history) ? spike_begin - history : 0;
+
+	trace_write_chrome_json(trace_filename.c_str(), since);
+
+	std::ofstream summary(summary_filename.c_str());
+
+	if(summary) {
+		std::vector<TraceZoneTotal> totals;
+
+		summary << "frame_ms=" << (spike_end - spike_begin) / 1000.0
+		        << " average_ms=" << spike_average_ms
+		        << " threshold=" << threshold << std::endl
+		        << "trace: " << trace_filename << std::endl << std::endl;
+
+		trace_get_totals(spike_begin, spike_end, false, totals);
+		write_totals(summary, "cpu zones in the frame", totals);
+
+		trace_get_totals(spike_begin, spike_end, true, totals);
+		write_totals(summary, "gpu zones in the frame", totals);
+	}
+
+	std::cerr << "WARNING: " << (spike_end - spike_begin) / 1000.0
+	          << " ms frame, wrote " << trace_filename
+	          << " and " << summary_filename << std::endl;
+
+	last_dump = trace_now();
+	dumps++;
+}
@@ -0,0 +1,69 @@
+/** @file flightrecorder.h
+ *  @brief Writes a trace automatically when a frame takes unusually long
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#ifndef _FLIGHT_RECORDER_H_
+#define _FLIGHT_RECORDER_H_
+
+#include "trace.h"
+#include <string>
+
+/**
+Watches frame times and, when one frame takes much longer than the moving
+average, writes the last few seconds of trace zones to PREFIX_N.json and a
+summary of the slow frame to PREFIX_N.txt.
+
+The zones are always recorded anyway (see trace.h), so watching costs a few
+arithmetic operations per frame. Files are written a few frames after the
+spike, once the GPU timings of the slow frame have been read back, and the
+time spent writing them is not counted as part of any frame.
+*/
+class FlightRecorder
+{
+public:
+	/** A frame is a spike if it takes longer than this multiple of the
+	    average frame time. Zero disables the recorder. */
+	double threshold;
+
+	/** Frames shorter than this are never spikes, in milliseconds */
+	double min_spike_ms;
+
+	/** Length of the trace written before each spike, in seconds */
+	double history_seconds;
+
+	/** Minimum time between two dumps, in seconds */
+	double cooldown_seconds;
+
+	/** Largest number of dumps written in one run */
+	int max_dumps;
+
+	/** Start of the names of the files written */
+	std::string prefix;
+
+	FlightRecorder();
+
+	/** Call once per frame, at the end of the frame */
+	void end_frame();
+
+	/** Gets the number of dumps written so far */
+	int get_dumps() const { return dumps; }
+
+private:
+	void dump();
+
+private:
+	trace_time_t frame_begin;
+	double average_ms;
+	int frames;
+
+	int pending_frames; // frames until the pending dump, or -1
+	trace_time_t spike_begin, spike_end;
+	double spike_average_ms;
+
+	trace_time_t last_dump;
+	int dumps;
+};
+
+#endif /* _FLIGHT_RECORDER_H_ */
@@ -0,0 +1,351 @@
+/** @file framegraph.cpp
+ *  @brief Orders, culls and renders passes by the render targets they use
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#include "glheaders.h"
+#include "framegraph.h"
+#include "gputimer.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include <typeinfo>
+
+/** Pinned targets first, as they cannot share, then in schedule order */
+static bool lifetime_less(const FrameGraph::Lifetime &a, const FrameGraph::Lifetime &b)
+{
+	if(a.pinned != b.pinned)
+		return a.pinned;
+
+	return a.first < b.first;
+}
+
+std::ostream& operator<<(std::ostream &o, const FrameGraphStats &stats)
+{
+	o << "passes=" << stats.passes
+	  << " culled=" << stats.culled
+	  << " feedback_reads=" << stats.feedback_reads
+	  << " transient_targets=" << stats.transient_targets
+	  << " storage_targets=" << stats.storage_targets;
+	return o;
+}
+
+FrameGraph::FrameGraph()
+{
+	// Do Nothing
+}
+
+void FrameGraph::execute(const Scene * scene)
+{
+	assert(scene);
+
+	stats = FrameGraphStats();
+	stats.passes = (int)scene->passes.size();
+
+	{
+		TRACE_ZONE("FrameGraph::schedule");
+		build(scene->passes);
+		cull();
+		sort();
+		allocate();
+	}
+
+	for(std::vector<Pass *>::const_iterator i = schedule.begin();
+		i != schedule.end(); ++i)
+	{
+		const char * name = trace_class_name(typeid(**i));
+		TraceZone zone(name);
+
+		gpu_timer.begin(GpuTimerEntry::PASS, *i, name);
+		(*i)->render(scene);
+		gpu_timer.end();
+	}
+
+	stats.culled = stats.passes - (int)schedule.size();
+	stats.storage_targets = (int)storage.size();
+}
+
+std::vector<int> FrameGraph::writers_of(const Texture * target) const
+{
+	std::vector<int> writers;
+
+	for(size_t i = 0; i < nodes.size(); ++i)
+	{
+		if(nodes[i].output.get() == target) {
+			writers.push_back((int)i);
+		}
+	}
+
+	return writers;
+}
+
+void FrameGraph::add_edge(int from, int to)
+{
+	std::vector<int> &successors = nodes[from].successors;
+
+	if(from != to && std::find(successors.begin(), successors.end(), to) == successors.end()) {
+		successors.push_back(to);
+	}
+}
+
+void FrameGraph::build(const Scene::PassList &passes)
+{
+	nodes.clear();
+	nodes.reserve(passes.size());
+
+	for(Scene::PassList::const_iterator i = passes.begin(); i != passes.end(); ++i)
+	{
+		Node node;
+		node.pass = (*i).get();
+		node.output = (*i)->get_output();
+		node.predecessors = 0;
+		node.live = false;
+		node.position = -1;
+
+		(*i)->get_inputs(node.inputs);
+
+		// A pass sampling its own target sees what it drew last time
+		node.inputs.erase(std::remove(node.inputs.begin(), node.inputs.end(), node.output),
+		                  node.inputs.end());
+
+		nodes.push_back(node);
+	}
+
+	for(size_t i = 0; i < nodes.size(); ++i)
+	{
+		// Passes drawing into the same target keep their relative order
+		for(size_t j = i + 1; j < nodes.size(); ++j)
+		{
+			if(nodes[j].output == nodes[i].output) {
+				add_edge((int)i, (int)j);
+				break;
+			}
+		}
+
+		for(RenderMethod::TextureList::const_iterator t = nodes[i].inputs.begin();
+			t != nodes[i].inputs.end(); ++t)
+		{
+			const std::vector<int> writers = writers_of((*t).get());
+
+			for(std::vector<int>::const_iterator w = writers.begin(); w != writers.end(); ++w)
+			{
+				add_edge(*w, (int)i);
+			}
+		}
+	}
+}
+
+void FrameGraph::cull()
+{
+	// Everything drawn into the framebuffer is wanted. From there, walk back
+	// to the passes which draw what the wanted passes read.
+	std::vector<int> pending = writers_of(NULL);
+
+	for(std::vector<int>::const_iterator i = pending.begin(); i != pending.end(); ++i)
+	{
+		nodes[*i].live = true;
+	}
+
+	while(!pending.empty())
+	{
+		const Node &node = nodes[pending.back()];
+		pending.pop_back();
+
+		for(RenderMethod::TextureList::const_iterator t = node.inputs.begin();
+			t != node.inputs.end(); ++t)
+		{
+			const std::vector<int> writers = writers_of((*t).get());
+
+			for(std::vector<int>::const_iterator w = writers.begin(); w != writers.end(); ++w)
+			{
+				if(!nodes[*w].live) {
+					nodes[*w].live = true;
+					pending.push_back(*w);
+				}
+			}
+		}
+	}
+}
+
+void FrameGraph::sort()
+{
+	schedule.clear();
+
+	int remaining = 0;
+
+	for(size_t i = 0; i < nodes.size(); ++i)
+	{
+		if(!nodes[i].live)
+			continue;
+
+		remaining++;
+
+		for(std::vector<int>::const_iterator j = nodes[i].successors.begin();
+			j != nodes[i].successors.end(); ++j)
+		{
+			if(nodes[*j].live) {
+				nodes[*j].predecessors++;
+			}
+		}
+	}
+
+	// Kahn's algorithm, always taking the earliest ready pass in list order
+	// so that independent passes keep the order they were given in
+	while(remaining > 0)
+	{
+		int next = -1;
+		int earliest = -1;
+
+		for(size_t i = 0; i < nodes.size(); ++i)
+		{
+			const Node &node = nodes[i];
+
+			if(!node.live || node.position >= 0)
+				continue;
+
+			if(earliest < 0) {
+				earliest = (int)i;
+			}
+
+			if(node.predecessors == 0) {
+				next = (int)i;
+				break;
+			}
+		}
+
+		// Every remaining pass waits on another, so there is a cycle. Break
+		// it at the earliest pass, which then reads last frame's contents.
+		if(next < 0) {
+			next = earliest;
+			stats.feedback_reads += nodes[next].predecessors;
+		}
+
+		Node &node = nodes[next];
+		node.position = (int)schedule.size();
+		schedule.push_back(node.pass);
+		remaining--;
+
+		for(std::vector<int>::const_iterator j = node.successors.begin();
+			j != node.successors.end(); ++j)
+		{
+			if(nodes[*j].live && nodes[*j].position < 0) {
+				nodes[*j].predecessors--;
+			}
+		}
+	}
+}
+
+void FrameGraph::allocate()
+{
+	std::vector<Lifetime> lifetimes;
+
+	for(size_t i = 0; i < nodes.size(); ++i)
+	{
+		const RenderTarget2D * target = dynamic_cast<const RenderTarget2D *>(nodes[i].output.get());
+
+		if(!nodes[i].live || !target || !target->is_transient())
+			continue;
+
+		// Only the first live writer of each target starts its lifetime
+		bool seen = false;
+		for(std::vector<Lifetime>::const_iterator l = lifetimes.begin(); l != lifetimes.end(); ++l)
+		{
+			seen = seen || (l->target == target);
+		}
+
+		if(seen)
+			continue;
+
+		Lifetime lifetime;
+		lifetime.target = target;
+		lifetime.first = INT_MAX;
+		lifetime.last = -1;
+		lifetime.pinned = false;
+
+		for(size_t j = 0; j < nodes.size(); ++j)
+		{
+			const Node &node = nodes[j];
+
+			if(!node.live)
+				continue;
+
+			if(node.output.get() == target) {
+				lifetime.first = std::min(lifetime.first, node.position);
+				lifetime.last = std::max(lifetime.last, node.position);
+			}
+		}
+
+		for(size_t j = 0; j < nodes.size(); ++j)
+		{
+			const Node &node = nodes[j];
+
+			if(!node.live)
+				continue;
+
+			for(RenderMethod::TextureList::const_iterator t = node.inputs.begin();
+				t != node.inputs.end(); ++t)
+			{
+				if((*t).get() == target) {
+					lifetime.last = std::max(lifetime.last, node.position);
+					lifetime.pinned = lifetime.pinned || (node.position < lifetime.first);
+				}
+			}
+		}
+
+		// Last frame's contents are read, so nothing else may use the
+		// storage at any point in the frame
+		if(lifetime.pinned) {
+			lifetime.first = 0;
+			lifetime.last = INT_MAX;
+		}
+
+		lifetimes.push_back(lifetime);
+	}
+
+	std::sort(lifetimes.begin(), lifetimes.end(), lifetime_less);
+
+	for(std::vector<Storage>::iterator s = storage.begin(); s != storage.end(); ++s)
+	{
+		(*s).free_after = -1;
+	}
+
+	for(std::vector<Lifetime>::const_iterator l = lifetimes.begin(); l != lifetimes.end(); ++l)
+	{
+		l->target->alias(find_storage(*l->target, l->first, l->last));
+	}
+
+	stats.transient_targets = (int)lifetimes.size();
+}
+
+const RenderTarget2D * FrameGraph::find_storage(const RenderTarget2D &target, int first, int last)
+{
+	const ivec2 &dimensions = target.get_dimensions();
+	Storage * found = NULL;
+
+	for(std::vector<Storage>::iterator s = storage.begin(); s != storage.end(); ++s)
+	{
+		const ivec2 &d = (*s).target->get_dimensions();
+
+		if(d.x != dimensions.x || d.y != dimensions.y || (*s).free_after >= first)
+			continue;
+
+		// Prefer the storage used last frame, which still holds its contents
+		if(!found || (*s).target.get() == target.get_storage()) {
+			found = &(*s);
+		}
+	}
+
+	if(!found) {
+		Storage s;
+		s.target = boost::shared_ptr<RenderTarget2D>(new RenderTarget2D(dimensions));
+		s.target->init();
+		storage.push_back(s);
+		found = &storage.back();
+	}
+
+	found->free_after = last;
+	return found->target.get();
+}
@@ -0,0 +1,122 @@
+/** @file framegraph.h
+ *  @brief Orders, culls and renders passes by the render targets they use
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#ifndef _FRAME_GRAPH_H_
+#define _FRAME_GRAPH_H_
+
+#include "scene.h"
+#include <iosfwd>
+#include <vector>
+
+/** Statistics gathered by FrameGraph over one frame */
+struct FrameGraphStats
+{
+	/** Number of passes in the scene */
+	int passes;
+
+	/** Number of passes skipped because nothing reads what they draw */
+	int culled;
+
+	/** Number of reads which had to see the previous frame's contents,
+	    because the passes read each other's targets in a cycle */
+	int feedback_reads;
+
+	/** Number of transient render targets drawn */
+	int transient_targets;
+
+	/** Number of render targets lent to transient targets */
+	int storage_targets;
+
+	FrameGraphStats()
+	: passes(0),
+	  culled(0),
+	  feedback_reads(0),
+	  transient_targets(0),
+	  storage_targets(0) {}
+};
+
+std::ostream& operator<<(std::ostream &o, const FrameGraphStats &stats);
+
+/**
+Decides each frame which passes to render, and in what order.
+
+A pass writes the target returned by Pass::get_output() and reads the targets
+returned by Pass::get_inputs(), which depend on what the pass can see this
+frame. A pass which reads a target runs after every pass which writes it, and
+passes writing the same target keep their order in Scene::passes. Otherwise,
+ties are broken by the order in Scene::passes. Where passes read each other's
+targets in a cycle, the earliest pass in Scene::passes runs first and sees
+the previous frame's contents.
+
+Passes which draw into the framebuffer are always rendered. Other passes are
+rendered only if a rendered pass reads their target this frame, e.g. a probe
+is skipped while its reflective object is out of view.
+
+Transient RenderTarget2D objects have no storage of their own. They are lent
+storage from a pool, and two transient targets of the same size share it if
+the first is read for the last time before the second is drawn.
+*/
+class FrameGraph
+{
+public:
+	FrameGraph();
+
+	/** Renders the scene's passes */
+	void execute(const Scene * scene);
+
+	/** Gets the passes rendered in the last frame, in order */
+	const std::vector<Pass *> & get_schedule() const { return schedule; }
+
+	/** Gets statistics for the last frame rendered */
+	const FrameGraphStats & get_stats() const { return stats; }
+
+	/** A transient target drawn this frame, and the part of the schedule
+	    over which its contents are needed */
+	struct Lifetime
+	{
+		const RenderTarget2D * target;
+		int first, last;
+		bool pinned; // read before it is drawn, so it keeps last frame's storage
+	};
+
+private:
+	struct Node
+	{
+		Pass * pass;
+		boost::shared_ptr<const Texture> output;
+		RenderMethod::TextureList inputs;
+		std::vector<int> successors;
+		int predecessors; // edges from live nodes not yet scheduled
+		bool live;
+		int position; // index in the schedule, or -1
+	};
+
+	struct Storage
+	{
+		boost::shared_ptr<RenderTarget2D> target;
+		int free_after; // schedule position after which it may be reused
+	};
+
+	// no meaningful assignment or copy
+	FrameGraph(const FrameGraph &r);
+	FrameGraph& operator=(const FrameGraph &r);
+
+	void build(const Scene::PassList &passes);
+	void add_edge(int from, int to);
+	void cull();
+	void sort();
+	void allocate();
+	const RenderTarget2D * find_storage(const RenderTarget2D &target, int first, int last);
+	std::vector<int> writers_of(const Texture * target) const;
+
+private:
+	std::vector<Node> nodes;
+	std::vector<Pass *> schedule;
+	std::vector<Storage> storage;
+	FrameGraphStats stats;
+};
+
+#endif /* _FRAME_GRAPH_H_ */
@@ -0,0 +1,48 @@
+/**
+ * @file mesh.cpp
+ * @brief Geometry in CPU memory, and the step which uploads it
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#include "mesh.h"
+
+void Mesh::clear()
+{
+	vertices.clear();
+	normals.clear();
+	tangents.clear();
+	tcoords.clear();
+	indices.clear();
+	bounds = AABB::Empty;
+}
+
+void Mesh::reserve(size_t num_of_vertices)
+{
+	vertices.reserve(num_of_vertices);
+	normals.reserve(num_of_vertices);
+	tangents.reserve(num_of_vertices);
+	tcoords.reserve(num_of_vertices);
+}
+
+void Mesh::add_face(const Face &face)
+{
+	vertices.insert(vertices.end(), face.vertices, face.vertices + 3);
+	normals.insert(normals.end(), face.normals, face.normals + 3);
+	tangents.insert(tangents.end(), face.tangents, face.tangents + 3);
+	tcoords.insert(tcoords.end(), face.tcoords, face.tcoords + 3);
+
+	bounds.include(face.vertices[0]);
+	bounds.include(face.vertices[1]);
+	bounds.include(face.vertices[2]);
+}
+
+void Mesh::add_faces(const std::vector<Face> &faces)
+{
+	reserve(vertices.size() + faces.size() * 3);
+
+	for(std::vector<Face>::const_iterator i = faces.begin(); i != faces.end(); ++i)
+	{
+		add_face(*i);
+	}
+}
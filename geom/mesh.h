@@ -0,0 +1,124 @@
+/**
+ * @file mesh.h
+ * @brief Geometry in CPU memory, and the step which uploads it
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _MESH_H_
+#define _MESH_H_
+
+#include "scene.h"
+#include "vec/aabb.h"
+#include <vector>
+
+/**
+Geometry held in CPU memory, with one array per vertex attribute. Filling
+a Mesh makes no OpenGL calls, so generators can run on any thread, or with
+no context at all. Only upload_stream(), e.g. through TriangleSoup, must
+run on the thread which owns the context.
+*/
+class Mesh
+{
+public:
+	std::vector<Vec3> vertices;
+	std::vector<Vec3> normals;
+	std::vector<Vec4> tangents;
+	std::vector<Vec2> tcoords;
+
+	/** Triangle list indices. Empty if the triangles are unindexed. */
+	std::vector<index_t> indices;
+
+	/** Object-space bounds of the vertices */
+	AABB bounds;
+
+	Mesh() : bounds(AABB::Empty) {}
+
+	/** Removes all vertices and indices */
+	void clear();
+
+	/** Reserves space for the given number of vertices in each stream */
+	void reserve(size_t num_of_vertices);
+
+	/** Appends the three vertices of an unindexed face */
+	void add_face(const Face &face);
+
+	/** Appends unindexed faces */
+	void add_faces(const std::vector<Face> &faces);
+
+	size_t get_num_of_vertices() const { return vertices.size(); }
+};
+
+/**
+Creates a buffer object holding a copy of a stream, or returns null if the
+stream is empty. Makes OpenGL calls.
+*/
+template<typename ELEMENT>
+boost::shared_ptr< BufferObject<ELEMENT> > upload_stream(const std::vector<ELEMENT> &stream,
+                                                         BUFFER_USAGE usage)
+{
+	boost::shared_ptr< BufferObject<ELEMENT> > buffer;
+
+	if(!stream.empty()) {
+		buffer = boost::shared_ptr< BufferObject<ELEMENT> >(new BufferObject<ELEMENT>());
+		buffer->recreate((int)stream.size(), &stream[0], usage);
+	}
+
+	return buffer;
+}
+
+/**
+Creates a buffer object holding a stream converted to ELEMENT, one of the
+types of gltypes.h, or returns null if the stream is empty. Makes OpenGL
+calls.
+*/
+template<typename ELEMENT, typename SOURCE>
+boost::shared_ptr< BufferObject<ELEMENT> > upload_stream(const std::vector<SOURCE> &stream,
+                                                         BUFFER_USAGE usage)
+{
+	boost::shared_ptr< BufferObject<ELEMENT> > buffer;
+
+	if(!stream.empty()) {
+		std::vector<ELEMENT> elements(stream.size());
+		convert_elements(&stream[0], &elements[0], stream.size());
+
+		buffer = boost::shared_ptr< BufferObject<ELEMENT> >(new BufferObject<ELEMENT>());
+		buffer->recreate((int)elements.size(), &elements[0], usage);
+	}
+
+	return buffer;
+}
+
+/**
+Uploads texture coordinates as Half2 if the format is packed and the
+context supports it, or as Float2. Returns null if the stream is empty.
+Makes OpenGL calls.
+*/
+inline boost::shared_ptr<VertexStream> upload_tcoords(const std::vector<Vec2> &tcoords,
+                                                      VertexFormat format,
+                                                      BUFFER_USAGE usage)
+{
+	if(format == VERTEX_FORMAT_PACKED && has_packed_tcoords()) {
+		return upload_stream<PackedTexCoordElement>(tcoords, usage);
+	} else {
+		return upload_stream<TexCoordElement>(tcoords, usage);
+	}
+}
+
+/**
+Uploads tangents as PackedTangent if the format is packed and the context
+supports it, or as Float4. Returns null if the stream is empty. Makes
+OpenGL calls.
+*/
+inline boost::shared_ptr<VertexStream> upload_tangents(const std::vector<Vec4> &tangents,
+                                                       VertexFormat format,
+                                                       BUFFER_USAGE usage)
+{
+	if(format == VERTEX_FORMAT_PACKED && has_packed_tangents()) {
+		return upload_stream<PackedTangentElement>(tangents, usage);
+	} else {
+		return upload_stream<TangentElement>(tangents, usage);
+	}
+}
+
+#endif /* _MESH_H_ */
@@ -70,12 +70,8 @@ static void create_square(std::vector<Face> &faces,
 	/****************************************************************************/
 }
 
-TriangleSoup gen_pool_geometry(Scene * scene)
+void gen_pool_faces(std::vector<Face> &faces)
 {
-	assert(scene);
-
-	std::vector<Face> faces;
-
 	Vec2 tcmin(0,0);
 	Vec2 tcunit(.25,.25);
 
@@ -138,6 +134,22 @@ TriangleSoup gen_pool_geometry(Scene * scene)
 	create_square(faces,
 		Vec3(0,0,2*POZ), Vec3(2*POX,0,0), Vec3(-POX,PBY,-POZ),
 		-Vec3::UnitY, tcmin, tcunit);
+}
+
+void gen_pool_mesh(Mesh &mesh)
+{
+	std::vector<Face> faces;
+	gen_pool_faces(faces);
+
+	mesh.add_faces(faces);
+}
+
+TriangleSoup gen_pool_geometry(Scene * scene)
+{
+	assert(scene);
+
+	Mesh mesh;
+	gen_pool_mesh(mesh);
 
-	return TriangleSoup(scene, faces);
+	return TriangleSoup(scene, mesh, VERTEX_FORMAT_PACKED);
 }
@@ -10,6 +10,7 @@
 #define _POOL_H_
 
 #include "scene.h"
+#include "mesh.h"
 #include "trianglesoup.h"
 
 // pool boundaries
@@ -21,6 +22,15 @@
 #define PIY (-4)
 #define PBY (-5)
 
+/** Appends the faces of the pool to faces, in world space */
+void gen_pool_faces(std::vector<Face> &faces);
+
+/** Appends the faces of the pool to mesh, in world space. Makes no OpenGL
+    calls, so it may run on any thread. */
+void gen_pool_mesh(Mesh &mesh);
+
+/** Uploads the faces of the pool, with packed normals for the bump-mapped
+    walls */
 TriangleSoup gen_pool_geometry(Scene * scene);
 
 #endif
@@ -8,6 +8,7 @@
  */
 
 #include "vec/mat.h"
+#include "vec/fastmath.h"
 #include "sphere.h"
 #include "glheaders.h"
 #include <memory.h>
@@ -19,7 +20,7 @@
  *  @param v3 Triangle Vertex 3
  *  @param depth Recursive depth subdivision
  */
-static void subdivide(std::vector<Face> &faces,
+static void subdivide(Mesh &mesh,
                       const Vec3 &v1,
                       const Vec3 &v2,
                       const Vec3 &v3,
@@ -77,20 +78,30 @@ static const Vec3 vertices[24] =
 	Vec3( 1,  0, -1).normalize(), // Bottom, South, 3
 };
 
-TriangleSoup gen_sphere(Scene * scene, int num_of_divisions)
+void gen_sphere_mesh(Mesh &mesh, int num_of_divisions)
 {
-	std::vector<Face> faces;
-	
+	assert(num_of_divisions>=0);
+
+	// 8 faces, each split into 4 per division
+	mesh.reserve(mesh.get_num_of_vertices() + (24 << (2 * num_of_divisions)));
+
 	for(int i = 0; i < 24; i+=3)
 	{
-		subdivide(faces,
+		subdivide(mesh,
 		          vertices[i+0],
 		          vertices[i+1],
 		          vertices[i+2],
 		          num_of_divisions);
 	}
+}
+
+TriangleSoup gen_sphere(Scene * scene, int num_of_divisions, VertexFormat format)
+{
+	Mesh mesh;
 	
-	return TriangleSoup(scene, faces);
+	gen_sphere_mesh(mesh, num_of_divisions);
+	
+	return TriangleSoup(scene, mesh, format);
 }
                
 static void texmap_theta(const Vec3 &v1,
@@ -100,9 +111,9 @@ static void texmap_theta(const Vec3 &v1,
                          real_t &theta2,
                          real_t &theta3)
 {
-	theta1 = atan2(v1.z, v1.x);
-	theta2 = atan2(v2.z, v2.x);
-	theta3 = atan2(v3.z, v3.x);
+	theta1 = math_atan2<MATH_FAST>(v1.z, v1.x);
+	theta2 = math_atan2<MATH_FAST>(v2.z, v2.x);
+	theta3 = math_atan2<MATH_FAST>(v3.z, v3.x);
 	
 	/* There atan function has a range from [-pi, pi]. Some triangles will have
 	 * vertices that span the transition between -pi and 0, or between pi and
@@ -169,7 +180,7 @@ static void texmap_theta(const Vec3 &v1,
 	}
 }
    
-static void subdivide(std::vector<Face> &faces,
+static void subdivide(Mesh &mesh,
                       const Vec3 &v1,
                       const Vec3 &v2,
                       const Vec3 &v3,
@@ -194,28 +205,25 @@ static void subdivide(std::vector<Face> &faces,
 						
 		texmap_theta(v1, v2, v3, theta1, theta2, theta3);
 		
-		face.tcoords[0] = Vec2(0.5 - theta1 / (2 * PI), acos(-v1.y) / PI);
-		face.tcoords[1] = Vec2(0.5 - theta2 / (2 * PI), acos(-v2.y) / PI);
-		face.tcoords[2] = Vec2(0.5 - theta3 / (2 * PI), acos(-v3.y) / PI);
+		face.tcoords[0] = Vec2(0.5 - theta1 / (2 * PI), math_acos<MATH_FAST>(-v1.y) / PI);
+		face.tcoords[1] = Vec2(0.5 - theta2 / (2 * PI), math_acos<MATH_FAST>(-v2.y) / PI);
+		face.tcoords[2] = Vec2(0.5 - theta3 / (2 * PI), math_acos<MATH_FAST>(-v3.y) / PI);
 		
 		calculate_triangle_tangent(face.vertices, face.normals,
 			                       face.tcoords, face.tangents);
 			                       
-		faces.push_back(face);
+		mesh.add_face(face);
 						
 		return;
 	}
 
-	v12 = v1 + v2;
-	v23 = v2 + v3;
-	v31 = v3 + v1;
-	v12.normalize();
-	v23.normalize();
-	v31.normalize();
-
-	subdivide(faces, v1,  v12, v31, depth-1);
-	subdivide(faces, v2,  v23, v12, depth-1);
-	subdivide(faces, v3,  v31, v23, depth-1);
-	subdivide(faces, v12, v23, v31, depth-1);
+	v12 = math_normalize<MATH_FAST>(v1 + v2);
+	v23 = math_normalize<MATH_FAST>(v2 + v3);
+	v31 = math_normalize<MATH_FAST>(v3 + v1);
+
+	subdivide(mesh, v1,  v12, v31, depth-1);
+	subdivide(mesh, v2,  v23, v12, depth-1);
+	subdivide(mesh, v3,  v31, v23, depth-1);
+	subdivide(mesh, v12, v23, v31, depth-1);
 }
 
@@ -9,13 +9,23 @@
 #define _SPHERE_H_
 
 #include "scene.h"
+#include "mesh.h"
 #include "trianglesoup.h"
 
 /** @brief Generates geometry for a sphere.
  *  Sphere is generated by subdividing a platonic solid a number of times.
  *  @param num_of_divisions Number of times to subdivide the initial solid.
+ *  @param format How the normals are stored, for the render method drawing it.
  *  @return Container holding the geometry buffers.
  */
-TriangleSoup gen_sphere(Scene * scene, int num_of_divisions);
+TriangleSoup gen_sphere(Scene * scene, int num_of_divisions,
+                        VertexFormat format = VERTEX_FORMAT_FLOAT);
+
+/** @brief Generates the geometry of a sphere without making OpenGL calls,
+ *  so it may run on any thread.
+ *  @param mesh Receives 8 * 4^num_of_divisions unindexed faces.
+ *  @param num_of_divisions Number of times to subdivide the initial solid.
+ */
+void gen_sphere_mesh(Mesh &mesh, int num_of_divisions);
 
 #endif
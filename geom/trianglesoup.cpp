@@ -8,55 +8,42 @@
 #include "vec/mat.h"
 #include "trianglesoup.h"
 #include "glheaders.h"
-#include <memory.h>
 
 TriangleSoup::~TriangleSoup() { /* Do Nothing */ }
 
-TriangleSoup::TriangleSoup() { /* Do Nothing */ }
+TriangleSoup::TriangleSoup() : bounds(AABB::Empty) { /* Do Nothing */ }
 
-TriangleSoup::TriangleSoup(Scene * scene, const std::vector<Face> &faces)
+TriangleSoup::TriangleSoup(Scene * scene, const Mesh &mesh, VertexFormat format)
+: bounds(AABB::Empty)
 {
-	create(scene, faces);
+	create(scene, mesh, format);
 }
 
-void TriangleSoup::create(Scene * scene, const std::vector<Face> &faces)
+TriangleSoup::TriangleSoup(Scene * scene, const std::vector<Face> &faces, VertexFormat format)
+: bounds(AABB::Empty)
+{
+	Mesh mesh;
+	mesh.add_faces(faces);
+	create(scene, mesh, format);
+}
+
+void TriangleSoup::create(Scene * scene, const Mesh &mesh, VertexFormat format)
 {
 	assert(scene);
 
-	size_t num_of_vertices = faces.size()*3;
-
-	vertices_buffer = boost::shared_ptr<BufferObject<Vec3> >(new BufferObject<Vec3>());
-	normals_buffer  = boost::shared_ptr<BufferObject<Vec3> >(new BufferObject<Vec3>());
-	tangents_buffer = boost::shared_ptr<BufferObject<Vec4> >(new BufferObject<Vec4>());
-	tcoords_buffer  = boost::shared_ptr<BufferObject<Vec2> >(new BufferObject<Vec2>());
-
-	// Create buffer objects from the vector of faces
-	vertices_buffer->create(num_of_vertices, STATIC_DRAW);
-	normals_buffer->create(num_of_vertices, STATIC_DRAW);
-	tangents_buffer->create(num_of_vertices, STATIC_DRAW);
-	tcoords_buffer->create(num_of_vertices, STATIC_DRAW);
-
-	Vec3 * vertices = vertices_buffer->lock();
-	Vec3 * normals = normals_buffer->lock();
-	Vec4 * tangents = tangents_buffer->lock();
-	Vec2 * tcoords = tcoords_buffer->lock();
-
-	for(std::vector<Face>::const_iterator i=faces.begin();
-		i != faces.end(); ++i)
-	{
-		memcpy(vertices, (*i).vertices, sizeof(Vec3)*3);
-		memcpy(normals, (*i).normals, sizeof(Vec3)*3);
-		memcpy(tangents, (*i).tangents, sizeof(Vec4)*3);
-		memcpy(tcoords, (*i).tcoords, sizeof(Vec2)*3);
-
-		vertices += 3;
-		normals += 3;
-		tangents += 3;
-		tcoords += 3;
+	vertices_buffer = upload_stream<PositionElement>(mesh.vertices, STATIC_DRAW);
+
+	if(format == VERTEX_FORMAT_PACKED) {
+		normals_buffer.reset();
+		packed_normals_buffer = upload_stream<PackedNormalElement>(mesh.normals, STATIC_DRAW);
+	} else {
+		normals_buffer = upload_stream<NormalElement>(mesh.normals, STATIC_DRAW);
+		packed_normals_buffer.reset();
 	}
 
-	vertices_buffer->unlock();
-	normals_buffer->unlock();
-	tangents_buffer->unlock();
-	tcoords_buffer->unlock();
+	tangents_buffer = upload_tangents(mesh.tangents, format, STATIC_DRAW);
+	tcoords_buffer  = upload_tcoords(mesh.tcoords, format, STATIC_DRAW);
+	indices_buffer  = upload_stream(mesh.indices, STATIC_DRAW);
+
+	bounds = mesh.bounds;
 }
@@ -9,21 +9,41 @@
 #define _TRIANGLE_SOUP_H_
 
 #include "scene.h"
+#include "mesh.h"
+#include "vec/aabb.h"
 
-/** An unindexed collection of triangles stored in BufferObjects. */
+/** A collection of triangles stored in BufferObjects, uploaded from a Mesh.
+    Creating one makes OpenGL calls. */
 class TriangleSoup
 {
 public:
 	~TriangleSoup(void);
 	TriangleSoup(void);
-	TriangleSoup(Scene * scene, const std::vector<Face> &faces);
-	void create(Scene * scene, const std::vector<Face> &faces);
+	TriangleSoup(Scene * scene, const Mesh &mesh,
+	             VertexFormat format = VERTEX_FORMAT_FLOAT);
+	TriangleSoup(Scene * scene, const std::vector<Face> &faces,
+	             VertexFormat format = VERTEX_FORMAT_FLOAT);
+	void create(Scene * scene, const Mesh &mesh,
+	            VertexFormat format = VERTEX_FORMAT_FLOAT);
 
 public:
-	boost::shared_ptr< BufferObject<Vec4> > tangents_buffer;
-	boost::shared_ptr< BufferObject<Vec3> > normals_buffer;
-	boost::shared_ptr< BufferObject<Vec3> > vertices_buffer;
-	boost::shared_ptr< BufferObject<Vec2> > tcoords_buffer;
+	/** Float4 or PackedTangent, see upload_tangents() */
+	boost::shared_ptr< VertexStream > tangents_buffer;
+
+	/** Only the buffer of the format the soup was created with is set */
+	boost::shared_ptr< BufferObject<NormalElement> > normals_buffer;
+	boost::shared_ptr< BufferObject<PackedNormalElement> > packed_normals_buffer;
+
+	boost::shared_ptr< BufferObject<PositionElement> > vertices_buffer;
+
+	/** Float2 or Half2, see upload_tcoords() */
+	boost::shared_ptr< VertexStream > tcoords_buffer;
+
+	/** Null unless the Mesh was indexed */
+	boost::shared_ptr< BufferObject<index_t> > indices_buffer;
+
+	/** Object-space bounds of the vertices */
+	AABB bounds;
 };
 
 #endif
@@ -0,0 +1,55 @@
+/**
+ * @file waterkernels.h
+ * @brief The SIMD loops of WaterSurface, built once for each tier of
+ * SimdTier, as the kernels of vec/kernels.h.
+ *
+ * Each kernel fills as much of one column of the grid as suits its
+ * instruction set and returns where it stopped. WaterSurface finishes the
+ * column one vertex at a time, which is all that runs at SIMD_SCALAR.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _WATERKERNELS_H_
+#define _WATERKERNELS_H_
+
+#include "watersurface.h"
+#include "vec/cpu.h"
+#include <cstddef>
+
+struct WaterKernels
+{
+    /**
+     * The heights of the column at x, from z = 0, as get_height. Returns the
+     * number of heights written.
+     */
+    int (*heights)(const WaterSurface::WavePoint* waves, size_t num_waves,
+                   real_t x, int resz, real_t time, real_t* column);
+
+    /**
+     * The normals of the column row, from z = 1, as compute_normal, where
+     * prev and next are the columns either side, clamped at the edges,
+     * packed as set_normal. Returns the z it stopped at.
+     */
+    int (*normals)(const real_t* prev, const real_t* row, const real_t* next,
+                   int resz, real_t ny, PackedNormalElement* column);
+};
+
+/**
+ * The kernels built for each tier, or NULL if the compiler could not build
+ * them.
+ */
+const WaterKernels* water_kernels_sse();
+const WaterKernels* water_kernels_avx2();
+
+/**
+ * Returns the kernels of the current tier, or NULL to run the scalar code.
+ */
+inline const WaterKernels* water_kernels()
+{
+    static const WaterKernels* const tables[SIMD_TIER_COUNT] =
+        { NULL, water_kernels_sse(), water_kernels_avx2() };
+    return simd_select(tables);
+}
+
+#endif /* _WATERKERNELS_H_ */
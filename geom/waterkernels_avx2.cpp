@@ -0,0 +1,39 @@
+/**
+ * @file waterkernels_avx2.cpp
+ * @brief The SIMD_AVX2 kernels of waterkernels.h, built for AVX2 and FMA
+ * even when the rest of the program is not, as vec/kernels_avx2.cpp.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#include "waterkernels.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__AVX2__) && \
+    (defined(__i386__) || defined(__x86_64__))
+#pragma GCC push_options
+#pragma GCC target("avx,avx2,fma")
+#define VEC_TARGET_AVX2 1
+#define KERNELS_AVX2_PRAGMA 1
+#endif
+
+#include "vec/simd.h"
+
+#if VEC_AVX2
+#include "waterkernels_impl.h"
+#endif
+
+#ifdef KERNELS_AVX2_PRAGMA
+#pragma GCC pop_options
+#endif
+
+// built for the baseline, as it runs before the CPU is checked
+const WaterKernels* water_kernels_avx2()
+{
+#if VEC_AVX2
+    return &VEC_ISA::water_kernels;
+#else
+    return NULL;
+#endif
+}
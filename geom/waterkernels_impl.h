@@ -0,0 +1,78 @@
+/**
+ * @file waterkernels_impl.h
+ * @brief The bodies of the kernels in waterkernels.h.
+ *
+ * Included once by each of waterkernels_sse.cpp and waterkernels_avx2.cpp,
+ * as vec/kernels_impl.h.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _WATERKERNELS_IMPL_H_
+#define _WATERKERNELS_IMPL_H_
+
+#include "waterkernels.h"
+#include "vec/simd.h"
+#include "vec/wide.h"
+#include "vec/fastmath.h"
+#include "vec/octahedral.h"
+
+#if !VEC_SSE
+#error "the kernels need SSE"
+#endif
+
+namespace VEC_ISA {
+
+static int water_heights(const WaterSurface::WavePoint* waves, size_t num_waves,
+                         real_t x, int resz, real_t time, real_t* column)
+{
+    const Floatx8 lane(0, 1, 2, 3, 4, 5, 6, 7);
+    int z = 0;
+
+    // eight points along z at a time
+    for (; z + Floatx8::WIDTH <= resz + 1; z += Floatx8::WIDTH) {
+        const Vec2x8 pos(x, (Floatx8((real_t)z) + lane)/resz*2-1);
+
+        // each lane sums its waves as get_height does
+        Floatx8 h = 0;
+
+        for (size_t i = 0; i < num_waves; ++i) {
+            const WaterSurface::WavePoint& p = waves[i];
+            const Floatx8 r = pos.distance(Vec2x8(p.position));
+            h += p.coefficient * math_exp<MATH_FAST>(-p.falloff * r) *
+                math_sin<MATH_FAST>(p.period * r + p.timerate * time);
+        }
+
+        h.store(column + z);
+    }
+
+    return z;
+}
+
+static int water_normals(const real_t* prev, const real_t* row, const real_t* next,
+                         int resz, real_t ny, PackedNormalElement* column)
+{
+    const Floatx8 wide_ny = ny;
+    int z = 1;
+
+    // eight normals at a time away from the clamped ends of the row; the
+    // encoding projects them onto the octahedron, so they need no normalizing
+    for (; z + Floatx8::WIDTH < resz; z += Floatx8::WIDTH) {
+        const Floatx8 nx = Floatx8::load(prev + z) - Floatx8::load(next + z);
+        const Floatx8 nz = Floatx8::load(row + z - 1) - Floatx8::load(row + z + 1);
+        Floatx8 u, v;
+        octahedral_encode(nx, wide_ny, nz, u, v);
+        store_snorm16(&column[z].x, u, v);
+    }
+
+    return z;
+}
+
+static const WaterKernels water_kernels = {
+    water_heights,
+    water_normals,
+};
+
+} /* namespace VEC_ISA */
+
+#endif /* _WATERKERNELS_IMPL_H_ */
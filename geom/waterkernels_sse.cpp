@@ -0,0 +1,24 @@
+/**
+ * @file waterkernels_sse.cpp
+ * @brief The SIMD_SSE kernels of waterkernels.h, built for the instruction
+ * set the whole program targets.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#include "waterkernels.h"
+#include "vec/simd.h"
+
+// a program built for AVX2 takes its kernels from waterkernels_avx2.cpp
+#if VEC_SSE && !VEC_AVX2
+#include "waterkernels_impl.h"
+#endif
+
+const WaterKernels* water_kernels_sse()
+{
+#if VEC_SSE && !VEC_AVX2
+    return &VEC_ISA::water_kernels;
+#else
+    return NULL;
+#endif
+}
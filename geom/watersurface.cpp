@@ -9,8 +9,12 @@
  */
 
 #include "vec/mat.h"
+#include "vec/fastmath.h"
 #include "watersurface.h"
+#include "waterkernels.h"
+#include "mesh.h"
 #include "glheaders.h"
+#include "trace.h"
 #include <iostream>
 #include <cstring>
 
@@ -30,21 +34,18 @@ WaterSurface::WaterSurface(Scene * scene,
 	heightmap = new real_t[num_of_vertices];
 	memset(heightmap, 0, sizeof(real_t) * num_of_vertices);
 
-	// Create the vertices buffer
-	vertices_buffer = boost::shared_ptr< BufferObject<Vec3> >(new BufferObject<Vec3>());
-	vertices_buffer->create(num_of_vertices, DYNAMIC_DRAW);
+	// Generate the grid, then upload it. Vertices and normals are
+	// regenerated by each tick.
+	Mesh mesh;
+	mesh.vertices.resize(num_of_vertices);
+	mesh.normals.resize(num_of_vertices);
+	generate_tcoords(mesh.tcoords);
+	generate_indices(mesh.indices);
 
-	// Create the normals buffer
-	normals_buffer = boost::shared_ptr< BufferObject<Vec3> >(new BufferObject<Vec3>());
-	normals_buffer->create(num_of_vertices, DYNAMIC_DRAW);
-
-	// Create the tcoords buffer
-	tcoords_buffer = boost::shared_ptr< BufferObject<Vec2> >(new BufferObject<Vec2>());
-	tcoords_buffer->create(num_of_vertices, STATIC_DRAW);
-	generate_tcoords();
-	
-	// Create the indices buffer to define the mesh topology
-	generate_indices(scene);
+	vertices_buffer = upload_stream<PositionElement>(mesh.vertices, DYNAMIC_DRAW);
+	normals_buffer = upload_stream<PackedNormalElement>(mesh.normals, DYNAMIC_DRAW);
+	tcoords_buffer = upload_tcoords(mesh.tcoords, VERTEX_FORMAT_PACKED, STATIC_DRAW);
+	indices_buffer = upload_stream(mesh.indices, STATIC_DRAW);
 
 	tick(0.0);
 }
@@ -62,21 +63,40 @@ real_t WaterSurface::get_height(const Vec2& pos, real_t time)
             i != wave_points.end(); ++i) {
         WavePoint& p = *i;
         real_t r = pos.distance(p.position);
-        h += p.coefficient * exp(-p.falloff * r ) *
-            sin(p.period * r + p.timerate * time);
+        h += p.coefficient * math_exp<MATH_FAST>(-p.falloff * r) *
+            math_sin<MATH_FAST>(p.period * r + p.timerate * time);
     }
 
     return h;
 }
 
+AABB WaterSurface::get_bounds() const
+{
+	// Each wave point contributes at most |coefficient| to the height
+	real_t amplitude = 0;
+
+	for (WavePointList::const_iterator i=wave_points.begin();
+	        i != wave_points.end(); ++i) {
+		amplitude += fabs((*i).coefficient);
+	}
+
+	return AABB(Vec3(-1, -amplitude, -1), Vec3(1, amplitude, 1));
+}
+
 void WaterSurface::generate_heightmap(real_t time)
 {
 #define NX(x) ((real_t)(x)/resx*2-1)
 #define NZ(z) ((real_t)(z)/resz*2-1)
 
+	const WaterKernels * kernels = water_kernels();
+
 	for(int x=0; x<=resx; x++)
 	{
-		for(int z=0; z<=resz; z++)
+		int z = kernels && !wave_points.empty() ?
+			kernels->heights(&wave_points[0], wave_points.size(), NX(x), resz, time,
+			                 &heightmap[x*resz]) : 0;
+
+		for(; z<=resz; z++)
 		{
 			heightmap[x*resz + z] = get_height(Vec2(NX(x), NZ(z)), time);
 		}
@@ -102,7 +122,7 @@ Vec3 WaterSurface::compute_normal(real_t *heightmap,
 	nv.x = y01 - y20;
 	nv.z = y10 - y02;
 	nv.y = 8.0 / sx; // 0.03
-	nv.normalize();
+	nv = math_normalize<MATH_FAST>(nv);
 	
 	Vec3 n;
 	n.x = nv.x;
@@ -115,11 +135,24 @@ void WaterSurface::generate_normals()
 {
 	assert(normals_buffer);
 
-	Vec3 * normals = normals_buffer->lock();
+	PackedNormalElement * normals = normals_buffer->lock();
+
+	const WaterKernels * kernels = water_kernels();
+	const real_t ny = 8.0 / resx;
 
 	for(int x=0; x<=resx; x++)
 	{
-		for(int z=0; z<=resz; z++)
+		// the rows either side, clamped at the edges as compute_normal
+		const real_t * row = heightmap + x*resz;
+		const real_t * prev = (x - 1 >= 0) ? row - resz : row;
+		const real_t * next = (x + 1 < resx) ? row + resz : row;
+
+		set_normal(normals, x, 0, compute_normal(heightmap, resx, resz, x, 0));
+
+		int z = kernels ?
+			kernels->normals(prev, row, next, resz, ny, &normals[x*(resz+1)]) : 1;
+
+		for(; z<=resz; z++)
 		{
 			set_normal(normals, x, z,
 			           compute_normal(heightmap, resx, resz, x, z));
@@ -129,21 +162,17 @@ void WaterSurface::generate_normals()
 	normals_buffer->unlock();
 }
 
-void WaterSurface::generate_tcoords()
+void WaterSurface::generate_tcoords(std::vector<Vec2> &tcoords) const
 {
-	assert(tcoords_buffer);
-
-	Vec2 * tcoords = tcoords_buffer->lock();
+	tcoords.resize((resx+1) * (resz+1));
 
 	for(int x=0; x<=resx; x++)
 	{
 		for(int z=0; z<=resz; z++)
 		{
-			set_tcoord(tcoords, x, z, Vec2((real_t)x/resx, (real_t)z/resz));
+			set_tcoord(&tcoords[0], x, z, Vec2((real_t)x/resx, (real_t)z/resz));
 		}
 	}
-
-	tcoords_buffer->unlock();
 }
 
 void WaterSurface::generate_vertices()
@@ -153,7 +182,7 @@ void WaterSurface::generate_vertices()
 
 	assert(vertices_buffer);
 
-	Vec3 * vertices = vertices_buffer->lock();
+	PositionElement * vertices = vertices_buffer->lock();
 
 	// fill in vertices
 	for(int x=0; x <=resx; x++)
@@ -177,30 +206,43 @@ void WaterSurface::generate_vertices()
 
 void WaterSurface::tick(real_t time)
 {
-	generate_heightmap(time);
-	generate_normals();
-	generate_vertices();
+	{
+		TRACE_ZONE("WaterSurface::generate_heightmap");
+		generate_heightmap(time);
+	}
+
+	{
+		TRACE_ZONE("WaterSurface::generate_normals");
+		generate_normals();
+	}
+
+	{
+		TRACE_ZONE("WaterSurface::generate_vertices");
+		generate_vertices();
+	}
+
+	mark_changed();
 }
 
-void WaterSurface::set_vertex(Vec3 * vertices, int x, int z, Vec3 v)
+void WaterSurface::set_vertex(PositionElement * vertices, int x, int z, Vec3 v)
 {
 	assert(x <= resx);
 	assert(x >= 0);
 	assert(z <= resz);
 	assert(z >= 0);
-	vertices[x*(resz+1)+z] = v;
+	vertices[x*(resz+1)+z] = PositionElement(v);
 }
 
-void WaterSurface::set_normal(Vec3 * normals, int x, int z, Vec3 n)
+void WaterSurface::set_normal(PackedNormalElement * normals, int x, int z, Vec3 n)
 {
 	assert(x <= resx);
 	assert(x >= 0);
 	assert(z <= resz);
 	assert(z >= 0);
-	normals[x*(resz+1)+z] = n;
+	normals[x*(resz+1)+z] = PackedNormalElement(n);
 }
 
-void WaterSurface::set_tcoord(Vec2 * tcoords, int x, int z, Vec2 st)
+void WaterSurface::set_tcoord(Vec2 * tcoords, int x, int z, Vec2 st) const
 {
 	assert(x <= resx);
 	assert(x >= 0);
@@ -209,13 +251,11 @@ void WaterSurface::set_tcoord(Vec2 * tcoords, int x, int z, Vec2 st)
 	tcoords[x*(resz+1)+z] = st;
 }
 
-void WaterSurface::generate_indices( Scene * scene )
+void WaterSurface::generate_indices(std::vector<index_t> &indices) const
 {
-	assert(scene);
-
 	const size_t num_of_indices = resx * resz * 6;
 
-	index_t * indices = new index_t[num_of_indices];
+	indices.resize(num_of_indices);
 
 	size_t idx;
 	int x, z;
@@ -238,10 +278,4 @@ void WaterSurface::generate_indices( Scene * scene )
 			assert(idx <= num_of_indices);
 		}
 	}
-
-	// Create the indices buffer
-	indices_buffer = boost::shared_ptr< BufferObject<index_t> >(new BufferObject<index_t>());
-	indices_buffer->recreate(num_of_indices, indices, STATIC_DRAW);
-
-	delete [] indices;
 }
\ No newline at end of file
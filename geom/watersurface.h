@@ -12,6 +12,7 @@
 #define _WATERSURFACE_H_
 
 #include "scene.h"
+#include "vec/aabb.h"
 #include <vector>
 
 class WaterSurface : public Tickable
@@ -40,8 +41,6 @@ public:
 	             const WavePointList& wave_points,
 				 int resx, int resz);
 
-	void generate_indices(Scene * scene);
-
     virtual ~WaterSurface();
 
     /**
@@ -53,12 +52,18 @@ public:
      */
     real_t get_height(const Vec2& pos, real_t time);
 
+    /**
+     * Returns bounds (in the local coordinate space) enclosing the surface
+     * at any time.
+     */
+    AABB get_bounds() const;
+
     virtual void tick(real_t time);
 
 public:
-	boost::shared_ptr< BufferObject<Vec3> > vertices_buffer;
-	boost::shared_ptr< BufferObject<Vec3> > normals_buffer;
-	boost::shared_ptr< BufferObject<Vec2> > tcoords_buffer;
+	boost::shared_ptr< BufferObject<PositionElement> > vertices_buffer;
+	boost::shared_ptr< BufferObject<PackedNormalElement> > normals_buffer;
+	boost::shared_ptr< VertexStream > tcoords_buffer;
 	boost::shared_ptr< BufferObject<index_t> > indices_buffer;
 
 private:
@@ -73,16 +78,18 @@ private:
 	// generate the heightmap from the surface function
 	void generate_heightmap(real_t time);
 
-	void generate_indices();
+	// fill the static parts of the grid, without OpenGL calls
+	void generate_indices(std::vector<index_t> &indices) const;
+	void generate_tcoords(std::vector<Vec2> &tcoords) const;
+
 	void generate_normals();
 	void generate_vertices();
-	void generate_tcoords();
 	
-	void set_vertex(Vec3 * vertices, int x, int z, Vec3 v);
+	void set_vertex(PositionElement * vertices, int x, int z, Vec3 v);
 	
-	void set_normal(Vec3 * normals, int x, int z, Vec3 n);
+	void set_normal(PackedNormalElement * normals, int x, int z, Vec3 n);
 
-	void set_tcoord(Vec2 * tcoords, int x, int z, Vec2 st);
+	void set_tcoord(Vec2 * tcoords, int x, int z, Vec2 st) const;
 	
 	static Vec3 compute_normal(real_t *heightmap, int sx, int sz, int x, int z);
 };
@@ -28,6 +28,11 @@
 #include <cstdlib>
 #include <GL/glext.h>
 
+// Tokens missing from older copies of glew.h
+#ifndef GL_ANY_SAMPLES_PASSED
+#define GL_ANY_SAMPLES_PASSED 0x8C2F
+#endif
+
 #define MESH_INDEX_FORMAT_IS_UINT 1
 #if MESH_INDEX_FORMAT_IS_UINT
 #define MESH_INDEX_FORMAT (GLenum)(GL_UNSIGNED_INT)
@@ -0,0 +1,99 @@
+/**
+ * @file gltypes.cpp
+ * @brief Packs and unpacks the quantized element types of gltypes.h.
+ *
+ * The unpacking mirrors the shaders (see shaders/vertex_decode.glsl), so
+ * that code reading a buffer back sees the vectors the GPU draws.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#include "gltypes.h"
+#include "packkernels.h"
+#include "vec/octahedral.h"
+#include <algorithm>
+
+/* a signed normalized integer of the given largest magnitude, as GL 4.2
+   converts it; earlier versions map the most negative value past -1 */
+static real_t snorm_to_real(int c, int largest)
+{
+	return std::max((real_t)c / largest, real_t(-1));
+}
+
+/* a signed 10-bit field of a packed tangent */
+static int field10(GLuint bits, int shift)
+{
+	const int c = (int)((bits >> shift) & 0x3ff);
+	return c >= 0x200 ? c - 0x400 : c;
+}
+
+OctNormal::OctNormal(const Vec3 &n)
+{
+	real_t u, v;
+	octahedral_encode(n.x, n.y, n.z, u, v);
+	store_snorm16(&x, u, v);
+}
+
+Vec3 OctNormal::to_vec() const
+{
+	Vec3 n;
+	octahedral_decode(snorm_to_real(x, 32767), snorm_to_real(y, 32767), n.x, n.y, n.z);
+	return n;
+}
+
+PackedTangent::PackedTangent(const Vec4 &t)
+{
+	real_t u, v;
+	octahedral_encode(t.x, t.y, t.z, u, v);
+
+	// u and v are in [-1, 1], so the rounded fields are in [-511, 511]
+	const GLuint iu = (GLuint)(int)fastmath::round(u * 511) & 0x3ff;
+	const GLuint iv = (GLuint)(int)fastmath::round(v * 511) & 0x3ff;
+	const GLuint handedness = t.w < 0 ? 3u : 1u;
+	bits = iu | (iv << 10) | (handedness << 30);
+}
+
+Vec4 PackedTangent::to_vec() const
+{
+	Vec4 t;
+	octahedral_decode(snorm_to_real(field10(bits, 0), 511),
+	                  snorm_to_real(field10(bits, 10), 511),
+	                  t.x, t.y, t.z);
+
+	// the top two bits hold 1 or -1
+	t.w = (bits >> 31) ? -1 : 1;
+	return t;
+}
+
+void convert_elements(const Vec3 *in, OctNormal *out, size_t n)
+{
+	assert(in && out);
+	const PackKernels *k = pack_kernels();
+	size_t i = k ? k->normals(in, out, n) : 0;
+
+	for(; i < n; ++i) {
+		out[i] = OctNormal(in[i]);
+	}
+}
+
+void convert_elements(const Vec4 *in, PackedTangent *out, size_t n)
+{
+	assert(in && out);
+	const PackKernels *k = pack_kernels();
+	size_t i = k ? k->tangents(in, out, n) : 0;
+
+	for(; i < n; ++i) {
+		out[i] = PackedTangent(in[i]);
+	}
+}
+
+void convert_elements(const Vec2 *in, Half2 *out, size_t n)
+{
+	assert(in && out);
+	const PackKernels *k = pack_kernels();
+	size_t i = k ? k->tcoords(in, out, n) : 0;
+
+	for(; i < n; ++i) {
+		out[i] = Half2(in[i]);
+	}
+}
@@ -0,0 +1,323 @@
+/**
+ * @file gltypes.h
+ * @brief The types vertex data is stored as in buffer objects, and how
+ *  OpenGL is told about them.
+ *
+ * Geometry is computed in real_t, which is double if REAL_IS_DOUBLE is set,
+ * but buffer objects always hold float or half components. Streams are
+ * converted to the element types below as they are uploaded (see
+ * upload_stream()), and code writing through BufferObject::lock() converts
+ * each value it writes. gl_type_traits<ELEMENT> gives the arguments for the
+ * gl*Pointer functions, so drawing code follows the element type of its
+ * buffers instead of real_t.
+ *
+ * Streams drawn by shaders (VERTEX_FORMAT_PACKED) are quantized, to 24
+ * bytes a vertex from 48 with float positions. Texture coordinates are two
+ * halves. Normals are two octahedral snorm16 coordinates (OctNormal), and
+ * tangents one GL_INT_2_10_10_10_REV word (PackedTangent), which the shaders
+ * decode with the functions of shaders/vertex_decode.glsl. A context lacking
+ * ARB_half_float_vertex or ARB_vertex_type_2_10_10_10_rev gets Float2
+ * texture coordinates or Float4 tangents instead. Measured against the
+ * originals:
+ *
+ *   OctNormal       0.004 degrees
+ *   PackedTangent   0.25 degrees, handedness exact
+ *   Half2           2^-11 of the coordinate, or of one repeat below 1
+ *
+ * Before GL 4.2, signed normalized integers are converted as (2c+1)/(2^b-1),
+ * which about doubles the angles. Positions stay float, as quantizing them
+ * would need a dequantizing transform in every render method.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _GLTYPES_H_
+#define _GLTYPES_H_
+
+#include "glheaders.h"
+#include "vec/vec.h"
+#include <cstring>
+#include <cstddef>
+
+#ifndef GL_HALF_FLOAT_ARB
+#define GL_HALF_FLOAT_ARB 0x140B
+#endif
+
+#ifndef GL_INT_2_10_10_10_REV
+#define GL_INT_2_10_10_10_REV 0x8D9F
+#endif
+
+/** Rounds a float to the nearest half, to even on ties. Overflows to
+    infinity above 65504. */
+inline unsigned short float_to_half(float f)
+{
+	unsigned int u;
+	memcpy(&u, &f, sizeof u);
+
+	const unsigned int sign = (u >> 16) & 0x8000;
+	const unsigned int a = u & 0x7fffffff;
+
+	if(a >= 0x7f800000) {
+		// infinity, or NaN kept quiet
+		return (unsigned short)(sign | 0x7c00 | (a > 0x7f800000 ? 0x200 : 0));
+	}
+
+	if(a >= 0x477ff000) {
+		// rounds past 65504
+		return (unsigned short)(sign | 0x7c00);
+	}
+
+	if(a < 0x38800000) {
+		// below 2^-14, the smallest normal half: a denormal, or zero
+		if(a < 0x33000000) {
+			return (unsigned short)sign;
+		}
+
+		const unsigned int shift = 126 - (a >> 23);
+		const unsigned int m = (a & 0x7fffff) | 0x800000;
+		const unsigned int rem = m & ((1u << shift) - 1);
+		const unsigned int tie = 1u << (shift - 1);
+		unsigned int h = m >> shift;
+		h += (rem > tie || (rem == tie && (h & 1))) ? 1 : 0;
+		return (unsigned short)(sign | h);
+	}
+
+	// rebias the exponent and round away 13 bits of mantissa; a carry out
+	// of the mantissa correctly bumps the exponent
+	const unsigned int rem = a & 0x1fff;
+	unsigned int h = (a - 0x38000000) >> 13;
+	h += (rem > 0x1000 || (rem == 0x1000 && (h & 1))) ? 1 : 0;
+	return (unsigned short)(sign | h);
+}
+
+/** Widens a half to a float, which is always exact */
+inline float half_to_float(unsigned short h)
+{
+	const unsigned int sign = (unsigned int)(h & 0x8000) << 16;
+	const unsigned int e = (h >> 10) & 0x1f;
+	const unsigned int m = h & 0x3ff;
+	unsigned int u;
+
+	if(e == 0x1f) {
+		u = sign | 0x7f800000 | (m << 13);
+	} else if(e != 0) {
+		u = sign | ((e + 112) << 23) | (m << 13);
+	} else {
+		// zero or denormal, m * 2^-24
+		const float f = m * (1.0f / 16777216.0f);
+		return sign ? -f : f;
+	}
+
+	float f;
+	memcpy(&f, &u, sizeof f);
+	return f;
+}
+
+/** A half-precision float, as GL_HALF_FLOAT_ARB stores it: 11 significant
+    bits and magnitudes up to 65504. */
+struct Half
+{
+	unsigned short bits;
+
+	Half() : bits(0) { /* Do Nothing */ }
+	explicit Half(float f) : bits(float_to_half(f)) { /* Do Nothing */ }
+
+	operator float() const { return half_to_float(bits); }
+};
+
+/** Two floats, a Vec2 as stored on the GPU */
+struct Float2
+{
+	GLfloat x, y;
+
+	Float2() : x(0), y(0) { /* Do Nothing */ }
+	explicit Float2(const Vec2 &v) : x((GLfloat)v.x), y((GLfloat)v.y) { /* Do Nothing */ }
+
+	Vec2 to_vec() const { return Vec2(x, y); }
+};
+
+/** Three floats, a Vec3 as stored on the GPU */
+struct Float3
+{
+	GLfloat x, y, z;
+
+	Float3() : x(0), y(0), z(0) { /* Do Nothing */ }
+	explicit Float3(const Vec3 &v)
+		: x((GLfloat)v.x), y((GLfloat)v.y), z((GLfloat)v.z) { /* Do Nothing */ }
+
+	Vec3 to_vec() const { return Vec3(x, y, z); }
+};
+
+/** Four floats, a Vec4 as stored on the GPU */
+struct Float4
+{
+	GLfloat x, y, z, w;
+
+	Float4() : x(0), y(0), z(0), w(0) { /* Do Nothing */ }
+	explicit Float4(const Vec4 &v)
+		: x((GLfloat)v.x), y((GLfloat)v.y), z((GLfloat)v.z), w((GLfloat)v.w) { /* Do Nothing */ }
+
+	Vec4 to_vec() const { return Vec4(x, y, z, w); }
+};
+
+/** Two halves, e.g. texture coordinates needing no more than 11 bits */
+struct Half2
+{
+	Half x, y;
+
+	Half2() { /* Do Nothing */ }
+	explicit Half2(const Vec2 &v) : x((float)v.x), y((float)v.y) { /* Do Nothing */ }
+
+	Vec2 to_vec() const { return Vec2(x, y); }
+};
+
+/** Four halves. There is no Half3, as rows of three halves break the
+    four-byte alignment drivers expect of each vertex. */
+struct Half4
+{
+	Half x, y, z, w;
+
+	Half4() { /* Do Nothing */ }
+	explicit Half4(const Vec4 &v)
+		: x((float)v.x), y((float)v.y), z((float)v.z), w((float)v.w) { /* Do Nothing */ }
+
+	Vec4 to_vec() const { return Vec4(x, y, z, w); }
+};
+
+/** A direction as two signed normalized shorts, its octahedral coordinates
+    (see vec/octahedral.h). The shaders decode it. */
+struct OctNormal
+{
+	GLshort x, y;
+
+	OctNormal() : x(0), y(0) { /* Do Nothing */ }
+	explicit OctNormal(const Vec3 &n);
+
+	Vec3 to_vec() const;
+};
+
+/** A tangent and its handedness in GL_INT_2_10_10_10_REV: the octahedral
+    coordinates of the direction in the low two 10-bit fields, zero in the
+    third, and the sign of w, +1 or -1, in the top two bits. The shaders
+    decode it. */
+struct PackedTangent
+{
+	GLuint bits;
+
+	PackedTangent() : bits(0) { /* Do Nothing */ }
+	explicit PackedTangent(const Vec4 &t);
+
+	Vec4 to_vec() const;
+};
+
+/**
+ * Describes an element of a buffer object to OpenGL: the type of each
+ * component, how many components there are, and whether integer components
+ * are normalized to [0,1] or [-1,1]. Left undefined for types which are not
+ * stored on the GPU, such as the real_t vectors.
+ */
+template<typename ELEMENT> struct gl_type_traits;
+
+#define GL_TYPE_TRAITS(ELEMENT, TYPE, COMPONENTS, NORMALIZED) \
+template<> struct gl_type_traits<ELEMENT>                     \
+{                                                             \
+	static const GLenum type = TYPE;                          \
+	static const GLint components = COMPONENTS;               \
+	static const GLboolean normalized = NORMALIZED;           \
+};
+
+GL_TYPE_TRAITS(Float2,        GL_FLOAT,              2, GL_FALSE)
+GL_TYPE_TRAITS(Float3,        GL_FLOAT,              3, GL_FALSE)
+GL_TYPE_TRAITS(Float4,        GL_FLOAT,              4, GL_FALSE)
+GL_TYPE_TRAITS(Half2,         GL_HALF_FLOAT_ARB,     2, GL_FALSE)
+GL_TYPE_TRAITS(Half4,         GL_HALF_FLOAT_ARB,     4, GL_FALSE)
+GL_TYPE_TRAITS(OctNormal,     GL_SHORT,              2, GL_TRUE)
+GL_TYPE_TRAITS(PackedTangent, GL_INT_2_10_10_10_REV, 4, GL_TRUE)
+GL_TYPE_TRAITS(index_t,       MESH_INDEX_FORMAT,     1, GL_FALSE)
+
+#undef GL_TYPE_TRAITS
+
+/* The element types each vertex stream may be uploaded as. Normals are
+   floats for the fixed-function pipeline, and packed for render methods
+   whose shaders decode them; only shaders read tangents. */
+typedef Float3 PositionElement;
+typedef Float3 NormalElement;
+typedef OctNormal PackedNormalElement;
+typedef Float4 TangentElement;
+typedef PackedTangent PackedTangentElement;
+typedef Float2 TexCoordElement;
+typedef Half2 PackedTexCoordElement;
+
+/** How the normals, tangents and texture coordinates of a mesh are stored,
+    which depends on the render methods drawing it */
+enum VertexFormat
+{
+	/** Floats, which the fixed-function pipeline reads */
+	VERTEX_FORMAT_FLOAT,
+
+	/** Octahedral normals, which only shaders can decode, and packed
+	    tangents and half texture coordinates where the context supports
+	    them (see has_packed_tangents() and has_packed_tcoords()) */
+	VERTEX_FORMAT_PACKED
+};
+
+/**
+ * Checks the extensions the packed streams need, printing a warning for
+ * each one which is missing. Must be called once the context exists; until
+ * then every stream is stored as floats.
+ */
+void init_vertex_formats();
+
+/** True if VERTEX_FORMAT_PACKED stores tangents as PackedTangent, which
+    needs ARB_vertex_type_2_10_10_10_rev, rather than Float4 */
+bool has_packed_tangents();
+
+/** True if VERTEX_FORMAT_PACKED stores texture coordinates as Half2, which
+    needs ARB_half_float_vertex, rather than Float2 */
+bool has_packed_tcoords();
+
+/**
+ * Converts n values, e.g. real_t vectors, to the element type of a buffer
+ * object.
+ */
+template<typename ELEMENT, typename SOURCE>
+void convert_elements(const SOURCE *in, ELEMENT *out, size_t n)
+{
+	for(size_t i = 0; i < n; ++i) {
+		out[i] = ELEMENT(in[i]);
+	}
+}
+
+/* The packed types, converted by the SIMD kernels of the current tier */
+void convert_elements(const Vec3 *in, OctNormal *out, size_t n);
+void convert_elements(const Vec4 *in, PackedTangent *out, size_t n);
+void convert_elements(const Vec2 *in, Half2 *out, size_t n);
+
+/** Sets a mat4 uniform from a real_t matrix, converting it to floats if
+    real_t is double */
+inline void set_uniform_matrix4(GLint location, const float *m)
+{
+	glUniformMatrix4fvARB(location, 1, GL_FALSE, m);
+}
+
+inline void set_uniform_matrix4(GLint location, const double *m)
+{
+	GLfloat f[16];
+	for(int i = 0; i < 16; ++i) {
+		f[i] = (GLfloat)m[i];
+	}
+	glUniformMatrix4fvARB(location, 1, GL_FALSE, f);
+}
+
+/** Reads a matrix, such as GL_MODELVIEW_MATRIX, into real_t */
+inline void get_matrix(GLenum pname, float *m)
+{
+	glGetFloatv(pname, m);
+}
+
+inline void get_matrix(GLenum pname, double *m)
+{
+	glGetDoublev(pname, m);
+}
+
+#endif /* _GLTYPES_H_ */
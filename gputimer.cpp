@@ -0,0 +1,292 @@
+/** @file gputimer.cpp
+ *  @brief Measures GPU time per pass, per cube map face and per draw
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#include "glheaders.h"
+#include "gputimer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+GpuTimer gpu_timer;
+
+/** Weight of the newest frame in the moving average */
+static const double AVERAGE_WEIGHT = 0.1;
+
+std::ostream& operator<<(std::ostream &o, const GpuTimerEntry &entry)
+{
+	o << entry.label
+	  << ": last_ms=" << entry.last_ms
+	  << " average_ms=" << entry.average_ms
+	  << " frames=" << entry.frames;
+	return o;
+}
+
+GpuTimer::GpuTimer()
+: draw_timing(false),
+  supported(-1),
+  current(0),
+  frame_ms(0),
+  frames_read(0),
+  frames_dropped(0)
+{
+	// Do Nothing
+}
+
+bool GpuTimer::is_supported() const
+{
+	if(supported < 0) {
+		supported = GLEW_EXT_timer_query ? 1 : 0;
+
+		if(!supported) {
+			std::cerr << "WARNING: GPU timing needs EXT_timer_query" << std::endl;
+		}
+	}
+
+	return supported != 0;
+}
+
+void GpuTimer::begin_frame()
+{
+	if(!is_supported())
+		return;
+
+	assert(stack.empty() && "a scope was not ended");
+
+	current = (current + 1) % FRAMES;
+
+	Frame &frame = frames[current];
+	read_back(frame);
+	frame.segments.clear();
+	frame.scopes.clear();
+}
+
+void GpuTimer::read_back(Frame &frame)
+{
+	if(frame.segments.empty())
+		return;
+
+	// Queries finish in order, so if the last is ready then all of them are
+	GLuint available = 0;
+	glGetQueryObjectuiv(frame.segments.back().query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+	if(!available) {
+		frames_dropped++;
+		return;
+	}
+
+	trace_time_t gpu_time = 0; // end of the last segment on the GPU track
+
+	for(std::vector<Segment>::const_iterator i = frame.segments.begin();
+		i != frame.segments.end(); ++i)
+	{
+		GLuint64EXT ns = 0;
+		glGetQueryObjectui64vEXT((*i).query, GL_QUERY_RESULT, &ns);
+
+		Scope &scope = frame.scopes[(*i).scope];
+		scope.ms += ns / 1000000.0;
+
+		const trace_time_t begin = std::max(gpu_time, (*i).issued);
+		gpu_time = begin + (trace_time_t)(ns / 1000);
+
+		// A scope's first segment comes before those of the scopes in it
+		if(!scope.begin) scope.begin = begin;
+		scope.end = gpu_time;
+	}
+
+	// Scopes begin after the scopes enclosing them, so walking backwards
+	// adds each scope to its parent after its own children were added
+	for(int i = (int)frame.scopes.size() - 1; i >= 0; --i)
+	{
+		const Scope &scope = frame.scopes[i];
+
+		if(scope.parent >= 0) {
+			Scope &parent = frame.scopes[scope.parent];
+			parent.ms += scope.ms;
+			parent.end = std::max(parent.end, scope.end);
+		}
+	}
+
+	if(trace_enabled) {
+		for(std::vector<Scope>::const_iterator i = frame.scopes.begin();
+			i != frame.scopes.end(); ++i)
+		{
+			trace_gpu_zone(entries[(*i).entry].label, (*i).begin, (*i).end);
+		}
+	}
+
+	std::vector<bool> timed(entries.size(), false);
+
+	for(std::vector<GpuTimerEntry>::iterator i = entries.begin(); i != entries.end(); ++i)
+	{
+		(*i).frame_ms = 0;
+	}
+
+	frame_ms = 0;
+
+	for(std::vector<Scope>::const_iterator i = frame.scopes.begin();
+		i != frame.scopes.end(); ++i)
+	{
+		GpuTimerEntry &entry = entries[(*i).entry];
+		entry.frame_ms += (*i).ms;
+		timed[(*i).entry] = true;
+
+		if(entry.category == GpuTimerEntry::PASS) {
+			frame_ms += (*i).ms;
+		}
+	}
+
+	for(size_t i = 0; i < entries.size(); ++i)
+	{
+		if(!timed[i])
+			continue;
+
+		GpuTimerEntry &entry = entries[i];
+		entry.last_ms = entry.frame_ms;
+		entry.average_ms = (entry.frames == 0) ? entry.last_ms
+		                 : entry.average_ms + (entry.last_ms - entry.average_ms) * AVERAGE_WEIGHT;
+		entry.frames++;
+	}
+
+	frames_read++;
+}
+
+int GpuTimer::find_entry(GpuTimerEntry::Category category, const void * key, const char * label)
+{
+	for(size_t i = 0; i < entries.size(); ++i)
+	{
+		if(entries[i].category == category && entries[i].key == key)
+			return (int)i;
+	}
+
+	GpuTimerEntry entry;
+	entry.category = category;
+	entry.key = key;
+	entry.label = label;
+	entry.last_ms = 0;
+	entry.average_ms = 0;
+	entry.frames = 0;
+	entry.frame_ms = 0;
+
+	entries.push_back(entry);
+	return (int)entries.size() - 1;
+}
+
+void GpuTimer::begin_segment(int scope)
+{
+	Frame &frame = frames[current];
+	const size_t n = frame.segments.size();
+
+	if(n == frame.queries.size()) {
+		GLuint query = 0;
+		glGenQueries(1, &query);
+		frame.queries.push_back(query);
+	}
+
+	Segment segment;
+	segment.query = frame.queries[n];
+	segment.scope = scope;
+	segment.issued = trace_now();
+	frame.segments.push_back(segment);
+
+	glBeginQuery(GL_TIME_ELAPSED_EXT, segment.query);
+}
+
+void GpuTimer::begin(GpuTimerEntry::Category category, const void * key, const char * label)
+{
+	if(!is_supported())
+		return;
+
+	Frame &frame = frames[current];
+
+	// Pause the enclosing scope; only one query may be active at a time
+	if(!stack.empty()) {
+		glEndQuery(GL_TIME_ELAPSED_EXT);
+	}
+
+	Scope scope;
+	scope.entry = find_entry(category, key, label);
+	scope.parent = stack.empty() ? -1 : stack.back();
+	scope.ms = 0;
+	scope.begin = 0;
+	scope.end = 0;
+
+	const int index = (int)frame.scopes.size();
+	frame.scopes.push_back(scope);
+	stack.push_back(index);
+
+	begin_segment(index);
+}
+
+void GpuTimer::end()
+{
+	if(!is_supported())
+		return;
+
+	assert(!stack.empty() && "end() without begin()");
+
+	glEndQuery(GL_TIME_ELAPSED_EXT);
+	stack.pop_back();
+
+	// Resume the enclosing scope
+	if(!stack.empty()) {
+		begin_segment(stack.back());
+	}
+}
+
+void GpuTimer::clear()
+{
+	assert(stack.empty() && "a scope was not ended");
+
+	for(int i=0; i<FRAMES; ++i)
+	{
+		frames[i].segments.clear();
+		frames[i].scopes.clear();
+	}
+
+	entries.clear();
+	frame_ms = 0;
+}
+
+void GpuTimer::release()
+{
+	clear();
+
+	for(int i=0; i<FRAMES; ++i)
+	{
+		if(!frames[i].queries.empty()) {
+			glDeleteQueries((GLsizei)frames[i].queries.size(), &frames[i].queries[0]);
+			frames[i].queries.clear();
+		}
+	}
+}
+
+void GpuTimer::print(std::ostream &o) const
+{
+	static const char * headings[] = { "passes", "cube map faces", "draws" };
+
+	o << "gpu: frame_ms=" << frame_ms
+	  << " frames_read=" << frames_read
+	  << " frames_dropped=" << frames_dropped << std::endl;
+
+	for(int category = GpuTimerEntry::PASS; category <= GpuTimerEntry::DRAW; ++category)
+	{
+		bool heading = false;
+
+		for(std::vector<GpuTimerEntry>::const_iterator i = entries.begin(); i != entries.end(); ++i)
+		{
+			if((*i).category != category)
+				continue;
+
+			if(!heading) {
+				o << "  " << headings[category] << ":" << std::endl;
+				heading = true;
+			}
+
+			o << "    " << *i << std::endl;
+		}
+	}
+}
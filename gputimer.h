@@ -0,0 +1,160 @@
+/** @file gputimer.h
+ *  @brief Measures GPU time per pass, per cube map face and per draw
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#ifndef _GPU_TIMER_H_
+#define _GPU_TIMER_H_
+
+#include "glheaders.h"
+#include "trace.h"
+#include <iosfwd>
+#include <vector>
+
+/** GPU time spent on one pass, face or type of RenderMethod */
+struct GpuTimerEntry
+{
+	enum Category { PASS, FACE, DRAW };
+
+	Category category;
+
+	/** Identifies what was timed, e.g. the Pass object */
+	const void * key;
+
+	/** Name to print, e.g. the class of the Pass object */
+	const char * label;
+
+	/** Total for the last frame read back which timed it, in milliseconds */
+	double last_ms;
+
+	/** Exponential moving average of last_ms */
+	double average_ms;
+
+	/** Number of frames which timed it */
+	int frames;
+
+	/** Scratch total for the frame being read back */
+	double frame_ms;
+};
+
+std::ostream& operator<<(std::ostream &o, const GpuTimerEntry &entry);
+
+/**
+Times scopes on the GPU with EXT_timer_query, e.g. each Pass::render(),
+each cube map face and each RenderInstance::draw().
+
+GL_TIME_ELAPSED queries cannot be nested, so when a scope begins inside
+another, the outer scope's query is ended and a new one started once the
+inner scope ends. A scope's time includes the scopes inside it.
+
+Queries are kept in one pool per frame, for FRAMES frames, and a frame is
+read back just before its pool is reused. The CPU therefore never waits on
+the GPU, unless it is FRAMES frames ahead. A frame whose results are still
+not available is dropped instead.
+
+Results are totalled per pass, per face and per RenderMethod type, with a
+moving average. While trace_enabled is set, each scope is also recorded on
+the trace's GPU track. Only durations are measured, so a scope is placed no
+earlier than the CPU issued it and no earlier than the scope before it ended.
+Without EXT_timer_query every call does nothing.
+*/
+class GpuTimer
+{
+public:
+	/** If true, each RenderInstance::draw() is timed. This adds two
+	    queries per draw, so it is off by default. */
+	bool draw_timing;
+
+	GpuTimer();
+
+	/** Returns true if timer queries are supported. Only valid once the
+	    OpenGL context exists. */
+	bool is_supported() const;
+
+	/** Reads back the frame issued FRAMES frames ago. Call once per frame,
+	    before any scope begins. */
+	void begin_frame();
+
+	/**
+	Starts timing a scope. Scopes must end in the reverse order they began.
+	@param category What is timed
+	@param key Identifies what is timed; the same key is totalled together
+	@param label Name to print. Must outlive the timer, e.g. a string
+	literal or trace_class_name().
+	*/
+	void begin(GpuTimerEntry::Category category, const void * key, const char * label);
+
+	/** Stops timing the innermost scope */
+	void end();
+
+	/** Forgets every entry and every frame in flight, e.g. because the
+	    objects used as keys are about to be deleted */
+	void clear();
+
+	/** Deletes the query objects. Call while the OpenGL context exists. */
+	void release();
+
+	/** Gets the GPU time of all passes in the last frame read back, in ms */
+	double get_frame_ms() const { return frame_ms; }
+
+	/** Gets the number of frames read back so far */
+	int get_frames_read() const { return frames_read; }
+
+	/** Gets the number of frames whose results were not ready in time */
+	int get_frames_dropped() const { return frames_dropped; }
+
+	/** Gets every entry, in the order they were first timed */
+	const std::vector<GpuTimerEntry> & get_entries() const { return entries; }
+
+	/** Prints every entry, grouped by category */
+	void print(std::ostream &o) const;
+
+	enum { FRAMES = 3 };
+
+private:
+	struct Scope
+	{
+		int entry;
+		int parent; // index of the enclosing scope, or -1
+		double ms;
+		trace_time_t begin, end; // placement on the trace's GPU track
+	};
+
+	struct Segment
+	{
+		GLuint query;
+		int scope;
+		trace_time_t issued; // when the CPU began the query
+	};
+
+	struct Frame
+	{
+		std::vector<GLuint> queries; // pool, grown as needed
+		std::vector<Segment> segments;
+		std::vector<Scope> scopes;
+	};
+
+	// no meaningful assignment or copy
+	GpuTimer(const GpuTimer &r);
+	GpuTimer& operator=(const GpuTimer &r);
+
+	int find_entry(GpuTimerEntry::Category category, const void * key, const char * label);
+	void begin_segment(int scope);
+	void read_back(Frame &frame);
+
+private:
+	mutable int supported; // -1 until checked
+	Frame frames[FRAMES];
+	int current;
+	std::vector<int> stack; // scopes which have begun and not ended
+	std::vector<GpuTimerEntry> entries;
+	double frame_ms;
+	int frames_read;
+	int frames_dropped;
+};
+
+/** The timer used by the frame graph and by passes */
+extern GpuTimer gpu_timer;
+
+#endif /* _GPU_TIMER_H_ */
@@ -0,0 +1,203 @@
+/** @file headlessdevice.cpp
+ *  @brief Creates an OpenGL context with no window, for benchmarking
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#include "glheaders.h"
+#include "gltypes.h"
+#include "headlessdevice.h"
+#include "scene.h"
+
+#ifndef _WIN32
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <cstring>
+#include <iostream>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+HeadlessDevice::HeadlessDevice(const ivec2 &_dimensions)
+: display(0),
+  context(0),
+  surface(0),
+  fbo(0),
+  color(0),
+  depth(0),
+  dimensions(_dimensions),
+  valid(false)
+{
+	assert(dimensions.x > 0 && dimensions.y > 0);
+
+	if(!create_context())
+		return;
+
+	GLenum err = glewInit();
+	if(GLEW_OK != err) {
+		std::cerr << "ERROR: " << (const char*)glewGetErrorString(err) << std::endl;
+		return;
+	}
+
+	std::clog << "headless renderer: " << (const char*)glGetString(GL_RENDERER) << std::endl;
+
+	init_vertex_formats();
+
+	valid = create_framebuffer();
+}
+
+#ifdef _WIN32
+
+bool HeadlessDevice::create_context()
+{
+	std::cerr << "ERROR: Headless rendering needs EGL, which is not available on Windows" << std::endl;
+	return false;
+}
+
+HeadlessDevice::~HeadlessDevice()
+{
+	// Do Nothing
+}
+
+#else
+
+bool HeadlessDevice::create_context()
+{
+	EGLDisplay egl_display = EGL_NO_DISPLAY;
+
+	// Prefer the surfaceless platform, which needs neither a display server
+	// nor a GPU device node
+	const char * client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+	if(client_extensions && strstr(client_extensions, "EGL_MESA_platform_surfaceless")) {
+		PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+		if(get_platform_display) {
+			egl_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		}
+	}
+
+	if(egl_display == EGL_NO_DISPLAY) {
+		egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	if(egl_display == EGL_NO_DISPLAY || !eglInitialize(egl_display, NULL, NULL)) {
+		std::cerr << "ERROR: Failed to initialize EGL" << std::endl;
+		return false;
+	}
+
+	display = egl_display;
+
+	if(!eglBindAPI(EGL_OPENGL_API)) {
+		std::cerr << "ERROR: EGL does not support desktop OpenGL" << std::endl;
+		return false;
+	}
+
+	const bool surfaceless = strstr(eglQueryString(egl_display, EGL_EXTENSIONS),
+	                                "EGL_KHR_surfaceless_context") != NULL;
+
+	const EGLint config_attributes[] =
+	{
+		EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+
+	EGLConfig config;
+	EGLint configs = 0;
+
+	if(!eglChooseConfig(egl_display, config_attributes, &config, 1, &configs) || configs < 1) {
+		std::cerr << "ERROR: No EGL config supports desktop OpenGL" << std::endl;
+		return false;
+	}
+
+	// A compatibility context, since the renderer uses the fixed-function
+	// pipeline
+	EGLContext egl_context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, NULL);
+
+	if(egl_context == EGL_NO_CONTEXT) {
+		std::cerr << "ERROR: Failed to create an EGL context" << std::endl;
+		return false;
+	}
+
+	context = egl_context;
+
+	EGLSurface egl_surface = EGL_NO_SURFACE;
+
+	if(!surfaceless) {
+		// Everything is drawn into an FBO, so the pbuffer is only a stand-in
+		const EGLint pbuffer_attributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		egl_surface = eglCreatePbufferSurface(egl_display, config, pbuffer_attributes);
+		surface = egl_surface;
+	}
+
+	if(!eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context)) {
+		std::cerr << "ERROR: Failed to make the EGL context current" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+HeadlessDevice::~HeadlessDevice()
+{
+	if(fbo) {
+		main_framebuffer = 0;
+		glDeleteFramebuffersEXT(1, &fbo);
+		glDeleteRenderbuffersEXT(1, &color);
+		glDeleteRenderbuffersEXT(1, &depth);
+	}
+
+	if(display) {
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+		if(surface) eglDestroySurface(display, surface);
+		if(context) eglDestroyContext(display, context);
+
+		eglTerminate(display);
+	}
+}
+
+#endif /* _WIN32 */
+
+bool HeadlessDevice::create_framebuffer()
+{
+	if(!GLEW_EXT_framebuffer_object) {
+		std::cerr << "ERROR: Headless rendering needs EXT_framebuffer_object" << std::endl;
+		return false;
+	}
+
+	glGenFramebuffersEXT(1, &fbo);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fbo);
+
+	glGenRenderbuffersEXT(1, &color);
+	glBindRenderbufferEXT(GL_RENDERBUFFER_EXT, color);
+	glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT, GL_RGBA8, dimensions.x, dimensions.y);
+	glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_RENDERBUFFER_EXT, color);
+
+	glGenRenderbuffersEXT(1, &depth);
+	glBindRenderbufferEXT(GL_RENDERBUFFER_EXT, depth);
+	glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT, GL_DEPTH_COMPONENT24, dimensions.x, dimensions.y);
+	glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, depth);
+
+	// There is no window, so this is the only place to draw
+	glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	glReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
+
+	if(glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT) != GL_FRAMEBUFFER_COMPLETE_EXT) {
+		std::cerr << "ERROR: Failed to create the headless framebuffer" << std::endl;
+		return false;
+	}
+
+	main_framebuffer = fbo;
+
+	glViewport(0, 0, dimensions.x, dimensions.y);
+
+	CHECK_GL_ERROR();
+
+	return true;
+}
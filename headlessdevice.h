@@ -0,0 +1,54 @@
+/** @file headlessdevice.h
+ *  @brief Creates an OpenGL context with no window, for benchmarking
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#ifndef _HEADLESS_DEVICE_H_
+#define _HEADLESS_DEVICE_H_
+
+#include "glheaders.h"
+#include "vec/vec.h"
+
+/**
+Creates an OpenGL context through EGL, with no window and no display
+server, e.g. on Mesa's llvmpipe. The Mesa surfaceless platform is tried
+first, then the default display. No default framebuffer is needed, since
+everything is drawn into a frame buffer object of the given size, which
+becomes main_framebuffer.
+
+Not available on Windows, where the context cannot be created.
+*/
+class HeadlessDevice
+{
+public:
+	/** Creates the context and framebuffer. Check is_valid() afterwards. */
+	HeadlessDevice(const ivec2 &_dimensions);
+	~HeadlessDevice();
+
+	/** Returns true if the context and framebuffer were created */
+	bool is_valid() const { return valid; }
+
+	/** Gets the size of the framebuffer */
+	const ivec2 & get_dimensions() const { return dimensions; }
+
+private:
+	// no meaningful assignment or copy
+	HeadlessDevice(const HeadlessDevice &r);
+	HeadlessDevice& operator=(const HeadlessDevice &r);
+
+	bool create_context();
+	bool create_framebuffer();
+
+private:
+	void * display; // EGLDisplay
+	void * context; // EGLContext
+	void * surface; // EGLSurface, only if surfaceless contexts are unsupported
+	GLuint fbo;
+	GLuint color;
+	GLuint depth;
+	ivec2 dimensions;
+	bool valid;
+};
+
+#endif /* _HEADLESS_DEVICE_H_ */
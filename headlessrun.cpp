@@ -0,0 +1,186 @@
+/** @file headlessrun.cpp
+ *  @brief Command line parsing, frame statistics and the frame loop shared
+ *  by headless mode and the benchmarks
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#include "glheaders.h"
+#include "headlessrun.h"
+#include "project.h"
+#include "scene.h"
+#include "gputimer.h"
+#include "renderstats.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+int getarg(int argc, char *argv[], int optc, const char* optv[])
+{
+	for (int i=1; i < argc; i++)
+		for (int j=0; j < optc; j++)
+			if (strcmp(optv[j], argv[i]) == 0)
+				return i;
+
+	return -1;
+}
+
+// the command line options
+static const char* OPT_FR[] = { "-frames", "--frames" };
+#define OPTLEN_FR 2
+static const char* OPT_SZ[] = { "-size", "--size" };
+#define OPTLEN_SZ 2
+
+bool parse_headless_options(int argc, char *argv[], int &frames, ivec2 &dimensions)
+{
+	int index;
+
+	if ((index = getarg(argc, argv, OPTLEN_FR, OPT_FR)) != -1) {
+		if (index >= argc - 1 ||
+				sscanf(argv[index+1], "%d", &frames) != 1 || frames < 1) {
+			std::cerr << "Error: cannot parse frame count.\n";
+			return false;
+		}
+	}
+
+	if ((index = getarg(argc, argv, OPTLEN_SZ, OPT_SZ)) != -1) {
+		if (index >= argc - 1 ||
+				sscanf(argv[index+1], "%dx%d", &dimensions.x, &dimensions.y) != 2 ||
+				dimensions.x < 1 || dimensions.y < 1) {
+			std::cerr << "Error: cannot parse framebuffer size.\n";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+FrameStats::FrameStats(const std::vector<double> &ms)
+: count((int)ms.size()),
+  mean(0), min(0), p50(0), p95(0), p99(0), max(0)
+{
+	if(ms.empty())
+		return;
+
+	std::vector<double> sorted(ms);
+	std::sort(sorted.begin(), sorted.end());
+
+	double total = 0;
+	for(size_t i = 0; i < sorted.size(); ++i) {
+		total += sorted[i];
+	}
+
+	// nearest rank
+	const size_t n = sorted.size();
+	mean = total / n;
+	min = sorted.front();
+	p50 = sorted[std::min(n-1, (n * 50 + 99) / 100 - 1)];
+	p95 = sorted[std::min(n-1, (n * 95 + 99) / 100 - 1)];
+	p99 = sorted[std::min(n-1, (n * 99 + 99) / 100 - 1)];
+	max = sorted.back();
+}
+
+std::ostream& operator<<(std::ostream &o, const FrameStats &stats)
+{
+	if(!stats.count) {
+		return o << "null";
+	}
+
+	return o << "{\"mean\": " << stats.mean
+	         << ", \"min\": " << stats.min
+	         << ", \"p50\": " << stats.p50
+	         << ", \"p95\": " << stats.p95
+	         << ", \"p99\": " << stats.p99
+	         << ", \"max\": " << stats.max << "}";
+}
+
+void print_json_array(std::ostream &o, const std::vector<double> &ms)
+{
+	o << "[";
+
+	for(size_t i = 0; i < ms.size(); ++i) {
+		o << (i ? ", " : "") << ms[i];
+	}
+
+	o << "]";
+}
+
+/**
+ * Reads the GPU time of a frame whenever gpu_timer reads one back.
+ */
+static void collect_gpu_time(int &frames_read, std::vector<double> &gpu_ms)
+{
+	if(gpu_timer.get_frames_read() != frames_read) {
+		frames_read = gpu_timer.get_frames_read();
+		gpu_ms.push_back(gpu_timer.get_frame_ms());
+	}
+}
+
+void render_headless_frames(Scene * scene, int warmup, int frames, double period,
+                            real_t orbit, HeadlessFrames &result)
+{
+	assert(scene);
+
+	for(int frame = 0; frame < warmup; ++frame) {
+		prj_update(scene, period);
+		scene->render();
+	}
+
+	// Wait for the warm-up frames so they are not counted
+	glFinish();
+
+	int frames_read = gpu_timer.get_frames_read();
+	const real_t orbit_step = orbit / frames;
+	trace_time_t frame_end = trace_now();
+
+	result.cpu_ms.reserve(frames);
+	result.frame_ms.reserve(frames);
+	result.gpu_ms.reserve(frames);
+
+	for(int frame = 0; frame < frames; ++frame) {
+		TRACE_ZONE("frame");
+
+		const trace_time_t begin = trace_now();
+
+		if(orbit_step != 0 && scene->primary_camera) {
+			scene->primary_camera->yaw_about_focus(orbit_step);
+		}
+
+		{
+			TRACE_ZONE("prj_update");
+			prj_update(scene, period);
+		}
+
+		scene->render();
+
+		const trace_time_t now = trace_now();
+		result.cpu_ms.push_back((now - begin) / 1000.0);
+		result.frame_ms.push_back((now - frame_end) / 1000.0);
+		frame_end = now;
+
+		// GPU times arrive a few frames late (see GpuTimer::FRAMES)
+		collect_gpu_time(frames_read, result.gpu_ms);
+
+		result.draw_calls += render_stats.get_last_frame().draw_calls;
+		result.bytes_uploaded += render_stats.get_last_frame().bytes_uploaded;
+
+		for(GLenum err = glGetError(); err != GL_NO_ERROR; err = glGetError()) {
+			std::cerr << "ERROR: OpenGL error in frame " << frame << ": "
+			          << gluErrorString(err) << std::endl;
+			result.gl_errors++;
+		}
+	}
+
+	// Read back the GPU times of the last frames
+	glFinish();
+
+	for(int i = 0; i < GpuTimer::FRAMES; ++i) {
+		gpu_timer.begin_frame();
+		collect_gpu_time(frames_read, result.gpu_ms);
+	}
+
+	result.draw_calls /= frames;
+	result.bytes_uploaded /= frames;
+}
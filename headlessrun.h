@@ -0,0 +1,81 @@
+/** @file headlessrun.h
+ *  @brief Command line parsing, frame statistics and the frame loop shared
+ *  by headless mode and the benchmarks
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#ifndef _HEADLESS_RUN_H_
+#define _HEADLESS_RUN_H_
+
+#include "vec/vec.h"
+#include <iosfwd>
+#include <vector>
+
+class Scene;
+
+/**
+ * If any of optv are contained in argv, returns the index into argv. Otherwise
+ * returns -1.
+ */
+int getarg(int argc, char *argv[], int optc, const char* optv[]);
+
+/**
+ * Reads the values of --frames [COUNT] and --size [WIDTH]x[HEIGHT], leaving
+ * those which are not given unchanged. Prints an error and returns false if
+ * either cannot be parsed.
+ */
+bool parse_headless_options(int argc, char *argv[], int &frames, ivec2 &dimensions);
+
+/** The mean, extremes and nearest-rank percentiles of some frame times */
+struct FrameStats
+{
+	int count;
+	double mean, min, p50, p95, p99, max;
+
+	/** All zero if ms is empty */
+	explicit FrameStats(const std::vector<double> &ms);
+};
+
+/** Prints frame statistics as a JSON object, or null if there were none */
+std::ostream& operator<<(std::ostream &o, const FrameStats &stats);
+
+/** Prints frame times as a JSON array */
+void print_json_array(std::ostream &o, const std::vector<double> &ms);
+
+/** Times measured by render_headless_frames() */
+struct HeadlessFrames
+{
+	/** Time spent in prj_update and Scene::render, per frame */
+	std::vector<double> cpu_ms;
+
+	/** Wall time between the ends of consecutive frames */
+	std::vector<double> frame_ms;
+
+	/** GPU time of the frames gpu_timer read back, which may be fewer */
+	std::vector<double> gpu_ms;
+
+	/** Errors reported by glGetError after each frame */
+	int gl_errors;
+
+	/** Per-frame averages, from render_stats */
+	double draw_calls;
+	double bytes_uploaded;
+
+	HeadlessFrames()
+	: gl_errors(0),
+	  draw_calls(0),
+	  bytes_uploaded(0) {}
+};
+
+/**
+ * Renders a loaded scene as fast as possible, simulating period seconds per
+ * frame. The warm-up frames are rendered and waited for first, and are not
+ * measured. The primary camera yaws about its focus by orbit radians in all
+ * over the measured frames. Afterwards the GPU times of the last frames are
+ * read back, so the results are complete.
+ */
+void render_headless_frames(Scene * scene, int warmup, int frames, double period,
+                            real_t orbit, HeadlessFrames &result);
+
+#endif /* _HEADLESS_RUN_H_ */
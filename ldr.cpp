@@ -9,11 +9,15 @@
 #include "project.h"
 #include "scene.h"
 #include "passes.h"
+#include "occlusionquery.h"
+#include "softwareocclusion.h"
+#include "resolutiongovernor.h"
 #include "geom/sphere.h"
 #include "geom/trianglesoup.h"
 #include "geom/watersurface.h"
 #include "geom/pool.h"
 
+#include <cstring>
 #include <iostream>
 
 static
@@ -42,10 +46,11 @@ create_tex_sphere(Scene * scene,
 		                                sphere.normals_buffer,
 										include_tcoords
 										  ? sphere.tcoords_buffer
-										  : boost::shared_ptr< BufferObject<Vec2> >(),
+										  : boost::shared_ptr< VertexStream >(),
 										boost::shared_ptr< const BufferObject<index_t> >(), // no indices
 		                                mat,
 		                                tex));
+	rendermethod->set_bounds(sphere.bounds);
 	scene->rendermethods.push_back(rendermethod);
 
 	return rendermethod;
@@ -83,18 +88,19 @@ create_cubemapped_sphere(Scene * scene,
 	mat.specular = Vec3::Ones * 0.1;
 	
 	// Generate sphere geometry
-	TriangleSoup sphere = gen_sphere(scene, 4);
+	TriangleSoup sphere = gen_sphere(scene, 4, VERTEX_FORMAT_PACKED);
 
 	// Compile a shader for the mirror sphere
 	shader = boost::shared_ptr<ShaderProgram>(new ShaderProgram(vert, frag));
 	
 	// Put it all together to make the object
 	rendermethod = boost::shared_ptr<RenderMethod>(new RenderMethod_CubemapReflection(sphere.vertices_buffer,
-		                                                                              sphere.normals_buffer,
+		                                                                              sphere.packed_normals_buffer,
 												                                      boost::shared_ptr< const BufferObject<index_t> >(), // no indices
 		                                                                              mat,
 		                                                                              cubemap,
 																					  shader));
+	rendermethod->set_bounds(sphere.bounds);
 	scene->rendermethods.push_back(rendermethod);
 
 	return rendermethod;
@@ -123,16 +129,17 @@ static boost::shared_ptr<RenderMethod> create_fresnel_sphere(Scene * scene)
 	scene->resources.push_back(fresnel_shader);
 
 	// Generate sphere geometry
-	TriangleSoup sphere = gen_sphere(scene, 4);
+	TriangleSoup sphere = gen_sphere(scene, 4, VERTEX_FORMAT_PACKED);
 
 	// Put it all together
 	rendermethod = boost::shared_ptr<RenderMethod>(new RenderMethod_FresnelEnvMap(sphere.vertices_buffer,
-	                                                                              sphere.normals_buffer,
+	                                                                              sphere.packed_normals_buffer,
 																				  boost::shared_ptr< const BufferObject<index_t> >(), // no indices
 																				  fresnel_shader,
 																				  mat,
 																				  spheremap,											         											        
 																				  1.33));
+	rendermethod->set_bounds(sphere.bounds);
 	scene->rendermethods.push_back(rendermethod);
 
 	return rendermethod;
@@ -168,11 +175,11 @@ static boost::shared_ptr<RenderMethod> create_bumpy_sphere(Scene * scene)
 	scene->resources.push_back(parallax_bump_shader);
 
 	// Generate sphere geometry
-	TriangleSoup sphere = gen_sphere(scene, 4);
+	TriangleSoup sphere = gen_sphere(scene, 4, VERTEX_FORMAT_PACKED);
 
 	// Put it all together
 	rendermethod = boost::shared_ptr<RenderMethod>(new RenderMethod_BumpMap(sphere.vertices_buffer,
-		                                                                    sphere.normals_buffer,
+		                                                                    sphere.packed_normals_buffer,
 		                                                                    sphere.tangents_buffer,
 											                                sphere.tcoords_buffer,
 												                            boost::shared_ptr< const BufferObject<index_t> >(), // no indices
@@ -181,6 +188,7 @@ static boost::shared_ptr<RenderMethod> create_bumpy_sphere(Scene * scene)
 		                                                                    diffuse_map,
 		                                                                    normal_map,
 		                                                                    height_map));
+	rendermethod->set_bounds(sphere.bounds);
 	scene->rendermethods.push_back(rendermethod);
 
 	return rendermethod;
@@ -222,7 +230,7 @@ static boost::shared_ptr<RenderMethod> create_pool(Scene * scene)
 
 	// Put it all together
 	rendermethod = boost::shared_ptr<RenderMethod>(new RenderMethod_BumpMap(pool.vertices_buffer,
-	                                                                        pool.normals_buffer,
+	                                                                        pool.packed_normals_buffer,
 	                                                                        pool.tangents_buffer,
 											                                pool.tcoords_buffer,
 											                                boost::shared_ptr< const BufferObject<index_t> >(), // no indices
@@ -231,11 +239,57 @@ static boost::shared_ptr<RenderMethod> create_pool(Scene * scene)
 	                                                                        diffuse_map,
 	                                                                        normal_map,
 	                                                                        height_map));
+	rendermethod->set_bounds(pool.bounds);
 	scene->rendermethods.push_back(rendermethod);
 
 	return rendermethod;
 }
 
+/** Returns true if GL_RENDERER names a CPU implementation of OpenGL */
+static bool is_software_renderer(void)
+{
+	static const char * const names[] = { "llvmpipe", "softpipe", "Software Rasterizer", "SwiftShader", "GDI Generic" };
+	const char * renderer = (const char *)glGetString(GL_RENDERER);
+
+	if(!renderer)
+		return false;
+
+	for(size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+	{
+		if(strstr(renderer, names[i]))
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Culls the pass's instances against the pool. GPU occlusion queries are used
+ * on hardware; on software renderers, where queries are expensive, the pool
+ * walls are rasterized on the CPU instead.
+ */
+static void enable_occlusion_culling(StandardPass * pass)
+{
+	assert(pass);
+
+	if(!is_software_renderer()) {
+		pass->occlusion_culler = boost::shared_ptr<OcclusionQueryCuller>(new OcclusionQueryCuller());
+		return;
+	}
+
+	std::vector<Face> faces;
+	gen_pool_faces(faces);
+
+	std::vector<Vec3> vertices;
+	for(std::vector<Face>::const_iterator i = faces.begin(); i != faces.end(); ++i)
+	{
+		vertices.insert(vertices.end(), (*i).vertices, (*i).vertices + 3);
+	}
+
+	pass->software_culler = boost::shared_ptr<SoftwareOcclusionCuller>(new SoftwareOcclusionCuller());
+	pass->software_culler->add_occluder(&vertices[0], vertices.size(), Affine3::Identity);
+}
+
 static void ldr_load_example_scene(Scene * scene)
 {
 	assert(scene);
@@ -265,10 +319,9 @@ static void ldr_load_example_scene(Scene * scene)
 	scene->primary_camera = &(pass->camera);
 
 	// Create an instance of the Earth object
-	boost::shared_ptr<RenderInstance> earth = boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(3.0, 0.0, 0.0, 0.0,
-	                                            	                                                    0.0, 3.0, 0.0, 0.0,
-	                                            													    0.0, 0.0, 3.0, 0.0,
-	                                            													    0.0, 0.0, 0.0, 1.0),
+	boost::shared_ptr<RenderInstance> earth = boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(3.0, 0.0, 0.0, 0.0,
+	                                            	                                                       0.0, 3.0, 0.0, 0.0,
+	                                            													       0.0, 0.0, 3.0, 0.0),
 	                                            	                                               create_tex_sphere(scene,
 																								                     "images/earth.png")));
 	pass->instances.push_back(earth);
@@ -303,18 +356,16 @@ static void ldr_load_cubemap_sphere_scene(Scene * scene)
 	scene->resources.push_back(cubemap);
 
 	// Create an instance of the Earth object
-	boost::shared_ptr<RenderInstance> earth = boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(3.0, 0.0, 0.0, 4.0,
-	                                                                                                    0.0, 3.0, 0.0, 0.0,
-													                                                    0.0, 0.0, 3.0, -5.0,
-													                                                    0.0, 0.0, 0.0, 1.0),
+	boost::shared_ptr<RenderInstance> earth = boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(3.0, 0.0, 0.0, 4.0,
+	                                                                                                       0.0, 3.0, 0.0, 0.0,
+													                                                       0.0, 0.0, 3.0, -5.0),
 	                                                                                               create_tex_sphere(scene, "images/earth.png")));
 	pass->instances.push_back(earth);
 
 	// Create an instance of a cubemapped sphere
-	boost::shared_ptr<RenderInstance> sphere = boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(3.0, 0.0, 0.0, 0.0,
-	                                                                                                     0.0, 3.0, 0.0, 0.0,
-													                                                     0.0, 0.0, 3.0, 0.0,
-													                                                     0.0, 0.0, 0.0, 1.0),
+	boost::shared_ptr<RenderInstance> sphere = boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(3.0, 0.0, 0.0, 0.0,
+	                                                                                                        0.0, 3.0, 0.0, 0.0,
+													                                                        0.0, 0.0, 3.0, 0.0),
 												                                                   create_tex_sphere(scene, cubemap, false)));
 	pass->instances.push_back(sphere);
 
@@ -346,10 +397,9 @@ static void ldr_load_fresnel_sphere_scene(Scene * scene)
 	pass->proj = Mat4::perspective(PI / 3.0, 800.0/600.0, 0.1, 100.0);
 
 	// Create an instance of the object
-	const Mat4 obj_space_to_wld_space(3.0, 0.0, 0.0, 0.0,
-	                                  0.0, 3.0, 0.0, 0.0,
-								      0.0, 0.0, 3.0, 0.0,
-								      0.0, 0.0, 0.0, 1.0);
+	const Affine3 obj_space_to_wld_space(3.0, 0.0, 0.0, 0.0,
+	                                     0.0, 3.0, 0.0, 0.0,
+								         0.0, 0.0, 3.0, 0.0);
 	boost::shared_ptr<RenderInstance> fresnel = boost::shared_ptr<RenderInstance>(new RenderInstance(obj_space_to_wld_space, create_fresnel_sphere(scene)));
 	pass->instances.push_back(fresnel);
 
@@ -424,6 +474,44 @@ create_water(Scene * scene,
 								                                           mat,
 								                                           cubemap,
 								                                           1.33));
+	water->set_bounds(watergeom->get_bounds());
+	water->set_animator(watergeom);
+	scene->rendermethods.push_back(water);
+
+	return water;
+}
+
+static boost::shared_ptr<RenderMethod>
+create_planar_water(Scene * scene,
+                    const boost::shared_ptr<const PlanarReflectionPass> &reflection)
+{
+	Material mat;
+	boost::shared_ptr<WaterSurface> watergeom;
+	boost::shared_ptr<ShaderProgram> shader;
+	boost::shared_ptr<RenderMethod> water;
+
+	assert(reflection);
+
+	mat.ambient = Vec3(0.0, 0.2, 0.3);
+	mat.diffuse = Vec3(0.0, 0.2, 0.3); // blue water
+	mat.shininess = 20;
+	mat.specular = Vec3::Ones;
+
+	shader = boost::shared_ptr<ShaderProgram>(new ShaderProgram("shaders/fresnel_planar_vert.glsl",
+	                                                            "shaders/fresnel_planar_frag.glsl"));
+	scene->resources.push_back(shader);
+
+	watergeom = gen_water_surface(scene);
+
+	water = boost::shared_ptr<RenderMethod>(new RenderMethod_PlanarReflection(watergeom->vertices_buffer,
+	                                                                          watergeom->normals_buffer,
+	                                                                          watergeom->indices_buffer,
+	                                                                          shader,
+	                                                                          mat,
+	                                                                          reflection,
+	                                                                          1.33));
+	water->set_bounds(watergeom->get_bounds());
+	water->set_animator(watergeom);
 	scene->rendermethods.push_back(water);
 
 	return water;
@@ -456,31 +544,28 @@ static void ldr_load_pool_scene(Scene * scene)
 	// Render target for the main framebuffer
 	pass->rendertarget = boost::shared_ptr<RenderTarget2D>(); // set to null
 	pass->proj = Mat4::perspective(PI / 3.0, 800.0/600.0, 0.1, 100.0);
+	enable_occlusion_culling(pass.get());
 
-	pass->instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4::Identity, pool)));
+	pass->instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3::Identity, pool)));
 
-	pass->instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(PIX, 0.0, 0.0, 0.0,
-	                                                                                    0.0, 0.4, 0.0, POY - 1.0,
-	                                                                                    0.0, 0.0, PIZ, 0.0,
-	                                                                                    0.0, 0.0, 0.0, 1.0),
+	pass->instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(PIX, 0.0, 0.0, 0.0,
+	                                                                                       0.0, 0.4, 0.0, POY - 1.0,
+	                                                                                       0.0, 0.0, PIZ, 0.0),
 	                                                                               water)));
 
-	pass->instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(rad, 0.0, 0.0, (POX+PIX)/2,
-	                                                                                    0.0, rad, 0.0, POY+rad,
-												                                        0.0, 0.0, rad, (POZ+PIZ)/2,
-												                                        0.0, 0.0, 0.0, 1.0),
+	pass->instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(rad, 0.0, 0.0, (POX+PIX)/2,
+	                                                                                       0.0, rad, 0.0, POY+rad,
+												                                           0.0, 0.0, rad, (POZ+PIZ)/2),
 													                               earth)));
 
-	pass->instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(rad, 0.0, 0.0, -(POX+PIX)/2,
-	                                                                                    0.0, rad, 0.0, POY+rad,
-	                                                                                    0.0, 0.0, rad, -(POZ+PIZ)/2,
-	                                                                                    0.0, 0.0, 0.0, 1.0),
+	pass->instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(rad, 0.0, 0.0, -(POX+PIX)/2,
+	                                                                                       0.0, rad, 0.0, POY+rad,
+	                                                                                       0.0, 0.0, rad, -(POZ+PIZ)/2),
 	                                                                               fresnel_sphere)));
 
-	pass->instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(rad, 0.0, 0.0, (POX+PIX)/2,
-	                                                                                    0.0, rad, 0.0, POY+rad,
-													                                    0.0, 0.0, rad, -(POZ+PIZ)/2,
-													                                    0.0, 0.0, 0.0, 1.0),
+	pass->instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(rad, 0.0, 0.0, (POX+PIX)/2,
+	                                                                                       0.0, rad, 0.0, POY+rad,
+													                                       0.0, 0.0, rad, -(POZ+PIZ)/2),
 												                                    swirly_sphere)));
 
 	// Set up the camera
@@ -511,10 +596,9 @@ static void ldr_load_bumpy_sphere_scene(Scene * scene)
 	pass->proj = Mat4::perspective(PI / 3.0, 800.0/600.0, 0.1, 100.0);
 
 	// Create an instance of the Earth object
-	boost::shared_ptr<RenderInstance> bumpy = boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(3.0, 0.0, 0.0, 0.0,
-	                                                                                                    0.0, 3.0, 0.0, 0.0,
-												                                                        0.0, 0.0, 3.0, 0.0,
-												                                                        0.0, 0.0, 0.0, 1.0),
+	boost::shared_ptr<RenderInstance> bumpy = boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(3.0, 0.0, 0.0, 0.0,
+	                                                                                                       0.0, 3.0, 0.0, 0.0,
+												                                                           0.0, 0.0, 3.0, 0.0),
 												                                                   create_bumpy_sphere(scene)));
 	pass->instances.push_back(bumpy);
 
@@ -541,8 +625,8 @@ static void ldr_load_rendertarget_scene_1(Scene * scene)
 
 	boost::shared_ptr<StandardPass> pass1 = boost::shared_ptr<StandardPass>(new StandardPass());
 
-	// Render target for the main framebuffer
-	boost::shared_ptr<RenderTarget2D> rendertarget1 = boost::shared_ptr<RenderTarget2D>(new RenderTarget2D(ivec2(256,256)));
+	// Render target for the main framebuffer, only needed within the frame
+	boost::shared_ptr<RenderTarget2D> rendertarget1 = boost::shared_ptr<RenderTarget2D>(new RenderTarget2D(ivec2(256,256), true));
 	scene->resources.push_back(rendertarget1);
 	pass1->rendertarget = rendertarget1;
 	pass1->proj = Mat4::perspective(PI / 3.0, 1.0, 0.1, 100.0);
@@ -552,10 +636,9 @@ static void ldr_load_rendertarget_scene_1(Scene * scene)
 	pass1->clear_color = Vec4(0.3, 0.3, 0.3, 1.0);
 
 	// Add a bumpy sphere
-	pass1->instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(3.0, 0.0, 0.0, 0.0,
-	                                                                                     0.0, 3.0, 0.0, 0.0,
-													                                     0.0, 0.0, 3.0, 0.0,
-													                                     0.0, 0.0, 0.0, 1.0),
+	pass1->instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(3.0, 0.0, 0.0, 0.0,
+	                                                                                        0.0, 3.0, 0.0, 0.0,
+													                                        0.0, 0.0, 3.0, 0.0),
 												                                    create_bumpy_sphere(scene))));
 
 	/************************************************************************/
@@ -603,8 +686,9 @@ static void ldr_load_rendertarget_scene_1(Scene * scene)
 														                                                    geom.tcoords_buffer,
 																											boost::shared_ptr< const BufferObject<index_t> >(), // no indices
 														                                                    rendertarget1));
+		r->set_bounds(geom.bounds);
 		scene->rendermethods.push_back(r);
-		pass2->instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4::Identity, r)));
+		pass2->instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3::Identity, r)));
 	}
 
 	/************************************************************************/
@@ -612,9 +696,13 @@ static void ldr_load_rendertarget_scene_1(Scene * scene)
 	// Set the scene's primary camera
 	scene->primary_camera = &(pass2->camera);
 
-	// Set up the order of passes
-	scene->passes.push_back(pass1);
+	// Draw less of rendertarget1 when the frame runs long
+	scene->resolution_governor = boost::shared_ptr<ResolutionGovernor>(new ResolutionGovernor());
+	scene->resolution_governor->add_target(rendertarget1);
+
+	// The frame graph runs pass1 first, as pass2 reads its target
 	scene->passes.push_back(pass2);
+	scene->passes.push_back(pass1);
 }
 
 static TriangleSoup create_square(Scene * scene)
@@ -665,13 +753,13 @@ static boost::shared_ptr<RenderInstance> create_square(real_t x, real_t y,
 	                                                                                                    geom.tcoords_buffer,
 																										boost::shared_ptr< const BufferObject<index_t> >(), // no indices
 	                                                                                                    tex));
+	r->set_bounds(geom.bounds);
 
 	scene->rendermethods.push_back(r);
 
-	return boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(w,   0.0, 0.0, x,
-	                                                                 0.0, h,   0.0, y,
-								                                     0.0, 0.0, w,   0.0,
-								                                     0.0, 0.0, 0.0, 1.0), r));
+	return boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(w,   0.0, 0.0, x,
+	                                                                    0.0, h,   0.0, y,
+								                                        0.0, 0.0, w,   0.0), r));
 }
 
 static void ldr_load_rendertarget_scene_2(Scene * scene)
@@ -704,31 +792,27 @@ static void ldr_load_rendertarget_scene_2(Scene * scene)
 		boost::shared_ptr<RenderMethod> fresnel_sphere = create_fresnel_sphere(scene);
 		boost::shared_ptr<RenderMethod> swirly_sphere = create_tex_sphere(scene, "images/swirly.png");
 
-		instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4::Identity,
+		instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3::Identity,
 		                                                                         pool)));
 
-		instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(PIX, 0.0, 0.0, 0.0,
-		                                                                              0.0, 0.4, 0.0, POY - 1.0,
-		                                                                              0.0, 0.0, PIZ, 0.0,
-		                                                                              0.0, 0.0, 0.0, 1.0),
+		instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(PIX, 0.0, 0.0, 0.0,
+		                                                                                 0.0, 0.4, 0.0, POY - 1.0,
+		                                                                                 0.0, 0.0, PIZ, 0.0),
 		                                                                         water)));
 
-		instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(rad, 0.0, 0.0, (POX+PIX)/2,
-		                                                                              0.0, rad, 0.0, POY+rad,
-		                                                                              0.0, 0.0, rad, (POZ+PIZ)/2,
-		                                                                              0.0, 0.0, 0.0, 1.0),
+		instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(rad, 0.0, 0.0, (POX+PIX)/2,
+		                                                                                 0.0, rad, 0.0, POY+rad,
+		                                                                                 0.0, 0.0, rad, (POZ+PIZ)/2),
 		                                                                         earth)));
 
-		instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(rad, 0.0, 0.0, -(POX+PIX)/2,
-		                                                                              0.0, rad, 0.0, POY+rad,
-		                                                                              0.0, 0.0, rad, -(POZ+PIZ)/2,
-		                                                                              0.0, 0.0, 0.0, 1.0),
+		instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(rad, 0.0, 0.0, -(POX+PIX)/2,
+		                                                                                 0.0, rad, 0.0, POY+rad,
+		                                                                                 0.0, 0.0, rad, -(POZ+PIZ)/2),
 		                                                                         fresnel_sphere)));
 
-		instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(rad, 0.0, 0.0, (POX+PIX)/2,
-		                                                                              0.0, rad, 0.0, POY+rad,
-		                                                                              0.0, 0.0, rad, -(POZ+PIZ)/2,
-		                                                                              0.0, 0.0, 0.0, 1.0),
+		instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(rad, 0.0, 0.0, (POX+PIX)/2,
+		                                                                                 0.0, rad, 0.0, POY+rad,
+		                                                                                 0.0, 0.0, rad, -(POZ+PIZ)/2),
 		                                                                         swirly_sphere)));
 	}
 
@@ -737,7 +821,7 @@ static void ldr_load_rendertarget_scene_2(Scene * scene)
 	for(int i=FACE_BEGIN; i<FACE_END; ++i)
 	{
 		pass_face[i] = boost::shared_ptr<StandardPass>(new StandardPass());
-		rt_face[i] = boost::shared_ptr<RenderTarget2D>(new RenderTarget2D(ivec2(128,128)));
+		rt_face[i] = boost::shared_ptr<RenderTarget2D>(new RenderTarget2D(ivec2(128,128), true));
 		scene->resources.push_back(rt_face[i]);
 		pass_face[i]->rendertarget = rt_face[i];
 		pass_face[i]->proj = Mat4::perspective(PI / 2.0, 1.0, 0.1, 100.0);
@@ -772,14 +856,20 @@ static void ldr_load_rendertarget_scene_2(Scene * scene)
 	// Set the scene's primary camera
 	scene->primary_camera = &(pass_main->camera);
 
-	// Set up the order of passes
-	scene->passes.push_back(pass_face[FRONT]);
-	scene->passes.push_back(pass_face[BACK]);
-	scene->passes.push_back(pass_face[TOP]);
-	scene->passes.push_back(pass_face[BOTTOM]);
-	scene->passes.push_back(pass_face[LEFT]);
-	scene->passes.push_back(pass_face[RIGHT]);
+	// Draw less of each face when the frame runs long
+	scene->resolution_governor = boost::shared_ptr<ResolutionGovernor>(new ResolutionGovernor());
+	for(int i=FACE_BEGIN; i<FACE_END; ++i)
+	{
+		scene->resolution_governor->add_target(rt_face[i]);
+	}
+
+	// The frame graph runs the face passes before pass_main, which reads
+	// their targets
 	scene->passes.push_back(pass_main);
+	for(int i=FACE_BEGIN; i<FACE_END; ++i)
+	{
+		scene->passes.push_back(pass_face[i]);
+	}
 }
 
 static
@@ -787,7 +877,8 @@ Pass::RenderInstanceList
 ldr_load_cubemap_rendertarget_scene_2_setup_instances(Scene * scene,
 													  boost::shared_ptr<CubeMapTarget> &cubemap1,
 													  boost::shared_ptr<CubeMapTarget> &cubemap2,
-													  boost::shared_ptr<CubeMapTarget> &cubemap3,
+													  boost::shared_ptr<PlanarReflectionPass> &reflection,
+													  boost::shared_ptr<RenderInstance> &water_instance,
 													  const real_t rad)
 {
 	Pass::RenderInstanceList instances;
@@ -796,36 +887,33 @@ ldr_load_cubemap_rendertarget_scene_2_setup_instances(Scene * scene,
 
 	boost::shared_ptr<RenderMethod> pool = create_pool(scene);
 	boost::shared_ptr<RenderMethod> earth = create_tex_sphere(scene, "images/earth.png");
-	boost::shared_ptr<RenderMethod> water = create_water(scene, cubemap3);
+	boost::shared_ptr<RenderMethod> water = create_planar_water(scene, reflection);
 	boost::shared_ptr<RenderMethod> swirly_sphere = create_tex_sphere(scene, "images/swirly.png");
 	boost::shared_ptr<RenderMethod> mirror_sphere1 = create_cubemapped_sphere(scene, cubemap1, "shaders/reflect_vert.glsl", "shaders/reflect_frag.glsl");
 	boost::shared_ptr<RenderMethod> mirror_sphere2 = create_cubemapped_sphere(scene, cubemap2, "shaders/reflect_vert.glsl", "shaders/reflect_frag.glsl");
 
-	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4::Identity,
+	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3::Identity,
 	                                                                         pool)));
 
-	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(PIX, 0.0, 0.0, 0.0,
+	water_instance = boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(PIX, 0.0, 0.0, 0.0,
 	                                                                              0.0, 0.4, 0.0, POY - 1.0,
-	                                                                              0.0, 0.0, PIZ, 0.0,
-	                                                                              0.0, 0.0, 0.0, 1.0),
-	                                                                         water)));
+	                                                                              0.0, 0.0, PIZ, 0.0),
+	                                                                      water));
+	instances.push_back(water_instance);
 
-	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(rad*2, 0.0, 0.0, -(POX+PIX)/2,
-		                                                                          0.0, rad*2, 0.0, POY+rad*2,
-		                                                                          0.0, 0.0, rad*2, -(POZ+PIZ)/2,
-		                                                                          0.0, 0.0, 0.0, 1.0),
+	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(rad*2, 0.0, 0.0, -(POX+PIX)/2,
+		                                                                             0.0, rad*2, 0.0, POY+rad*2,
+		                                                                             0.0, 0.0, rad*2, -(POZ+PIZ)/2),
 		                                                                     earth)));
 
-	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(rad, 0.0, 0.0, (POX+PIX)/2,
-	                                                                              0.0, rad, 0.0, POY+rad,
-	                                                                              0.0, 0.0, rad, (POZ+PIZ)/2,
-	                                                                              0.0, 0.0, 0.0, 1.0),
+	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(rad, 0.0, 0.0, (POX+PIX)/2,
+	                                                                                 0.0, rad, 0.0, POY+rad,
+	                                                                                 0.0, 0.0, rad, (POZ+PIZ)/2),
 	                                                                         mirror_sphere1)));
 
-	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(rad, 0.0, 0.0, (POX+PIX)/2,
-	                                                                              0.0, rad, 0.0, POY+rad,
-	                                                                              0.0, 0.0, rad, -(POZ+PIZ)/2,
-	                                                                              0.0, 0.0, 0.0, 1.0),
+	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(rad, 0.0, 0.0, (POX+PIX)/2,
+	                                                                                 0.0, rad, 0.0, POY+rad,
+	                                                                                 0.0, 0.0, rad, -(POZ+PIZ)/2),
 	                                                                         mirror_sphere2)));
 
 	return instances;
@@ -833,9 +921,12 @@ ldr_load_cubemap_rendertarget_scene_2_setup_instances(Scene * scene,
 
 void ldr_load_cubemap_rendertarget_scene_2(Scene * scene)
 {
-	boost::shared_ptr<CubeMapUpdatePass> pass1, pass2, pass3;
+	boost::shared_ptr<CubeMapUpdatePass> pass1, pass2;
+	boost::shared_ptr<PlanarReflectionPass> pass3;
 	boost::shared_ptr<StandardPass> pass4;
-	boost::shared_ptr<CubeMapTarget> cubemap1, cubemap2, cubemap3;
+	boost::shared_ptr<CubeMapTarget> cubemap1, cubemap2;
+	boost::shared_ptr<RenderTarget2D> reflection_target;
+	boost::shared_ptr<RenderInstance> water_instance;
 	const real_t rad = 2.0;
 
 	// Light the scene
@@ -845,14 +936,17 @@ void ldr_load_cubemap_rendertarget_scene_2(Scene * scene)
 	scene->lights.push_back(light);
 	scene->ambient_light = Vec3(.1, .1, .1);
 
-	// Create the cubemaps (used for reflections)
-	cubemap1 = boost::shared_ptr<CubeMapTarget>(new CubeMapTarget(ivec2(128, 128)));
-	cubemap2 = boost::shared_ptr<CubeMapTarget>(new CubeMapTarget(ivec2(128, 128)));
-	cubemap3 = boost::shared_ptr<CubeMapTarget>(new CubeMapTarget(ivec2(128, 128)));
+	// Create the cubemaps (used for reflections), caching the static pool
+	cubemap1 = boost::shared_ptr<CubeMapTarget>(new CubeMapTarget(ivec2(128, 128), true));
+	cubemap2 = boost::shared_ptr<CubeMapTarget>(new CubeMapTarget(ivec2(128, 128), true));
 
 	scene->resources.push_back(cubemap1);
 	scene->resources.push_back(cubemap2);
-	scene->resources.push_back(cubemap3);
+
+	// The water only reflects what is above it, so a single mirrored view
+	// replaces a six-face cubemap
+	reflection_target = boost::shared_ptr<RenderTarget2D>(new RenderTarget2D(ivec2(400, 300)));
+	scene->resources.push_back(reflection_target);
 
 	// Cubemap Update Pass 1 (mirrored sphere #1)
 	pass1 = boost::shared_ptr<CubeMapUpdatePass>(new CubeMapUpdatePass());
@@ -862,6 +956,7 @@ void ldr_load_cubemap_rendertarget_scene_2(Scene * scene)
 	pass1->camera.position = Vec3((POX+PIX)/2, POY+rad, (POZ+PIZ)/2); // position of the first mirrored sphere
 	pass1->camera.focus_dist = 1.0;
 	pass1->clear_color = Vec4(0.0, 0.0, 0.0, 1.0);
+	pass1->update_policy = CubeMapUpdatePass::UPDATE_WHEN_DIRTY;
 
 	// Cubemap Update Pass 2 (mirrored sphere #2)
 	pass2 = boost::shared_ptr<CubeMapUpdatePass>(new CubeMapUpdatePass());
@@ -871,15 +966,7 @@ void ldr_load_cubemap_rendertarget_scene_2(Scene * scene)
 	pass2->camera.position = Vec3((POX+PIX)/2, POY+rad, -(POZ+PIZ)/2); // position of the second mirrored sphere
 	pass2->camera.focus_dist = 1.0;
 	pass2->clear_color = Vec4(0.0, 0.0, 0.0, 1.0);
-
-	// Cubemap Update Pass 3 (water)
-	pass3 = boost::shared_ptr<CubeMapUpdatePass>(new CubeMapUpdatePass());
-	pass3->cubemaptarget = cubemap3;
-	pass3->proj = Mat4::perspective(PI / 2.0, 1.0, 1.0, 50.0);
-	pass3->camera.orientation = Quat::Identity; // orientation is irrelevant as given here
-	pass3->camera.position = Vec3(0.0, POY - 1.0, 0.0); // position of the water surface
-	pass3->camera.focus_dist = 1.0;
-	pass3->clear_color = Vec4(0.3, 0.3, 0.3, 1.0);
+	pass2->update_policy = CubeMapUpdatePass::UPDATE_WHEN_DIRTY;
 
 	// Framebuffer update pass 
 	pass4 = boost::shared_ptr<StandardPass>(new StandardPass());
@@ -888,17 +975,43 @@ void ldr_load_cubemap_rendertarget_scene_2(Scene * scene)
 	pass4->camera.orientation = Quat::Identity;
 	pass4->camera.position = Vec3(0,0,20);
 	pass4->camera.focus_dist = 10;
+	enable_occlusion_culling(pass4.get());
+
+	// Planar Reflection Pass 3 (water), mirroring the main camera
+	pass3 = boost::shared_ptr<PlanarReflectionPass>(new PlanarReflectionPass());
+	pass3->rendertarget = reflection_target;
+	pass3->proj = pass4->proj;
+	pass3->source_camera = &(pass4->camera);
+	pass3->plane = Vec4(0.0, 1.0, 0.0, -(POY - 1.0)); // the water's rest plane
+	pass3->clear_color = Vec4(0.3, 0.3, 0.3, 1.0);
 
 	// Specify geometry to use for each pass
 	pass4->instances =
-	pass3->instances =
 	pass2->instances =
-	pass1->instances = ldr_load_cubemap_rendertarget_scene_2_setup_instances(scene, cubemap1, cubemap2, cubemap3, rad);
+	pass1->instances = ldr_load_cubemap_rendertarget_scene_2_setup_instances(scene, cubemap1, cubemap2, pass3, water_instance, rad);
+
+	// The water cannot appear in its own reflection
+	for(Pass::RenderInstanceList::const_iterator i = pass4->instances.begin();
+		i != pass4->instances.end(); ++i)
+	{
+		if(*i != water_instance) {
+			pass3->instances.push_back(*i);
+		}
+	}
 
 	// Set the scene's primary camera
 	scene->primary_camera = &(pass4->camera);
 
-	// Set up the order of passes
+	// Lower the resolution of the reflections when the frame runs long
+	scene->resolution_governor = boost::shared_ptr<ResolutionGovernor>(new ResolutionGovernor());
+	scene->resolution_governor->add_target(reflection_target);
+	scene->resolution_governor->add_target(cubemap1);
+	scene->resolution_governor->add_target(cubemap2);
+
+	// The probes and the reflection read one another's targets, so the frame
+	// graph keeps this order between them and each sees the others' contents
+	// from the previous frame. Probes are skipped while nothing visible
+	// reflects them.
 	scene->passes.push_back(pass1);
 	scene->passes.push_back(pass2);
 	scene->passes.push_back(pass3);
@@ -919,31 +1032,27 @@ Pass::RenderInstanceList build_pool_geometry(Scene * scene, real_t rad)
 	boost::shared_ptr<RenderMethod> water = create_water(scene, spheremap);
 	boost::shared_ptr<RenderMethod> swirly_sphere = create_tex_sphere(scene, "images/swirly.png");
 
-	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4::Identity,
+	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3::Identity,
 	                                                                         pool)));
 
-	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(PIX, 0.0, 0.0, 0.0,
-	                                                                              0.0, 0.4, 0.0, POY - 1.0,
-	                                                                              0.0, 0.0, PIZ, 0.0,
-	                                                                              0.0, 0.0, 0.0, 1.0),
+	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(PIX, 0.0, 0.0, 0.0,
+	                                                                                 0.0, 0.4, 0.0, POY - 1.0,
+	                                                                                 0.0, 0.0, PIZ, 0.0),
 	                                                                         water)));
 
-	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(rad, 0.0, 0.0, (POX+PIX)/2,
-	                                                                              0.0, rad, 0.0, POY+rad,
-	                                                                              0.0, 0.0, rad, (POZ+PIZ)/2,
-	                                                                              0.0, 0.0, 0.0, 1.0),
+	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(rad, 0.0, 0.0, (POX+PIX)/2,
+	                                                                                 0.0, rad, 0.0, POY+rad,
+	                                                                                 0.0, 0.0, rad, (POZ+PIZ)/2),
 	                                                                         swirly_sphere)));
 
-	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(rad, 0.0, 0.0, -(POX+PIX)/2,
-	                                                                              0.0, rad, 0.0, POY+rad,
-	                                                                              0.0, 0.0, rad, -(POZ+PIZ)/2,
-	                                                                              0.0, 0.0, 0.0, 1.0),
+	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(rad, 0.0, 0.0, -(POX+PIX)/2,
+	                                                                                 0.0, rad, 0.0, POY+rad,
+	                                                                                 0.0, 0.0, rad, -(POZ+PIZ)/2),
 	                                                                         earth)));
 
-	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(rad, 0.0, 0.0, (POX+PIX)/2,
-	                                                                              0.0, rad, 0.0, POY+rad,
-	                                                                              0.0, 0.0, rad, -(POZ+PIZ)/2,
-	                                                                              0.0, 0.0, 0.0, 1.0),
+	instances.push_back(boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(rad, 0.0, 0.0, (POX+PIX)/2,
+	                                                                                 0.0, rad, 0.0, POY+rad,
+	                                                                                 0.0, 0.0, rad, -(POZ+PIZ)/2),
 	                                                                         swirly_sphere)));
 
 	return instances;
@@ -977,6 +1086,7 @@ static void ldr_load_cubemap_rendertarget_scene_1(Scene * scene)
 		pass_cubemap->camera.position = Vec3((POX+PIX)/2, POY+rad, (POZ+PIZ)/2);
 		pass_cubemap->camera.focus_dist = 1.0;
 		pass_cubemap->instances = build_pool_geometry(scene, rad);
+		pass_cubemap->update_policy = CubeMapUpdatePass::UPDATE_WHEN_DIRTY;
 	}
 
 	/************************************************************************/
@@ -991,18 +1101,16 @@ static void ldr_load_cubemap_rendertarget_scene_1(Scene * scene)
 		pass_main->camera.focus_dist = 10;
 	
 		// Create an instance of the Earth object
-		boost::shared_ptr<RenderInstance> earth = boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(3.0, 0.0, 0.0, 4.0,
-		                                                 0.0, 3.0, 0.0, 0.0,
-														 0.0, 0.0, 3.0, -5.0,
-														 0.0, 0.0, 0.0, 1.0),
+		boost::shared_ptr<RenderInstance> earth = boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(3.0, 0.0, 0.0, 4.0,
+		                                                    0.0, 3.0, 0.0, 0.0,
+														    0.0, 0.0, 3.0, -5.0),
 		                                            create_tex_sphere(scene, "images/earth.png")));
 		pass_main->instances.push_back(earth);
 	
 		// Create an instance of a cubemapped sphere
-		boost::shared_ptr<RenderInstance> sphere = boost::shared_ptr<RenderInstance>(new RenderInstance(Mat4(3.0, 0.0, 0.0, 0.0,
-		                                                  0.0, 3.0, 0.0, 0.0,
-														  0.0, 0.0, 3.0, 0.0,
-														  0.0, 0.0, 0.0, 1.0),
+		boost::shared_ptr<RenderInstance> sphere = boost::shared_ptr<RenderInstance>(new RenderInstance(Affine3(3.0, 0.0, 0.0, 0.0,
+		                                                     0.0, 3.0, 0.0, 0.0,
+														     0.0, 0.0, 3.0, 0.0),
 													create_tex_sphere(scene, cubemap, false)));
 		pass_main->instances.push_back(sphere);
 	}
@@ -1010,6 +1118,10 @@ static void ldr_load_cubemap_rendertarget_scene_1(Scene * scene)
 	// Set the scene's primary camera
 	scene->primary_camera = &(pass_main->camera);
 
+	// Shrink the cube map when the frame runs long
+	scene->resolution_governor = boost::shared_ptr<ResolutionGovernor>(new ResolutionGovernor());
+	scene->resolution_governor->add_target(cubemap);
+
 	scene->passes.push_back(pass_cubemap);
 	scene->passes.push_back(pass_main);
 }
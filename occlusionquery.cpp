@@ -0,0 +1,240 @@
+/** @file occlusionquery.cpp
+ *  @brief Hardware occlusion culling with temporally coherent GL queries
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#include "glheaders.h"
+#include "occlusionquery.h"
+
+#include <iostream>
+
+static void draw_instance(const RenderInstance &instance)
+{
+	glPushAttrib(GL_ALL_ATTRIB_BITS);
+	instance.draw();
+	glPopAttrib();
+	CHECK_GL_ERROR();
+}
+
+std::ostream& operator<<(std::ostream &o, const OcclusionStats &stats)
+{
+	o << "instances=" << stats.instances
+	  << " culled=" << stats.culled
+	  << " queries_issued=" << stats.queries_issued
+	  << " queries_pending=" << stats.queries_pending
+	  << " results_retrieved=" << stats.results_retrieved
+	  << " mean_latency=" << stats.mean_latency << " frames";
+	return o;
+}
+
+OcclusionQueryCuller::OcclusionQueryCuller(int _visible_query_interval)
+: query_target(GL_SAMPLES_PASSED),
+  visible_query_interval(_visible_query_interval),
+  frame(0)
+{
+	assert(visible_query_interval > 0);
+
+	// ANY_SAMPLES_PASSED lets the driver stop counting at the first sample
+	if(glewIsSupported("GL_ARB_occlusion_query2")) {
+		query_target = GL_ANY_SAMPLES_PASSED;
+	}
+}
+
+OcclusionQueryCuller::~OcclusionQueryCuller()
+{
+	release_queries();
+}
+
+void OcclusionQueryCuller::release_queries()
+{
+	for(std::vector<InstanceState>::iterator i = states.begin();
+		i != states.end(); ++i)
+	{
+		glDeleteQueries(1, &(*i).query);
+	}
+
+	states.clear();
+}
+
+bool OcclusionQueryCuller::needs_reset(const Pass::RenderInstanceList &instances) const
+{
+	if(states.size() != instances.size())
+		return true;
+
+	for(size_t i = 0; i < instances.size(); ++i)
+	{
+		if(states[i].instance != instances[i].get())
+			return true;
+	}
+
+	return false;
+}
+
+void OcclusionQueryCuller::reset(const Pass::RenderInstanceList &instances)
+{
+	release_queries();
+
+	states.resize(instances.size());
+
+	for(size_t i = 0; i < instances.size(); ++i)
+	{
+		InstanceState &state = states[i];
+		state.instance = instances[i].get();
+		state.pending = false;
+		state.visible = true; // draw everything until we know better
+		state.issue_frame = frame;
+		glGenQueries(1, &state.query);
+	}
+}
+
+void OcclusionQueryCuller::retrieve_results()
+{
+	int latency = 0;
+
+	for(std::vector<InstanceState>::iterator i = states.begin();
+		i != states.end(); ++i)
+	{
+		InstanceState &state = *i;
+
+		if(!state.pending)
+			continue;
+
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(state.query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+		if(!available)
+			continue; // keep using the old result rather than stall
+
+		GLuint samples = 0;
+		glGetQueryObjectuiv(state.query, GL_QUERY_RESULT, &samples);
+
+		state.pending = false;
+		state.visible = (samples > 0);
+
+		latency += frame - state.issue_frame;
+		stats.results_retrieved++;
+	}
+
+	if(stats.results_retrieved > 0) {
+		stats.mean_latency = (double)latency / stats.results_retrieved;
+	}
+}
+
+void OcclusionQueryCuller::begin_query(InstanceState &state)
+{
+	glBeginQuery(query_target, state.query);
+	state.pending = true;
+	state.issue_frame = frame;
+	stats.queries_issued++;
+}
+
+void OcclusionQueryCuller::end_query()
+{
+	glEndQuery(query_target);
+}
+
+void OcclusionQueryCuller::draw(const Pass::RenderInstanceList &instances,
+                                const Vec3 &eye,
+                                real_t near_clip)
+{
+	CHECK_GL_ERROR();
+
+	frame++;
+	stats = OcclusionStats();
+	stats.instances = (int)instances.size();
+
+	if(needs_reset(instances)) {
+		reset(instances);
+	}
+
+	retrieve_results();
+
+	// Draw everything believed to be visible. This also lays down the depth
+	// buffer against which the occluded instances are tested below.
+	for(size_t i = 0; i < instances.size(); ++i)
+	{
+		InstanceState &state = states[i];
+		const AABB bounds = instances[i]->get_bounds();
+
+		// Instances without bounds, or which the near plane may cut through,
+		// cannot be tested with a bounding box and are always drawn.
+		if(bounds.is_empty() || bounds.expand(near_clip).contains(eye)) {
+			state.visible = true;
+			draw_instance(*instances[i]);
+			continue;
+		}
+
+		if(!state.visible) {
+			stats.culled++;
+			continue;
+		}
+
+		// Stagger the checks so that the queries are spread across frames
+		const bool check = !state.pending &&
+		                   ((frame + (int)i) % visible_query_interval) == 0;
+
+		if(check) { begin_query(state); }
+		draw_instance(*instances[i]);
+		if(check) { end_query(); }
+	}
+
+	// Test the bounding boxes of occluded instances without touching the
+	// color or depth buffers.
+	glPushAttrib(GL_ALL_ATTRIB_BITS);
+	glUseProgramObjectARB(0);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_TEXTURE_2D);
+	glDisable(GL_CULL_FACE);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+
+	for(size_t i = 0; i < instances.size(); ++i)
+	{
+		InstanceState &state = states[i];
+
+		if(state.visible || state.pending)
+			continue;
+
+		begin_query(state);
+		draw_bounding_box(instances[i]->get_bounds());
+		end_query();
+	}
+
+	glPopAttrib();
+
+	for(std::vector<InstanceState>::const_iterator i = states.begin();
+		i != states.end(); ++i)
+	{
+		if((*i).pending) stats.queries_pending++;
+	}
+
+	CHECK_GL_ERROR();
+}
+
+void OcclusionQueryCuller::draw_bounding_box(const AABB &box)
+{
+	static const int quads[6][4] =
+	{
+		{ 0, 2, 3, 1 }, // -Z
+		{ 4, 5, 7, 6 }, // +Z
+		{ 0, 1, 5, 4 }, // -Y
+		{ 2, 6, 7, 3 }, // +Y
+		{ 0, 4, 6, 2 }, // -X
+		{ 1, 3, 7, 5 }, // +X
+	};
+
+	Vec3 corners[8];
+	box.get_corners(corners);
+
+	glBegin(GL_QUADS);
+	for(int face = 0; face < 6; ++face)
+	{
+		for(int v = 0; v < 4; ++v)
+		{
+			const Vec3 &c = corners[quads[face][v]];
+			glVertex3f((GLfloat)c.x, (GLfloat)c.y, (GLfloat)c.z);
+		}
+	}
+	glEnd();
+}
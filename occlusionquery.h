@@ -0,0 +1,119 @@
+/** @file occlusionquery.h
+ *  @brief Hardware occlusion culling with temporally coherent GL queries
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#ifndef _OCCLUSION_QUERY_H_
+#define _OCCLUSION_QUERY_H_
+
+#include "glheaders.h"
+#include "scene.h"
+#include <iosfwd>
+#include <vector>
+
+/** Statistics gathered by OcclusionQueryCuller over one frame */
+struct OcclusionStats
+{
+	/** Number of instances considered */
+	int instances;
+
+	/** Number of instances which were not drawn */
+	int culled;
+
+	/** Number of queries begun */
+	int queries_issued;
+
+	/** Number of queries still in flight at the end of the frame */
+	int queries_pending;
+
+	/** Number of query results read back */
+	int results_retrieved;
+
+	/** Frames between issuing a query and reading back its result, averaged
+	    over the results read back this frame */
+	double mean_latency;
+
+	OcclusionStats()
+	: instances(0),
+	  culled(0),
+	  queries_issued(0),
+	  queries_pending(0),
+	  results_retrieved(0),
+	  mean_latency(0.0) {}
+};
+
+std::ostream& operator<<(std::ostream &o, const OcclusionStats &stats);
+
+/**
+Culls instances hidden behind other geometry using GPU occlusion queries.
+
+Visibility is decided from the results of queries issued in earlier frames, in
+the manner of Coherent Hierarchical Culling (Bittner et al. 2004) but without
+the hierarchy. Only results which are already available are read, so the CPU
+never waits on the GPU.
+
+Instances which were visible are drawn and, every few frames, their draw is
+wrapped in a query to find out whether they are still visible. Instances which
+were occluded are not drawn. Instead, their bounding boxes are queried after
+all visible geometry has been drawn, and they are drawn again from the frame
+after a query reports any samples passing.
+*/
+class OcclusionQueryCuller
+{
+public:
+	/**
+	Constructor. Requires a current OpenGL context.
+	@param visible_query_interval Number of frames between queries on an
+	instance which is known to be visible
+	*/
+	OcclusionQueryCuller(int visible_query_interval = 4);
+
+	~OcclusionQueryCuller();
+
+	/**
+	Draws the instances which are believed to be visible and issues queries
+	to update their visibility. The camera must already be set.
+	@param instances Instances to draw. Visibility is tracked per element, so
+	the list should stay the same from frame to frame.
+	@param eye World-space position of the camera
+	@param near_clip Distance from the camera to the near clip plane
+	*/
+	void draw(const Pass::RenderInstanceList &instances,
+	          const Vec3 &eye,
+	          real_t near_clip);
+
+	/** Gets statistics for the last frame drawn */
+	const OcclusionStats & get_stats() const { return stats; }
+
+private:
+	struct InstanceState
+	{
+		const RenderInstance * instance;
+		GLuint query;
+		bool pending;
+		bool visible;
+		int issue_frame;
+	};
+
+	// no meaningful assignment or copy
+	OcclusionQueryCuller(const OcclusionQueryCuller &r);
+	OcclusionQueryCuller& operator=(const OcclusionQueryCuller &r);
+
+	bool needs_reset(const Pass::RenderInstanceList &instances) const;
+	void reset(const Pass::RenderInstanceList &instances);
+	void release_queries();
+	void retrieve_results();
+	void begin_query(InstanceState &state);
+	void end_query();
+	static void draw_bounding_box(const AABB &box);
+
+private:
+	std::vector<InstanceState> states;
+	GLenum query_target;
+	int visible_query_interval;
+	int frame;
+	OcclusionStats stats;
+};
+
+#endif /* _OCCLUSION_QUERY_H_ */
@@ -0,0 +1,45 @@
+/**
+ * @file packkernels.h
+ * @brief The SIMD loops converting vertex streams to the packed element
+ * types of gltypes.h, built once for each tier of SimdTier, as the kernels
+ * of vec/kernels.h.
+ *
+ * Each kernel converts as much of its array as suits its instruction set
+ * and returns how many elements it converted, always a prefix. The
+ * convert_elements() overloads of gltypes.cpp finish the rest one at a time.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _PACKKERNELS_H_
+#define _PACKKERNELS_H_
+
+#include "gltypes.h"
+#include "vec/cpu.h"
+#include <cstddef>
+
+struct PackKernels
+{
+    size_t (*normals)(const Vec3* in, OctNormal* out, size_t n);
+    size_t (*tangents)(const Vec4* in, PackedTangent* out, size_t n);
+    size_t (*tcoords)(const Vec2* in, Half2* out, size_t n);
+};
+
+/**
+ * The kernels built for each tier, or NULL if the compiler could not build
+ * them.
+ */
+const PackKernels* pack_kernels_sse();
+const PackKernels* pack_kernels_avx2();
+
+/**
+ * Returns the kernels of the current tier, or NULL to run the scalar code.
+ */
+inline const PackKernels* pack_kernels()
+{
+    static const PackKernels* const tables[SIMD_TIER_COUNT] =
+        { NULL, pack_kernels_sse(), pack_kernels_avx2() };
+    return simd_select(tables);
+}
+
+#endif /* _PACKKERNELS_H_ */
@@ -0,0 +1,39 @@
+/**
+ * @file packkernels_avx2.cpp
+ * @brief The SIMD_AVX2 kernels of packkernels.h, built for AVX2 and FMA
+ * even when the rest of the program is not, as vec/kernels_avx2.cpp.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#include "packkernels.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__AVX2__) && \
+    (defined(__i386__) || defined(__x86_64__))
+#pragma GCC push_options
+#pragma GCC target("avx,avx2,fma")
+#define VEC_TARGET_AVX2 1
+#define KERNELS_AVX2_PRAGMA 1
+#endif
+
+#include "vec/simd.h"
+
+#if VEC_AVX2
+#include "packkernels_impl.h"
+#endif
+
+#ifdef KERNELS_AVX2_PRAGMA
+#pragma GCC pop_options
+#endif
+
+// built for the baseline, as it runs before the CPU is checked
+const PackKernels* pack_kernels_avx2()
+{
+#if VEC_AVX2
+    return &VEC_ISA::pack_kernels;
+#else
+    return NULL;
+#endif
+}
@@ -0,0 +1,145 @@
+/**
+ * @file packkernels_impl.h
+ * @brief The bodies of the kernels in packkernels.h.
+ *
+ * Included once by each of packkernels_sse.cpp and packkernels_avx2.cpp,
+ * as vec/kernels_impl.h.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _PACKKERNELS_IMPL_H_
+#define _PACKKERNELS_IMPL_H_
+
+#include "packkernels.h"
+#include "vec/simd.h"
+#include "vec/wide.h"
+#include "vec/octahedral.h"
+
+#if !VEC_SSE
+#error "the kernels need SSE"
+#endif
+
+namespace VEC_ISA {
+
+/* lanes 0-3 and 4-7 */
+static inline Floatx4 lanes_lo(const Floatx8& a)
+{
+#if VEC_AVX
+    return Floatx4(_mm256_castps256_ps128(a.v));
+#else
+    return a.lo;
+#endif
+}
+
+static inline Floatx4 lanes_hi(const Floatx8& a)
+{
+#if VEC_AVX
+    return Floatx4(_mm256_extractf128_ps(a.v, 1));
+#else
+    return a.hi;
+#endif
+}
+
+/*
+ * The halves nearest the lanes of f, as float_to_half, sign extended in
+ * each 32-bit lane so that _mm_packs_epi32 keeps their bits (after Fabian
+ * Giesen's float_to_half_fast3_rtne).
+ */
+static inline __m128i half_bits(__m128 f)
+{
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 justsign = _mm_and_ps(f, sign);
+    const __m128 absf = _mm_andnot_ps(sign, f);
+    const __m128i a = _mm_castps_si128(absf);
+
+    // infinity, or NaN kept quiet, from 65536 up; 65520 up rounds there
+    const __m128i nan = _mm_and_si128(_mm_castps_si128(_mm_cmpunord_ps(absf, absf)), _mm_set1_epi32(0x200));
+    const __m128i special = _mm_or_si128(nan, _mm_set1_epi32(0x7c00));
+    const __m128i regular = _mm_cmpgt_epi32(_mm_set1_epi32(0x47800000), a);
+
+    // below 2^-14 the float unit rounds the denormal, by adding 0.5
+    const __m128i magic = _mm_set1_epi32(0x3f000000);
+    const __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absf, _mm_castsi128_ps(magic))), magic);
+    const __m128i is_denormal = _mm_cmpgt_epi32(_mm_set1_epi32(0x38800000), a);
+
+    // rebias the exponent and round to nearest even on the 13 bits dropped
+    const __m128i odd = _mm_and_si128(_mm_srli_epi32(a, 13), _mm_set1_epi32(1));
+    const __m128i bias = _mm_set1_epi32(0xfff - 0x38000000);
+    const __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(a, bias), odd), 13);
+
+    __m128i h = _mm_or_si128(_mm_and_si128(is_denormal, denormal), _mm_andnot_si128(is_denormal, normal));
+    h = _mm_or_si128(_mm_and_si128(regular, h), _mm_andnot_si128(regular, special));
+    h = _mm_or_si128(h, _mm_srli_epi32(_mm_castps_si128(justsign), 16));
+    return _mm_srai_epi32(_mm_slli_epi32(h, 16), 16);
+}
+
+/* four tangents from their octahedral coordinates and the signs of w */
+static inline void store_tangents(PackedTangent* p, const Floatx4& u, const Floatx4& v, const Floatx4& w)
+{
+    const __m128 scale = _mm_set1_ps(511);
+    const __m128i field = _mm_set1_epi32(0x3ff);
+    const __m128i iu = _mm_and_si128(_mm_cvtps_epi32(_mm_mul_ps(u.v, scale)), field);
+    const __m128i iv = _mm_and_si128(_mm_cvtps_epi32(_mm_mul_ps(v.v, scale)), field);
+
+    // w is +1, 01 in two bits, or -1, 11
+    const __m128i negative = _mm_castps_si128(_mm_cmplt_ps(w.v, _mm_setzero_ps()));
+    const __m128i handedness = _mm_or_si128(_mm_set1_epi32(0x40000000),
+                                            _mm_and_si128(negative, _mm_set1_epi32(0x80000000)));
+
+    const __m128i bits = _mm_or_si128(_mm_or_si128(iu, _mm_slli_epi32(iv, 10)), handedness);
+    _mm_storeu_si128((__m128i*)p, bits);
+}
+
+static size_t pack_normals(const Vec3* in, OctNormal* out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + Floatx8::WIDTH <= n; i += Floatx8::WIDTH) {
+        Floatx8 x, y, z, u, v;
+        load_interleaved(&in[i].x, x, y, z);
+        octahedral_encode(x, y, z, u, v);
+        store_snorm16(&out[i].x, u, v);
+    }
+
+    return i;
+}
+
+static size_t pack_tangents(const Vec4* in, PackedTangent* out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + Floatx8::WIDTH <= n; i += Floatx8::WIDTH) {
+        Floatx8 x, y, z, w, u, v;
+        load_interleaved(&in[i].x, x, y, z, w);
+        octahedral_encode(x, y, z, u, v);
+        store_tangents(out + i, lanes_lo(u), lanes_lo(v), lanes_lo(w));
+        store_tangents(out + i + 4, lanes_hi(u), lanes_hi(v), lanes_hi(w));
+    }
+
+    return i;
+}
+
+static size_t pack_tcoords(const Vec2* in, Half2* out, size_t n)
+{
+    size_t i = 0;
+
+    // the halves keep the order of the coordinates, four pairs at a time
+    for (; i + 4 <= n; i += 4) {
+        const __m128i lo = half_bits(Floatx4::load(&in[i].x).v);
+        const __m128i hi = half_bits(Floatx4::load(&in[i].x + 4).v);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(lo, hi));
+    }
+
+    return i;
+}
+
+static const PackKernels pack_kernels = {
+    pack_normals,
+    pack_tangents,
+    pack_tcoords,
+};
+
+} /* namespace VEC_ISA */
+
+#endif /* _PACKKERNELS_IMPL_H_ */
@@ -0,0 +1,24 @@
+/**
+ * @file packkernels_sse.cpp
+ * @brief The SIMD_SSE kernels of packkernels.h, built for the instruction
+ * set the whole program targets.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#include "packkernels.h"
+#include "vec/simd.h"
+
+// a program built for AVX2 takes its kernels from packkernels_avx2.cpp
+#if VEC_SSE && !VEC_AVX2
+#include "packkernels_impl.h"
+#endif
+
+const PackKernels* pack_kernels_sse()
+{
+#if VEC_SSE && !VEC_AVX2
+    return &VEC_ISA::pack_kernels;
+#else
+    return NULL;
+#endif
+}
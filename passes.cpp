@@ -3,9 +3,33 @@
 #include "glheaders.h"
 #include "scene.h"
 #include "passes.h"
+#include "occlusionquery.h"
+#include "softwareocclusion.h"
+#include "gputimer.h"
+#include "vec/batch.h"
 
+#include <algorithm>
 #include <iostream>
 
+/** Names of the cube map faces, in the order of face_orientation */
+static const char * face_names[6] =
+{
+	"left", "right", "top", "bottom", "front", "back"
+};
+
+/** Recovers the near clip distance from a perspective projection matrix */
+static real_t get_near_clip(const Mat4 &proj)
+{
+	// Mat4::perspective sets _m[2][2] = (f+n)/(n-f) and _m[3][2] = 2fn/(n-f)
+	return proj._m[3][2] / (proj._m[2][2] - 1.0);
+}
+
+/** Recovers the far clip distance from a perspective projection matrix */
+static real_t get_far_clip(const Mat4 &proj)
+{
+	return proj._m[3][2] / (proj._m[2][2] + 1.0);
+}
+
 void StandardPass::render(const Scene * scene)
 {
 	assert(scene);
@@ -23,7 +47,7 @@ void StandardPass::render(const Scene * scene)
 		glPushAttrib(GL_VIEWPORT_BIT); // save the viewport (set by RenderTarget)
 		rendertarget->bind_render_target();
 	} else {
-		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, main_framebuffer);
 	}
 
 	set_camera();
@@ -31,24 +55,137 @@ void StandardPass::render(const Scene * scene)
 
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	for(RenderInstanceList::const_iterator i = instances.begin();
-		i != instances.end(); ++i)
-	{
-		glPushAttrib(GL_ALL_ATTRIB_BITS);
-		(*i)->draw();
-		glPopAttrib();
-		CHECK_GL_ERROR();
+	if(occlusion_culler) {
+		occlusion_culler->draw(instances, camera.get_position(), get_near_clip(proj));
+	} else {
+		if(software_culler) {
+			software_culler->render(proj * get_view_matrix());
+		}
+
+		for(RenderInstanceList::const_iterator i = instances.begin();
+			i != instances.end(); ++i)
+		{
+			if(software_culler && !software_culler->is_visible((*i)->get_bounds()))
+				continue;
+
+			glPushAttrib(GL_ALL_ATTRIB_BITS);
+			(*i)->draw();
+			glPopAttrib();
+			CHECK_GL_ERROR();
+		}
 	}
 
-	if(rendertarget) { glPopAttrib(); } // restore the viewport
+	if(rendertarget) {
+		glPopAttrib(); // restore the viewport
+		rendertarget->mark_changed();
+	}
 
 	CHECK_GL_ERROR();
 }
 
 CubeMapUpdatePass::CubeMapUpdatePass()
+: update_policy(UPDATE_ALWAYS),
+  update_interval(1),
+  range(0),
+  frame(0),
+  next_face(0),
+  captured_size(0)
 {
-	dimensions = ivec2(128, 128);
-	rt = boost::shared_ptr<RenderTarget2D>(new RenderTarget2D(dimensions));
+	std::fill(static_valid, static_valid + 6, false);
+}
+
+void CubeMapUpdatePass::get_inputs(RenderMethod::TextureList &inputs) const
+{
+	const AABB range_box = get_range();
+
+	for(RenderInstanceList::const_iterator i = instances.begin();
+		i != instances.end(); ++i)
+	{
+		const AABB bounds = (*i)->get_bounds();
+
+		if(bounds.is_empty() || bounds.intersects(range_box)) {
+			add_inputs(**i, inputs);
+		}
+	}
+}
+
+AABB CubeMapUpdatePass::get_range(void) const
+{
+	const real_t r = (range > 0) ? range : get_far_clip(proj);
+	const Vec3 &center = camera.get_position();
+	return AABB(center - Vec3(r, r, r), center + Vec3(r, r, r));
+}
+
+bool CubeMapUpdatePass::select_faces(const Frustum frustums[6], bool faces[6])
+{
+	bool changed = false;
+
+	std::fill(faces, faces + 6, false);
+
+	if(revisions.size() != instances.size()) {
+		// nothing has been captured yet, or the instances were replaced
+		std::fill(faces, faces + 6, true);
+		changed = true;
+	} else {
+		switch(update_policy)
+		{
+		case UPDATE_ALWAYS:
+			std::fill(faces, faces + 6, true);
+			changed = true;
+			break;
+
+		case UPDATE_EVERY_N_FRAMES:
+			if(frame % std::max(update_interval, 1) == 0) {
+				std::fill(faces, faces + 6, true);
+				changed = true;
+			}
+			break;
+
+		case UPDATE_ROUND_ROBIN:
+			faces[next_face] = true;
+			next_face = (next_face + 1) % 6;
+			changed = true;
+			break;
+
+		case UPDATE_WHEN_DIRTY:
+			{
+				const AABB probe_range = get_range();
+
+				for(size_t i=0; i<instances.size(); ++i)
+				{
+					const RenderMethod &rendermethod = *instances[i]->get_rendermethod();
+					const bool geometry_changed = rendermethod.get_revision() != revisions[i].geometry;
+					const bool textures_changed = rendermethod.get_texture_revision() != revisions[i].textures;
+
+					if(!geometry_changed && !textures_changed)
+						continue;
+
+					if(!bounds[i].is_empty() && !probe_range.intersects(bounds[i]))
+						continue;
+
+					for(int face=0; face<6; ++face)
+					{
+						faces[face] = faces[face] || frustums[face].intersects(bounds[i]);
+					}
+
+					// Changes which only come from another probe's texture are
+					// not passed on, so that probes which see each other settle
+					// down instead of updating each other every frame.
+					changed = changed || geometry_changed;
+				}
+			}
+			break;
+		}
+	}
+
+	revisions.resize(instances.size());
+	for(size_t i=0; i<instances.size(); ++i)
+	{
+		revisions[i].geometry = instances[i]->get_rendermethod()->get_revision();
+		revisions[i].textures = instances[i]->get_rendermethod()->get_texture_revision();
+	}
+
+	return changed;
 }
 
 void CubeMapUpdatePass::render(const Scene * scene)
@@ -58,6 +195,49 @@ void CubeMapUpdatePass::render(const Scene * scene)
 
 	CHECK_GL_ERROR();
 
+	// World-space bounds and face frustums do not change between faces
+	bounds.resize(instances.size());
+	transforms.resize(instances.size());
+	for(size_t i=0; i<instances.size(); ++i)
+	{
+		bounds[i] = instances[i]->get_rendermethod()->get_bounds();
+		transforms[i] = instances[i]->get_transform();
+	}
+
+	if(!instances.empty()) {
+		transform_aabbs(&transforms[0], &bounds[0], &bounds[0], bounds.size());
+	}
+
+	Frustum frustums[6];
+	for(int face=0; face<6; ++face)
+	{
+		frustums[face] = Frustum(proj * look_at(camera.get_position(),
+		                                        face_orientation[face] * -Vec3::UnitZ,
+		                                        face_orientation[face] * Vec3::UnitY));
+	}
+
+	// Draw every face again after the target is resized, which loses the
+	// contents of the faces and of the static cache
+	if(cubemaptarget->get_dimensions().x != captured_size) {
+		captured_size = cubemaptarget->get_dimensions().x;
+		revisions.clear();
+		std::fill(static_valid, static_valid + 6, false);
+	}
+
+	// Re-capture static geometry whenever the instances are replaced
+	if(revisions.size() != instances.size()) {
+		std::fill(static_valid, static_valid + 6, false);
+	}
+
+	bool faces[6];
+	const bool changed = select_faces(frustums, faces);
+	frame++;
+
+	const bool cached = cubemaptarget->has_static_cache();
+
+	if(std::find(faces, faces + 6, true) == faces + 6)
+		return; // nothing to update this frame
+
 	glClearColor((GLclampf)clear_color.x,
 	             (GLclampf)clear_color.y,
 				 (GLclampf)clear_color.z,
@@ -69,28 +249,40 @@ void CubeMapUpdatePass::render(const Scene * scene)
 	glMatrixMode(GL_PROJECTION); // save the projection matrix
 	glPushMatrix();
 
-	for(int i=0; i<6; ++i)
+	for(int face=0; face<6; ++face)
 	{
-		cubemaptarget->bind_render_target(i);
+		if(!faces[face])
+			continue;
+
+		TRACE_ZONE(face_names[face]);
+		gpu_timer.begin(GpuTimerEntry::FACE, &face_names[face], face_names[face]);
 
 		glMatrixMode(GL_MODELVIEW); // save the modelview matrix
 		glPushMatrix();
-		set_camera(camera.get_position(), face_orientation[i]);
-
+		set_camera(camera.get_position(), face_orientation[face]);
 		set_light_positions(scene->lights);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		CHECK_GL_ERROR();
-		for(RenderInstanceList::const_iterator i = instances.begin();
-			i != instances.end(); ++i)
-		{
-			glPushAttrib(GL_ALL_ATTRIB_BITS);
-			(*i)->draw();
-			glPopAttrib();
-			CHECK_GL_ERROR();
+		if(cached && !static_valid[face]) {
+			// Capture the static geometry once; later updates copy it back
+			cubemaptarget->bind_static_capture(face);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			draw_instances(frustums[face], STATIC_INSTANCES);
+			static_valid[face] = true;
+		}
+
+		cubemaptarget->bind_render_target(face);
+
+		if(cached) {
+			cubemaptarget->restore_static_capture(face);
+			draw_instances(frustums[face], DYNAMIC_INSTANCES);
+		} else {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			draw_instances(frustums[face], ALL_INSTANCES);
 		}
 
 		glPopMatrix(); // restore the modelview matrix
+
+		gpu_timer.end();
 	}
 
 	glMatrixMode(GL_PROJECTION); // restore the projection matrix
@@ -98,9 +290,40 @@ void CubeMapUpdatePass::render(const Scene * scene)
 
 	glPopAttrib(); // restore the viewport
 
+	if(changed) {
+		cubemaptarget->mark_changed();
+	}
+
 	CHECK_GL_ERROR();
 }
 
+void CubeMapUpdatePass::draw_instances(const Frustum &frustum, InstanceFilter filter) const
+{
+	CHECK_GL_ERROR();
+
+	if(bounds.empty())
+		return;
+
+	// Only draw instances which overlap this face, so that each one
+	// is typically submitted once or twice rather than six times.
+	std::vector<size_t> visible(bounds.size());
+	visible.resize(frustum.cull(&bounds[0], bounds.size(), &visible[0]));
+
+	for(size_t v=0; v<visible.size(); ++v)
+	{
+		const size_t i = visible[v];
+
+		if(filter != ALL_INSTANCES &&
+		   instances[i]->get_rendermethod()->is_dynamic() != (filter == DYNAMIC_INSTANCES))
+			continue;
+
+		glPushAttrib(GL_ALL_ATTRIB_BITS);
+		instances[i]->draw();
+		glPopAttrib();
+		CHECK_GL_ERROR();
+	}
+}
+
 void CubeMapUpdatePass::set_camera(const Vec3 &eye, const Quat &orientation)
 {
 	const Vec3 up = orientation * Vec3::UnitY;
@@ -120,3 +343,157 @@ void CubeMapUpdatePass::set_camera(const Vec3 &eye, const Quat &orientation)
 	          centerx, centery, centerz,
 	          up.x, up.y, up.z);
 }
+
+PlanarReflectionPass::PlanarReflectionPass()
+: source_camera(NULL),
+  plane(0.0, 1.0, 0.0, 0.0),
+  texture_matrix(Mat4::Identity)
+{
+	// Do Nothing
+}
+
+Mat4 PlanarReflectionPass::get_reflection_matrix(void) const
+{
+	const real_t a = plane.x, b = plane.y, c = plane.z, d = plane.w;
+
+	return Mat4(1.0 - 2.0*a*a,     -2.0*a*b,     -2.0*a*c, -2.0*a*d,
+	                -2.0*a*b, 1.0 - 2.0*b*b,     -2.0*b*c, -2.0*b*d,
+	                -2.0*a*c,     -2.0*b*c, 1.0 - 2.0*c*c, -2.0*c*d,
+	                     0.0,           0.0,           0.0,      1.0);
+}
+
+static real_t sgn(real_t x)
+{
+	return (x > 0) ? 1.0 : ((x < 0) ? -1.0 : 0.0);
+}
+
+/**
+Replaces the near clip plane of a perspective projection with the given
+eye-space plane, keeping the far plane as close as possible to the original.
+The eye must lie on the negative side of the plane.
+*/
+static Mat4 oblique_projection(const Mat4 &proj, const Vec4 &clip_plane)
+{
+	Mat4 m = proj;
+
+	// the corner of the view volume opposite the plane, in eye space
+	const Vec4 q((sgn(clip_plane.x) + m._m[2][0]) / m._m[0][0],
+	             (sgn(clip_plane.y) + m._m[2][1]) / m._m[1][1],
+	             -1.0,
+	             (1.0 + m._m[2][2]) / m._m[3][2]);
+
+	const Vec4 c = clip_plane * (2.0 / clip_plane.dot(q));
+
+	// replace the third row
+	m._m[0][2] = c.x;
+	m._m[1][2] = c.y;
+	m._m[2][2] = c.z + 1.0;
+	m._m[3][2] = c.w;
+
+	return m;
+}
+
+Mat4 PlanarReflectionPass::get_mirrored_view(void) const
+{
+	const Camera &eye_camera = source_camera ? *source_camera : camera;
+
+	return look_at(eye_camera.get_position(),
+	               eye_camera.get_direction(),
+	               eye_camera.get_up()) * get_reflection_matrix();
+}
+
+Mat4 PlanarReflectionPass::get_clipped_projection(const Mat4 &view) const
+{
+	// Bring the plane into eye space, where it becomes the near plane.
+	// Planes transform by the inverse transpose. Mat4::inverse() follows the
+	// row-major formulation, so with our column-major storage it already
+	// returns the transpose of the inverse.
+	const Vec4 eye_plane = view.inverse() * plane;
+
+	// If the eye is behind the plane there is nothing to reflect, but keep
+	// the ordinary projection rather than an inverted oblique one.
+	return (eye_plane.w < 0) ? oblique_projection(proj, eye_plane) : proj;
+}
+
+void PlanarReflectionPass::get_inputs(RenderMethod::TextureList &inputs) const
+{
+	const Mat4 view = get_mirrored_view();
+	const Frustum frustum(get_clipped_projection(view) * view);
+
+	for(RenderInstanceList::const_iterator i = instances.begin();
+		i != instances.end(); ++i)
+	{
+		if(frustum.intersects((*i)->get_bounds())) {
+			add_inputs(**i, inputs);
+		}
+	}
+}
+
+void PlanarReflectionPass::render(const Scene * scene)
+{
+	assert(scene);
+	assert(rendertarget);
+
+	CHECK_GL_ERROR();
+
+	const Mat4 view = get_mirrored_view();
+
+	const Mat4 clipped_proj = get_clipped_projection(view);
+
+	// Maps clip space [-1,1] to texture space [0,1]
+	static const Mat4 bias(0.5, 0.0, 0.0, 0.5,
+	                       0.0, 0.5, 0.0, 0.5,
+	                       0.0, 0.0, 0.5, 0.5,
+	                       0.0, 0.0, 0.0, 1.0);
+
+	// Only the lower left of the target is drawn when it is scaled down
+	const Vec2 uv_scale = rendertarget->get_uv_scale();
+	const Mat4 scale(uv_scale.x, 0.0, 0.0, 0.0,
+	                 0.0, uv_scale.y, 0.0, 0.0,
+	                 0.0, 0.0, 1.0, 0.0,
+	                 0.0, 0.0, 0.0, 1.0);
+
+	texture_matrix = scale * bias * clipped_proj * view;
+
+	glClearColor((GLclampf)clear_color.x,
+	             (GLclampf)clear_color.y,
+				 (GLclampf)clear_color.z,
+				 (GLclampf)clear_color.w);
+	glClearDepth(1.0);
+
+	glPushAttrib(GL_VIEWPORT_BIT | GL_POLYGON_BIT); // save the viewport and winding
+	rendertarget->bind_render_target();
+
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixr(clipped_proj.m);
+
+	glMatrixMode(GL_MODELVIEW);
+	glLoadMatrixr(view.m);
+
+	set_light_positions(scene->lights);
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// The reflection reverses the winding of every triangle
+	glFrontFace(GL_CW);
+
+	const Frustum frustum(clipped_proj * view);
+
+	for(RenderInstanceList::const_iterator i = instances.begin();
+		i != instances.end(); ++i)
+	{
+		if(!frustum.intersects((*i)->get_bounds()))
+			continue;
+
+		glPushAttrib(GL_ALL_ATTRIB_BITS);
+		(*i)->draw();
+		glPopAttrib();
+		CHECK_GL_ERROR();
+	}
+
+	glPopAttrib(); // restore the viewport and winding
+
+	rendertarget->mark_changed();
+
+	CHECK_GL_ERROR();
+}
@@ -10,24 +10,56 @@
 #include "glheaders.h"
 #include "vec/vec.h"
 #include "vec/mat.h"
+#include "vec/frustum.h"
+
+class OcclusionQueryCuller;
+class SoftwareOcclusionCuller;
 
 class StandardPass : public Pass
 {
 public:
 	boost::shared_ptr<const RenderTarget2D> rendertarget;
 
+	/** If set, instances are drawn through this occlusion culler */
+	boost::shared_ptr<OcclusionQueryCuller> occlusion_culler;
+
+	/** If set, instances hidden behind this culler's occluders are skipped.
+	    Ignored when occlusion_culler is set. */
+	boost::shared_ptr<SoftwareOcclusionCuller> software_culler;
+
 public:
 	StandardPass(void) {}
 	virtual ~StandardPass() {}
 
 	virtual void render(const Scene * scene);
+
+	virtual boost::shared_ptr<const Texture> get_output(void) const { return rendertarget; }
 };
 
 class CubeMapUpdatePass : public Pass
 {
 public:
+	/** Which faces of the cube map are re-rendered each frame. Faces which
+	    are not re-rendered keep their previous contents. */
+	enum UpdatePolicy
+	{
+		UPDATE_ALWAYS,         // all faces, every frame
+		UPDATE_EVERY_N_FRAMES, // all faces, every update_interval frames
+		UPDATE_ROUND_ROBIN,    // one face per frame, in turn
+		UPDATE_WHEN_DIRTY      // faces which see an instance that changed
+	};
+
 	boost::shared_ptr<const CubeMapTarget> cubemaptarget;
 
+	UpdatePolicy update_policy;
+
+	/** Number of frames between updates with UPDATE_EVERY_N_FRAMES */
+	int update_interval;
+
+	/** With UPDATE_WHEN_DIRTY, changes to instances farther than this from
+	    the probe are ignored. Zero means the far clip distance. */
+	real_t range;
+
 public:
 	CubeMapUpdatePass();
 
@@ -35,10 +67,78 @@ public:
 
 	virtual void render(const Scene * scene);
 
+	virtual boost::shared_ptr<const Texture> get_output(void) const { return cubemaptarget; }
+
+	/** Any instance in range may be seen by some face */
+	virtual void get_inputs(RenderMethod::TextureList &inputs) const;
+
 private:
+	struct Revision
+	{
+		unsigned int geometry;
+		unsigned int textures;
+	};
+
+	enum InstanceFilter { ALL_INSTANCES, STATIC_INSTANCES, DYNAMIC_INSTANCES };
+
 	void set_camera(const Vec3 &eye, const Quat &orientation);
-	boost::shared_ptr<RenderTarget2D> rt;
-	ivec2 dimensions;
+	bool select_faces(const Frustum frustums[6], bool faces[6]);
+	void draw_instances(const Frustum &frustum, InstanceFilter filter) const;
+	AABB get_range(void) const;
+
+	std::vector<AABB> bounds; // scratch space for world-space instance bounds
+	std::vector<Affine3> transforms; // scratch space for instance transforms
+	std::vector<Revision> revisions; // instance revisions at the last update
+	int frame;
+	int next_face;
+	int captured_size; // face size at the last update
+	bool static_valid[6]; // whether the target's static cache holds each face
+};
+
+/**
+Renders the scene mirrored about a plane, as seen by another pass's camera,
+for use as a planar reflection. Geometry on the far side of the plane is
+removed by an oblique near clip plane (Lengyel, "Oblique View Frustum
+Depth Projection and Clipping", 2005), so the reflecting surface itself
+should not be among the instances.
+*/
+class PlanarReflectionPass : public Pass
+{
+public:
+	boost::shared_ptr<const RenderTarget2D> rendertarget;
+
+	/** Camera whose view is mirrored, e.g. the main pass's camera. If NULL,
+	    this pass's own camera is used. proj should match that camera's. */
+	const Camera * source_camera;
+
+	/** World-space reflection plane (a,b,c,d) with a*x + b*y + c*z + d = 0.
+	    The normal (a,b,c) must be unit length and point to the side which
+	    is reflected. */
+	Vec4 plane;
+
+public:
+	PlanarReflectionPass();
+
+	virtual ~PlanarReflectionPass() { /* Do nothing */ }
+
+	virtual void render(const Scene * scene);
+
+	virtual boost::shared_ptr<const Texture> get_output(void) const { return rendertarget; }
+
+	/** Instances in the mirrored view frustum */
+	virtual void get_inputs(RenderMethod::TextureList &inputs) const;
+
+	/** Gets the matrix which maps world space to projective texture
+	    coordinates in rendertarget, for the last frame rendered. It
+	    accounts for the target's scale. */
+	const Mat4 & get_texture_matrix(void) const { return texture_matrix; }
+
+private:
+	Mat4 get_reflection_matrix(void) const;
+	Mat4 get_mirrored_view(void) const;
+	Mat4 get_clipped_projection(const Mat4 &view) const;
+
+	Mat4 texture_matrix;
 };
 
 extern Quat face_orientation[6];
@@ -1,13 +1,5 @@
-solution "crystal-coffee"
-    configurations { "Debug", "Release" }
-
-    project "crystal-coffee"
-        kind "ConsoleApp"
-        language "C++"
-        files { "**.h", "**.cpp" } -- recurse into subdirectories
-		targetname "crystal-coffee"
-		targetdir "./bin/"
-
+-- settings shared by the application and the benchmark
+function common_configuration()
         configuration "windows"  
             links { "opengl32",
             		"glu32",
@@ -22,12 +14,14 @@ solution "crystal-coffee"
         configuration "linux"
         	links { "GL",
                     "GLU",
+                    "EGL",
             		"GLEW",
             		"SDL",
             		"SDLmain",
             		"IL",
             		"ILU",
-            		"ILUT" }
+            		"ILUT",
+            		"rt" }
                     
         configuration "gmake"
             includedirs { "." }
@@ -48,3 +42,39 @@ solution "crystal-coffee"
         configuration "Release"
             defines { "NDEBUG" }
             flags { "OptimizeSpeed" }
+end
+
+solution "crystal-coffee"
+    configurations { "Debug", "Release" }
+
+    project "crystal-coffee"
+        kind "ConsoleApp"
+        language "C++"
+        files { "**.h", "**.cpp" } -- recurse into subdirectories
+        excludes { "bench/**" }
+		targetname "crystal-coffee"
+		targetdir "./bin/"
+
+        common_configuration()
+
+    -- renders every scene headless and compares against a baseline
+    project "crystal-coffee-bench"
+        kind "ConsoleApp"
+        language "C++"
+        files { "**.h", "**.cpp" }
+        excludes { "app.cpp", "SDLinput.*", "GraphicsDevice.*", "bench/microbench.cpp" }
+		targetname "crystal-coffee-bench"
+		targetdir "./bin/"
+
+        common_configuration()
+
+    -- times math, geometry and simulation kernels, mostly without OpenGL
+    project "crystal-coffee-microbench"
+        kind "ConsoleApp"
+        language "C++"
+        files { "**.h", "**.cpp" }
+        excludes { "app.cpp", "SDLinput.*", "GraphicsDevice.*", "bench/bench.cpp" }
+		targetname "crystal-coffee-microbench"
+		targetdir "./bin/"
+
+        common_configuration()
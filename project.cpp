@@ -9,6 +9,9 @@
 #include "glheaders.h"
 #include "project.h"
 #include "scene.h"
+#include "rendertargetpool.h"
+#include "gputimer.h"
+#include "trace.h"
 #include "geom/sphere.h"
 #include <iostream>
 using namespace std;
@@ -62,6 +65,13 @@ void prj_initialize( Scene* scene )
 	for_each(scene->resources.begin(),
 	         scene->resources.end(),
 	         &init_resource);
+
+	// Free whatever the last scene's render targets left which this scene
+	// did not pick up
+	render_target_pool.trim();
+
+	// Timings are keyed by the last scene's passes
+	gpu_timer.clear();
 	         
 	init_light_properties(scene->lights);
 
@@ -84,7 +94,10 @@ void prj_update(Scene* scene, double delta_time)
     Scene::TickableList& list = scene->tickables;
     for (Scene::TickableList::iterator i = list.begin();
             i != list.end(); ++i)
+    {
+        TRACE_ZONE(trace_class_name(typeid(**i)));
         (*i)->tick(sim_time);
+    }
 }
 
 static void init_light_properties(const LightList & lights)
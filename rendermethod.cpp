@@ -8,6 +8,7 @@
 #include "glheaders.h"
 #include "rendermethod.h"
 #include "scene.h"
+#include "passes.h"
 #include "vec/mat.h"
 #include <iostream>
 #include <fstream>
@@ -15,10 +16,75 @@
 
 using namespace std;
 
+/* Point the fixed-function arrays, or a vertex attribute, at a buffer
+   object, described by the gl_type_traits of its elements */
+static void vertex_pointer(const VertexStream &buffer)
+{
+	buffer.bind();
+	glVertexPointer(buffer.get_gl_components(), buffer.get_gl_type(), 0, 0);
+}
+
+static void normal_pointer(const VertexStream &buffer)
+{
+	assert(buffer.get_gl_components() == 3);
+	buffer.bind();
+	glNormalPointer(buffer.get_gl_type(), 0, 0);
+}
+
+static void tcoord_pointer(const VertexStream &buffer)
+{
+	buffer.bind();
+	glTexCoordPointer(buffer.get_gl_components(), buffer.get_gl_type(), 0, 0);
+}
+
+static void attrib_pointer(GLuint slot, const VertexStream &buffer)
+{
+	buffer.bind();
+	glVertexAttribPointerARB(slot, buffer.get_gl_components(), buffer.get_gl_type(),
+	                         buffer.is_gl_normalized(), 0, 0);
+}
+
+void RenderMethod::uses_texture(const boost::shared_ptr<const Texture> &texture)
+{
+	assert(texture);
+	textures.push_back(texture);
+}
+
+bool RenderMethod::is_dynamic() const
+{
+	if(animator)
+		return true;
+
+	for(TextureList::const_iterator i = textures.begin(); i != textures.end(); ++i)
+	{
+		if((*i)->is_render_target())
+			return true;
+	}
+
+	return false;
+}
+
+unsigned int RenderMethod::get_revision() const
+{
+	return animator ? animator->get_revision() : 0;
+}
+
+unsigned int RenderMethod::get_texture_revision() const
+{
+	unsigned int revision = 0;
+
+	for(TextureList::const_iterator i = textures.begin(); i != textures.end(); ++i)
+	{
+		revision += (*i)->get_revision();
+	}
+
+	return revision;
+}
+
 RenderMethod_DiffuseTexture::
-RenderMethod_DiffuseTexture(const boost::shared_ptr< const BufferObject<Vec3> > _vertices_buffer,
-                            const boost::shared_ptr< const BufferObject<Vec3> > _normals_buffer,
-							const boost::shared_ptr< const BufferObject<Vec2> > _tcoords_buffer,
+RenderMethod_DiffuseTexture(const boost::shared_ptr< const BufferObject<PositionElement> > _vertices_buffer,
+                            const boost::shared_ptr< const BufferObject<NormalElement> > _normals_buffer,
+							const boost::shared_ptr< const VertexStream > _tcoords_buffer,
 							const boost::shared_ptr< const BufferObject<index_t> > _indices_buffer,
                             const Material & _mat,
 	                        const boost::shared_ptr< const Texture > _diffuse_texture)
@@ -32,9 +98,11 @@ RenderMethod_DiffuseTexture(const boost::shared_ptr< const BufferObject<Vec3> >
 	assert(vertices_buffer);
 	assert(normals_buffer);
 	assert(diffuse_texture);
+
+	uses_texture(diffuse_texture);
 }
 
-void RenderMethod_DiffuseTexture::draw(const Mat4 &transform) const
+void RenderMethod_DiffuseTexture::draw(const Affine3 &transform) const
 {	
 	assert(vertices_buffer);
 	assert(normals_buffer);
@@ -64,36 +132,21 @@ void RenderMethod_DiffuseTexture::draw(const Mat4 &transform) const
 	glMatrixMode(GL_MODELVIEW);
 	glPushMatrix();
 
-	glMultMatrixr(transform.m);
+	glMultMatrixr(transform.to_mat4().m);
 	
 	// Bind the vertex buffer
 	glEnableClientState(GL_VERTEX_ARRAY);
-	vertices_buffer->bind();
-#if REAL_IS_DOUBLE
-	glVertexPointer(3, GL_DOUBLE, 0, 0);
-#else
-	glVertexPointer(3, GL_FLOAT, 0, 0);
-#endif
+	vertex_pointer(*vertices_buffer);
 	
 	// Bind the normals buffer
 	glEnableClientState(GL_NORMAL_ARRAY);
-	normals_buffer->bind();
-#if REAL_IS_DOUBLE
-	glNormalPointer(GL_DOUBLE, 0, 0);
-#else
-	glNormalPointer(GL_FLOAT, 0, 0);
-#endif
+	normal_pointer(*normals_buffer);
 
 	// Bind the tcoord buffer
 	if(tcoords_buffer) {
 		glClientActiveTexture(GL_TEXTURE0);
 		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		tcoords_buffer->bind();
-		#if REAL_IS_DOUBLE
-				glTexCoordPointer(2, GL_DOUBLE, 0, 0);
-		#else
-				glTexCoordPointer(2, GL_FLOAT, 0, 0);
-		#endif
+		tcoord_pointer(*tcoords_buffer);
 	}
 
 	// Actually draw the triangles	
@@ -117,9 +170,9 @@ void RenderMethod_DiffuseTexture::draw(const Mat4 &transform) const
 }
 
 RenderMethod_TextureReplace::
-RenderMethod_TextureReplace(const boost::shared_ptr< const BufferObject<Vec3> > _vertices_buffer,
-							const boost::shared_ptr< const BufferObject<Vec3> > _normals_buffer,
-							const boost::shared_ptr< const BufferObject<Vec2> > _tcoords_buffer,
+RenderMethod_TextureReplace(const boost::shared_ptr< const BufferObject<PositionElement> > _vertices_buffer,
+							const boost::shared_ptr< const BufferObject<NormalElement> > _normals_buffer,
+							const boost::shared_ptr< const VertexStream > _tcoords_buffer,
 							const boost::shared_ptr< const BufferObject<index_t> > _indices_buffer,
 							const boost::shared_ptr< const Texture > _diffuse_texture)
 : vertices_buffer(_vertices_buffer),
@@ -132,9 +185,11 @@ RenderMethod_TextureReplace(const boost::shared_ptr< const BufferObject<Vec3> >
 	assert(normals_buffer);
 	assert(tcoords_buffer);
 	assert(diffuse_texture);
+
+	uses_texture(diffuse_texture);
 }
 
-void RenderMethod_TextureReplace::draw(const Mat4 &transform) const
+void RenderMethod_TextureReplace::draw(const Affine3 &transform) const
 {	
 	assert(vertices_buffer);
 	assert(normals_buffer);
@@ -159,37 +214,32 @@ void RenderMethod_TextureReplace::draw(const Mat4 &transform) const
 
 	glUseProgramObjectARB(0); // fixed-function pipeline
 
+	// Sample only the part of a scaled render target which was drawn
+	const Vec2 uv_scale = diffuse_texture->get_uv_scale();
+	const bool scaled = (uv_scale.x != 1 || uv_scale.y != 1);
+
+	if(scaled) {
+		glMatrixMode(GL_TEXTURE);
+		glLoadIdentity();
+		glScalef((GLfloat)uv_scale.x, (GLfloat)uv_scale.y, 1.0f);
+	}
+
 	glMatrixMode(GL_MODELVIEW);
 	glPushMatrix();
 
-	glMultMatrixr(transform.m);
+	glMultMatrixr(transform.to_mat4().m);
 
 	// Bind the vertex buffer
 	glEnableClientState(GL_VERTEX_ARRAY);
-	vertices_buffer->bind();
-#if REAL_IS_DOUBLE
-	glVertexPointer(3, GL_DOUBLE, 0, 0);
-#else
-	glVertexPointer(3, GL_FLOAT, 0, 0);
-#endif
+	vertex_pointer(*vertices_buffer);
 
 	// Bind the normals buffer
 	glEnableClientState(GL_NORMAL_ARRAY);
-	normals_buffer->bind();
-#if REAL_IS_DOUBLE
-	glNormalPointer(GL_DOUBLE, 0, 0);
-#else
-	glNormalPointer(GL_FLOAT, 0, 0);
-#endif
+	normal_pointer(*normals_buffer);
 
 	// Bind the tcoord buffer
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-	tcoords_buffer->bind();
-#if REAL_IS_DOUBLE
-	glTexCoordPointer(2, GL_DOUBLE, 0, 0);
-#else
-	glTexCoordPointer(2, GL_FLOAT, 0, 0);
-#endif
+	tcoord_pointer(*tcoords_buffer);
 
 	// Actually draw the triangles	
 	if(indices_buffer) {
@@ -208,19 +258,26 @@ void RenderMethod_TextureReplace::draw(const Mat4 &transform) const
 
 	glPopMatrix();
 
+	if(scaled) {
+		glMatrixMode(GL_TEXTURE);
+		glLoadIdentity();
+		glMatrixMode(GL_MODELVIEW);
+	}
+
 	glEnable(GL_LIGHTING);
 	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 }
 
 RenderMethod_FresnelEnvMap::
-RenderMethod_FresnelEnvMap(const boost::shared_ptr< const BufferObject<Vec3> > _vertices_buffer,
-					       const boost::shared_ptr< const BufferObject<Vec3> > _normals_buffer,
+RenderMethod_FresnelEnvMap(const boost::shared_ptr< const BufferObject<PositionElement> > _vertices_buffer,
+					       const boost::shared_ptr< const BufferObject<PackedNormalElement> > _normals_buffer,
 					       const boost::shared_ptr< const BufferObject<index_t> > _indices_buffer,
 					       const boost::shared_ptr< const ShaderProgram > _shader,
 						   const Material & _mat,
 						   const boost::shared_ptr<const Texture> _env_map,
 				           real_t refraction_index)
 : wld_space_to_obj_space_uniform(0),
+  normal_attrib_slot(0),
   vertices_buffer(_vertices_buffer),
   normals_buffer(_normals_buffer),
   indices_buffer(_indices_buffer),
@@ -235,6 +292,8 @@ RenderMethod_FresnelEnvMap(const boost::shared_ptr< const BufferObject<Vec3> > _
 	assert(shader);
 	assert(env_map);
 
+	uses_texture(env_map);
+
 	GLhandleARB program = shader->get_program();
 
 	glUseProgramObjectARB(program);
@@ -249,10 +308,12 @@ RenderMethod_FresnelEnvMap(const boost::shared_ptr< const BufferObject<Vec3> > _
 	n_t = glGetUniformLocationARB(program, "n_t");
 	glUniform1fARB(n_t, (GLfloat)refraction_index);
 
+	normal_attrib_slot = glGetAttribLocationARB(program, "PackedNormal");
+
 	glUseProgramObjectARB(0);
 }
 
-void RenderMethod_FresnelEnvMap::draw(const Mat4 &obj_space_to_wld_space) const
+void RenderMethod_FresnelEnvMap::draw(const Affine3 &obj_space_to_wld_space) const
 {
 	assert(vertices_buffer);
 	assert(normals_buffer);
@@ -279,35 +340,22 @@ void RenderMethod_FresnelEnvMap::draw(const Mat4 &obj_space_to_wld_space) const
 
 	// Bind the shader program
 	glUseProgramObjectARB(shader->get_program());
-	const Mat4 wld_space_to_obj_space = obj_space_to_wld_space.inverse();
-#if REAL_IS_DOUBLE
-#pragma error("There is no glUniformMatrix4dv function. Manual conversion is necessary!")
-#else
-	glUniformMatrix4fv(wld_space_to_obj_space_uniform, 16, GL_FALSE, wld_space_to_obj_space.m);
-#endif
+	// The shader takes the transposed inverse, as Mat4::inverse() returns it
+	const Mat4 wld_space_to_obj_space = obj_space_to_wld_space.inverse().to_mat4().transpose();
+	set_uniform_matrix4(wld_space_to_obj_space_uniform, wld_space_to_obj_space.m);
 	
 	glMatrixMode(GL_MODELVIEW);
 	glPushMatrix();
 
-	glMultMatrixr(obj_space_to_wld_space.m);
+	glMultMatrixr(obj_space_to_wld_space.to_mat4().m);
 	
 	// Bind the vertex buffer
 	glEnableClientState(GL_VERTEX_ARRAY);
-	vertices_buffer->bind();
-#if REAL_IS_DOUBLE
-	glVertexPointer(3, GL_DOUBLE, 0, 0);
-#else
-	glVertexPointer(3, GL_FLOAT, 0, 0);
-#endif
+	vertex_pointer(*vertices_buffer);
 	
-	// Bind the normals buffer
-	glEnableClientState(GL_NORMAL_ARRAY);
-	normals_buffer->bind();
-#if REAL_IS_DOUBLE
-	glNormalPointer(GL_DOUBLE, 0, 0);
-#else
-	glNormalPointer(GL_FLOAT, 0, 0);
-#endif
+	// Bind the packed normals, which the shader decodes
+	glEnableVertexAttribArrayARB(normal_attrib_slot);
+	attrib_pointer(normal_attrib_slot, *normals_buffer);
 
 	// Actually draw the triangles	
 	if(indices_buffer) {
@@ -320,7 +368,122 @@ void RenderMethod_FresnelEnvMap::draw(const Mat4 &obj_space_to_wld_space) const
 	}
 	
 	// Clean up
-	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableVertexAttribArrayARB(normal_attrib_slot);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	glPopMatrix();
+
+	CHECK_GL_ERROR();
+}
+
+RenderMethod_PlanarReflection::
+RenderMethod_PlanarReflection(const boost::shared_ptr< const BufferObject<PositionElement> > _vertices_buffer,
+                              const boost::shared_ptr< const BufferObject<PackedNormalElement> > _normals_buffer,
+                              const boost::shared_ptr< const BufferObject<index_t> > _indices_buffer,
+                              const boost::shared_ptr< const ShaderProgram > _shader,
+                              const Material & _mat,
+                              const boost::shared_ptr<const PlanarReflectionPass> _reflection,
+                              real_t refraction_index,
+                              real_t distortion)
+: obj_space_to_tex_space_uniform(0),
+  normal_attrib_slot(0),
+  vertices_buffer(_vertices_buffer),
+  normals_buffer(_normals_buffer),
+  indices_buffer(_indices_buffer),
+  shader(_shader),
+  mat(_mat),
+  reflection(_reflection)
+{
+	GLint reflection_map_uniform, n_t, distortion_uniform;
+
+	assert(vertices_buffer);
+	assert(normals_buffer);
+	assert(shader);
+	assert(reflection);
+	assert(reflection->rendertarget);
+
+	uses_texture(reflection->rendertarget);
+
+	GLhandleARB program = shader->get_program();
+
+	glUseProgramObjectARB(program);
+
+	// Set these uniforms whenever the object is rendered
+	obj_space_to_tex_space_uniform = glGetUniformLocationARB(program, "obj_space_to_tex_space");
+
+	// Set these uniforms only once when the effect is initialized
+	reflection_map_uniform = glGetUniformLocationARB(program, "reflection_map");
+	glUniform1iARB(reflection_map_uniform, 0);
+
+	n_t = glGetUniformLocationARB(program, "n_t");
+	glUniform1fARB(n_t, (GLfloat)refraction_index);
+
+	distortion_uniform = glGetUniformLocationARB(program, "distortion");
+	glUniform1fARB(distortion_uniform, (GLfloat)distortion);
+
+	normal_attrib_slot = glGetAttribLocationARB(program, "PackedNormal");
+
+	glUseProgramObjectARB(0);
+}
+
+void RenderMethod_PlanarReflection::draw(const Affine3 &obj_space_to_wld_space) const
+{
+	assert(vertices_buffer);
+	assert(normals_buffer);
+	assert(shader);
+	assert(reflection);
+
+	CHECK_GL_ERROR();
+
+	// Set material properties
+	mat.bind();
+
+	// Disable texture unit 2
+	glActiveTexture(GL_TEXTURE2);
+	glDisable(GL_TEXTURE_2D);
+
+	// Disable texture unit 1
+	glActiveTexture(GL_TEXTURE1);
+	glDisable(GL_TEXTURE_2D);
+
+	// Bind texture unit 0
+	glActiveTexture(GL_TEXTURE0);
+	reflection->rendertarget->bind();
+	CHECK_GL_ERROR();
+
+	// Bind the shader program
+	glUseProgramObjectARB(shader->get_program());
+
+	// The reflection pass has already run this frame, so its texture matrix
+	// matches the contents of the render target.
+	const Mat4 obj_space_to_tex_space = reflection->get_texture_matrix() * obj_space_to_wld_space.to_mat4();
+	set_uniform_matrix4(obj_space_to_tex_space_uniform, obj_space_to_tex_space.m);
+
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+
+	glMultMatrixr(obj_space_to_wld_space.to_mat4().m);
+
+	// Bind the vertex buffer
+	glEnableClientState(GL_VERTEX_ARRAY);
+	vertex_pointer(*vertices_buffer);
+
+	// Bind the packed normals, which the shader decodes
+	glEnableVertexAttribArrayARB(normal_attrib_slot);
+	attrib_pointer(normal_attrib_slot, *normals_buffer);
+
+	// Actually draw the triangles
+	if(indices_buffer) {
+		// Draw using the index buffer
+		GLsizei count = indices_buffer->getNumber();
+		indices_buffer->bind();
+		glDrawElements(GL_TRIANGLES, count, MESH_INDEX_FORMAT, 0);
+	} else {
+		glDrawArrays(GL_TRIANGLES, 0, vertices_buffer->getNumber());
+	}
+
+	// Clean up
+	glDisableVertexAttribArrayARB(normal_attrib_slot);
 	glDisableClientState(GL_VERTEX_ARRAY);
 
 	glPopMatrix();
@@ -329,9 +492,9 @@ void RenderMethod_FresnelEnvMap::draw(const Mat4 &obj_space_to_wld_space) const
 }
 
 RenderMethod_Fresnel::
-RenderMethod_Fresnel(const boost::shared_ptr< const BufferObject<Vec3> > _vertices_buffer,
-					 const boost::shared_ptr< const BufferObject<Vec3> > _normals_buffer,
-					 const boost::shared_ptr< const BufferObject<Vec2> > _tcoords_buffer,
+RenderMethod_Fresnel(const boost::shared_ptr< const BufferObject<PositionElement> > _vertices_buffer,
+					 const boost::shared_ptr< const BufferObject<NormalElement> > _normals_buffer,
+					 const boost::shared_ptr< const VertexStream > _tcoords_buffer,
 					 const boost::shared_ptr< const BufferObject<index_t> > _indices_buffer,
 					 const boost::shared_ptr< const ShaderProgram > _shader,
 				     const Material & _mat,
@@ -353,6 +516,8 @@ RenderMethod_Fresnel(const boost::shared_ptr< const BufferObject<Vec3> > _vertic
 	assert(shader);
 	assert(diffuse_map);
 
+	uses_texture(diffuse_map);
+
 	GLhandleARB program = shader->get_program();
 
 	// Set these uniforms only once when the effect is initialized
@@ -367,7 +532,7 @@ RenderMethod_Fresnel(const boost::shared_ptr< const BufferObject<Vec3> > _vertic
 	glUseProgramObjectARB(0);
 }
 
-void RenderMethod_Fresnel::draw(const Mat4 &transform) const
+void RenderMethod_Fresnel::draw(const Affine3 &transform) const
 {
 	assert(vertices_buffer);
 	assert(normals_buffer);
@@ -395,34 +560,19 @@ void RenderMethod_Fresnel::draw(const Mat4 &transform) const
 	glMatrixMode(GL_MODELVIEW);
 	glPushMatrix();
 
-	glMultMatrixr(transform.m);
+	glMultMatrixr(transform.to_mat4().m);
 	
 	// Bind the vertex buffer
 	glEnableClientState(GL_VERTEX_ARRAY);
-	vertices_buffer->bind();
-#if REAL_IS_DOUBLE
-	glVertexPointer(3, GL_DOUBLE, 0, 0);
-#else
-	glVertexPointer(3, GL_FLOAT, 0, 0);
-#endif
+	vertex_pointer(*vertices_buffer);
 	
 	// Bind the normals buffer
 	glEnableClientState(GL_NORMAL_ARRAY);
-	normals_buffer->bind();
-#if REAL_IS_DOUBLE
-	glNormalPointer(GL_DOUBLE, 0, 0);
-#else
-	glNormalPointer(GL_FLOAT, 0, 0);
-#endif
+	normal_pointer(*normals_buffer);
 
 	// Bind the normals buffer
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-	tcoords_buffer->bind();
-#if REAL_IS_DOUBLE
-	glTexCoordPointer(2, GL_DOUBLE, 0, 0);
-#else
-	glTexCoordPointer(2, GL_FLOAT, 0, 0);
-#endif
+	tcoord_pointer(*tcoords_buffer);
 
 	// Actually draw the triangles	
 	if(indices_buffer) {
@@ -443,10 +593,10 @@ void RenderMethod_Fresnel::draw(const Mat4 &transform) const
 }
 
 RenderMethod_BumpMap::
-RenderMethod_BumpMap(const boost::shared_ptr< const BufferObject<Vec3> > _vertices_buffer,
-                     const boost::shared_ptr< const BufferObject<Vec3> > _normals_buffer,
-                     const boost::shared_ptr< const BufferObject<Vec4> > _tangents_buffer,
-					 const boost::shared_ptr< const BufferObject<Vec2> > _tcoords_buffer,
+RenderMethod_BumpMap(const boost::shared_ptr< const BufferObject<PositionElement> > _vertices_buffer,
+                     const boost::shared_ptr< const BufferObject<PackedNormalElement> > _normals_buffer,
+                     const boost::shared_ptr< const VertexStream > _tangents_buffer,
+					 const boost::shared_ptr< const VertexStream > _tcoords_buffer,
 					 const boost::shared_ptr< const BufferObject<index_t> > _indices_buffer,
 					 const boost::shared_ptr< const ShaderProgram > _shader,
 				     const Material & _mat,
@@ -475,6 +625,10 @@ RenderMethod_BumpMap(const boost::shared_ptr< const BufferObject<Vec3> > _vertic
 	assert(height_map);
 	assert(diffuse_map);
 
+	uses_texture(diffuse_map);
+	uses_texture(normal_map);
+	uses_texture(height_map);
+
 	// Set these uniforms only once when the effect is initialized
 
 	GLhandleARB program = shader->get_program();
@@ -490,12 +644,17 @@ RenderMethod_BumpMap(const boost::shared_ptr< const BufferObject<Vec3> > _vertic
 	height_map_uniform = glGetUniformLocationARB(program, "height_map");
 	glUniform1iARB(height_map_uniform, 2);
 	
+	// The shaders decode tangents as the context stores them, see
+	// ShaderProgram::load_shaders()
+	assert((tangents_buffer->get_gl_type() == GL_INT_2_10_10_10_REV) == has_packed_tangents());
+
+	normal_attrib_slot = glGetAttribLocationARB(program, "PackedNormal");
 	tangent_attrib_slot = glGetAttribLocationARB(program, "Tangent");
 	
 	glUseProgramObjectARB(0);
 }
 
-void RenderMethod_BumpMap::draw(const Mat4 &transform) const
+void RenderMethod_BumpMap::draw(const Affine3 &transform) const
 {
 	assert(vertices_buffer);
 	assert(normals_buffer);
@@ -528,45 +687,23 @@ void RenderMethod_BumpMap::draw(const Mat4 &transform) const
 	glMatrixMode(GL_MODELVIEW);
 	glPushMatrix();
 
-	glMultMatrixr(transform.m);
+	glMultMatrixr(transform.to_mat4().m);
 	
 	// Bind the vertex buffer
 	glEnableClientState(GL_VERTEX_ARRAY);
-	vertices_buffer->bind();
-#if REAL_IS_DOUBLE
-	glVertexPointer(3, GL_DOUBLE, 0, 0);
-#else
-	glVertexPointer(3, GL_FLOAT, 0, 0);
-#endif
+	vertex_pointer(*vertices_buffer);
 	
-	// Bind the normals buffer
-	glEnableClientState(GL_NORMAL_ARRAY);
-	normals_buffer->bind();
-#if REAL_IS_DOUBLE
-	glNormalPointer(GL_DOUBLE, 0, 0);
-#else
-	glNormalPointer(GL_FLOAT, 0, 0);
-#endif
+	// Bind the packed normals, which the shader decodes
+	glEnableVertexAttribArrayARB(normal_attrib_slot);
+	attrib_pointer(normal_attrib_slot, *normals_buffer);
 	
 	// Bind the tangents buffer
 	glEnableVertexAttribArrayARB(tangent_attrib_slot);
-	tangents_buffer->bind();
-
-#if REAL_IS_DOUBLE
-	glVertexAttribPointerARB(tangent_attrib_slot, 4, GL_DOUBLE, GL_FALSE, 0, 0);
-#else
-	glVertexAttribPointerARB(tangent_attrib_slot, 4, GL_FLOAT, GL_FALSE, 0, 0);
-#endif
+	attrib_pointer(tangent_attrib_slot, *tangents_buffer);
 
 	// Bind the tcoord buffer
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-	tcoords_buffer->bind();
-
-#if REAL_IS_DOUBLE
-	glTexCoordPointer(2, GL_DOUBLE, 0, 0);
-#else
-	glTexCoordPointer(2, GL_FLOAT, 0, 0);
-#endif
+	tcoord_pointer(*tcoords_buffer);
 
 	// Actually draw the triangles	
 	if(indices_buffer) {
@@ -581,15 +718,15 @@ void RenderMethod_BumpMap::draw(const Mat4 &transform) const
 	// Clean up
 	glDisableVertexAttribArrayARB(tangent_attrib_slot);
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableVertexAttribArrayARB(normal_attrib_slot);
 	glDisableClientState(GL_VERTEX_ARRAY);
 
 	glPopMatrix();
 }
 
 RenderMethod_CubemapReflection::
-RenderMethod_CubemapReflection(const boost::shared_ptr< const BufferObject<Vec3> > _vertices_buffer,
-							   const boost::shared_ptr< const BufferObject<Vec3> > _normals_buffer,
+RenderMethod_CubemapReflection(const boost::shared_ptr< const BufferObject<PositionElement> > _vertices_buffer,
+							   const boost::shared_ptr< const BufferObject<PackedNormalElement> > _normals_buffer,
 							   const boost::shared_ptr< const BufferObject<index_t> > _indices_buffer,
 							   const Material & _mat,
 							   const boost::shared_ptr<const CubeMapTexture> _cubemap,
@@ -608,6 +745,8 @@ RenderMethod_CubemapReflection(const boost::shared_ptr< const BufferObject<Vec3>
 	assert(cubemap);
 	assert(shader);
 
+	uses_texture(cubemap);
+
 	const GLhandleARB program = shader->get_program();
 
 	glUseProgramObjectARB(program);
@@ -617,10 +756,12 @@ RenderMethod_CubemapReflection(const boost::shared_ptr< const BufferObject<Vec3>
 
 	wld_space_to_obj_space_uniform = glGetUniformLocationARB(program, "wld_space_to_obj_space");
 
+	normal_attrib_slot = glGetAttribLocationARB(program, "PackedNormal");
+
 	glUseProgramObjectARB(0);
 }
 
-void RenderMethod_CubemapReflection::draw(const Mat4 &obj_space_to_wld_space) const
+void RenderMethod_CubemapReflection::draw(const Affine3 &obj_space_to_wld_space) const
 {
 	assert(vertices_buffer);
 	assert(normals_buffer);
@@ -648,35 +789,22 @@ void RenderMethod_CubemapReflection::draw(const Mat4 &obj_space_to_wld_space) co
 
 	// Bind the shader program
 	glUseProgram(shader->get_program());
-	const Mat4 wld_space_to_obj_space = obj_space_to_wld_space.inverse();
-#if REAL_IS_DOUBLE
-#pragma error("There is no glUniformMatrix4dv function. Manual conversion is necessary!")
-#else
-	glUniformMatrix4fv(wld_space_to_obj_space_uniform, 16, GL_FALSE, wld_space_to_obj_space.m);
-#endif
+	// The shader takes the transposed inverse, as Mat4::inverse() returns it
+	const Mat4 wld_space_to_obj_space = obj_space_to_wld_space.inverse().to_mat4().transpose();
+	set_uniform_matrix4(wld_space_to_obj_space_uniform, wld_space_to_obj_space.m);
 
 	glMatrixMode(GL_MODELVIEW);
 	glPushMatrix();
 
-	glMultMatrixr(obj_space_to_wld_space.m);
+	glMultMatrixr(obj_space_to_wld_space.to_mat4().m);
 
 	// Bind the vertex buffer
 	glEnableClientState(GL_VERTEX_ARRAY);
-	vertices_buffer->bind();
-#if REAL_IS_DOUBLE
-	glVertexPointer(3, GL_DOUBLE, 0, 0);
-#else
-	glVertexPointer(3, GL_FLOAT, 0, 0);
-#endif
+	vertex_pointer(*vertices_buffer);
 
-	// Bind the normals buffer
-	glEnableClientState(GL_NORMAL_ARRAY);
-	normals_buffer->bind();
-#if REAL_IS_DOUBLE
-	glNormalPointer(GL_DOUBLE, 0, 0);
-#else
-	glNormalPointer(GL_FLOAT, 0, 0);
-#endif
+	// Bind the packed normals, which the shader decodes
+	glEnableVertexAttribArrayARB(normal_attrib_slot);
+	attrib_pointer(normal_attrib_slot, *normals_buffer);
 
 	// Actually draw the triangles	
 	if(indices_buffer) {
@@ -689,7 +817,7 @@ void RenderMethod_CubemapReflection::draw(const Mat4 &obj_space_to_wld_space) co
 	}
 
 	// Clean up
-	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableVertexAttribArrayARB(normal_attrib_slot);
 	glDisableClientState(GL_VERTEX_ARRAY);
 
 	glPopMatrix();
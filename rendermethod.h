@@ -10,44 +10,83 @@
 #define _EFFECT_H_
 
 #include "glheaders.h"
+#include "gltypes.h"
 #include "vec/vec.h"
 #include "vec/mat.h"
+#include "vec/affine.h"
+#include "vec/aabb.h"
 #include "material.h"
 #include <string>
+#include <vector>
 #include <boost/shared_ptr.hpp>
 
 template<class TYPE> class BufferObject;
+class VertexStream;
 class Material;
 class Texture;
 class ShaderProgram;
 class CubeMapTexture;
+class Tickable;
+class PlanarReflectionPass;
 
 class RenderMethod
 {
 public:
 	virtual ~RenderMethod() { /* Do Nothing */ }
-	virtual void draw(const Mat4 &transform) const = 0;
+	virtual void draw(const Affine3 &transform) const = 0;
+
+	/** Object-space bounds of the geometry drawn. Empty if unknown. */
+	const AABB & get_bounds() const { return bounds; }
+
+	void set_bounds(const AABB &_bounds) { bounds = _bounds; }
+
+	/** Sets the Tickable which animates the geometry, if any */
+	void set_animator(const boost::shared_ptr<const Tickable> &_animator) { animator = _animator; }
+
+	/** Returns true if what is drawn can change from frame to frame, either
+	    because the geometry is animated or because a texture is rendered */
+	bool is_dynamic() const;
+
+	/** Revision of the animator, or zero if there is none */
+	unsigned int get_revision() const;
+
+	/** Sum of the revisions of the textures used, which changes whenever
+	    any of them is rendered into */
+	unsigned int get_texture_revision() const;
+
+	typedef std::vector< boost::shared_ptr<const Texture> > TextureList;
+
+	/** Textures sampled by draw() */
+	const TextureList & get_textures() const { return textures; }
 
 protected:
-	RenderMethod(void) { /* Do Nothing */ }
+	RenderMethod(void) : bounds(AABB::Empty) { /* Do Nothing */ }
+
+	/** Registers a texture sampled by draw(). Called by constructors. */
+	void uses_texture(const boost::shared_ptr<const Texture> &texture);
+
+private:
+	AABB bounds;
+	boost::shared_ptr<const Tickable> animator;
+	TextureList textures;
 };
 
 class RenderMethod_DiffuseTexture : public RenderMethod
 {
 public:
-	RenderMethod_DiffuseTexture(const boost::shared_ptr< const BufferObject<Vec3> > vertices_buffer,
-                                const boost::shared_ptr< const BufferObject<Vec3> > normals_buffer,
-								const boost::shared_ptr< const BufferObject<Vec2> > tcoords_buffer,
+	RenderMethod_DiffuseTexture(const boost::shared_ptr< const BufferObject<PositionElement> > vertices_buffer,
+                                const boost::shared_ptr< const BufferObject<NormalElement> > normals_buffer,
+								const boost::shared_ptr< const VertexStream > tcoords_buffer,
 								const boost::shared_ptr< const BufferObject<index_t> > indices_buffer,
                                 const Material & mat,
 	                            const boost::shared_ptr<const Texture> diffuse_texture);
 
-	virtual void draw(const Mat4 &transform) const;
+	virtual void draw(const Affine3 &transform) const;
 
 private:
-	const boost::shared_ptr< const BufferObject<Vec3> > vertices_buffer;
-	const boost::shared_ptr< const BufferObject<Vec3> > normals_buffer;
-	const boost::shared_ptr< const BufferObject<Vec2> > tcoords_buffer;
+	const boost::shared_ptr< const BufferObject<PositionElement> > vertices_buffer;
+	const boost::shared_ptr< const BufferObject<NormalElement> > normals_buffer;
+	const boost::shared_ptr< const VertexStream > tcoords_buffer;
 	const boost::shared_ptr< const BufferObject<index_t> > indices_buffer;
 	const Material mat;
 	const boost::shared_ptr<const Texture> diffuse_texture;
@@ -56,18 +95,18 @@ private:
 class RenderMethod_TextureReplace : public RenderMethod
 {
 public:
-	RenderMethod_TextureReplace(const boost::shared_ptr< const BufferObject<Vec3> > vertices_buffer,
-                                const boost::shared_ptr< const BufferObject<Vec3> > normals_buffer,
-								const boost::shared_ptr< const BufferObject<Vec2> > tcoords_buffer,
+	RenderMethod_TextureReplace(const boost::shared_ptr< const BufferObject<PositionElement> > vertices_buffer,
+                                const boost::shared_ptr< const BufferObject<NormalElement> > normals_buffer,
+								const boost::shared_ptr< const VertexStream > tcoords_buffer,
 								const boost::shared_ptr< const BufferObject<index_t> > indices_buffer,
 	                            boost::shared_ptr<const Texture> diffuse_texture);
 
-	virtual void draw(const Mat4 &transform) const;
+	virtual void draw(const Affine3 &transform) const;
 
 private:
-	const boost::shared_ptr< const BufferObject<Vec3> > vertices_buffer;
-	const boost::shared_ptr< const BufferObject<Vec3> > normals_buffer;
-	const boost::shared_ptr< const BufferObject<Vec2> > tcoords_buffer;
+	const boost::shared_ptr< const BufferObject<PositionElement> > vertices_buffer;
+	const boost::shared_ptr< const BufferObject<NormalElement> > normals_buffer;
+	const boost::shared_ptr< const VertexStream > tcoords_buffer;
 	const boost::shared_ptr< const BufferObject<index_t> > indices_buffer;
 	const boost::shared_ptr<const Texture> diffuse_texture;
 };
@@ -75,45 +114,77 @@ private:
 class RenderMethod_FresnelEnvMap : public RenderMethod
 {
 public:
-    RenderMethod_FresnelEnvMap(const boost::shared_ptr< const BufferObject<Vec3> > vertices_buffer,
-                               const boost::shared_ptr< const BufferObject<Vec3> > normals_buffer,
+    RenderMethod_FresnelEnvMap(const boost::shared_ptr< const BufferObject<PositionElement> > vertices_buffer,
+                               const boost::shared_ptr< const BufferObject<PackedNormalElement> > normals_buffer,
                                const boost::shared_ptr< const BufferObject<index_t> > indices_buffer,
 						       const boost::shared_ptr<const ShaderProgram> shader,
 				               const Material & mat,
 				               const boost::shared_ptr<const Texture> env_map,
 				               real_t refraction_index);
 
-	virtual void draw(const Mat4 &transform) const;
+	virtual void draw(const Affine3 &transform) const;
     
 private:
 	GLint wld_space_to_obj_space_uniform;
+	GLint normal_attrib_slot;
 
-	const boost::shared_ptr< const BufferObject<Vec3> > vertices_buffer;
-	const boost::shared_ptr< const BufferObject<Vec3> > normals_buffer;
+	const boost::shared_ptr< const BufferObject<PositionElement> > vertices_buffer;
+	const boost::shared_ptr< const BufferObject<PackedNormalElement> > normals_buffer;
 	const boost::shared_ptr< const BufferObject<index_t> > indices_buffer;
 	const boost::shared_ptr<const ShaderProgram> shader;
 	const Material mat;
 	const boost::shared_ptr<const Texture> env_map;
 };
 
+/**
+Fresnel-weighted reflection of a planar surface, sampled projectively from
+the texture rendered by a PlanarReflectionPass. The surface normal perturbs
+the lookup so that ripples distort the reflection.
+*/
+class RenderMethod_PlanarReflection : public RenderMethod
+{
+public:
+	RenderMethod_PlanarReflection(const boost::shared_ptr< const BufferObject<PositionElement> > vertices_buffer,
+	                              const boost::shared_ptr< const BufferObject<PackedNormalElement> > normals_buffer,
+	                              const boost::shared_ptr< const BufferObject<index_t> > indices_buffer,
+	                              const boost::shared_ptr<const ShaderProgram> shader,
+	                              const Material & mat,
+	                              const boost::shared_ptr<const PlanarReflectionPass> reflection,
+	                              real_t refraction_index,
+	                              real_t distortion = 0.05);
+
+	virtual void draw(const Affine3 &transform) const;
+
+private:
+	GLint obj_space_to_tex_space_uniform;
+	GLint normal_attrib_slot;
+
+	const boost::shared_ptr< const BufferObject<PositionElement> > vertices_buffer;
+	const boost::shared_ptr< const BufferObject<PackedNormalElement> > normals_buffer;
+	const boost::shared_ptr< const BufferObject<index_t> > indices_buffer;
+	const boost::shared_ptr<const ShaderProgram> shader;
+	const Material mat;
+	const boost::shared_ptr<const PlanarReflectionPass> reflection;
+};
+
 class RenderMethod_Fresnel : public RenderMethod
 {
 public:
-	RenderMethod_Fresnel(const boost::shared_ptr< const BufferObject<Vec3> > vertices_buffer,
-	                     const boost::shared_ptr< const BufferObject<Vec3> > normals_buffer,
-	                     const boost::shared_ptr< const BufferObject<Vec2> > tcoords_buffer,
+	RenderMethod_Fresnel(const boost::shared_ptr< const BufferObject<PositionElement> > vertices_buffer,
+	                     const boost::shared_ptr< const BufferObject<NormalElement> > normals_buffer,
+	                     const boost::shared_ptr< const VertexStream > tcoords_buffer,
 	                     const boost::shared_ptr< const BufferObject<index_t> > indices_buffer,
 	                     boost::shared_ptr<const ShaderProgram> shader,
 	                     const Material & mat,
 	                     boost::shared_ptr<const Texture> diffuse_map,
 	                     real_t refraction_index);
 
-	virtual void draw(const Mat4 &transform) const;
+	virtual void draw(const Affine3 &transform) const;
 
 private:
-	const boost::shared_ptr< const BufferObject<Vec3> > vertices_buffer;
-	const boost::shared_ptr< const BufferObject<Vec3> > normals_buffer;
-	const boost::shared_ptr< const BufferObject<Vec2> > tcoords_buffer;
+	const boost::shared_ptr< const BufferObject<PositionElement> > vertices_buffer;
+	const boost::shared_ptr< const BufferObject<NormalElement> > normals_buffer;
+	const boost::shared_ptr< const VertexStream > tcoords_buffer;
 	const boost::shared_ptr< const BufferObject<index_t> > indices_buffer;
 	const boost::shared_ptr<const ShaderProgram> shader;
 	const Material mat;
@@ -123,10 +194,10 @@ private:
 class RenderMethod_BumpMap : public RenderMethod
 {
 public:
-    RenderMethod_BumpMap(const boost::shared_ptr< const BufferObject<Vec3> > vertices_buffer,
-                         const boost::shared_ptr< const BufferObject<Vec3> > normals_buffer,
-                         const boost::shared_ptr< const BufferObject<Vec4> > tangents_buffer,
-						 const boost::shared_ptr< const BufferObject<Vec2> > tcoords_buffer,
+    RenderMethod_BumpMap(const boost::shared_ptr< const BufferObject<PositionElement> > vertices_buffer,
+                         const boost::shared_ptr< const BufferObject<PackedNormalElement> > normals_buffer,
+                         const boost::shared_ptr< const VertexStream > tangents_buffer,
+						 const boost::shared_ptr< const VertexStream > tcoords_buffer,
 						 const boost::shared_ptr< const BufferObject<index_t> > indices_buffer,
 						 const boost::shared_ptr<const ShaderProgram> shader,
 				         const Material & mat,
@@ -134,15 +205,16 @@ public:
                          const boost::shared_ptr<const Texture> normal_map,
 				         const boost::shared_ptr<const Texture> height_map);
 
-	virtual void draw(const Mat4 &transform) const;
+	virtual void draw(const Affine3 &transform) const;
     
 private:
 	GLint tangent_attrib_slot;
+	GLint normal_attrib_slot;
 	
-	const boost::shared_ptr< const BufferObject<Vec3> > vertices_buffer;
-	const boost::shared_ptr< const BufferObject<Vec3> > normals_buffer;
-	const boost::shared_ptr< const BufferObject<Vec4> > tangents_buffer;
-	const boost::shared_ptr< const BufferObject<Vec2> > tcoords_buffer;
+	const boost::shared_ptr< const BufferObject<PositionElement> > vertices_buffer;
+	const boost::shared_ptr< const BufferObject<PackedNormalElement> > normals_buffer;
+	const boost::shared_ptr< const VertexStream > tangents_buffer;
+	const boost::shared_ptr< const VertexStream > tcoords_buffer;
 	const boost::shared_ptr< const BufferObject<index_t> > indices_buffer;
 	const boost::shared_ptr<const ShaderProgram> shader;
 	const Material mat;
@@ -154,20 +226,21 @@ private:
 class RenderMethod_CubemapReflection : public RenderMethod
 {
 public:
-	RenderMethod_CubemapReflection(const boost::shared_ptr< const BufferObject<Vec3> > _vertices_buffer,
-                                   const boost::shared_ptr< const BufferObject<Vec3> > _normals_buffer,
+	RenderMethod_CubemapReflection(const boost::shared_ptr< const BufferObject<PositionElement> > _vertices_buffer,
+                                   const boost::shared_ptr< const BufferObject<PackedNormalElement> > _normals_buffer,
 								   const boost::shared_ptr< const BufferObject<index_t> > _indices_buffer,
                                    const Material & _mat,
 								   const boost::shared_ptr<const CubeMapTexture> _cubemap,
 								   const boost::shared_ptr<const ShaderProgram> _shader);
 
-	virtual void draw(const Mat4 &transform) const;
+	virtual void draw(const Affine3 &transform) const;
 
 private:
 	GLint wld_space_to_obj_space_uniform;
+	GLint normal_attrib_slot;
 
-	const boost::shared_ptr< const BufferObject<Vec3> > vertices_buffer;
-	const boost::shared_ptr< const BufferObject<Vec3> > normals_buffer;
+	const boost::shared_ptr< const BufferObject<PositionElement> > vertices_buffer;
+	const boost::shared_ptr< const BufferObject<PackedNormalElement> > normals_buffer;
 	const boost::shared_ptr< const BufferObject<index_t> > indices_buffer;
 	const Material mat;
 	const boost::shared_ptr<const CubeMapTexture> cubemap;
@@ -0,0 +1,17 @@
+/** @file renderstats.cpp
+ *  @brief Counts draw calls and bytes uploaded to the GPU per frame
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#include "renderstats.h"
+#include <iostream>
+
+RenderStatsCounter render_stats;
+
+std::ostream& operator<<(std::ostream &o, const RenderStats &stats)
+{
+	o << "draw_calls=" << stats.draw_calls
+	  << " bytes_uploaded=" << stats.bytes_uploaded;
+	return o;
+}
@@ -0,0 +1,56 @@
+/** @file renderstats.h
+ *  @brief Counts draw calls and bytes uploaded to the GPU per frame
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#ifndef _RENDER_STATS_H_
+#define _RENDER_STATS_H_
+
+#include <cstddef>
+#include <iosfwd>
+
+/** Work submitted to OpenGL during one frame */
+struct RenderStats
+{
+	/** Number of RenderInstance::draw() calls */
+	int draw_calls;
+
+	/** Bytes written to buffer objects and textures from the CPU */
+	size_t bytes_uploaded;
+
+	RenderStats()
+	: draw_calls(0),
+	  bytes_uploaded(0) {}
+};
+
+std::ostream& operator<<(std::ostream &o, const RenderStats &stats);
+
+/**
+Counts the work of the frame in progress, including buffers updated while
+ticking the scene, until Scene::render() ends the frame. Counting costs an
+addition per draw or upload, so it is always on.
+*/
+class RenderStatsCounter
+{
+public:
+	/** Counts for the frame in progress */
+	RenderStats current;
+
+	/** Finishes the frame in progress and starts the next */
+	void end_frame()
+	{
+		last = current;
+		current = RenderStats();
+	}
+
+	/** Gets the counts for the last complete frame */
+	const RenderStats & get_last_frame() const { return last; }
+
+private:
+	RenderStats last;
+};
+
+extern RenderStatsCounter render_stats;
+
+#endif /* _RENDER_STATS_H_ */
@@ -0,0 +1,284 @@
+/** @file rendertargetpool.cpp
+ *  @brief Shares and recycles the GL objects behind render targets
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#include "glheaders.h"
+#include "rendertargetpool.h"
+
+#include <algorithm>
+#include <iostream>
+
+RenderTargetPool render_target_pool;
+
+std::ostream& operator<<(std::ostream &o, const RenderTargetPoolStats &stats)
+{
+	o << "color_textures=" << stats.color_textures
+	  << " depth_buffers=" << stats.depth_buffers
+	  << " framebuffers=" << stats.framebuffers
+	  << " bytes=" << stats.bytes
+	  << " bytes_unused=" << stats.bytes_unused;
+	return o;
+}
+
+RenderTargetPool::RenderTargetPool()
+: framebuffers_in_use(0)
+{
+	// Do Nothing
+}
+
+GLuint RenderTargetPool::acquire_color(GLenum texture_target, const ivec2 &size, GLenum format)
+{
+	for(std::vector<Color>::iterator i = colors.begin(); i != colors.end(); ++i)
+	{
+		Color &color = *i;
+
+		if(!color.in_use &&
+		   color.texture_target == texture_target &&
+		   color.size.x == size.x && color.size.y == size.y &&
+		   color.format == format) {
+			color.in_use = true;
+			return color.name;
+		}
+	}
+
+	Color color;
+	color.texture_target = texture_target;
+	color.size = size;
+	color.format = format;
+	color.in_use = true;
+
+	glGenTextures(1, &color.name);
+	glBindTexture(texture_target, color.name);
+
+	if(texture_target == GL_TEXTURE_CUBE_MAP_EXT) {
+		static const GLenum faces[6] =
+		{
+			GL_TEXTURE_CUBE_MAP_POSITIVE_X_EXT, GL_TEXTURE_CUBE_MAP_NEGATIVE_X_EXT,
+			GL_TEXTURE_CUBE_MAP_POSITIVE_Y_EXT, GL_TEXTURE_CUBE_MAP_NEGATIVE_Y_EXT,
+			GL_TEXTURE_CUBE_MAP_POSITIVE_Z_EXT, GL_TEXTURE_CUBE_MAP_NEGATIVE_Z_EXT
+		};
+
+		for(int i=0; i<6; ++i)
+		{
+			glTexImage2D(faces[i], 0, format, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_EXT, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	} else {
+		glTexImage2D(texture_target, 0, format, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+
+	glTexParameteri(texture_target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(texture_target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(texture_target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(texture_target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+	CHECK_GL_ERROR();
+
+	colors.push_back(color);
+	return color.name;
+}
+
+void RenderTargetPool::release_color(GLuint texture)
+{
+	for(std::vector<Color>::iterator i = colors.begin(); i != colors.end(); ++i)
+	{
+		if((*i).name == texture) {
+			assert((*i).in_use);
+			(*i).in_use = false;
+			return;
+		}
+	}
+
+	assert(!"texture was not acquired from the pool");
+}
+
+GLuint RenderTargetPool::create_depth(const ivec2 &size, bool shared)
+{
+	Depth depth;
+	depth.size = size;
+	depth.shared = shared;
+	depth.users = 1;
+
+	glGenRenderbuffersEXT(1, &depth.name);
+	glBindRenderbufferEXT(GL_RENDERBUFFER_EXT, depth.name);
+	glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT, GL_DEPTH_COMPONENT, size.x, size.y);
+	CHECK_GL_ERROR();
+
+	depths.push_back(depth);
+	return depth.name;
+}
+
+GLuint RenderTargetPool::acquire_shared_depth(const ivec2 &size)
+{
+	for(std::vector<Depth>::iterator i = depths.begin(); i != depths.end(); ++i)
+	{
+		Depth &depth = *i;
+
+		if(depth.size.x != size.x || depth.size.y != size.y)
+			continue;
+
+		// Take the shared buffer, or an unused one which can become shared
+		if(depth.shared || depth.users == 0) {
+			depth.shared = true;
+			depth.users++;
+			return depth.name;
+		}
+	}
+
+	return create_depth(size, true);
+}
+
+GLuint RenderTargetPool::acquire_depth(const ivec2 &size)
+{
+	for(std::vector<Depth>::iterator i = depths.begin(); i != depths.end(); ++i)
+	{
+		Depth &depth = *i;
+
+		if(depth.users == 0 && depth.size.x == size.x && depth.size.y == size.y) {
+			depth.shared = false;
+			depth.users = 1;
+			return depth.name;
+		}
+	}
+
+	return create_depth(size, false);
+}
+
+void RenderTargetPool::release_depth(GLuint renderbuffer)
+{
+	for(std::vector<Depth>::iterator i = depths.begin(); i != depths.end(); ++i)
+	{
+		if((*i).name == renderbuffer) {
+			assert((*i).users > 0);
+			(*i).users--;
+			return;
+		}
+	}
+
+	assert(!"renderbuffer was not acquired from the pool");
+}
+
+GLuint RenderTargetPool::acquire_framebuffer()
+{
+	GLuint fbo = 0;
+
+	if(free_framebuffers.empty()) {
+		glGenFramebuffersEXT(1, &fbo);
+	} else {
+		fbo = free_framebuffers.back();
+		free_framebuffers.pop_back();
+	}
+
+	framebuffers_in_use++;
+	return fbo;
+}
+
+void RenderTargetPool::release_framebuffer(GLuint fbo)
+{
+	assert(framebuffers_in_use > 0);
+
+	GLint max_attachments = 1;
+	glGetIntegerv(GL_MAX_COLOR_ATTACHMENTS_EXT, &max_attachments);
+
+	// Detach everything, so that the frame buffer object holds no reference
+	// to storage which is about to be deleted or handed to another target
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fbo);
+
+	for(int i=0; i<std::min(max_attachments, 6); ++i)
+	{
+		glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT + i, GL_TEXTURE_2D, 0, 0);
+	}
+
+	glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, 0);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	glReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+
+	CHECK_GL_ERROR();
+
+	free_framebuffers.push_back(fbo);
+	framebuffers_in_use--;
+}
+
+void RenderTargetPool::trim()
+{
+	std::vector<Color> used_colors;
+	std::vector<Depth> used_depths;
+
+	for(std::vector<Color>::const_iterator i = colors.begin(); i != colors.end(); ++i)
+	{
+		if((*i).in_use) {
+			used_colors.push_back(*i);
+		} else {
+			glDeleteTextures(1, &(*i).name);
+		}
+	}
+
+	for(std::vector<Depth>::const_iterator i = depths.begin(); i != depths.end(); ++i)
+	{
+		if((*i).users > 0) {
+			used_depths.push_back(*i);
+		} else {
+			glDeleteRenderbuffersEXT(1, &(*i).name);
+		}
+	}
+
+	if(!free_framebuffers.empty()) {
+		glDeleteFramebuffersEXT((GLsizei)free_framebuffers.size(), &free_framebuffers[0]);
+	}
+
+	colors.swap(used_colors);
+	depths.swap(used_depths);
+	free_framebuffers.clear();
+
+	CHECK_GL_ERROR();
+}
+
+size_t RenderTargetPool::get_bytes(const Color &color)
+{
+	size_t texel_bytes = 4;
+
+	switch(color.format)
+	{
+	case GL_RGBA16F_ARB: texel_bytes = 8;  break;
+	case GL_RGBA32F_ARB: texel_bytes = 16; break;
+	}
+
+	const size_t faces = (color.texture_target == GL_TEXTURE_CUBE_MAP_EXT) ? 6 : 1;
+
+	return faces * texel_bytes * color.size.x * color.size.y;
+}
+
+size_t RenderTargetPool::get_bytes(const Depth &depth)
+{
+	// Depth is usually stored as 24 bits padded to 32
+	return 4 * depth.size.x * depth.size.y;
+}
+
+RenderTargetPoolStats RenderTargetPool::get_stats() const
+{
+	RenderTargetPoolStats stats;
+
+	stats.color_textures = (int)colors.size();
+	stats.depth_buffers = (int)depths.size();
+	stats.framebuffers = framebuffers_in_use + (int)free_framebuffers.size();
+
+	for(std::vector<Color>::const_iterator i = colors.begin(); i != colors.end(); ++i)
+	{
+		const size_t bytes = get_bytes(*i);
+		stats.bytes += bytes;
+		if(!(*i).in_use) stats.bytes_unused += bytes;
+	}
+
+	for(std::vector<Depth>::const_iterator i = depths.begin(); i != depths.end(); ++i)
+	{
+		const size_t bytes = get_bytes(*i);
+		stats.bytes += bytes;
+		if((*i).users == 0) stats.bytes_unused += bytes;
+	}
+
+	return stats;
+}
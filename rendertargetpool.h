@@ -0,0 +1,131 @@
+/** @file rendertargetpool.h
+ *  @brief Shares and recycles the GL objects behind render targets
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#ifndef _RENDER_TARGET_POOL_H_
+#define _RENDER_TARGET_POOL_H_
+
+#include "glheaders.h"
+#include "vec/vec.h"
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+/** GPU memory held by RenderTargetPool */
+struct RenderTargetPoolStats
+{
+	/** Number of color textures, in use or not */
+	int color_textures;
+
+	/** Number of depth renderbuffers, in use or not */
+	int depth_buffers;
+
+	/** Number of frame buffer objects, in use or not */
+	int framebuffers;
+
+	/** Bytes held by color textures and depth renderbuffers */
+	size_t bytes;
+
+	/** Bytes held by objects which no render target is using */
+	size_t bytes_unused;
+
+	RenderTargetPoolStats()
+	: color_textures(0),
+	  depth_buffers(0),
+	  framebuffers(0),
+	  bytes(0),
+	  bytes_unused(0) {}
+};
+
+std::ostream& operator<<(std::ostream &o, const RenderTargetPoolStats &stats);
+
+/**
+Hands out the textures, depth renderbuffers and frame buffer objects used by
+render targets, so that they can be shared and recycled.
+
+Color textures are keyed by (texture target, size, format). A texture which
+is released is kept, and handed to the next render target asking for the same
+key, e.g. when a scene is reloaded. Depth renderbuffers are shared by every
+render target of the same size, since each pass clears depth before drawing.
+Targets which must keep their depth between passes get their own. Frame
+buffer objects are detached when released and reused by any target.
+
+Released objects are only deleted by trim(), which must be called while the
+OpenGL context exists.
+*/
+class RenderTargetPool
+{
+public:
+	RenderTargetPool();
+
+	/**
+	Gets a color texture with undefined contents.
+	@param texture_target GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP_EXT
+	@param size Size of the texture, or of each face of a cube map
+	@param format Internal format, e.g. GL_RGBA8
+	*/
+	GLuint acquire_color(GLenum texture_target, const ivec2 &size, GLenum format);
+
+	/** Returns a texture from acquire_color() to the pool */
+	void release_color(GLuint texture);
+
+	/** Gets the depth renderbuffer shared by all targets of the given size */
+	GLuint acquire_shared_depth(const ivec2 &size);
+
+	/** Gets a depth renderbuffer which no other target draws into */
+	GLuint acquire_depth(const ivec2 &size);
+
+	/** Returns a renderbuffer from either depth function to the pool */
+	void release_depth(GLuint renderbuffer);
+
+	/** Gets a frame buffer object with nothing attached */
+	GLuint acquire_framebuffer();
+
+	/** Detaches everything from a frame buffer object and returns it */
+	void release_framebuffer(GLuint fbo);
+
+	/** Deletes everything which is not in use */
+	void trim();
+
+	/** Gets the memory held by the pool */
+	RenderTargetPoolStats get_stats() const;
+
+private:
+	struct Color
+	{
+		GLuint name;
+		GLenum texture_target;
+		ivec2 size;
+		GLenum format;
+		bool in_use;
+	};
+
+	struct Depth
+	{
+		GLuint name;
+		ivec2 size;
+		bool shared;
+		int users;
+	};
+
+	// no meaningful assignment or copy
+	RenderTargetPool(const RenderTargetPool &r);
+	RenderTargetPool& operator=(const RenderTargetPool &r);
+
+	GLuint create_depth(const ivec2 &size, bool shared);
+	static size_t get_bytes(const Color &color);
+	static size_t get_bytes(const Depth &depth);
+
+private:
+	std::vector<Color> colors;
+	std::vector<Depth> depths;
+	std::vector<GLuint> free_framebuffers;
+	int framebuffers_in_use;
+};
+
+/** The pool used by all render targets */
+extern RenderTargetPool render_target_pool;
+
+#endif /* _RENDER_TARGET_POOL_H_ */
@@ -0,0 +1,140 @@
+/** @file resolutiongovernor.cpp
+ *  @brief Scales offscreen render targets to hold a frame time
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#include "glheaders.h"
+#include "resolutiongovernor.h"
+#include "gputimer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+/** Frame times within this fraction of the target leave the scale alone,
+    so that noise in the timings does not make the resolution flicker */
+static const double DEADBAND = 0.1;
+
+/** Largest change of scale in one frame. Shrinking is allowed to be
+    quicker than growing, so that a spike is cut short. */
+static const double MIN_STEP = 0.9;
+static const double MAX_STEP = 1.05;
+
+/** Frames a cube map must ask for a new size before it is resized, since
+    every resize redraws all six faces */
+static const int CUBE_RESIZE_FRAMES = 30;
+
+/** Gets the largest power of two no larger than x, or 1 */
+static int floor_power_of_two(int x)
+{
+	int p = 1;
+
+	while(p * 2 <= x)
+	{
+		p *= 2;
+	}
+
+	return p;
+}
+
+std::ostream& operator<<(std::ostream &o, const ResolutionGovernorStats &stats)
+{
+	o << "gpu_ms=" << stats.gpu_ms
+	  << " scale=" << stats.scale
+	  << " cube_resizes=" << stats.cube_resizes;
+	return o;
+}
+
+ResolutionGovernor::ResolutionGovernor()
+: target_ms(1000.0 / 60.0),
+  min_scale(0.25),
+  max_scale(1.0),
+  min_cube_size(32),
+  frames_read(0),
+  scale(1)
+{
+	// Do Nothing
+}
+
+void ResolutionGovernor::add_target(const boost::shared_ptr<RenderTarget2D> &target)
+{
+	assert(target);
+	target->set_scale(scale);
+	targets.push_back(target);
+}
+
+void ResolutionGovernor::add_target(const boost::shared_ptr<CubeMapTarget> &target)
+{
+	assert(target);
+
+	CubeMap cube_map;
+	cube_map.target = target;
+	cube_map.max_size = target->get_dimensions().x;
+	cube_map.wanted_size = cube_map.max_size;
+	cube_map.wanted_frames = 0;
+
+	cube_maps.push_back(cube_map);
+}
+
+void ResolutionGovernor::update()
+{
+	if(!gpu_timer.is_supported() || gpu_timer.get_frames_read() == frames_read)
+		return; // nothing new was measured
+
+	frames_read = gpu_timer.get_frames_read();
+
+	const double gpu_ms = gpu_timer.get_frame_ms();
+	stats.gpu_ms = gpu_ms;
+
+	if(gpu_ms > 0) {
+		const double ratio = target_ms / gpu_ms;
+
+		if(ratio < 1 - DEADBAND || ratio > 1 + DEADBAND) {
+			// The cost of a pass goes roughly with its pixel count, which
+			// goes with the square of the scale
+			const double step = std::min(std::max(sqrt(ratio), MIN_STEP), MAX_STEP);
+			scale = std::min(std::max((real_t)(scale * step), min_scale), max_scale);
+		}
+	}
+
+	stats.scale = scale;
+
+	for(std::vector< boost::shared_ptr<RenderTarget2D> >::iterator i = targets.begin();
+		i != targets.end(); ++i)
+	{
+		(*i)->set_scale(scale);
+	}
+
+	for(std::vector<CubeMap>::iterator i = cube_maps.begin(); i != cube_maps.end(); ++i)
+	{
+		resize_cube_map(*i);
+	}
+}
+
+void ResolutionGovernor::resize_cube_map(CubeMap &cube_map)
+{
+	const int current = cube_map.target->get_dimensions().x;
+	const int lowest = std::min(min_cube_size, cube_map.max_size);
+	const int size = (int)(cube_map.max_size * scale);
+	const int wanted = (size >= cube_map.max_size) ? cube_map.max_size
+	                                               : std::max(floor_power_of_two(size), lowest);
+
+	if(wanted == current) {
+		cube_map.wanted_frames = 0;
+		return;
+	}
+
+	if(wanted == cube_map.wanted_size) {
+		cube_map.wanted_frames++;
+	} else {
+		cube_map.wanted_size = wanted;
+		cube_map.wanted_frames = 1;
+	}
+
+	if(cube_map.wanted_frames >= CUBE_RESIZE_FRAMES) {
+		cube_map.target->resize(ivec2(wanted, wanted));
+		cube_map.wanted_frames = 0;
+		stats.cube_resizes++;
+	}
+}
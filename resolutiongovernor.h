@@ -0,0 +1,99 @@
+/** @file resolutiongovernor.h
+ *  @brief Scales offscreen render targets to hold a frame time
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#ifndef _RESOLUTION_GOVERNOR_H_
+#define _RESOLUTION_GOVERNOR_H_
+
+#include "glheaders.h"
+#include "scene.h"
+#include <iosfwd>
+#include <vector>
+
+/** State of ResolutionGovernor after the last update */
+struct ResolutionGovernorStats
+{
+	/** GPU time of the passes in the last frame measured, in milliseconds */
+	double gpu_ms;
+
+	/** Fraction of the width and height of 2D targets which is drawn */
+	real_t scale;
+
+	/** Number of times a cube map has been resized */
+	int cube_resizes;
+
+	ResolutionGovernorStats()
+	: gpu_ms(0),
+	  scale(1),
+	  cube_resizes(0) {}
+};
+
+std::ostream& operator<<(std::ostream &o, const ResolutionGovernorStats &stats);
+
+/**
+Lowers the resolution of offscreen targets while the GPU time of the passes,
+as measured by gpu_timer, is longer than the target time, and raises it
+again once there is time to spare.
+
+RenderTarget2D objects keep their size; only their viewport is scaled, and
+consumers sample the scaled rectangle through Texture::get_uv_scale().
+A cube map cannot be sampled in part, so CubeMapTarget objects are resized
+instead, in steps of powers of two, and only after the new size has been
+wanted for several frames in a row.
+
+The timings are a few frames old, so changes are damped. Without
+EXT_timer_query, nothing is measured and nothing is scaled.
+*/
+class ResolutionGovernor
+{
+public:
+	/** Frame time to hold, in milliseconds */
+	double target_ms;
+
+	/** Range of the scale of 2D targets */
+	real_t min_scale, max_scale;
+
+	/** Smallest size of a cube map face */
+	int min_cube_size;
+
+	ResolutionGovernor();
+
+	/** Scales the viewport of the target. It may be transient. */
+	void add_target(const boost::shared_ptr<RenderTarget2D> &target);
+
+	/** Resizes the target, which is never made larger than it is now */
+	void add_target(const boost::shared_ptr<CubeMapTarget> &target);
+
+	/** Rescales the targets for the latest timings. Call once per frame,
+	    after GpuTimer::begin_frame() and before any pass is rendered. */
+	void update();
+
+	/** Gets statistics for the last update */
+	const ResolutionGovernorStats & get_stats() const { return stats; }
+
+private:
+	struct CubeMap
+	{
+		boost::shared_ptr<CubeMapTarget> target;
+		int max_size;
+		int wanted_size; // size the scale asks for
+		int wanted_frames; // consecutive frames it has asked for it
+	};
+
+	// no meaningful assignment or copy
+	ResolutionGovernor(const ResolutionGovernor &r);
+	ResolutionGovernor& operator=(const ResolutionGovernor &r);
+
+	void resize_cube_map(CubeMap &cube_map);
+
+private:
+	int frames_read; // GpuTimer::get_frames_read() at the last update
+	real_t scale;
+	std::vector< boost::shared_ptr<RenderTarget2D> > targets;
+	std::vector<CubeMap> cube_maps;
+	ResolutionGovernorStats stats;
+};
+
+#endif /* _RESOLUTION_GOVERNOR_H_ */
@@ -9,9 +9,18 @@
  */
 
 #include <SDL/SDL.h>
+#include <algorithm>
 #include <iostream>
+#include <typeinfo>
 #include "vec/mat.h"
+#include "vec/frustum.h"
 #include "scene.h"
+#include "framegraph.h"
+#include "rendertargetpool.h"
+#include "resolutiongovernor.h"
+#include "gputimer.h"
+#include "renderstats.h"
+#include "trace.h"
 #include "glheaders.h"
 #include "devil_wrapper.h"
 
@@ -44,20 +53,22 @@ char* ShaderProgram::load_file(const char* file)
 * @param file  The file to load
 * @param type  Either GL_VERTEX_SHADER_ARB, or GL_FRAGMENT_SHADER_ARB
 * @param program  The shading program to which the shaders are attached
+* @param defines  Preprocessor lines compiled ahead of the file
 */
 void ShaderProgram::load_shader(const char* file,
 								GLint type,
-								GLhandleARB& program)
+								GLhandleARB& program,
+								const char* defines)
 {
 	int result;
 	char error_msg[1024];
 
-	const char* src = load_file(file);
+	const char* src[2] = { defines, load_file(file) };
 	// Create shader object
 	GLhandleARB shader = glCreateShaderObjectARB(type);
 
 	// Load Shader Sources
-	glShaderSourceARB(shader, 1, &src, NULL);
+	glShaderSourceARB(shader, 2, src, NULL);
 	// Compile The Shaders
 	glCompileShaderARB(shader);
 	// Get compile result
@@ -87,6 +98,13 @@ GLhandleARB ShaderProgram::load_shaders(const char* vert_file,
 	std::cout << "loading vertex shader " << vert_file << std::endl;
 	load_shader(vert_file, GL_VERTEX_SHADER_ARB, program);
 
+	// Load the functions decoding packed vertex attributes, which any
+	// vertex shader may declare and call. The tangents are only packed if
+	// the context can read them (see init_vertex_formats)
+	load_shader("shaders/vertex_decode.glsl", GL_VERTEX_SHADER_ARB, program,
+	            has_packed_tangents() ? "#define PACKED_TANGENTS 1\n"
+	                                  : "#define PACKED_TANGENTS 0\n");
+
 	// Load fragment shader
 	std::cout << "loading fragment shader " << frag_file << std::endl;
 	load_shader(frag_file, GL_FRAGMENT_SHADER_ARB, program);
@@ -110,6 +128,36 @@ GLhandleARB ShaderProgram::load_shaders(const char* vert_file,
 	return program;
 }
 
+static bool packed_tangents = false;
+static bool packed_tcoords = false;
+
+void init_vertex_formats()
+{
+	packed_tangents = glewIsSupported("GL_ARB_vertex_type_2_10_10_10_rev") ||
+	                  glewIsSupported("GL_VERSION_3_3");
+
+	packed_tcoords = glewIsSupported("GL_ARB_half_float_vertex") ||
+	                 glewIsSupported("GL_VERSION_3_0");
+
+	if(!packed_tangents) {
+		std::cerr << "WARNING: No ARB_vertex_type_2_10_10_10_rev, storing tangents as floats" << std::endl;
+	}
+
+	if(!packed_tcoords) {
+		std::cerr << "WARNING: No ARB_half_float_vertex, storing texture coordinates as floats" << std::endl;
+	}
+}
+
+bool has_packed_tangents()
+{
+	return packed_tangents;
+}
+
+bool has_packed_tcoords()
+{
+	return packed_tcoords;
+}
+
 ShaderProgram::ShaderProgram(const char* _vert_file, const char* _frag_file)
 : program(0),
   vert_file(_vert_file),
@@ -203,6 +251,9 @@ ELEMENT * BufferObject<ELEMENT>::lock() {
 	
 	glBindBuffer(getTarget(), handle);
 	mapped_buffer = glMapBuffer(getTarget(), GL_READ_WRITE);
+
+	// the whole buffer may be written, so count all of it
+	render_stats.current.bytes_uploaded += sizeof(ELEMENT) * numElements;
 	
 	return (ELEMENT*)mapped_buffer;
 }
@@ -236,13 +287,12 @@ void BufferObject<ELEMENT>::create_cpu_buffer( int numElements, const ELEMENT *
 	this->numElements = numElements;
 	
 	if (numElements>0) {
-		this->buffer = new ELEMENT[numElements];
+		// value-initialized, so zero until copied over
+		this->buffer = new ELEMENT[numElements]();
 		this->numElements = numElements;
 		
 		if (buffer != 0) {
-			memcpy(this->buffer, buffer, sizeof(ELEMENT)*numElements);
-		} else {
-			memset(this->buffer, 0, sizeof(ELEMENT)*numElements);
+			std::copy(buffer, buffer + numElements, this->buffer);
 		}
 	}
 }
@@ -260,6 +310,10 @@ void BufferObject<ELEMENT>::create_gpu_buffer(int numElements,
 	             sizeof(ELEMENT) * numElements,
 	             buffer,
 	             usage);
+
+	if(buffer) {
+		render_stats.current.bytes_uploaded += sizeof(ELEMENT) * numElements;
+	}
 }
 
 template<typename ELEMENT>
@@ -304,11 +358,31 @@ GLenum BufferObject<ELEMENT>::getGLUsageToken(BUFFER_USAGE usage) {
 
 // template class instantiations
 // (see http://www.codeproject.com/cpp/templatesourceorg.asp)
-template class BufferObject<Vec4>;
-template class BufferObject<Vec3>;
-template class BufferObject<Vec2>;
+template class BufferObject<Float4>;
+template class BufferObject<Float3>;
+template class BufferObject<Float2>;
+template class BufferObject<Half4>;
+template class BufferObject<Half2>;
+template class BufferObject<OctNormal>;
+template class BufferObject<PackedTangent>;
 template class BufferObject<index_t>;
 
+void RenderInstance::draw(void) const
+{
+	assert(rendermethod);
+
+	render_stats.current.draw_calls++;
+
+	if(gpu_timer.draw_timing) {
+		const std::type_info &type = typeid(*rendermethod);
+		gpu_timer.begin(GpuTimerEntry::DRAW, &type, trace_class_name(type));
+		rendermethod->draw(transform);
+		gpu_timer.end();
+	} else {
+		rendermethod->draw(transform);
+	}
+}
+
 Texture::~Texture()
 {
 	glDeleteTextures(1, &gltex_name);
@@ -461,7 +535,8 @@ Light::Light()
 Scene::Scene()
 : ambient_light(Vec3::Zero),
   start_time(0),
-  primary_camera(NULL)
+  primary_camera(NULL),
+  frame_graph(new FrameGraph())
 {
 	// Do Nothing
 }
@@ -514,6 +589,48 @@ void Pass::set_camera(void)
 	          upx, upy, upz);
 }
 
+void Pass::get_inputs(RenderMethod::TextureList &inputs) const
+{
+	const Frustum frustum(proj * get_view_matrix());
+
+	for(RenderInstanceList::const_iterator i = instances.begin();
+		i != instances.end(); ++i)
+	{
+		if(frustum.intersects((*i)->get_bounds())) {
+			add_inputs(**i, inputs);
+		}
+	}
+}
+
+void Pass::add_inputs(const RenderInstance &instance, RenderMethod::TextureList &inputs)
+{
+	const RenderMethod::TextureList &textures = instance.get_rendermethod()->get_textures();
+
+	for(RenderMethod::TextureList::const_iterator i = textures.begin();
+		i != textures.end(); ++i)
+	{
+		if((*i)->is_render_target() &&
+		   std::find(inputs.begin(), inputs.end(), *i) == inputs.end()) {
+			inputs.push_back(*i);
+		}
+	}
+}
+
+Mat4 Pass::get_view_matrix(void) const
+{
+	return look_at(camera.get_position(), camera.get_direction(), camera.get_up());
+}
+
+Mat4 Pass::look_at(const Vec3 &eye, const Vec3 &direction, const Vec3 &up)
+{
+	const Mat4 translation(1.0, 0.0, 0.0, -eye.x,
+	                       0.0, 1.0, 0.0, -eye.y,
+	                       0.0, 0.0, 1.0, -eye.z,
+	                       0.0, 0.0, 0.0, 1.0);
+
+	return Mat4::lookAt(direction, up) * translation;
+}
+
 void Pass::set_light_positions(const LightList & lights)
 {
 	for(int i=0; i<8 && i < (int)lights.size(); ++i)
@@ -528,47 +645,55 @@ void Pass::set_light_positions(const LightList & lights)
 
 void Scene::render()
 {
-	for(PassList::iterator i = passes.begin();
-		i != passes.end(); ++i)
-	{
-		(*i)->render(this);
+	TRACE_ZONE("Scene::render");
+
+	gpu_timer.begin_frame();
+
+	if(resolution_governor) {
+		resolution_governor->update();
 	}
 
-	SDL_GL_SwapBuffers();
+	frame_graph->execute(this);
+
+	render_stats.end_frame();
 }
 
 RenderTarget2D::~RenderTarget2D()
 {
-	glDeleteFramebuffersEXT(1, &fbo);
-	glDeleteRenderbuffersEXT(1, &renderbuffer);
+	if(fbo) {
+		render_target_pool.release_framebuffer(fbo);
+		render_target_pool.release_depth(renderbuffer);
+		render_target_pool.release_color(gltex_name);
+		gltex_name = 0; // not ours to delete
+	}
 }
 
-RenderTarget2D::RenderTarget2D( const ivec2 &_dimensions )
-	: fbo(0), renderbuffer(0), dimensions(_dimensions)
+RenderTarget2D::RenderTarget2D( const ivec2 &_dimensions, bool _transient )
+	: fbo(0),
+	  renderbuffer(0),
+	  dimensions(_dimensions),
+	  transient(_transient),
+	  scale(1),
+	  storage(NULL)
 {
 	// Do Nothing
 }
 
 void RenderTarget2D::init()
 {
-	glGenFramebuffersEXT(1, &fbo);
+	if(transient) {
+		return; // storage is lent by the frame graph
+	}
+
+	fbo = render_target_pool.acquire_framebuffer();
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fbo);
 
-	glGenRenderbuffersEXT(1, &renderbuffer);
-	glBindRenderbufferEXT(GL_RENDERBUFFER_EXT, renderbuffer);
-	glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT, GL_DEPTH_COMPONENT, dimensions.x, dimensions.y); 
+	renderbuffer = render_target_pool.acquire_shared_depth(dimensions);
 	glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, renderbuffer);
 
-	glGenTextures(1, &gltex_name);
-	glBindTexture(GL_TEXTURE_2D, gltex_name);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,  dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	gltex_name = render_target_pool.acquire_color(GL_TEXTURE_2D, dimensions, GL_RGBA8);
 	glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, gltex_name, 0);
 
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
 	// Error Checking: Make sure the FBO is properly constituted
 #ifndef NDEBUG
 	GLenum status = glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT);
@@ -577,18 +702,68 @@ void RenderTarget2D::init()
 	}
 #endif
 
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+
 	CHECK_GL_ERROR();
 }
 
+GLuint RenderTarget2D::get_gltex_name() const
+{
+	return storage ? storage->get_gltex_name() : gltex_name;
+}
+
+void RenderTarget2D::alias(const RenderTarget2D * _storage) const
+{
+	assert(transient);
+	assert(!_storage || (_storage->get_dimensions().x == dimensions.x &&
+	                     _storage->get_dimensions().y == dimensions.y));
+	storage = _storage;
+}
+
+void RenderTarget2D::set_scale(real_t _scale)
+{
+	assert(_scale > 0 && _scale <= 1);
+	scale = _scale;
+}
+
+ivec2 RenderTarget2D::get_viewport() const
+{
+	return ivec2(std::max(1, (int)(dimensions.x * scale + 0.5)),
+	             std::max(1, (int)(dimensions.y * scale + 0.5)));
+}
+
+/* the fraction of a texture of the given size covering the first drawn
+   texels; a partly drawn one stops at the centre of the last drawn texel,
+   so that GL_LINEAR does not blend in the undefined texels beyond it */
+static real_t uv_scale_inside(int drawn, int size)
+{
+	return drawn < size ? (drawn - real_t(0.5)) / size : real_t(1);
+}
+
+Vec2 RenderTarget2D::get_uv_scale() const
+{
+	const ivec2 viewport = get_viewport();
+	return Vec2(uv_scale_inside(viewport.x, dimensions.x),
+	            uv_scale_inside(viewport.y, dimensions.y));
+}
+
 void RenderTarget2D::bind_render_target() const
 {
+	// The storage may belong to another target, but the viewport is ours
+	const RenderTarget2D * target = storage ? storage : this;
+
+	assert(target->fbo && "transient render target has no storage");
+
 	CHECK_GL_ERROR();
-	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fbo);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, target->fbo);
 
 	// No need to save state. The viewport is reset by the next pass anyway.
-	glViewport(0, 0, dimensions.x, dimensions.y);
+	const ivec2 viewport = get_viewport();
+	glViewport(0, 0, viewport.x, viewport.y);
 }
 
+GLuint main_framebuffer = 0;
+
 GLenum face_targets[6] =
 {
 	GL_TEXTURE_CUBE_MAP_NEGATIVE_Z_EXT, // left
@@ -667,6 +842,8 @@ void CubeMapTexture::load_face(GLenum target, const std::string &filename)
 					 GL_UNSIGNED_BYTE,
 					 data);
 
+		render_stats.current.bytes_uploaded += width * height * bpp;
+
 		ilDeleteImages(1, &ImageName); 
 	}
 	
@@ -743,29 +920,188 @@ void CubeMapTexture::init_blank_face(GLenum target, const ivec2 &dimensions)
 		GL_UNSIGNED_BYTE,
 		data);
 
+	render_stats.current.bytes_uploaded += dimensions.x * dimensions.y * 4;
+
 	delete [] data;
 }
 
-CubeMapTarget::CubeMapTarget(const ivec2 &_dimensions)
-	: fbo(0), renderbuffer(0), dimensions(_dimensions)
+CubeMapTarget::CubeMapTarget(const ivec2 &_dimensions, bool _static_cache)
+	: fbo(0),
+	  renderbuffer(0),
+	  dimensions(_dimensions),
+	  faces_attached(false),
+	  static_cache(_static_cache),
+	  static_texture(0)
 {
-	// Do Nothing
+	std::fill(static_fbo, static_fbo + 6, 0);
+	std::fill(static_renderbuffer, static_renderbuffer + 6, 0);
+}
+
+CubeMapTarget::~CubeMapTarget()
+{
+	release();
+}
+
+void CubeMapTarget::release(void)
+{
+	if(fbo) {
+		render_target_pool.release_framebuffer(fbo);
+		render_target_pool.release_depth(renderbuffer);
+		render_target_pool.release_color(gltex_name);
+		gltex_name = 0; // not ours to delete
+	}
+
+	if(static_texture) {
+		for(int i=0; i<6; ++i)
+		{
+			render_target_pool.release_framebuffer(static_fbo[i]);
+			render_target_pool.release_depth(static_renderbuffer[i]);
+		}
+
+		render_target_pool.release_color(static_texture);
+		static_texture = 0;
+	}
+
+	fbo = 0;
+	renderbuffer = 0;
+}
+
+void CubeMapTarget::resize(const ivec2 &_dimensions)
+{
+	if(_dimensions.x == dimensions.x && _dimensions.y == dimensions.y)
+		return;
+
+	const bool had_static_cache = static_cache;
+
+	release();
+
+	dimensions = _dimensions;
+	faces_attached = false;
+	static_cache = had_static_cache;
+	std::fill(static_fbo, static_fbo + 6, 0);
+	std::fill(static_renderbuffer, static_renderbuffer + 6, 0);
+
+	init();
+	mark_changed();
 }
 
 void CubeMapTarget::init(void)
 {
-	create_cubemap_texture(dimensions);
+	gltex_name = render_target_pool.acquire_color(GL_TEXTURE_CUBE_MAP_EXT, dimensions, GL_RGBA8);
 
 	// Create the frame buffer object
-	glGenFramebuffersEXT(1, &fbo);
+	fbo = render_target_pool.acquire_framebuffer();
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fbo);
 
-	// Add a depth buffer to the frame buffer object
-	glGenRenderbuffersEXT(1, &renderbuffer);
-	glBindRenderbufferEXT(GL_RENDERBUFFER_EXT, renderbuffer);
-	glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT, GL_DEPTH_COMPONENT, dimensions.x, dimensions.y); 
+	// Add a depth buffer to the frame buffer object. Every face is cleared
+	// or restored before drawing, so it can be shared with other targets.
+	renderbuffer = render_target_pool.acquire_shared_depth(dimensions);
 	glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, renderbuffer);
 
+	// Attach every face once, to its own color attachment, if there are
+	// enough attachment points. Selecting a face is then just a matter of
+	// changing the draw buffer, which is much cheaper than re-attaching.
+	GLint max_attachments = 0;
+	glGetIntegerv(GL_MAX_COLOR_ATTACHMENTS_EXT, &max_attachments);
+
+	if(max_attachments >= 6) {
+		for(int i=0; i<6; ++i)
+		{
+			glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,
+			                          GL_COLOR_ATTACHMENT0_EXT + i,
+			                          face_targets[i],
+			                          gltex_name,
+			                          0);
+		}
+
+		glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+		glReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
+
+		faces_attached = (glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT) == GL_FRAMEBUFFER_COMPLETE_EXT);
+
+		if(!faces_attached) {
+			// fall back to attaching one face at a time
+			for(int i=1; i<6; ++i)
+			{
+				glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,
+				                          GL_COLOR_ATTACHMENT0_EXT + i,
+				                          face_targets[i],
+				                          0,
+				                          0);
+			}
+		}
+	}
+
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+
+	if(static_cache) {
+		init_static_cache();
+	}
+
+	CHECK_GL_ERROR();
+}
+
+void CubeMapTarget::init_static_cache(void)
+{
+	if(!glewIsSupported("GL_EXT_framebuffer_blit")) {
+		std::cerr << "WARNING: Static cube map cache needs EXT_framebuffer_blit" << std::endl;
+		static_cache = false;
+		return;
+	}
+
+	static_texture = render_target_pool.acquire_color(GL_TEXTURE_CUBE_MAP_EXT, dimensions, GL_RGBA8);
+
+	// Each face gets its own depth buffer, since the depth has to be kept too
+	for(int i=0; i<6; ++i)
+	{
+		static_fbo[i] = render_target_pool.acquire_framebuffer();
+		static_renderbuffer[i] = render_target_pool.acquire_depth(dimensions);
+
+		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, static_fbo[i]);
+		glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, static_renderbuffer[i]);
+
+		glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,
+		                          GL_COLOR_ATTACHMENT0_EXT,
+		                          face_targets[i],
+		                          static_texture,
+		                          0);
+
+		if(glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT) != GL_FRAMEBUFFER_COMPLETE_EXT) {
+			std::cerr << "WARNING: Failed to create static cube map cache" << std::endl;
+			static_cache = false;
+		}
+	}
+
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+
+	CHECK_GL_ERROR();
+}
+
+void CubeMapTarget::bind_static_capture(int face) const
+{
+	assert(static_cache);
+
+	glViewport(0, 0, dimensions.x, dimensions.y);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, static_fbo[face]);
+
+	CHECK_GL_ERROR();
+}
+
+void CubeMapTarget::restore_static_capture(int face) const
+{
+	assert(static_cache);
+
+	// The draw buffer of fbo already selects the face (see bind_render_target)
+	glBindFramebufferEXT(GL_READ_FRAMEBUFFER_EXT, static_fbo[face]);
+	glBindFramebufferEXT(GL_DRAW_FRAMEBUFFER_EXT, fbo);
+
+	glBlitFramebufferEXT(0, 0, dimensions.x, dimensions.y,
+	                     0, 0, dimensions.x, dimensions.y,
+	                     GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT,
+	                     GL_NEAREST);
+
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fbo);
+
 	CHECK_GL_ERROR();
 }
 
@@ -779,6 +1115,12 @@ void CubeMapTarget::bind_render_target(int face) const
 	// Bind the frame buffer object
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fbo);
 
+	if(faces_attached) {
+		glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT + face);
+		CHECK_GL_ERROR();
+		return;
+	}
+
 	// Bind the face we are rendering to right now (must do one at a time)
 	glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,
 	                          GL_COLOR_ATTACHMENT0_EXT,
@@ -796,45 +1138,3 @@ void CubeMapTarget::bind_render_target(int face) const
 
 	CHECK_GL_ERROR();
 }
-
-void CubeMapTarget::init_face_texture( GLenum target, const ivec2 &dimensions )
-{
-	unsigned char * data = new unsigned char[dimensions.x * dimensions.y * 4];
-	unsigned char * pixel = data;
-
-	for(int y = 0; y < dimensions.y; ++y)
-	{
-		for(int x = 0; x < dimensions.x; ++x)
-		{
-			pixel[0] = 255; // R
-			pixel[1] = 0;   // G
-			pixel[2] = 0;   // B
-			pixel[3] = 255; // A
-			pixel += 4;
-		}
-	}
-
-	glTexImage2D(target,
-	             0,
-	             GL_RGBA8,
-	             dimensions.x,
-	             dimensions.y,
-	             0,
-	             GL_RGBA,
-	             GL_UNSIGNED_BYTE,
-	             data); // NULL
-
-	delete [] data;
-}
-
-void CubeMapTarget::create_cubemap_texture(const ivec2 &dim)
-{
-	glGenTextures(1, &gltex_name);
-	glBindTexture(GL_TEXTURE_CUBE_MAP_EXT, gltex_name);
-	for(int i=0; i<6; i++) { init_face_texture(face_targets[i], dim); }
-	glTexParameteri(GL_TEXTURE_CUBE_MAP_EXT, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP_EXT, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP_EXT, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP_EXT, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP_EXT, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-}
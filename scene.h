@@ -26,8 +26,17 @@ public:
 	virtual ~Tickable() { /* Do Nothing */ }
 	virtual void tick(real_t time) = 0;
 
+	/** Incremented whenever the object changes, so that anything derived
+	    from it can tell whether it is out of date */
+	unsigned int get_revision() const { return revision; }
+
 protected:
-	Tickable()  { /* Do Nothing */ }
+	Tickable() : revision(0) { /* Do Nothing */ }
+
+	void mark_changed() { ++revision; }
+
+private:
+	unsigned int revision;
 };
 
 struct Face
@@ -53,21 +62,36 @@ class RenderInstance
 public:
 	~RenderInstance(void) { /* Do Nothing */ }
 
-	RenderInstance(const Mat4 &_transform, const boost::shared_ptr<RenderMethod> _rendermethod)
+	RenderInstance(const Affine3 &_transform, const boost::shared_ptr<RenderMethod> _rendermethod)
 		: transform(_transform),
 		  rendermethod(_rendermethod)
 	{
 		assert(rendermethod);
 	}
 
-	void draw(void) const
+	/** Draws the instance, timed by gpu_timer if it times draws */
+	void draw(void) const;
+
+	const boost::shared_ptr<RenderMethod> & get_rendermethod(void) const
+	{
+		return rendermethod;
+	}
+
+	/** Transformation from object space to world space */
+	const Affine3 & get_transform(void) const
+	{
+		return transform;
+	}
+
+	/** World-space bounds of the instance. Empty if unknown. */
+	AABB get_bounds(void) const
 	{
 		assert(rendermethod);
-		rendermethod->draw(transform);
+		return rendermethod->get_bounds().transform(transform);
 	}
 
 private:
-	const Mat4 transform;
+	const Affine3 transform;
 	const boost::shared_ptr<RenderMethod> rendermethod;
 };
 
@@ -87,7 +111,8 @@ public:
 
 private:
 	char* load_file(const char* file);
-	void load_shader(const char* file, GLint type, GLhandleARB& program);
+	void load_shader(const char* file, GLint type, GLhandleARB& program,
+	                 const char* defines = "");
 	GLhandleARB load_shaders(const char* vert_file, const char* frag_file);
 
 private:
@@ -108,12 +133,30 @@ enum BUFFER_USAGE {
 	DYNAMIC_COPY
 };
 
+/**
+What drawing code needs of a BufferObject whose element type is chosen at
+run time, e.g. texture coordinates stored as Half2 or Float2 (see
+VertexFormat): binding it, and the gl_type_traits of its elements.
+*/
+class VertexStream
+{
+public:
+	virtual ~VertexStream() { /* Do Nothing */ }
+
+	/** Binds the buffer for use on the GPU */
+	virtual void bind() const = 0;
+
+	virtual GLenum get_gl_type() const = 0;
+	virtual GLint get_gl_components() const = 0;
+	virtual GLboolean is_gl_normalized() const = 0;
+};
+
 /**
 Contains a buffer of graphically related data such as an index array or a
 vertex array. This data may be stored in memory on the graphics device after
 being submitted.
 */
-template<typename ELEMENT> class BufferObject {
+template<typename ELEMENT> class BufferObject : public VertexStream {
 public:
 	/** Destructor */
 	virtual ~BufferObject();
@@ -177,6 +220,10 @@ public:
 	
 	/** Binds the buffer for use on the GPU */
 	void bind() const;
+
+	GLenum get_gl_type() const { return gl_type_traits<ELEMENT>::type; }
+	GLint get_gl_components() const { return gl_type_traits<ELEMENT>::components; }
+	GLboolean is_gl_normalized() const { return gl_type_traits<ELEMENT>::normalized; }
 	
 	/**
 	Locks the buffer to allow read-write access by the client.
@@ -229,13 +276,30 @@ class Texture : public SceneResource
 {
 public:
 	virtual ~Texture();
-	Texture(void) : gltex_name(0) {}
+	Texture(void) : gltex_name(0), revision(0) {}
 
-	inline GLuint get_gltex_name() const { return gltex_name; }
+	/** Gets the OpenGL texture object, which may belong to another texture
+	    whose storage this one shares */
+	virtual GLuint get_gltex_name() const { return gltex_name; }
 
 	virtual void init(void) = 0;
 	virtual void bind(void) const = 0;
 
+	/** Returns true if the contents are drawn by a pass */
+	virtual bool is_render_target(void) const { return false; }
+
+	/** Gets the part of the texture, from the origin, which holds the
+	    image. Texture coordinates in [0,1] must be scaled by this. A partly
+	    drawn target stops half a texel inside the drawn part, so that
+	    linear filtering never reaches past it. */
+	virtual Vec2 get_uv_scale(void) const { return Vec2(1, 1); }
+
+	/** Incremented whenever a pass changes the contents */
+	unsigned int get_revision(void) const { return revision; }
+
+	/** Passes only hold const pointers to their targets, hence const */
+	void mark_changed(void) const { ++revision; }
+
 private:
 	// no meaningful assignment or copy
 	Texture(const Texture &r);
@@ -246,6 +310,9 @@ public:
 
 protected:
 	GLuint gltex_name;
+
+private:
+	mutable unsigned int revision;
 };
 
 class Texture2D : public Texture
@@ -305,17 +372,55 @@ public:
 extern GLenum face_targets[6];
 extern Quat face_orientation[6];
 
+/** Framebuffer which passes without a render target draw into. Zero, the
+    window, unless rendering headless (see headlessdevice.h). */
+extern GLuint main_framebuffer;
+
 class RenderTarget2D : public Texture2D
 {
 public:
 	virtual ~RenderTarget2D();
 
-	RenderTarget2D(const ivec2 &_dimensions);
+	/**
+	@param _dimensions Size of the target
+	@param _transient If true, the contents are only needed from the pass
+	which draws them until the last pass to read them in the same frame.
+	No storage is allocated by init(); the frame graph lends the target
+	storage each frame, shared with other transient targets.
+	*/
+	RenderTarget2D(const ivec2 &_dimensions, bool _transient = false);
 
 	virtual void init();
 
 	virtual void bind_render_target() const;
 
+	virtual bool is_render_target(void) const { return true; }
+
+	virtual GLuint get_gltex_name() const;
+
+	const ivec2 & get_dimensions(void) const { return dimensions; }
+
+	bool is_transient(void) const { return transient; }
+
+	/** Sets the fraction of the width and height which passes draw into.
+	    The rest of the texture is left undefined. */
+	void set_scale(real_t _scale);
+
+	real_t get_scale(void) const { return scale; }
+
+	/** Gets the size of the part of the target which passes draw into */
+	ivec2 get_viewport(void) const;
+
+	virtual Vec2 get_uv_scale(void) const;
+
+	/** Makes a transient target draw into, and be read from, the storage of
+	    another target of the same size. Passes only hold const pointers to
+	    their targets, hence const. */
+	void alias(const RenderTarget2D * storage) const;
+
+	/** Gets the target whose storage this one uses, or NULL */
+	const RenderTarget2D * get_storage(void) const { return storage; }
+
 private:
 	// no meaningful assignment or copy
 	RenderTarget2D(const RenderTarget2D &r);
@@ -325,27 +430,67 @@ private:
 	GLuint fbo;
 	GLuint renderbuffer;
 	ivec2 dimensions;
+	bool transient;
+	real_t scale;
+	mutable const RenderTarget2D * storage;
 };
 
 class CubeMapTarget : public CubeMapTexture
 {
 public:
-	CubeMapTarget(const ivec2 &_dimensions);
+	/**
+	@param _dimensions Size of each face
+	@param _static_cache If true, keep a second copy of the faces, color and
+	depth, holding only static geometry. See restore_static_capture().
+	*/
+	CubeMapTarget(const ivec2 &_dimensions, bool _static_cache = false);
+	virtual ~CubeMapTarget();
 	virtual void init(void);
 	virtual void bind_render_target(int face) const;
 
+	virtual bool is_render_target(void) const { return true; }
+
+	const ivec2 & get_dimensions(void) const { return dimensions; }
+
+	/** Reallocates every face, and the static cache, at a new size. The
+	    contents are lost, so every face must be drawn again. */
+	void resize(const ivec2 &_dimensions);
+
+	/** Returns true if all six faces are attached to the frame buffer
+	    object at once, each to its own color attachment, so that switching
+	    faces only changes the draw buffer. Each face is still drawn by a
+	    separate pass over the geometry; this is not layered rendering. */
+	bool has_faces_attached(void) const { return faces_attached; }
+
+	/** Returns true if the static cache was requested and is supported */
+	bool has_static_cache(void) const { return static_cache; }
+
+	/** Binds the static cache of one face for rendering */
+	void bind_static_capture(int face) const;
+
+	/** Copies the static cache of one face, color and depth, over the face
+	    bound with bind_render_target(). Dynamic geometry may then be drawn
+	    on top without redrawing the static geometry. */
+	void restore_static_capture(int face) const;
+
 private:
 	// no meaningful assignment or copy
 	CubeMapTarget(const CubeMapTarget &r);
 	CubeMapTarget& operator=(const CubeMapTarget &r);
 
-	void init_face_texture(GLenum target, const ivec2 &dimensions);
-	void create_cubemap_texture(const ivec2 &dimensions);
+	void init_static_cache(void);
+	void release(void);
 
 private:
 	GLuint fbo;
 	GLuint renderbuffer;
 	ivec2 dimensions;
+	bool faces_attached;
+
+	bool static_cache;
+	GLuint static_texture;
+	GLuint static_fbo[6];
+	GLuint static_renderbuffer[6];
 };
 
 /** Calculate the tangents for one triangle */
@@ -443,12 +588,33 @@ public:
 
 	virtual void render(const Scene * scene) = 0;
 
+	/** Gets the render target which render() draws into, or NULL if it
+	    draws into the framebuffer */
+	virtual boost::shared_ptr<const Texture> get_output(void) const = 0;
+
+	/** Appends the render targets sampled by the instances which the next
+	    call to render() may draw. By default, those in the view frustum. */
+	virtual void get_inputs(RenderMethod::TextureList &inputs) const;
+
+	/** Gets the view matrix which set_camera() loads into the modelview matrix */
+	Mat4 get_view_matrix(void) const;
+
 protected:
 	Pass(void);
 	void set_camera(void);
+
+	/** Builds the view matrix gluLookAt() would for the given camera */
+	static Mat4 look_at(const Vec3 &eye, const Vec3 &direction, const Vec3 &up);
 	void set_light_positions(const LightList & lights);
+
+	/** Appends the render targets sampled by the instance, skipping any
+	    already in the list */
+	static void add_inputs(const RenderInstance &instance, RenderMethod::TextureList &inputs);
 };
 
+class FrameGraph;
+class ResolutionGovernor;
+
 class Scene
 {
 public:
@@ -465,6 +631,12 @@ public:
 	TickableList tickables;
 	PassList passes;
 
+	/** Orders, culls and renders the passes each frame */
+	boost::shared_ptr<FrameGraph> frame_graph;
+
+	/** Scales offscreen targets to hold a frame time, or NULL */
+	boost::shared_ptr<ResolutionGovernor> resolution_governor;
+
     // the absolute time at which to start updates for ths scene.
     real_t start_time;
 
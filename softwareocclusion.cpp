@@ -0,0 +1,483 @@
+/** @file softwareocclusion.cpp
+ *  @brief Occlusion culling against a depth buffer rasterized on the CPU
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#include "softwareocclusion.h"
+#include "vec/batch.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTWARE_OCCLUSION_SSE2 1
+#include <emmintrin.h>
+#else
+#define SOFTWARE_OCCLUSION_SSE2 0
+#endif
+
+std::ostream& operator<<(std::ostream &o, const SoftwareOcclusionStats &stats)
+{
+	o << "triangles=" << stats.triangles
+	  << " boxes_tested=" << stats.boxes_tested
+	  << " boxes_culled=" << stats.boxes_culled;
+	return o;
+}
+
+static int round_up(int x, int multiple)
+{
+	return ((x + multiple - 1) / multiple) * multiple;
+}
+
+SoftwareOcclusionCuller::SoftwareOcclusionCuller(int _width, int _height, int num_threads)
+: width(round_up(std::max(_width, 1), TILE_SIZE)),
+  height(round_up(std::max(_height, 1), TILE_SIZE)),
+  view_proj(Mat4::Identity),
+  done(0),
+  quit(false)
+{
+	assert(num_threads >= 0);
+
+	tiles_x = width / TILE_SIZE;
+	tiles_y = height / TILE_SIZE;
+
+	// the calling thread takes the last band
+	num_bands = std::min(num_threads + 1, tiles_y);
+
+	depth.resize(width * height, 1.0f);
+	hiz.resize(tiles_x * tiles_y, 1.0f);
+
+	if(num_bands > 1) {
+		done = SDL_CreateSemaphore(0);
+		workers.resize(num_bands - 1);
+	}
+
+	// workers must not move once their threads are running
+	for(size_t i = 0; i < workers.size(); ++i)
+	{
+		Worker &worker = workers[i];
+		worker.culler = this;
+		worker.band = (int)i;
+		worker.start = SDL_CreateSemaphore(0);
+		worker.thread = SDL_CreateThread(&SoftwareOcclusionCuller::worker_main, &worker);
+
+		if(!worker.thread) {
+			std::cerr << "Failed to create occlusion worker thread: "
+			          << SDL_GetError() << std::endl;
+		}
+	}
+}
+
+SoftwareOcclusionCuller::~SoftwareOcclusionCuller()
+{
+	quit = true;
+
+	for(std::vector<Worker>::iterator i = workers.begin(); i != workers.end(); ++i)
+	{
+		if((*i).thread) {
+			SDL_SemPost((*i).start);
+			SDL_WaitThread((*i).thread, NULL);
+		}
+
+		SDL_DestroySemaphore((*i).start);
+	}
+
+	if(done) {
+		SDL_DestroySemaphore(done);
+	}
+}
+
+int SoftwareOcclusionCuller::worker_main(void * data)
+{
+	Worker &worker = *(Worker *)data;
+
+	for(;;)
+	{
+		SDL_SemWait(worker.start);
+
+		if(worker.culler->quit)
+			break;
+
+		worker.culler->rasterize_band(worker.band);
+		SDL_SemPost(worker.culler->done);
+	}
+
+	return 0;
+}
+
+void SoftwareOcclusionCuller::add_occluder(const Vec3 * vertices,
+                                           size_t num_vertices,
+                                           const Affine3 &transform)
+{
+	assert(vertices);
+	assert(num_vertices % 3 == 0);
+
+	const size_t first = occluders.size();
+	occluders.resize(first + num_vertices);
+
+	if(num_vertices > 0) {
+		transform_points(transform, vertices, &occluders[first], num_vertices);
+	}
+}
+
+void SoftwareOcclusionCuller::clear_occluders()
+{
+	occluders.clear();
+}
+
+void SoftwareOcclusionCuller::render(const Mat4 &_view_proj)
+{
+	view_proj = _view_proj;
+	stats = SoftwareOcclusionStats();
+	triangles.clear();
+
+	clip_vertices.resize(occluders.size());
+	if(!occluders.empty()) {
+		transform_points(view_proj, &occluders[0], &clip_vertices[0], occluders.size());
+	}
+
+	for(size_t i = 0; i + 2 < occluders.size(); i += 3)
+	{
+		const Vec4 * clip = &clip_vertices[i];
+		int outside[6] = { 0, 0, 0, 0, 0, 0 };
+
+		for(int v = 0; v < 3; ++v)
+		{
+			if(clip[v].x >  clip[v].w) outside[0]++;
+			if(clip[v].x < -clip[v].w) outside[1]++;
+			if(clip[v].y >  clip[v].w) outside[2]++;
+			if(clip[v].y < -clip[v].w) outside[3]++;
+			if(clip[v].z >  clip[v].w) outside[4]++;
+			if(clip[v].z < -clip[v].w) outside[5]++;
+		}
+
+		// reject triangles entirely outside one of the frustum planes
+		if(std::find(outside, outside + 6, 3) != outside + 6)
+			continue;
+
+		clip_triangle(clip);
+	}
+
+	for(std::vector<Worker>::iterator i = workers.begin(); i != workers.end(); ++i)
+	{
+		if((*i).thread) {
+			SDL_SemPost((*i).start);
+		} else {
+			rasterize_band((*i).band);
+		}
+	}
+
+	rasterize_band(num_bands - 1);
+
+	for(std::vector<Worker>::iterator i = workers.begin(); i != workers.end(); ++i)
+	{
+		if((*i).thread) {
+			SDL_SemWait(done);
+		}
+	}
+}
+
+void SoftwareOcclusionCuller::clip_triangle(const Vec4 clip[3])
+{
+	// distance to the near plane, z = -w
+	real_t d[3];
+	int inside = 0;
+
+	for(int i = 0; i < 3; ++i)
+	{
+		d[i] = clip[i].z + clip[i].w;
+		if(d[i] >= 0) inside++;
+	}
+
+	if(inside == 3) {
+		setup_triangle(clip);
+		return;
+	}
+
+	// Sutherland-Hodgman against the near plane leaves at most four vertices
+	Vec4 poly[4];
+	int n = 0;
+
+	for(int i = 0; i < 3; ++i)
+	{
+		const int j = (i + 1) % 3;
+
+		if(d[i] >= 0) {
+			poly[n++] = clip[i];
+		}
+
+		if((d[i] >= 0) != (d[j] >= 0)) {
+			const real_t t = d[i] / (d[i] - d[j]);
+			poly[n++] = clip[i] + (clip[j] - clip[i]) * t;
+		}
+	}
+
+	for(int i = 1; i + 1 < n; ++i)
+	{
+		const Vec4 tri[3] = { poly[0], poly[i], poly[i+1] };
+		setup_triangle(tri);
+	}
+}
+
+void SoftwareOcclusionCuller::setup_triangle(const Vec4 clip[3])
+{
+	float x[3], y[3], z[3];
+
+	for(int i = 0; i < 3; ++i)
+	{
+		const float inv_w = (float)(1.0 / clip[i].w);
+		x[i] = ((float)clip[i].x * inv_w * 0.5f + 0.5f) * width;
+		y[i] = ((float)clip[i].y * inv_w * 0.5f + 0.5f) * height;
+		z[i] = ((float)clip[i].z * inv_w * 0.5f + 0.5f);
+	}
+
+	float area = (x[1]-x[0])*(y[2]-y[0]) - (y[1]-y[0])*(x[2]-x[0]);
+
+	if(std::fabs(area) < 1e-6f)
+		return; // degenerate, or seen edge-on
+
+	// occluders are not back-face culled; wind every triangle the same way
+	if(area < 0) {
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		std::swap(z[1], z[2]);
+		area = -area;
+	}
+
+	Triangle tri;
+
+	// edge i lies opposite vertex i
+	for(int i = 0; i < 3; ++i)
+	{
+		const int j = (i + 1) % 3;
+		const int k = (i + 2) % 3;
+		tri.a[i] = y[j] - y[k];
+		tri.b[i] = x[k] - x[j];
+		tri.c[i] = -(tri.a[i] * x[j] + tri.b[i] * y[j]);
+	}
+
+	const float inv_area = 1.0f / area;
+	tri.za = (tri.a[0]*z[0] + tri.a[1]*z[1] + tri.a[2]*z[2]) * inv_area;
+	tri.zb = (tri.b[0]*z[0] + tri.b[1]*z[1] + tri.b[2]*z[2]) * inv_area;
+	tri.zc = (tri.c[0]*z[0] + tri.c[1]*z[1] + tri.c[2]*z[2]) * inv_area;
+
+	const float min_x = std::min(x[0], std::min(x[1], x[2]));
+	const float max_x = std::max(x[0], std::max(x[1], x[2]));
+	const float min_y = std::min(y[0], std::min(y[1], y[2]));
+	const float max_y = std::max(y[0], std::max(y[1], y[2]));
+
+	tri.x0 = std::max(0, (int)std::floor(min_x));
+	tri.x1 = std::min(width - 1, (int)std::ceil(max_x));
+	tri.y0 = std::max(0, (int)std::floor(min_y));
+	tri.y1 = std::min(height - 1, (int)std::ceil(max_y));
+
+	if(tri.x0 > tri.x1 || tri.y0 > tri.y1)
+		return;
+
+	triangles.push_back(tri);
+	stats.triangles++;
+}
+
+void SoftwareOcclusionCuller::rasterize_band(int band)
+{
+	const int tiles_per_band = (tiles_y + num_bands - 1) / num_bands;
+	const int y0 = std::min(band * tiles_per_band * TILE_SIZE, height);
+	const int y1 = std::min(y0 + tiles_per_band * TILE_SIZE, height);
+
+	if(y0 >= y1)
+		return;
+
+	std::fill(depth.begin() + y0 * width, depth.begin() + y1 * width, 1.0f);
+
+	for(std::vector<Triangle>::const_iterator i = triangles.begin();
+		i != triangles.end(); ++i)
+	{
+		rasterize_triangle(*i, y0, y1);
+	}
+
+	build_hiz(y0, y1);
+}
+
+void SoftwareOcclusionCuller::rasterize_triangle(const Triangle &tri, int y0, int y1)
+{
+	const int ys = std::max(tri.y0, y0);
+	const int ye = std::min(tri.y1, y1 - 1);
+
+#if SOFTWARE_OCCLUSION_SSE2
+	// Four pixels at a time. The width is a multiple of four, so starting on a
+	// multiple of four never runs past the end of a row.
+	const int xs = tri.x0 & ~3;
+	const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	const __m128 px = _mm_add_ps(_mm_set1_ps((float)xs), offsets);
+	const __m128 zero = _mm_setzero_ps();
+
+	__m128 a[3], step[3];
+	for(int i = 0; i < 3; ++i)
+	{
+		a[i] = _mm_set1_ps(tri.a[i]);
+		step[i] = _mm_set1_ps(tri.a[i] * 4.0f);
+	}
+	const __m128 za = _mm_set1_ps(tri.za);
+	const __m128 zstep = _mm_set1_ps(tri.za * 4.0f);
+
+	for(int y = ys; y <= ye; ++y)
+	{
+		const float py = y + 0.5f;
+		float * row = &depth[y * width];
+
+		__m128 e0 = _mm_add_ps(_mm_mul_ps(a[0], px), _mm_set1_ps(tri.b[0] * py + tri.c[0]));
+		__m128 e1 = _mm_add_ps(_mm_mul_ps(a[1], px), _mm_set1_ps(tri.b[1] * py + tri.c[1]));
+		__m128 e2 = _mm_add_ps(_mm_mul_ps(a[2], px), _mm_set1_ps(tri.b[2] * py + tri.c[2]));
+		__m128 z = _mm_add_ps(_mm_mul_ps(za, px), _mm_set1_ps(tri.zb * py + tri.zc));
+
+		for(int x = xs; x <= tri.x1; x += 4)
+		{
+			const __m128 mask = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero),
+			                                          _mm_cmpge_ps(e1, zero)),
+			                               _mm_cmpge_ps(e2, zero));
+
+			if(_mm_movemask_ps(mask)) {
+				const __m128 old = _mm_loadu_ps(row + x);
+				const __m128 nearer = _mm_min_ps(old, z);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(mask, nearer),
+				                                 _mm_andnot_ps(mask, old)));
+			}
+
+			e0 = _mm_add_ps(e0, step[0]);
+			e1 = _mm_add_ps(e1, step[1]);
+			e2 = _mm_add_ps(e2, step[2]);
+			z = _mm_add_ps(z, zstep);
+		}
+	}
+#else
+	for(int y = ys; y <= ye; ++y)
+	{
+		const float py = y + 0.5f;
+		float * row = &depth[y * width];
+
+		for(int x = tri.x0; x <= tri.x1; ++x)
+		{
+			const float px = x + 0.5f;
+
+			if(tri.a[0]*px + tri.b[0]*py + tri.c[0] >= 0 &&
+			   tri.a[1]*px + tri.b[1]*py + tri.c[1] >= 0 &&
+			   tri.a[2]*px + tri.b[2]*py + tri.c[2] >= 0)
+			{
+				const float z = tri.za*px + tri.zb*py + tri.zc;
+				row[x] = std::min(row[x], z);
+			}
+		}
+	}
+#endif
+}
+
+void SoftwareOcclusionCuller::build_hiz(int y0, int y1)
+{
+	for(int ty = y0 / TILE_SIZE; ty < y1 / TILE_SIZE; ++ty)
+	{
+		for(int tx = 0; tx < tiles_x; ++tx)
+		{
+			float farthest = 0.0f;
+
+			for(int y = ty * TILE_SIZE; y < (ty + 1) * TILE_SIZE; ++y)
+			{
+				const float * row = &depth[y * width + tx * TILE_SIZE];
+				farthest = std::max(farthest, *std::max_element(row, row + TILE_SIZE));
+			}
+
+			hiz[ty * tiles_x + tx] = farthest;
+		}
+	}
+}
+
+bool SoftwareOcclusionCuller::test_tile(int tx, int ty,
+                                        int x0, int y0, int x1, int y1,
+                                        float z) const
+{
+	if(z > hiz[ty * tiles_x + tx])
+		return false; // behind everything in the tile
+
+	const int xs = std::max(x0, tx * TILE_SIZE);
+	const int xe = std::min(x1, (tx + 1) * TILE_SIZE - 1);
+	const int ys = std::max(y0, ty * TILE_SIZE);
+	const int ye = std::min(y1, (ty + 1) * TILE_SIZE - 1);
+
+	for(int y = ys; y <= ye; ++y)
+	{
+		const float * row = &depth[y * width];
+
+		for(int x = xs; x <= xe; ++x)
+		{
+			if(z <= row[x])
+				return true;
+		}
+	}
+
+	return false;
+}
+
+bool SoftwareOcclusionCuller::is_visible(const AABB &box) const
+{
+	stats.boxes_tested++;
+
+	if(box.is_empty())
+		return true;
+
+	Vec3 corners[8];
+	box.get_corners(corners);
+
+	Vec4 clip_corners[8];
+	transform_points(view_proj, corners, clip_corners, 8);
+
+	float min_x = std::numeric_limits<float>::max();
+	float min_y = std::numeric_limits<float>::max();
+	float min_z = std::numeric_limits<float>::max();
+	float max_x = -std::numeric_limits<float>::max();
+	float max_y = -std::numeric_limits<float>::max();
+
+	for(int i = 0; i < 8; ++i)
+	{
+		const Vec4 &clip = clip_corners[i];
+
+		// the box crosses the near plane, so its projection is unbounded
+		if(clip.w <= 0 || clip.z < -clip.w)
+			return true;
+
+		const float inv_w = (float)(1.0 / clip.w);
+		const float x = ((float)clip.x * inv_w * 0.5f + 0.5f) * width;
+		const float y = ((float)clip.y * inv_w * 0.5f + 0.5f) * height;
+		const float z = ((float)clip.z * inv_w * 0.5f + 0.5f);
+
+		min_x = std::min(min_x, x);
+		max_x = std::max(max_x, x);
+		min_y = std::min(min_y, y);
+		max_y = std::max(max_y, y);
+		min_z = std::min(min_z, z);
+	}
+
+	if(max_x < 0 || max_y < 0 || min_x >= width || min_y >= height) {
+		stats.boxes_culled++;
+		return false; // off-screen
+	}
+
+	const int x0 = std::max(0, (int)std::floor(min_x));
+	const int x1 = std::min(width - 1, (int)std::floor(max_x));
+	const int y0 = std::max(0, (int)std::floor(min_y));
+	const int y1 = std::min(height - 1, (int)std::floor(max_y));
+
+	for(int ty = y0 / TILE_SIZE; ty <= y1 / TILE_SIZE; ++ty)
+	{
+		for(int tx = x0 / TILE_SIZE; tx <= x1 / TILE_SIZE; ++tx)
+		{
+			if(test_tile(tx, ty, x0, y0, x1, y1, min_z))
+				return true;
+		}
+	}
+
+	stats.boxes_culled++;
+	return false;
+}
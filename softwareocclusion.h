@@ -0,0 +1,166 @@
+/** @file softwareocclusion.h
+ *  @brief Occlusion culling against a depth buffer rasterized on the CPU
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#ifndef _SOFTWARE_OCCLUSION_H_
+#define _SOFTWARE_OCCLUSION_H_
+
+#include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
+
+#include "vec/vec.h"
+#include "vec/mat.h"
+#include "vec/affine.h"
+#include "vec/aabb.h"
+
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+/** Statistics gathered by SoftwareOcclusionCuller over one frame */
+struct SoftwareOcclusionStats
+{
+	/** Number of occluder triangles which reached the rasterizer */
+	int triangles;
+
+	/** Number of boxes tested */
+	int boxes_tested;
+
+	/** Number of boxes found to be hidden */
+	int boxes_culled;
+
+	SoftwareOcclusionStats()
+	: triangles(0),
+	  boxes_tested(0),
+	  boxes_culled(0) {}
+};
+
+std::ostream& operator<<(std::ostream &o, const SoftwareOcclusionStats &stats);
+
+/**
+Culls bounding boxes hidden behind a fixed set of occluders, without using the
+GPU at all.
+
+Each frame, the occluder triangles are rasterized into a small depth buffer
+using half-space rasterization, four pixels at a time with SSE2 where it is
+available. The buffer is split into horizontal bands, each rasterized by its
+own worker thread. A hierarchical buffer holding the farthest depth of each
+8x8 tile is then built, and boxes are tested against it, falling back to the
+full resolution buffer only for tiles which cannot reject the box outright.
+
+Occluders should be large, opaque and simple, e.g. walls and floors. Depths
+are window-space depths in [0,1], with 0 at the near plane.
+*/
+class SoftwareOcclusionCuller
+{
+public:
+	/** Width and height of one tile of the hierarchical depth buffer */
+	static const int TILE_SIZE = 8;
+
+	/**
+	Constructor.
+	@param width Width of the depth buffer, rounded up to a multiple of TILE_SIZE
+	@param height Height of the depth buffer, rounded up to a multiple of TILE_SIZE
+	@param num_threads Number of worker threads to create. The calling thread
+	rasterizes a band too, so zero does all the work on the calling thread.
+	*/
+	SoftwareOcclusionCuller(int width = 256, int height = 128, int num_threads = 3);
+
+	~SoftwareOcclusionCuller();
+
+	/**
+	Adds occluder geometry.
+	@param vertices Triangle list, three vertices per triangle
+	@param num_vertices Number of vertices in the list
+	@param transform Transformation from the vertices' space to world space
+	*/
+	void add_occluder(const Vec3 * vertices,
+	                  size_t num_vertices,
+	                  const Affine3 &transform);
+
+	/** Removes all occluders */
+	void clear_occluders();
+
+	/**
+	Rasterizes the occluders as seen through the given matrix, replacing the
+	contents of the depth buffer.
+	@param view_proj Projection matrix multiplied by the view matrix
+	*/
+	void render(const Mat4 &view_proj);
+
+	/**
+	Tests a world-space box against the depth buffer from the last call to
+	render(). Boxes which are empty, or which cross the near plane, are
+	always visible.
+	@return false if the box is certainly hidden or entirely off-screen
+	*/
+	bool is_visible(const AABB &box) const;
+
+	/** Gets the depth buffer, row by row from the bottom of the screen */
+	const float * get_depth_buffer() const { return &depth[0]; }
+
+	int get_width() const { return width; }
+	int get_height() const { return height; }
+
+	/** Gets statistics for the frame since the last call to render() */
+	const SoftwareOcclusionStats & get_stats() const { return stats; }
+
+private:
+	/** An occluder triangle in window coordinates, ready for rasterization */
+	struct Triangle
+	{
+		// edge functions, non-negative inside the triangle
+		float a[3], b[3], c[3];
+
+		// window depth as a linear function of window position
+		float za, zb, zc;
+
+		// bounding rectangle, inclusive, clamped to the buffer
+		int x0, y0, x1, y1;
+	};
+
+	struct Worker
+	{
+		SoftwareOcclusionCuller * culler;
+		SDL_Thread * thread;
+		SDL_sem * start;
+		int band;
+	};
+
+	// no meaningful assignment or copy
+	SoftwareOcclusionCuller(const SoftwareOcclusionCuller &r);
+	SoftwareOcclusionCuller& operator=(const SoftwareOcclusionCuller &r);
+
+	static int worker_main(void * data);
+
+	void setup_triangle(const Vec4 clip[3]);
+	void clip_triangle(const Vec4 clip[3]);
+	void rasterize_band(int band);
+	void rasterize_triangle(const Triangle &tri, int y0, int y1);
+	void build_hiz(int y0, int y1);
+	bool test_tile(int tx, int ty, int x0, int y0, int x1, int y1, float z) const;
+
+private:
+	int width, height;
+	int tiles_x, tiles_y;
+	int num_bands;
+
+	std::vector<Vec3> occluders;
+	std::vector<Vec4> clip_vertices; // occluders in clip space, for render()
+	std::vector<Triangle> triangles;
+	std::vector<float> depth;
+	std::vector<float> hiz;
+
+	Mat4 view_proj;
+
+	std::vector<Worker> workers;
+	SDL_sem * done;
+	volatile bool quit;
+
+	// box tests are const but still counted
+	mutable SoftwareOcclusionStats stats;
+};
+
+#endif /* _SOFTWARE_OCCLUSION_H_ */
@@ -0,0 +1,311 @@
+/** @file trace.cpp
+ *  @brief Records timed zones for viewing on a timeline
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#ifdef _WIN32
+#include <windows.h>
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#define TRACE_FENCE() MemoryBarrier()
+#else
+#include <time.h>
+#define TRACE_THREAD_LOCAL __thread
+#define TRACE_FENCE() __sync_synchronize()
+#endif
+
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+enum
+{
+	MAX_THREADS = 16,
+	BUFFER_EVENTS = 1 << 16, // per thread, and for the GPU
+	GPU_TRACK = 1000         // thread id of the GPU track in the trace
+};
+
+struct TraceEvent
+{
+	const char * name;
+	trace_time_t begin;
+	trace_time_t end;
+};
+
+/** Ring buffer written by a single thread */
+struct TraceBuffer
+{
+	TraceEvent events[BUFFER_EVENTS];
+	volatile unsigned int written; // events ever written; the newest are kept
+
+	TraceBuffer() : written(0) {}
+};
+
+bool trace_enabled = true;
+
+static TraceBuffer * cpu_buffers[MAX_THREADS];
+static volatile long cpu_buffer_count = 0;
+static TraceBuffer gpu_buffer;
+
+// Slot of the calling thread in cpu_buffers, -1 until its first zone, or
+// -2 if there were no slots left
+static TRACE_THREAD_LOCAL int thread_slot = -1;
+
+static void push(TraceBuffer &buffer, const char * name, trace_time_t begin, trace_time_t end)
+{
+	TraceEvent &event = buffer.events[buffer.written % BUFFER_EVENTS];
+	event.name = name;
+	event.begin = begin;
+	event.end = end;
+
+	// Only publish the event once it is complete; the fence keeps the
+	// stores above from being reordered past the count
+	TRACE_FENCE();
+	buffer.written = buffer.written + 1;
+}
+
+static int claim_slot(void)
+{
+#ifdef _WIN32
+	return (int)InterlockedIncrement(&cpu_buffer_count) - 1;
+#else
+	return (int)__sync_fetch_and_add(&cpu_buffer_count, 1);
+#endif
+}
+
+trace_time_t trace_now(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency = { 0 };
+	LARGE_INTEGER count;
+
+	if(!frequency.QuadPart) {
+		QueryPerformanceFrequency(&frequency);
+	}
+
+	QueryPerformanceCounter(&count);
+	return (trace_time_t)(count.QuadPart * 1000000.0 / frequency.QuadPart);
+#else
+	// Monotonic, so that zones never end before they begin when the wall
+	// clock is stepped
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (trace_time_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+void trace_cpu_zone(const char * name, trace_time_t begin, trace_time_t end)
+{
+	if(thread_slot == -1) {
+		const int slot = claim_slot();
+
+		if(slot < MAX_THREADS) {
+			cpu_buffers[slot] = new TraceBuffer();
+			thread_slot = slot;
+		} else {
+			thread_slot = -2;
+		}
+	}
+
+	if(thread_slot >= 0) {
+		push(*cpu_buffers[thread_slot], name, begin, end);
+	}
+}
+
+void trace_gpu_zone(const char * name, trace_time_t begin, trace_time_t end)
+{
+	push(gpu_buffer, name, begin, end);
+}
+
+const char * trace_class_name(const std::type_info &type)
+{
+	const char * name = type.name();
+
+	// GCC prefixes the length, e.g. "12StandardPass"; MSVC prefixes "class "
+	while(*name >= '0' && *name <= '9')
+	{
+		++name;
+	}
+
+	if(strncmp(name, "class ", 6) == 0) {
+		name += 6;
+	} else if(strncmp(name, "struct ", 7) == 0) {
+		name += 7;
+	}
+
+	return name;
+}
+
+/** Writes a string with the characters JSON requires escaped */
+static void write_json_string(std::ostream &o, const char * s)
+{
+	o << '"';
+
+	for(; *s; ++s)
+	{
+		if(*s == '"' || *s == '\\') {
+			o << '\\' << *s;
+		} else if((unsigned char)*s < 0x20) {
+			o << ' ';
+		} else {
+			o << *s;
+		}
+	}
+
+	o << '"';
+}
+
+/** Gets the range of a buffer's events which are still held */
+static void get_held(const TraceBuffer &buffer, unsigned int &first, unsigned int &end)
+{
+	end = buffer.written;
+	TRACE_FENCE(); // pairs with the fence in push()
+	first = (end > BUFFER_EVENTS) ? end - BUFFER_EVENTS : 0;
+}
+
+static void write_events(std::ostream &o, const TraceBuffer &buffer, int tid,
+                         trace_time_t origin, trace_time_t since, bool &first_event)
+{
+	unsigned int first, end;
+	get_held(buffer, first, end);
+
+	for(unsigned int i = first; i != end; ++i)
+	{
+		const TraceEvent &event = buffer.events[i % BUFFER_EVENTS];
+
+		// Skip an event being overwritten by another thread while exporting
+		if(event.begin < origin || event.end < event.begin || event.end < since)
+			continue;
+
+		o << (first_event ? "\n" : ",\n");
+		first_event = false;
+
+		o << "{\"name\":";
+		write_json_string(o, event.name);
+		o << ",\"cat\":\"" << (tid == GPU_TRACK ? "gpu" : "cpu") << "\""
+		  << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+		  << ",\"ts\":" << (event.begin - origin)
+		  << ",\"dur\":" << (event.end - event.begin) << "}";
+	}
+}
+
+static void write_thread_name(std::ostream &o, int tid, const char * name, bool &first_event)
+{
+	o << (first_event ? "\n" : ",\n");
+	first_event = false;
+
+	o << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+	  << ",\"args\":{\"name\":";
+	write_json_string(o, name);
+	o << "}}";
+}
+
+bool trace_write_chrome_json(const char * filename, trace_time_t since)
+{
+	std::ofstream out(filename);
+
+	if(!out) {
+		std::cerr << "ERROR: cannot open trace file " << filename << std::endl;
+		return false;
+	}
+
+	const int threads = std::min((int)cpu_buffer_count, (int)MAX_THREADS);
+
+	// Timestamps are written relative to the oldest event held
+	trace_time_t origin = ~(trace_time_t)0;
+
+	for(int t = 0; t <= threads; ++t)
+	{
+		const TraceBuffer * buffer = (t < threads) ? cpu_buffers[t] : &gpu_buffer;
+
+		if(!buffer)
+			continue; // claimed, but not yet published
+
+		unsigned int first, end;
+		get_held(*buffer, first, end);
+
+		// Zones are written when they end, so the oldest need not be first
+		for(unsigned int i = first; i != end; ++i)
+		{
+			const TraceEvent &event = buffer->events[i % BUFFER_EVENTS];
+
+			if(event.end >= since) {
+				origin = std::min(origin, event.begin);
+			}
+		}
+	}
+
+	bool first_event = true;
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	for(int t = 0; t < threads; ++t)
+	{
+		if(!cpu_buffers[t])
+			continue;
+
+		// The first thread to record a zone is the main thread
+		write_thread_name(out, t + 1, (t == 0) ? "main" : "worker", first_event);
+		write_events(out, *cpu_buffers[t], t + 1, origin, since, first_event);
+	}
+
+	write_thread_name(out, GPU_TRACK, "GPU", first_event);
+	write_events(out, gpu_buffer, GPU_TRACK, origin, since, first_event);
+
+	out << "\n]}\n";
+
+	return !out.fail();
+}
+
+static bool total_longer(const TraceZoneTotal &a, const TraceZoneTotal &b)
+{
+	return a.ms > b.ms;
+}
+
+void trace_get_totals(trace_time_t begin, trace_time_t end, bool gpu,
+                      std::vector<TraceZoneTotal> &totals)
+{
+	totals.clear();
+
+	const TraceBuffer * buffer = gpu ? &gpu_buffer
+	                           : (thread_slot >= 0) ? cpu_buffers[thread_slot] : NULL;
+
+	if(!buffer)
+		return;
+
+	unsigned int first, last;
+	get_held(*buffer, first, last);
+
+	for(unsigned int i = first; i != last; ++i)
+	{
+		const TraceEvent &event = buffer->events[i % BUFFER_EVENTS];
+
+		if(event.begin < begin || event.begin > end)
+			continue;
+
+		// Names are usually string literals, so compare the pointers first
+		std::vector<TraceZoneTotal>::iterator total = totals.begin();
+		while(total != totals.end() && (*total).name != event.name &&
+		      strcmp((*total).name, event.name) != 0)
+		{
+			++total;
+		}
+
+		if(total == totals.end()) {
+			TraceZoneTotal t;
+			t.name = event.name;
+			t.ms = 0;
+			t.count = 0;
+			totals.push_back(t);
+			total = totals.end() - 1;
+		}
+
+		(*total).ms += (event.end - event.begin) / 1000.0;
+		(*total).count++;
+	}
+
+	std::sort(totals.begin(), totals.end(), total_longer);
+}
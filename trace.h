@@ -0,0 +1,85 @@
+/** @file trace.h
+ *  @brief Records timed zones for viewing on a timeline
+ *
+ *  @author Andrew Fox (arfox)
+ */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <typeinfo>
+#include <vector>
+
+/** Microseconds on the trace clock */
+typedef unsigned long long trace_time_t;
+
+/** If false, zones are not recorded. True by default. */
+extern bool trace_enabled;
+
+/** Gets the current time on the trace clock */
+trace_time_t trace_now(void);
+
+/**
+Records a zone which ran on the calling thread. Each thread writes into its
+own ring buffer, without locks, so only the most recent zones are kept.
+@param name Must outlive the trace, e.g. a string literal
+*/
+void trace_cpu_zone(const char * name, trace_time_t begin, trace_time_t end);
+
+/** Records a zone which ran on the GPU, in trace clock time. Must only be
+    called from the thread which owns the OpenGL context. */
+void trace_gpu_zone(const char * name, trace_time_t begin, trace_time_t end);
+
+/** Writes the recorded zones as Chrome trace event JSON, which can be
+    opened in chrome://tracing or Perfetto. Zones which ended before since
+    are left out. Returns false on failure. */
+bool trace_write_chrome_json(const char * filename, trace_time_t since = 0);
+
+/** Time spent in zones of one name */
+struct TraceZoneTotal
+{
+	const char * name;
+	double ms;
+	int count;
+};
+
+/** Totals the zones of the calling thread, or of the GPU track, which
+    begin within [begin, end]. Nested zones are included in their parents'
+    time. The totals are sorted from the longest. */
+void trace_get_totals(trace_time_t begin, trace_time_t end, bool gpu,
+                      std::vector<TraceZoneTotal> &totals);
+
+/** Gets the name of a class for use as a zone name, e.g. "StandardPass" */
+const char * trace_class_name(const std::type_info &type);
+
+/** Records the time from construction to destruction as a zone */
+class TraceZone
+{
+public:
+	explicit TraceZone(const char * _name)
+	: name(_name),
+	  begin(trace_enabled ? trace_now() : 0) {}
+
+	~TraceZone()
+	{
+		if(trace_enabled && begin) {
+			trace_cpu_zone(name, begin, trace_now());
+		}
+	}
+
+private:
+	// no meaningful assignment or copy
+	TraceZone(const TraceZone &r);
+	TraceZone& operator=(const TraceZone &r);
+
+	const char * name;
+	trace_time_t begin;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+/** Records the rest of the enclosing block as a zone */
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+
+#endif /* _TRACE_H_ */
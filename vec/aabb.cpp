@@ -0,0 +1,58 @@
+/**
+ * @file aabb.cpp
+ * @brief Axis-aligned bounding box.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#include "aabb.h"
+#include "mat.h"
+#include "affine.h"
+#include <limits>
+
+const AABB AABB::Empty = AABB(Vec3( std::numeric_limits<real_t>::max(),
+                                    std::numeric_limits<real_t>::max(),
+                                    std::numeric_limits<real_t>::max()),
+                              Vec3(-std::numeric_limits<real_t>::max(),
+                                   -std::numeric_limits<real_t>::max(),
+                                   -std::numeric_limits<real_t>::max()));
+
+void AABB::get_corners(Vec3 corners[8]) const
+{
+    for (int i = 0; i < 8; ++i) {
+        corners[i] = Vec3((i & 1) ? max.x : min.x,
+                          (i & 2) ? max.y : min.y,
+                          (i & 4) ? max.z : min.z);
+    }
+}
+
+AABB AABB::transform(const Mat4& m) const
+{
+    return transform(Affine3(m));
+}
+
+AABB AABB::transform(const Affine3& t) const
+{
+    if (is_empty())
+        return Empty;
+
+    // Arvo, "Transforming Axis-Aligned Bounding Boxes", Graphics Gems (1990)
+    const Vec3 translation = t.get_translation();
+    AABB rv(translation, translation);
+
+    for (int row = 0; row < 3; ++row) {
+        for (int col = 0; col < 3; ++col) {
+            const real_t a = t(col,row) * min[col];
+            const real_t b = t(col,row) * max[col];
+            rv.min[row] += std::min(a, b);
+            rv.max[row] += std::max(a, b);
+        }
+    }
+
+    return rv;
+}
+
+std::ostream& operator<<(std::ostream& os, const AABB& b)
+{
+    return os << '[' << b.min << ',' << b.max << ']';
+}
@@ -0,0 +1,133 @@
+/**
+ * @file aabb.h
+ * @brief Axis-aligned bounding box.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _VEC_AABB_H_
+#define _VEC_AABB_H_
+
+#include "462math.h"
+#include "vec.h"
+
+class Mat4;
+class Affine3;
+
+/**
+ * An axis-aligned bounding box, stored as its minimum and maximum corners.
+ *
+ * A box whose minimum exceeds its maximum along any axis is empty. The empty
+ * box is used to mean "bounds unknown" by code that culls against boxes, and
+ * such code must treat it as always visible.
+ */
+class AABB
+{
+public:
+    /**
+     * The empty box. Including any point in it yields a box around that point.
+     */
+    static const AABB Empty;
+
+    /**
+     * The corners of the box.
+     */
+    Vec3 min, max;
+
+    /**
+     * Default constructor. Leaves values unitialized.
+     */
+    AABB() {}
+
+    /**
+     * Create a box with the given corners.
+     */
+    AABB(const Vec3& min, const Vec3& max)
+        : min(min), max(max) {}
+
+    bool is_empty() const
+    {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    Vec3 center() const
+    {
+        return (min + max) * 0.5;
+    }
+
+    /**
+     * Returns the half-size of the box along each axis.
+     */
+    Vec3 extent() const
+    {
+        return (max - min) * 0.5;
+    }
+
+    /**
+     * Grows the box to include the given point.
+     */
+    AABB& include(const Vec3& p)
+    {
+        min.clamp_max(p);
+        max.clamp_min(p);
+        return *this;
+    }
+
+    /**
+     * Grows the box to include the given box.
+     */
+    AABB& include(const AABB& b)
+    {
+        if (!b.is_empty()) {
+            min.clamp_max(b.min);
+            max.clamp_min(b.max);
+        }
+        return *this;
+    }
+
+    /**
+     * Returns the box grown by the given distance along every axis.
+     */
+    AABB expand(real_t d) const
+    {
+        return AABB(min - Vec3(d, d, d), max + Vec3(d, d, d));
+    }
+
+    bool contains(const Vec3& p) const
+    {
+        return p.x >= min.x && p.x <= max.x &&
+               p.y >= min.y && p.y <= max.y &&
+               p.z >= min.z && p.z <= max.z;
+    }
+
+    bool intersects(const AABB& b) const
+    {
+        return min.x <= b.max.x && max.x >= b.min.x &&
+               min.y <= b.max.y && max.y >= b.min.y &&
+               min.z <= b.max.z && max.z >= b.min.z;
+    }
+
+    /**
+     * Fills the given array with the eight corners of the box. Bit 0 of the
+     * index selects max.x, bit 1 max.y and bit 2 max.z.
+     */
+    void get_corners(Vec3 corners[8]) const;
+
+    /**
+     * Returns the box enclosing this box after transformation by the given
+     * affine matrix. The empty box transforms to the empty box.
+     */
+    AABB transform(const Mat4& m) const;
+
+    /**
+     * Returns the box enclosing this box after the given transformation.
+     */
+    AABB transform(const Affine3& t) const;
+};
+
+/**
+ * Outputs a box text formatted as "[(x,y,z),(x,y,z)]".
+ */
+std::ostream& operator<<(std::ostream& os, const AABB& rhs);
+
+#endif /* _VEC_AABB_H_ */
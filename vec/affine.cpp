@@ -0,0 +1,244 @@
+/**
+ * @file affine.cpp
+ * @brief Affine transformations.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#include "affine.h"
+#include "simd.h"
+#include <cstring>
+
+#if VEC_SSE
+
+/* a x b in the first three lanes. The fourth lane is a.w*b.w - a.w*b.w, which
+   is not exactly zero if the compiler fuses it into a multiply-add. */
+static inline __m128 affine_cross(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(VEC_SWIZZLE(a, 1,2,0,3), VEC_SWIZZLE(b, 2,0,1,3)),
+                      _mm_mul_ps(VEC_SWIZZLE(a, 2,0,1,3), VEC_SWIZZLE(b, 1,2,0,3)));
+}
+
+#endif /* VEC_SSE */
+
+const Affine3 Affine3::Identity = Affine3( 1, 0, 0, 0,
+                                           0, 1, 0, 0,
+                                           0, 0, 1, 0 );
+
+Affine3::Affine3(const Mat3& linear, const Vec3& translation)
+{
+    for (int row = 0; row < ROWS; ++row) {
+        for (int col = 0; col < Mat3::DIM; ++col)
+            rows[row][col] = linear._m[col][row];
+        rows[row][3] = translation[row];
+    }
+}
+
+Affine3::Affine3(const Mat4& mat)
+{
+    assert(mat._m[0][3] == 0 && mat._m[1][3] == 0 && mat._m[2][3] == 0 && mat._m[3][3] == 1);
+
+    for (int row = 0; row < ROWS; ++row)
+        for (int col = 0; col < COLS; ++col)
+            rows[row][col] = mat._m[col][row];
+}
+
+Mat3 Affine3::get_linear() const
+{
+    return Mat3(rows[0][0], rows[0][1], rows[0][2],
+                rows[1][0], rows[1][1], rows[1][2],
+                rows[2][0], rows[2][1], rows[2][2]);
+}
+
+Affine3 Affine3::operator*(const Affine3& rhs) const
+{
+    // Only the top three rows of the 4x4 product are computed. Each row of
+    // the result combines the rows of rhs, plus this translation.
+    Affine3 product;
+
+#if VEC_SSE
+    const __m128 b0 = _mm_loadu_ps(rhs.m);
+    const __m128 b1 = _mm_loadu_ps(rhs.m+4);
+    const __m128 b2 = _mm_loadu_ps(rhs.m+8);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (int row = 0; row < ROWS; ++row) {
+        const __m128 a = _mm_loadu_ps(rows[row]);
+
+        // (0, 0, 0, a.w)
+        __m128 r = VEC_SHUFFLE(zero, VEC_SHUFFLE(a, zero, 3,3,0,0), 0,0,2,0);
+        r = vec_madd(VEC_SWIZZLE(a, 0,0,0,0), b0, r);
+        r = vec_madd(VEC_SWIZZLE(a, 1,1,1,1), b1, r);
+        r = vec_madd(VEC_SWIZZLE(a, 2,2,2,2), b2, r);
+
+        _mm_storeu_ps(product.rows[row], r);
+    }
+#else
+    for (int row = 0; row < ROWS; ++row) {
+        for (int col = 0; col < COLS; ++col) {
+            product.rows[row][col] = rows[row][0]*rhs.rows[0][col] +
+                                     rows[row][1]*rhs.rows[1][col] +
+                                     rows[row][2]*rhs.rows[2][col];
+        }
+        product.rows[row][3] += rows[row][3];
+    }
+#endif
+
+    return product;
+}
+
+bool Affine3::operator==(const Affine3& rhs) const
+{
+    return memcmp( m, rhs.m, sizeof m ) == 0;
+}
+
+bool Affine3::operator!=(const Affine3& rhs) const
+{
+    return !operator==(rhs);
+}
+
+/* the rows of the linear part */
+static inline void get_rows(const Affine3& t, Vec3& a, Vec3& b, Vec3& c)
+{
+    a = Vec3(t.rows[0][0], t.rows[0][1], t.rows[0][2]);
+    b = Vec3(t.rows[1][0], t.rows[1][1], t.rows[1][2]);
+    c = Vec3(t.rows[2][0], t.rows[2][1], t.rows[2][2]);
+}
+
+real_t Affine3::determinant() const
+{
+    Vec3 a, b, c;
+    get_rows(*this, a, b, c);
+    return a.dot(b.cross(c));
+}
+
+Mat3 Affine3::normal_matrix() const
+{
+    // The inverse transpose of a matrix with rows a, b and c has the rows
+    // b x c, c x a and a x b, divided by the determinant.
+    Vec3 a, b, c;
+    get_rows(*this, a, b, c);
+
+    const Vec3 bc = b.cross(c), ca = c.cross(a), ab = a.cross(b);
+    const real_t det = a.dot(bc);
+    assert(det != 0);
+
+    return Mat3(bc.x, bc.y, bc.z,
+                ca.x, ca.y, ca.z,
+                ab.x, ab.y, ab.z) * (1 / det);
+}
+
+Affine3 Affine3::inverse() const
+{
+    // The inverse of the linear part has the columns b x c, c x a and a x b,
+    // divided by the determinant, where a, b and c are its rows. The inverse
+    // translation is minus the new linear part times the translation.
+    Affine3 inv;
+
+#if VEC_SSE
+    const __m128 a = _mm_loadu_ps(m);
+    const __m128 b = _mm_loadu_ps(m+4);
+    const __m128 c = _mm_loadu_ps(m+8);
+
+    // the fourth lanes only reach the bottom row, which is dropped
+    __m128 col0 = affine_cross(b, c);
+    __m128 col1 = affine_cross(c, a);
+    __m128 col2 = affine_cross(a, b);
+
+    // so the determinant must leave them out
+    __m128 det = _mm_mul_ps(a, col0);
+    det = _mm_add_ss(_mm_add_ss(det, VEC_SWIZZLE(det, 1,1,1,1)), VEC_SWIZZLE(det, 2,2,2,2));
+    assert(_mm_cvtss_f32(det) != 0);
+
+    const __m128 inv_det = _mm_div_ps(_mm_set1_ps(1), VEC_SWIZZLE(det, 0,0,0,0));
+    col0 = _mm_mul_ps(col0, inv_det);
+    col1 = _mm_mul_ps(col1, inv_det);
+    col2 = _mm_mul_ps(col2, inv_det);
+
+    __m128 col3 = _mm_mul_ps(col0, VEC_SWIZZLE(a, 3,3,3,3));
+    col3 = vec_madd(col1, VEC_SWIZZLE(b, 3,3,3,3), col3);
+    col3 = vec_madd(col2, VEC_SWIZZLE(c, 3,3,3,3), col3);
+    col3 = _mm_sub_ps(_mm_setzero_ps(), col3);
+
+    _MM_TRANSPOSE4_PS(col0, col1, col2, col3);
+
+    _mm_storeu_ps(inv.m,   col0);
+    _mm_storeu_ps(inv.m+4, col1);
+    _mm_storeu_ps(inv.m+8, col2);
+#else
+    Vec3 a, b, c;
+    get_rows(*this, a, b, c);
+
+    const Vec3 bc = b.cross(c), ca = c.cross(a), ab = a.cross(b);
+    const real_t det = a.dot(bc);
+    assert(det != 0);
+    const real_t inv_det = 1 / det;
+
+    const Vec3 col[3] = { bc * inv_det, ca * inv_det, ab * inv_det };
+    const Vec3 translation = get_translation();
+
+    for (int row = 0; row < ROWS; ++row) {
+        inv.rows[row][0] = col[0][row];
+        inv.rows[row][1] = col[1][row];
+        inv.rows[row][2] = col[2][row];
+        inv.rows[row][3] = -(col[0][row]*translation.x +
+                             col[1][row]*translation.y +
+                             col[2][row]*translation.z);
+    }
+#endif
+
+    return inv;
+}
+
+Affine3 Affine3::rigid_inverse() const
+{
+    // The inverse of the linear part is its transpose
+    Affine3 inv;
+
+#if VEC_SSE
+    __m128 a = _mm_loadu_ps(m);
+    __m128 b = _mm_loadu_ps(m+4);
+    __m128 c = _mm_loadu_ps(m+8);
+
+    __m128 t = _mm_mul_ps(a, VEC_SWIZZLE(a, 3,3,3,3));
+    t = vec_madd(b, VEC_SWIZZLE(b, 3,3,3,3), t);
+    t = vec_madd(c, VEC_SWIZZLE(c, 3,3,3,3), t);
+    t = _mm_sub_ps(_mm_setzero_ps(), t);
+
+    _MM_TRANSPOSE4_PS(a, b, c, t);
+
+    _mm_storeu_ps(inv.m,   a);
+    _mm_storeu_ps(inv.m+4, b);
+    _mm_storeu_ps(inv.m+8, c);
+#else
+    for (int row = 0; row < ROWS; ++row) {
+        inv.rows[row][0] = rows[0][row];
+        inv.rows[row][1] = rows[1][row];
+        inv.rows[row][2] = rows[2][row];
+        inv.rows[row][3] = -(rows[0][row]*rows[0][3] +
+                             rows[1][row]*rows[1][3] +
+                             rows[2][row]*rows[2][3]);
+    }
+#endif
+
+    return inv;
+}
+
+Mat4 Affine3::to_mat4() const
+{
+    return Mat4(m[0], m[1], m[ 2], m[ 3],
+                m[4], m[5], m[ 6], m[ 7],
+                m[8], m[9], m[10], m[11],
+                0,    0,    0,     1);
+}
+
+std::ostream& operator<<(std::ostream& os, const Affine3& rhs)
+{
+    os << '[';
+    for (int row = 0; row < Affine3::ROWS; ++row) {
+        os << (row ? ",(" : "(")
+           << rhs.rows[row][0] << ',' << rhs.rows[row][1] << ','
+           << rhs.rows[row][2] << ',' << rhs.rows[row][3] << ')';
+    }
+    return os << ']';
+}
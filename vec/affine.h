@@ -0,0 +1,186 @@
+/**
+ * @file affine.h
+ * @brief Affine transformations.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _VEC_AFFINE_H_
+#define _VEC_AFFINE_H_
+
+#include "462math.h"
+#include "vec.h"
+#include "mat.h"
+
+/**
+ * An affine transformation: a 3x3 rotation and scale followed by a
+ * translation. This is a Mat4 whose bottom row is always (0, 0, 0, 1), so it
+ * takes 12 values instead of 16, and composition and inversion skip the
+ * bottom row entirely.
+ *
+ * Unlike the matrix classes, the values are stored ROW by row, so that each
+ * row is one SSE register: the three rows of the linear part, each followed
+ * by one element of the translation.
+ * [ A B C D ]
+ * [ E F G H ]
+ * [ I J K L ]
+ * looks like
+ * [ m[0] m[1] m[ 2] m[ 3] ]
+ * [ m[4] m[5] m[ 6] m[ 7] ]
+ * [ m[8] m[9] m[10] m[11] ]
+ *
+ * Transformations combine right-to-left like matrices, so A*B applies B
+ * first. Convert to a Mat4 with to_mat4() where OpenGL needs one.
+ */
+class Affine3
+{
+public:
+    /**
+     * The identity transformation.
+     */
+    static const Affine3 Identity;
+
+    static const int ROWS = 3;
+    static const int COLS = 4;
+    static const int SIZE = ROWS*COLS;
+
+    /**
+     * The values of this transformation. Named as both a 1d array and a 2d
+     * array.
+     */
+    union{
+        real_t m[SIZE];
+        real_t rows[ROWS][COLS]; // rows[row][column], column 3 is the translation
+    };
+
+    /**
+     * Leaves values unitialized.
+     */
+    Affine3() {}
+
+    /**
+     * Construct a transformation from the top three rows of a matrix, given
+     * in ROW MAJOR format like the Mat4 constructor. The bottom row is
+     * implicitly (0, 0, 0, 1).
+     */
+    Affine3(real_t m00, real_t m10, real_t m20, real_t m30,
+            real_t m01, real_t m11, real_t m21, real_t m31,
+            real_t m02, real_t m12, real_t m22, real_t m32)
+    {
+        m[0] = m00; m[1] = m10; m[ 2] = m20; m[ 3] = m30;
+        m[4] = m01; m[5] = m11; m[ 6] = m21; m[ 7] = m31;
+        m[8] = m02; m[9] = m12; m[10] = m22; m[11] = m32;
+    }
+
+    /**
+     * Construct a transformation from its linear part and translation.
+     */
+    Affine3(const Mat3& linear, const Vec3& translation);
+
+    /**
+     * Construct a transformation from a matrix, which must be affine.
+     */
+    explicit Affine3(const Mat4& mat);
+
+    // accessors
+
+    /**
+     * Affine3(i,j) gives the element at the ith column and jth row, as for
+     * Mat4. Column 3 is the translation.
+     */
+    real_t operator()(int col, int row) const
+    {
+        return rows[row][col];
+    }
+
+    /**
+     * Affine3(i,j) gives the element at the ith column and jth row, as for
+     * Mat4. Column 3 is the translation.
+     */
+    real_t& operator()(int col, int row)
+    {
+        return rows[row][col];
+    }
+
+    /**
+     * Returns the rotation and scale.
+     */
+    Mat3 get_linear() const;
+
+    Vec3 get_translation() const
+    {
+        return Vec3(rows[0][3], rows[1][3], rows[2][3]);
+    }
+
+    /**
+     * Combines two transformations, applying rhs first.
+     */
+    Affine3 operator*(const Affine3& rhs) const;
+
+    Affine3& operator*=(const Affine3& rhs)
+    {
+        return *this = operator*(rhs);
+    }
+
+    bool operator==(const Affine3& rhs) const;
+    bool operator!=(const Affine3& rhs) const;
+
+    Vec3 transform_point(const Vec3& v) const
+    {
+        return Vec3(rows[0][0]*v.x + rows[0][1]*v.y + rows[0][2]*v.z + rows[0][3],
+                    rows[1][0]*v.x + rows[1][1]*v.y + rows[1][2]*v.z + rows[1][3],
+                    rows[2][0]*v.x + rows[2][1]*v.y + rows[2][2]*v.z + rows[2][3]);
+    }
+
+    Vec3 transform_vector(const Vec3& v) const
+    {
+        return Vec3(rows[0][0]*v.x + rows[0][1]*v.y + rows[0][2]*v.z,
+                    rows[1][0]*v.x + rows[1][1]*v.y + rows[1][2]*v.z,
+                    rows[2][0]*v.x + rows[2][1]*v.y + rows[2][2]*v.z);
+    }
+
+    /**
+     * Transforms a surface normal by the inverse transpose of the linear
+     * part. The result is not normalized. To transform many normals, take
+     * normal_matrix() once instead.
+     */
+    Vec3 transform_normal(const Vec3& n) const
+    {
+        return normal_matrix() * n;
+    }
+
+    /**
+     * Returns the inverse transpose of the linear part, which transforms
+     * normals.
+     */
+    Mat3 normal_matrix() const;
+
+    /**
+     * Returns the determinant of the linear part.
+     */
+    real_t determinant() const;
+
+    /**
+     * Returns the inverse transformation. The linear part must be invertible.
+     */
+    Affine3 inverse() const;
+
+    /**
+     * Returns the inverse transformation, assuming the linear part is a pure
+     * rotation so that its inverse is its transpose. Much cheaper than
+     * inverse(), but wrong for transformations with scale or shear.
+     */
+    Affine3 rigid_inverse() const;
+
+    /**
+     * Returns the equivalent 4x4 matrix.
+     */
+    Mat4 to_mat4() const;
+};
+
+/**
+ * Outputs a transformation text formatted as "[(A,B,C,D),(E,F,G,H),(I,J,K,L)]".
+ */
+std::ostream& operator<<(std::ostream& os, const Affine3& rhs);
+
+#endif /* _VEC_AFFINE_H_ */
@@ -0,0 +1,193 @@
+/**
+ * @file batch.cpp
+ * @brief Transforms whole arrays of points, vectors, boxes and rotations.
+ *
+ * Each function runs the kernel of the current SIMD tier (see kernels.h),
+ * then finishes whatever it left one value at a time.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#include "batch.h"
+#include "kernels.h"
+#include "simd.h"
+
+/* points, or vectors without the translation */
+static void transform_affine(const Affine3& t, bool translate,
+                             const Vec3* in, Vec3* out, size_t n)
+{
+    assert(in && out);
+    const VecKernels* k = vec_kernels();
+    size_t i = k ? k->transform_affine(t, translate, in, out, n) : 0;
+
+    for (; i < n; ++i)
+        out[i] = translate ? t.transform_point(in[i]) : t.transform_vector(in[i]);
+}
+
+void transform_points(const Affine3& t, const Vec3* in, Vec3* out, size_t n)
+{
+    transform_affine(t, true, in, out, n);
+}
+
+void transform_points(const Affine3& t,
+                      const real_t* in_x, const real_t* in_y, const real_t* in_z,
+                      real_t* out_x, real_t* out_y, real_t* out_z,
+                      size_t n)
+{
+    assert(in_x && in_y && in_z && out_x && out_y && out_z);
+    const VecKernels* k = vec_kernels();
+    size_t i = k ? k->transform_coordinates(t, in_x, in_y, in_z, out_x, out_y, out_z, n) : 0;
+
+    for (; i < n; ++i) {
+        const Vec3 p = t.transform_point(Vec3(in_x[i], in_y[i], in_z[i]));
+        out_x[i] = p.x;
+        out_y[i] = p.y;
+        out_z[i] = p.z;
+    }
+}
+
+void transform_points(const Mat4& m, const Vec3* in, Vec3* out, size_t n)
+{
+    assert(in && out);
+
+    if (m._m[0][3] == 0 && m._m[1][3] == 0 && m._m[2][3] == 0 && m._m[3][3] == 1) {
+        transform_affine(Affine3(m), true, in, out, n);
+        return;
+    }
+
+    const VecKernels* k = vec_kernels();
+    size_t i = k ? k->project_points(m, in, out, n) : 0;
+
+    for (; i < n; ++i)
+        out[i] = m.transform_point(in[i]);
+}
+
+void transform_points(const Mat4& m, const Vec3* in, Vec4* out, size_t n)
+{
+    assert(in && out);
+    const VecKernels* k = vec_kernels();
+    size_t i = k ? k->clip_points(m, in, out, n) : 0;
+
+    for (; i < n; ++i)
+        out[i] = m * Vec4(in[i], 1);
+}
+
+void transform_vectors(const Affine3& t, const Vec3* in, Vec3* out, size_t n)
+{
+    transform_affine(t, false, in, out, n);
+}
+
+void transform_normals(const Affine3& t, const Vec3* in, Vec3* out, size_t n)
+{
+    transform_affine(Affine3(t.normal_matrix(), Vec3::Zero), false, in, out, n);
+}
+
+void transform_aabbs(const Affine3& t, const AABB* in, AABB* out, size_t n)
+{
+    assert(in && out);
+    const VecKernels* k = vec_kernels();
+    size_t i = k ? k->transform_aabbs(t, in, out, n) : 0;
+
+    for (; i < n; ++i)
+        out[i] = in[i].transform(t);
+}
+
+void transform_aabbs(const Affine3* t, const AABB* in, AABB* out, size_t n)
+{
+    assert(t && in && out);
+    const VecKernels* k = vec_kernels();
+    size_t i = k ? k->transform_aabbs_each(t, in, out, n) : 0;
+
+    for (; i < n; ++i)
+        out[i] = in[i].transform(t[i]);
+}
+
+void multiply_quats(const Quat* a, const Quat* b, Quat* out, size_t n)
+{
+    assert(a && b && out);
+    const VecKernels* k = vec_kernels();
+    size_t i = k ? k->multiply_quats(a, b, out, n) : 0;
+
+    for (; i < n; ++i)
+        out[i] = a[i] * b[i];
+}
+
+void rotate_points(const Quat& q, const Vec3* in, Vec3* out, size_t n)
+{
+    Vec3 axes[3];
+    q.to_axes(axes);
+
+    const Affine3 rotation(axes[0].x, axes[1].x, axes[2].x, 0,
+                           axes[0].y, axes[1].y, axes[2].y, 0,
+                           axes[0].z, axes[1].z, axes[2].z, 0);
+    transform_affine(rotation, false, in, out, n);
+}
+
+void rotate_points(const Quat* q, const Vec3* in, Vec3* out, size_t n)
+{
+    assert(q && in && out);
+    const VecKernels* k = vec_kernels();
+    size_t i = k ? k->rotate_points(q, in, out, n) : 0;
+
+    for (; i < n; ++i)
+        out[i] = q[i] * in[i];
+}
+
+void quats_to_matrices(const Quat* q, Mat3* out, size_t n)
+{
+    assert(q && out);
+    const VecKernels* k = vec_kernels();
+    size_t i = k ? k->quats_to_matrices(q, out, n) : 0;
+
+    for (; i < n; ++i) {
+        Vec3 axes[3];
+        q[i].to_axes(axes);
+        out[i] = Mat3(axes[0].x, axes[1].x, axes[2].x,
+                      axes[0].y, axes[1].y, axes[2].y,
+                      axes[0].z, axes[1].z, axes[2].z);
+    }
+}
+
+void quats_to_transforms(const Quat* q, const Vec3* translations, Affine3* out, size_t n)
+{
+    assert(q && translations && out);
+    const VecKernels* k = vec_kernels();
+    size_t i = k ? k->quats_to_transforms(q, translations, out, n) : 0;
+
+    for (; i < n; ++i) {
+        Vec3 axes[3];
+        q[i].to_axes(axes);
+        const Vec3& t = translations[i];
+        out[i] = Affine3(axes[0].x, axes[1].x, axes[2].x, t.x,
+                         axes[0].y, axes[1].y, axes[2].y, t.y,
+                         axes[0].z, axes[1].z, axes[2].z, t.z);
+    }
+}
+
+void nlerp_quats(const Quat* a, const Quat* b, const real_t* t, Quat* out, size_t n)
+{
+    assert(a && b && t && out);
+    const VecKernels* k = vec_kernels();
+    size_t i = k ? k->nlerp_quats(a, b, t, out, n) : 0;
+
+    for (; i < n; ++i)
+        out[i] = nlerp(a[i], b[i], t[i]);
+}
+
+void slerp_quats(const Quat* a, const Quat* b, const real_t* t, Quat* out, size_t n)
+{
+    assert(a && b && t && out);
+
+    for (size_t i = 0; i < n; ++i)
+        out[i] = slerp(a[i], b[i], t[i]);
+}
+
+void slerp_quats_fast(const Quat* a, const Quat* b, const real_t* t, Quat* out, size_t n)
+{
+    assert(a && b && t && out);
+    const VecKernels* k = vec_kernels();
+    size_t i = k ? k->slerp_quats_fast(a, b, t, out, n) : 0;
+
+    for (; i < n; ++i)
+        out[i] = nlerp(a[i], b[i], slerp_fast_t(t[i], (real_t)fabs(a[i].dot(b[i]))));
+}
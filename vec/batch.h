@@ -0,0 +1,120 @@
+/**
+ * @file batch.h
+ * @brief Transforms whole arrays of points, vectors, boxes and rotations.
+ *
+ * Transforming many values through these is cheaper than one call per
+ * value: the transformation is loaded once, and the arrays are processed
+ * four or eight values at a time with SSE where available.
+ *
+ * In every function out may be the same array as in, but the arrays must
+ * not otherwise overlap.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _VEC_BATCH_H_
+#define _VEC_BATCH_H_
+
+#include "462math.h"
+#include "vec.h"
+#include "mat.h"
+#include "affine.h"
+#include "quat.h"
+#include "aabb.h"
+#include <cstddef>
+
+/**
+ * Transforms n points, as Affine3::transform_point.
+ */
+void transform_points(const Affine3& t, const Vec3* in, Vec3* out, size_t n);
+
+/**
+ * Transforms n points stored as separate arrays of coordinates.
+ */
+void transform_points(const Affine3& t,
+                      const real_t* in_x, const real_t* in_y, const real_t* in_z,
+                      real_t* out_x, real_t* out_y, real_t* out_z,
+                      size_t n);
+
+/**
+ * Transforms n points, as Mat4::transform_point, including the divide by
+ * w. Affine matrices take the same path as an Affine3, without the divide.
+ */
+void transform_points(const Mat4& m, const Vec3* in, Vec3* out, size_t n);
+
+/**
+ * Transforms n points to homogeneous coordinates, e.g. to clip space, as
+ * m * Vec4(p, 1). There is no divide.
+ */
+void transform_points(const Mat4& m, const Vec3* in, Vec4* out, size_t n);
+
+/**
+ * Transforms n vectors, as Affine3::transform_vector.
+ */
+void transform_vectors(const Affine3& t, const Vec3* in, Vec3* out, size_t n);
+
+/**
+ * Transforms n normals by the inverse transpose of the linear part, as
+ * Affine3::transform_normal. The results are not normalized.
+ */
+void transform_normals(const Affine3& t, const Vec3* in, Vec3* out, size_t n);
+
+/**
+ * Transforms n boxes by one transformation, as AABB::transform.
+ */
+void transform_aabbs(const Affine3& t, const AABB* in, AABB* out, size_t n);
+
+/**
+ * Transforms n boxes, each by its own transformation, e.g. the object-space
+ * bounds of instances to world space.
+ */
+void transform_aabbs(const Affine3* t, const AABB* in, AABB* out, size_t n);
+
+/**
+ * Combines n pairs of rotations, out[i] = a[i] * b[i].
+ */
+void multiply_quats(const Quat* a, const Quat* b, Quat* out, size_t n);
+
+/**
+ * Rotates n points about the origin, as q * p. The rotation goes through
+ * its matrix, so the results may differ from Quat * Vec3 in the last bit.
+ */
+void rotate_points(const Quat& q, const Vec3* in, Vec3* out, size_t n);
+
+/**
+ * Rotates n points, each by its own rotation, as q[i] * in[i].
+ */
+void rotate_points(const Quat* q, const Vec3* in, Vec3* out, size_t n);
+
+/**
+ * Converts n unit quaternions to rotation matrices.
+ */
+void quats_to_matrices(const Quat* q, Mat3* out, size_t n);
+
+/**
+ * Converts n unit quaternions and translations to transformations which
+ * rotate and then translate, e.g. the orientations and positions of
+ * instances.
+ */
+void quats_to_transforms(const Quat* q, const Vec3* translations, Affine3* out, size_t n);
+
+/**
+ * Interpolates n pairs of rotations by their own t, as nlerp().
+ */
+void nlerp_quats(const Quat* a, const Quat* b, const real_t* t, Quat* out, size_t n);
+
+/**
+ * Interpolates n pairs of unit quaternions by their own t, as slerp(). One
+ * pair at a time, as there is no wide acos or sin.
+ */
+void slerp_quats(const Quat* a, const Quat* b, const real_t* t, Quat* out, size_t n);
+
+/**
+ * Approximates slerp_quats() at about the cost of nlerp_quats(), by
+ * correcting t for the speed-up of nlerp halfway between the rotations.
+ * Results are within 0.05 degrees of slerp(), and much closer for the
+ * small steps between animation keys.
+ */
+void slerp_quats_fast(const Quat* a, const Quat* b, const real_t* t, Quat* out, size_t n);
+
+#endif /* _VEC_BATCH_H_ */
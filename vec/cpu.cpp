@@ -0,0 +1,202 @@
+/**
+ * @file cpu.cpp
+ * @brief Detects the instruction sets of the CPU and picks the SIMD kernels
+ * to run.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#include "cpu.h"
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define CPU_X86 1
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <cpuid.h>
+#define CPU_X86 1
+#else
+#define CPU_X86 0
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CPU_FENCE() _ReadWriteBarrier() // x86 keeps stores in order
+#else
+#define CPU_FENCE() __sync_synchronize()
+#endif
+
+static const char* tier_names[SIMD_TIER_COUNT] = { "scalar", "sse", "avx2" };
+
+#if CPU_X86
+
+/* eax, ebx, ecx and edx of cpuid for the given leaf and subleaf */
+static void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+    int r[4];
+    __cpuidex(r, leaf, subleaf);
+    for (int i = 0; i < 4; ++i)
+        regs[i] = r[i];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/* the low half of XCR0, which says which registers the OS saves */
+static unsigned int read_xcr0()
+{
+#if defined(_MSC_VER) && _MSC_VER >= 1600
+    return (unsigned int)_xgetbv(0);
+#elif defined(_MSC_VER)
+    // too old to build AVX code, so there is no need to detect it
+    return 0;
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return eax;
+#endif
+}
+
+static CpuFeatures detect_features()
+{
+    CpuFeatures f;
+    memset(&f, 0, sizeof f);
+
+    unsigned int regs[4];
+    cpuid(0, 0, regs);
+    const unsigned int max_leaf = regs[0];
+    if (max_leaf < 1)
+        return f;
+
+    cpuid(1, 0, regs);
+    f.sse2  = (regs[3] & (1u << 26)) != 0;
+    f.sse41 = (regs[2] & (1u << 19)) != 0;
+
+    // AVX also needs the OS to save the YMM registers, and AVX-512 the
+    // opmask and ZMM registers
+    const bool osxsave = (regs[2] & (1u << 27)) != 0;
+    const unsigned int xcr0 = osxsave ? read_xcr0() : 0;
+    const bool ymm = (xcr0 & 0x06) == 0x06;
+    const bool zmm = (xcr0 & 0xe6) == 0xe6;
+
+    f.avx = ymm && (regs[2] & (1u << 28)) != 0;
+    f.fma = ymm && (regs[2] & (1u << 12)) != 0;
+
+    if (max_leaf >= 7) {
+        cpuid(7, 0, regs);
+        f.avx2    = ymm && (regs[1] & (1u << 5)) != 0;
+        f.avx512f = zmm && (regs[1] & (1u << 16)) != 0;
+    }
+
+    return f;
+}
+
+#else
+
+static CpuFeatures detect_features()
+{
+    CpuFeatures f;
+    memset(&f, 0, sizeof f);
+    return f;
+}
+
+#endif /* CPU_X86 */
+
+const CpuFeatures& cpu_features()
+{
+    static const CpuFeatures features = detect_features();
+    return features;
+}
+
+SimdTier simd_detect_tier()
+{
+    const CpuFeatures& f = cpu_features();
+
+    if (f.avx && f.avx2 && f.fma)
+        return SIMD_AVX2;
+    if (f.sse2)
+        return SIMD_SSE;
+    return SIMD_SCALAR;
+}
+
+// the tier to run; current_tier is only read once tier_chosen is set
+static volatile bool tier_chosen = false;
+static volatile SimdTier current_tier = SIMD_SCALAR;
+
+/* the detected tier, or the lower one CRYSTAL_SIMD asks for */
+static SimdTier choose_tier()
+{
+    const SimdTier detected = simd_detect_tier();
+
+    const char* name = getenv("CRYSTAL_SIMD");
+    if (name && *name) {
+        SimdTier tier;
+        if (!simd_parse_tier(name, &tier)) {
+            std::cerr << "WARNING: CRYSTAL_SIMD=" << name << " is not a SIMD tier; using "
+                      << simd_tier_name(detected) << std::endl;
+        } else if (tier > detected) {
+            std::cerr << "WARNING: this CPU cannot run " << name << " kernels; using "
+                      << simd_tier_name(detected) << std::endl;
+        } else {
+            return tier;
+        }
+    }
+
+    return detected;
+}
+
+static void publish_tier(SimdTier tier)
+{
+    current_tier = tier;
+    CPU_FENCE(); // the tier is stored before anyone sees tier_chosen
+    tier_chosen = true;
+}
+
+SimdTier simd_tier()
+{
+    if (!tier_chosen)
+        publish_tier(choose_tier());
+
+    return current_tier;
+}
+
+/* Chooses the tier during static initialization, before main can start any
+   threads, so that kernels running on them only ever read it. */
+static struct ChooseTierAtStartup
+{
+    ChooseTierAtStartup() { simd_tier(); }
+} choose_tier_at_startup;
+
+bool simd_force_tier(SimdTier tier)
+{
+    assert(tier >= SIMD_SCALAR && tier < SIMD_TIER_COUNT);
+
+    if (tier > simd_detect_tier())
+        return false;
+
+    publish_tier(tier);
+    return true;
+}
+
+const char* simd_tier_name(SimdTier tier)
+{
+    assert(tier >= SIMD_SCALAR && tier < SIMD_TIER_COUNT);
+    return tier_names[tier];
+}
+
+bool simd_parse_tier(const char* name, SimdTier* tier)
+{
+    assert(name && tier);
+
+    for (int i = 0; i < SIMD_TIER_COUNT; ++i) {
+        if (strcmp(name, tier_names[i]) == 0) {
+            *tier = (SimdTier)i;
+            return true;
+        }
+    }
+    return false;
+}
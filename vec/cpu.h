@@ -0,0 +1,99 @@
+/**
+ * @file cpu.h
+ * @brief Detects the instruction sets of the CPU and picks the SIMD kernels
+ * to run.
+ *
+ * The program is compiled for the oldest CPUs it runs on, and the kernels
+ * which gain the most from newer instruction sets are compiled again for
+ * each tier of SimdTier. At startup the best tier the CPU and operating
+ * system support is detected, and each family of kernels binds the table
+ * of functions built for it, or for the nearest tier below it which was
+ * built. The scalar tier runs the plain C++ code, which is the reference
+ * every other tier is verified against.
+ *
+ * The tier can be lowered for testing with the CRYSTAL_SIMD environment
+ * variable, set to one of the names from simd_tier_name(), or with
+ * simd_force_tier().
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _VEC_CPU_H_
+#define _VEC_CPU_H_
+
+#include <cstddef>
+
+/**
+ * The instruction sets kernels are built for, in increasing order.
+ */
+enum SimdTier
+{
+    SIMD_SCALAR,
+    SIMD_SSE,  // SSE2, on every x86-64 CPU
+    SIMD_AVX2, // AVX2 and FMA
+    SIMD_TIER_COUNT
+};
+
+/**
+ * The instruction sets of the CPU which the operating system also supports.
+ */
+struct CpuFeatures
+{
+    bool sse2;
+    bool sse41;
+    bool avx;
+    bool avx2;
+    bool fma;
+    bool avx512f;
+};
+
+/**
+ * Returns the features of this CPU, detected on the first call.
+ */
+const CpuFeatures& cpu_features();
+
+/**
+ * Returns the best tier this CPU can run.
+ */
+SimdTier simd_detect_tier();
+
+/**
+ * Returns the tier to run: the detected tier, unless lowered by CRYSTAL_SIMD
+ * or simd_force_tier(). It is chosen during static initialization, before
+ * any threads start.
+ */
+SimdTier simd_tier();
+
+/**
+ * Runs the given tier from now on. Returns false, and leaves the tier as it
+ * was, if this CPU cannot run it. Must not be called while other threads
+ * run kernels.
+ */
+bool simd_force_tier(SimdTier tier);
+
+/**
+ * Returns the name of a tier: "scalar", "sse" or "avx2".
+ */
+const char* simd_tier_name(SimdTier tier);
+
+/**
+ * Parses the name of a tier. Returns false if there is no such tier.
+ */
+bool simd_parse_tier(const char* name, SimdTier* tier);
+
+/**
+ * Returns the table of kernels for the current tier, or for the nearest tier
+ * below it which was built, where tables holds one table per tier and NULL
+ * for tiers which were not built. NULL means the scalar code should run.
+ */
+template<typename T>
+const T* simd_select(const T* const (&tables)[SIMD_TIER_COUNT])
+{
+    for (int tier = simd_tier(); tier > SIMD_SCALAR; --tier) {
+        if (tables[tier])
+            return tables[tier];
+    }
+    return NULL;
+}
+
+#endif /* _VEC_CPU_H_ */
@@ -0,0 +1,421 @@
+/**
+ * @file fastmath.h
+ * @brief Approximations of exp, sin, cos, atan2, acos and 1/sqrt at a choice
+ * of accuracies, for real_t and the wide types alike.
+ *
+ * The accuracy is a template argument, so each call site states how much
+ * error it accepts, and F is deduced as real_t, Floatx4 or Floatx8:
+ *
+ *     h += c * math_exp<MATH_FAST>(-falloff * r) * math_sin<MATH_FAST>(phase);
+ *
+ * MATH_EXACT calls the C library, lane by lane for the wide types.
+ * MATH_FAST reduces the argument and evaluates the polynomials of the Cephes
+ * library (Moshier, "Methods and Programs for Mathematical Functions",
+ * 1989), to within a few units in the last place (ULP) of the exact result.
+ * MATH_APPROX uses shorter polynomials, fit here for least maximum error, and
+ * the hardware estimate of 1/sqrt without refinement.
+ *
+ * The largest errors against the C library in double, as measured by
+ * microbench --verify over the given ranges, in units in the last place of
+ * a float, or absolute or relative:
+ *
+ *     function   range              MATH_FAST     MATH_APPROX
+ *     exp        [-87, 88]          1 ULP         7.5e-5 relative
+ *     sin, cos   [-8192, 8192]      8e-8 abs      1.6e-4 abs
+ *     atan2      any                4 ULP         6.1e-4 abs (radians)
+ *     acos       [-1, 1]            2 ULP         6.8e-5 abs (radians)
+ *     rsqrt      normal floats      4 ULP         3.7e-4 relative
+ *
+ * Arguments to exp outside its range are clamped to it. Beyond their range
+ * sin and cos lose accuracy gradually, to 1e-6 at 1e5. atan2 gives zero for
+ * (0, 0), and rsqrt of zero is not finite. None of them treat NaN or
+ * infinity specially.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _VEC_FASTMATH_H_
+#define _VEC_FASTMATH_H_
+
+#include "462math.h"
+#include "vec.h"
+#include "simd.h"
+#include "wide.h"
+#include <cmath>
+#include <cstring>
+
+/**
+ * How close to the exact result a function of fastmath.h must be.
+ */
+enum MathAccuracy
+{
+    MATH_EXACT,  // the C library
+    MATH_FAST,   // within a few ULP
+    MATH_APPROX  // around 1e-4
+};
+
+namespace VEC_ISA {
+
+namespace fastmath {
+
+/*
+ * The operations the functions are built from, for real_t. The wide types
+ * have min, max, abs, sqrt and select in wide.h, found by argument
+ * dependent lookup, and the rest below.
+ */
+
+inline real_t min(real_t a, real_t b) { return a < b ? a : b; }
+inline real_t max(real_t a, real_t b) { return a > b ? a : b; }
+inline real_t abs(real_t a) { return std::fabs(a); }
+inline real_t sqrt(real_t a) { return std::sqrt(a); }
+inline real_t select(bool m, real_t a, real_t b) { return m ? a : b; }
+
+/* a rounded to the nearest integer */
+inline real_t round(real_t a)
+{
+#if VEC_SSE
+    return (real_t)_mm_cvtss_si32(_mm_set_ss(a));
+#else
+    return std::floor(a + (real_t)0.5);
+#endif
+}
+
+/* 2 to the power of n, an integer in [-126, 127] */
+inline real_t pow2(real_t n)
+{
+    const int bits = ((int)n + 127) << 23;
+    real_t r;
+    memcpy(&r, &bits, sizeof r);
+    return r;
+}
+
+/* the magnitude of a with the sign of b */
+inline real_t copysign(real_t a, real_t b)
+{
+#if REAL_IS_DOUBLE
+    typedef unsigned long long bits_t;
+#else
+    typedef unsigned int bits_t;
+#endif
+    const bits_t sign = (bits_t)1 << (8 * sizeof(bits_t) - 1);
+    bits_t ua, ub;
+    memcpy(&ua, &a, sizeof ua);
+    memcpy(&ub, &b, sizeof ub);
+    ua = (ua & ~sign) | (ub & sign);
+    memcpy(&a, &ua, sizeof a);
+    return a;
+}
+
+/* 1/sqrt(a) to 12 bits, or exactly without SSE */
+inline real_t rsqrt_estimate(real_t a)
+{
+#if VEC_SSE
+    return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(a)));
+#else
+    return 1 / std::sqrt(a);
+#endif
+}
+
+#if VEC_SSE
+
+inline Floatx4 round(const Floatx4& a)
+{
+    return Floatx4(_mm_cvtepi32_ps(_mm_cvtps_epi32(a.v)));
+}
+
+inline Floatx4 pow2(const Floatx4& n)
+{
+    const __m128i e = _mm_add_epi32(_mm_cvtps_epi32(n.v), _mm_set1_epi32(127));
+    return Floatx4(_mm_castsi128_ps(_mm_slli_epi32(e, 23)));
+}
+
+inline Floatx4 copysign(const Floatx4& a, const Floatx4& b)
+{
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    return Floatx4(_mm_or_ps(_mm_andnot_ps(sign, a.v), _mm_and_ps(sign, b.v)));
+}
+
+inline Floatx4 rsqrt_estimate(const Floatx4& a) { return Floatx4(_mm_rsqrt_ps(a.v)); }
+
+#else
+
+#define VEC_WIDE_LANES(expr) for (int i = 0; i < 4; ++i) { expr; }
+
+inline Floatx4 round(const Floatx4& a) { Floatx4 r; VEC_WIDE_LANES(r.v[i] = round(a.v[i])) return r; }
+inline Floatx4 pow2(const Floatx4& n) { Floatx4 r; VEC_WIDE_LANES(r.v[i] = pow2(n.v[i])) return r; }
+inline Floatx4 copysign(const Floatx4& a, const Floatx4& b) { Floatx4 r; VEC_WIDE_LANES(r.v[i] = copysign(a.v[i], b.v[i])) return r; }
+inline Floatx4 rsqrt_estimate(const Floatx4& a) { Floatx4 r; VEC_WIDE_LANES(r.v[i] = rsqrt_estimate(a.v[i])) return r; }
+
+#undef VEC_WIDE_LANES
+
+#endif /* VEC_SSE */
+
+#if VEC_AVX
+
+inline Floatx8 round(const Floatx8& a)
+{
+    return Floatx8(_mm256_cvtepi32_ps(_mm256_cvtps_epi32(a.v)));
+}
+
+inline Floatx8 pow2(const Floatx8& n)
+{
+#if VEC_AVX2
+    const __m256i e = _mm256_add_epi32(_mm256_cvtps_epi32(n.v), _mm256_set1_epi32(127));
+    return Floatx8(_mm256_castsi256_ps(_mm256_slli_epi32(e, 23)));
+#else
+    // AVX has no 8-wide integer operations
+    const Floatx4 lo = pow2(Floatx4(_mm256_castps256_ps128(n.v)));
+    const Floatx4 hi = pow2(Floatx4(_mm256_extractf128_ps(n.v, 1)));
+    return Floatx8(_mm256_insertf128_ps(_mm256_castps128_ps256(lo.v), hi.v, 1));
+#endif
+}
+
+inline Floatx8 copysign(const Floatx8& a, const Floatx8& b)
+{
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    return Floatx8(_mm256_or_ps(_mm256_andnot_ps(sign, a.v), _mm256_and_ps(sign, b.v)));
+}
+
+inline Floatx8 rsqrt_estimate(const Floatx8& a) { return Floatx8(_mm256_rsqrt_ps(a.v)); }
+
+#else
+
+inline Floatx8 round(const Floatx8& a) { return Floatx8(round(a.lo), round(a.hi)); }
+inline Floatx8 pow2(const Floatx8& n) { return Floatx8(pow2(n.lo), pow2(n.hi)); }
+inline Floatx8 copysign(const Floatx8& a, const Floatx8& b) { return Floatx8(copysign(a.lo, b.lo), copysign(a.hi, b.hi)); }
+inline Floatx8 rsqrt_estimate(const Floatx8& a) { return Floatx8(rsqrt_estimate(a.lo), rsqrt_estimate(a.hi)); }
+
+#endif /* VEC_AVX */
+
+/* the largest integer not greater than a */
+template<typename F>
+inline F floor(const F& a)
+{
+    const F r = round(a);
+    return select(r > a, r - F(1), r);
+}
+
+/* the C library, for MATH_EXACT */
+inline real_t libm_exp(real_t x) { return std::exp(x); }
+inline real_t libm_sin(real_t x) { return std::sin(x); }
+inline real_t libm_cos(real_t x) { return std::cos(x); }
+inline real_t libm_acos(real_t x) { return std::acos(x); }
+inline real_t libm_atan2(real_t y, real_t x) { return std::atan2(y, x); }
+
+/* f of every lane */
+inline real_t lanes(real_t (*f)(real_t), real_t a) { return f(a); }
+inline real_t lanes(real_t (*f)(real_t, real_t), real_t a, real_t b) { return f(a, b); }
+
+template<typename F>
+inline F lanes(real_t (*f)(real_t), const F& a)
+{
+    real_t v[F::WIDTH];
+    a.store(v);
+    for (int i = 0; i < F::WIDTH; ++i)
+        v[i] = f(v[i]);
+    return F::load(v);
+}
+
+template<typename F>
+inline F lanes(real_t (*f)(real_t, real_t), const F& a, const F& b)
+{
+    real_t u[F::WIDTH], v[F::WIDTH];
+    a.store(u);
+    b.store(v);
+    for (int i = 0; i < F::WIDTH; ++i)
+        u[i] = f(u[i], v[i]);
+    return F::load(u);
+}
+
+/**
+ * e to the power of x.
+ */
+template<MathAccuracy A, typename F>
+inline F math_exp(const F& x)
+{
+    if (A == MATH_EXACT)
+        return lanes(libm_exp, x);
+
+    // e^x = 2^n e^r with |r| <= ln(2)/2, where n*ln(2) is subtracted in two
+    // parts, the first short enough to multiply exactly
+    const F c = min(max(x, F(-87.0f)), F(88.0f));
+    const F n = round(c * F(1.44269504088896341f));
+    const F r = c - n * F(0.693359375f) + n * F(2.12194440e-4f);
+
+    F p;
+    if (A == MATH_FAST) {
+        p = F(1.9875691500e-4f);
+        p = p * r + F(1.3981999507e-3f);
+        p = p * r + F(8.3334519073e-3f);
+        p = p * r + F(4.1665795894e-2f);
+        p = p * r + F(1.6666665459e-1f);
+        p = p * r + F(5.0000001201e-1f);
+        p = p * r * r + r + F(1);
+    } else {
+        p = ((F(0.16566789f) * r + F(0.50496324f)) * r + F(1.00016423f)) * r + F(0.99992808f);
+    }
+
+    return p * pow2(n);
+}
+
+/* sin(x + quadrant*pi/2) */
+template<MathAccuracy A, typename F>
+inline F sin_quadrant(const F& x, real_t quadrant)
+{
+    // x = q*pi/2 + r with |r| <= pi/4, where q*pi/2 is subtracted in three
+    // parts, the first two short enough to multiply exactly for |q| <= 8192
+    const F q = round(x * F(0.636619772367581343f));
+    const F r = ((x - q * F(1.5703125f)) - q * F(4.837512969970703125e-4f)) -
+                q * F(7.54978995489188216e-8f);
+    const F z = r * r;
+
+    F s, c;
+    if (A == MATH_FAST) {
+        s = ((F(-1.9515295891e-4f) * z + F(8.3321608736e-3f)) * z - F(1.6666654611e-1f)) * z * r + r;
+        c = ((F(2.443315711809948e-5f) * z - F(1.388731625493765e-3f)) * z + F(4.166664568298827e-2f)) * z * z -
+            F(0.5f) * z + F(1);
+    } else {
+        s = (F(-0.16034422f) * z + F(0.99903152f)) * r;
+        c = (F(0.040399182f) * z - F(0.49970864f)) * z + F(0.99999011f);
+    }
+
+    // the quadrant, 0 to 3, picks the polynomial and its sign
+    const F k = q + F(quadrant);
+    const F k4 = k - F(4) * floor(k * F(0.25f));
+    const F v = select((k4 == F(1)) | (k4 == F(3)), c, s);
+    return select(k4 >= F(2), -v, v);
+}
+
+/**
+ * The sine of x radians.
+ */
+template<MathAccuracy A, typename F>
+inline F math_sin(const F& x)
+{
+    if (A == MATH_EXACT)
+        return lanes(libm_sin, x);
+    return sin_quadrant<A>(x, 0);
+}
+
+/**
+ * The cosine of x radians.
+ */
+template<MathAccuracy A, typename F>
+inline F math_cos(const F& x)
+{
+    if (A == MATH_EXACT)
+        return lanes(libm_cos, x);
+    return sin_quadrant<A>(x, 1);
+}
+
+/**
+ * The angle of (x, y) from the x axis, in [-pi, pi].
+ */
+template<MathAccuracy A, typename F>
+inline F math_atan2(const F& y, const F& x)
+{
+    if (A == MATH_EXACT)
+        return lanes(libm_atan2, y, x);
+
+    // atan of the smaller coordinate over the larger, in [0, 1]
+    const F ax = abs(x), ay = abs(y);
+    const F hi = max(ax, ay), lo = min(ax, ay);
+    const F a = select(hi == F(0), F(0), lo / hi);
+
+    F t;
+    if (A == MATH_FAST) {
+        // atan(a) = pi/4 + atan((a - 1)/(a + 1)) brings |b| to tan(pi/8)
+        const F b = select(a > F(0.414213562373095f), (a - F(1)) / (a + F(1)), a);
+        const F z = b * b;
+        t = (((F(8.05374449538e-2f) * z - F(1.38776856032e-1f)) * z + F(1.99777106478e-1f)) * z -
+             F(3.33329491539e-1f)) * z * b + b;
+        t = t + select(a > F(0.414213562373095f), F(PI/4), F(0));
+    } else {
+        const F z = a * a;
+        t = ((F(0.079338660f) * z - F(0.28868995f)) * z + F(0.99535799f)) * a;
+    }
+
+    // back to the octant of (x, y)
+    t = select(ay > ax, F(PI/2) - t, t);
+    t = select(copysign(F(1), x) < F(0), F(PI) - t, t);
+    return copysign(t, y);
+}
+
+/**
+ * The angle whose cosine is x, in [0, pi].
+ */
+template<MathAccuracy A, typename F>
+inline F math_acos(const F& x)
+{
+    if (A == MATH_EXACT)
+        return lanes(libm_acos, x);
+
+    const F a = min(abs(x), F(1));
+
+    if (A == MATH_APPROX) {
+        // Abramowitz and Stegun, 4.4.45
+        const F t = sqrt(F(1) - a) *
+            (((F(-0.0187293f) * a + F(0.0742610f)) * a - F(0.2121144f)) * a + F(1.5707288f));
+        return select(x < F(0), F(PI) - t, t);
+    }
+
+    // asin(s), where near the ends s = sqrt((1 - |x|)/2), since
+    // acos(|x|) = 2 asin(s), and elsewhere s = x, since acos(x) = pi/2 - asin(x)
+    const F z = select(a > F(0.5f), F(0.5f) * (F(1) - a), x * x);
+    const F s = select(a > F(0.5f), sqrt(z), x);
+    const F p = ((((F(4.2163199048e-2f) * z + F(2.4181311049e-2f)) * z + F(4.5470025998e-2f)) * z +
+                  F(7.4953002686e-2f)) * z + F(1.6666752422e-1f)) * z * s + s;
+
+    const F ends = select(x < F(0), F(PI) - F(2) * p, F(2) * p);
+    return select(a > F(0.5f), ends, F(PI/2) - p);
+}
+
+/**
+ * 1/sqrt(x).
+ */
+template<MathAccuracy A, typename F>
+inline F math_rsqrt(const F& x)
+{
+    if (A == MATH_EXACT)
+        return F(1) / sqrt(x);
+
+    const F y = rsqrt_estimate(x);
+    if (A == MATH_APPROX)
+        return y;
+
+    // one Newton-Raphson step doubles the bits of the estimate
+    return y * (F(1.5f) - F(0.5f) * x * y * y);
+}
+
+/**
+ * The unit vector in the direction of v, as Vec3::unit() for MATH_EXACT.
+ */
+template<MathAccuracy A>
+inline Vec3 math_normalize(const Vec3& v)
+{
+    if (A == MATH_EXACT)
+        return v.unit();
+    return v * math_rsqrt<A>(v.squared_magnitude());
+}
+
+template<MathAccuracy A, typename F>
+inline Vec3xN<F> math_normalize(const Vec3xN<F>& v)
+{
+    if (A == MATH_EXACT)
+        return v.unit();
+    return v * math_rsqrt<A>(v.squared_magnitude());
+}
+
+} /* namespace fastmath */
+
+using fastmath::math_exp;
+using fastmath::math_sin;
+using fastmath::math_cos;
+using fastmath::math_atan2;
+using fastmath::math_acos;
+using fastmath::math_rsqrt;
+using fastmath::math_normalize;
+
+} /* namespace VEC_ISA */
+
+#endif /* _VEC_FASTMATH_H_ */
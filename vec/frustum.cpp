@@ -0,0 +1,70 @@
+/**
+ * @file frustum.cpp
+ * @brief View frustum.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#include "frustum.h"
+#include "mat.h"
+#include "kernels.h"
+
+Frustum::Frustum(const Mat4& m)
+{
+    const Vec4 row0(m(0,0), m(1,0), m(2,0), m(3,0));
+    const Vec4 row1(m(0,1), m(1,1), m(2,1), m(3,1));
+    const Vec4 row2(m(0,2), m(1,2), m(2,2), m(3,2));
+    const Vec4 row3(m(0,3), m(1,3), m(2,3), m(3,3));
+
+    planes[LEFT]       = row3 + row0;
+    planes[RIGHT]      = row3 - row0;
+    planes[BOTTOM]     = row3 + row1;
+    planes[TOP]        = row3 - row1;
+    planes[NEAR_PLANE] = row3 + row2;
+    planes[FAR_PLANE]  = row3 - row2;
+}
+
+bool Frustum::contains(const Vec3& p) const
+{
+    for (int i = 0; i < 6; ++i) {
+        const Vec4& n = planes[i];
+        if (n.x*p.x + n.y*p.y + n.z*p.z + n.w < 0)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::intersects(const AABB& box) const
+{
+    if (box.is_empty())
+        return true;
+
+    for (int i = 0; i < 6; ++i) {
+        // test the corner farthest along the plane normal
+        const Vec4& n = planes[i];
+        const real_t x = n.x >= 0 ? box.max.x : box.min.x;
+        const real_t y = n.y >= 0 ? box.max.y : box.min.y;
+        const real_t z = n.z >= 0 ? box.max.z : box.min.z;
+        if (n.x*x + n.y*y + n.z*z + n.w < 0)
+            return false;
+    }
+    return true;
+}
+
+size_t Frustum::cull(const AABB* boxes, size_t n, size_t* visible) const
+{
+    assert(boxes && visible);
+
+    // eight boxes at a time with SIMD. Without it, testing one box at a time
+    // is faster, as it stops at the first plane the box is outside.
+    const VecKernels* k = vec_kernels();
+    size_t count = 0;
+    size_t i = k ? k->cull(*this, boxes, n, visible, &count) : 0;
+
+    for (; i < n; ++i) {
+        if (intersects(boxes[i]))
+            visible[count++] = i;
+    }
+
+    return count;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file frustum.h
+ * @brief View frustum.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _VEC_FRUSTUM_H_
+#define _VEC_FRUSTUM_H_
+
+#include "462math.h"
+#include "vec.h"
+#include "aabb.h"
+#include <cstddef>
+
+class Mat4;
+
+/**
+ * A view frustum, stored as six planes facing inward.
+ */
+class Frustum
+{
+public:
+    enum Plane { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE };
+
+    /**
+     * The planes, indexed by Plane. A point p is on the inside of a plane
+     * (a,b,c,d) when a*p.x + b*p.y + c*p.z + d >= 0. The planes are not
+     * normalized.
+     */
+    Vec4 planes[6];
+
+    /**
+     * Default constructor. Leaves values unitialized.
+     */
+    Frustum() {}
+
+    /**
+     * Extracts the frustum of the given projection * view matrix
+     * (Gribb and Hartmann, "Fast Extraction of Viewing Frustum Planes
+     * from the World-View-Projection Matrix", 2001).
+     */
+    explicit Frustum(const Mat4& view_proj);
+
+    bool contains(const Vec3& p) const;
+
+    /**
+     * Returns false only if the box lies entirely outside one of the planes.
+     * This may report boxes near the corners of the frustum as intersecting
+     * when they do not. The empty box always intersects.
+     */
+    bool intersects(const AABB& box) const;
+
+    /**
+     * Tests n boxes as intersects(), eight at a time. Writes the indices of
+     * the boxes which intersect to visible, in order, and returns how many
+     * there are.
+     */
+    size_t cull(const AABB* boxes, size_t n, size_t* visible) const;
+};
+
+#endif /* _VEC_FRUSTUM_H_ */
@@ -0,0 +1,75 @@
+/**
+ * @file kernels.h
+ * @brief The SIMD loops of the batch functions and frustum culling, built
+ * once for each tier of SimdTier.
+ *
+ * Each kernel processes as much of its arrays as suits its instruction set
+ * and returns how many elements it processed, always a prefix. The public
+ * function finishes the rest one at a time with the scalar code, which is
+ * all that runs at SIMD_SCALAR.
+ *
+ * Only for use in vec/; nothing here is part of the interface of the math
+ * classes.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _VEC_KERNELS_H_
+#define _VEC_KERNELS_H_
+
+#include "462math.h"
+#include "vec.h"
+#include "mat.h"
+#include "affine.h"
+#include "quat.h"
+#include "aabb.h"
+#include "frustum.h"
+#include "cpu.h"
+#include <cstddef>
+
+struct VecKernels
+{
+    // batch.h
+    size_t (*transform_affine)(const Affine3& t, bool translate,
+                               const Vec3* in, Vec3* out, size_t n);
+    size_t (*transform_coordinates)(const Affine3& t,
+                                    const real_t* in_x, const real_t* in_y, const real_t* in_z,
+                                    real_t* out_x, real_t* out_y, real_t* out_z,
+                                    size_t n);
+    size_t (*project_points)(const Mat4& m, const Vec3* in, Vec3* out, size_t n);
+    size_t (*clip_points)(const Mat4& m, const Vec3* in, Vec4* out, size_t n);
+    size_t (*transform_aabbs)(const Affine3& t, const AABB* in, AABB* out, size_t n);
+    size_t (*transform_aabbs_each)(const Affine3* t, const AABB* in, AABB* out, size_t n);
+    size_t (*multiply_quats)(const Quat* a, const Quat* b, Quat* out, size_t n);
+    size_t (*rotate_points)(const Quat* q, const Vec3* in, Vec3* out, size_t n);
+    size_t (*quats_to_matrices)(const Quat* q, Mat3* out, size_t n);
+    size_t (*quats_to_transforms)(const Quat* q, const Vec3* translations,
+                                  Affine3* out, size_t n);
+    size_t (*nlerp_quats)(const Quat* a, const Quat* b, const real_t* t,
+                          Quat* out, size_t n);
+    size_t (*slerp_quats_fast)(const Quat* a, const Quat* b, const real_t* t,
+                               Quat* out, size_t n);
+
+    // frustum.h; also adds the indices of the visible boxes to count
+    size_t (*cull)(const Frustum& frustum, const AABB* boxes, size_t n,
+                   size_t* visible, size_t* count);
+};
+
+/**
+ * The kernels built for each tier, or NULL if the compiler could not build
+ * them.
+ */
+const VecKernels* vec_kernels_sse();
+const VecKernels* vec_kernels_avx2();
+
+/**
+ * Returns the kernels of the current tier, or NULL to run the scalar code.
+ */
+inline const VecKernels* vec_kernels()
+{
+    static const VecKernels* const tables[SIMD_TIER_COUNT] =
+        { NULL, vec_kernels_sse(), vec_kernels_avx2() };
+    return simd_select(tables);
+}
+
+#endif /* _VEC_KERNELS_H_ */
@@ -0,0 +1,42 @@
+/**
+ * @file kernels_avx2.cpp
+ * @brief The SIMD_AVX2 kernels of kernels.h, built for AVX2 and FMA even
+ * when the rest of the program is not.
+ *
+ * GCC builds them with a target pragma. The headers of the math classes are
+ * included before it, so that their inline functions, which other
+ * translation units share, stay built for the baseline. Other compilers
+ * build them only when the whole program targets AVX2.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#include "kernels.h"
+
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__AVX2__) && \
+    (defined(__i386__) || defined(__x86_64__))
+#pragma GCC push_options
+#pragma GCC target("avx,avx2,fma")
+#define VEC_TARGET_AVX2 1
+#define KERNELS_AVX2_PRAGMA 1
+#endif
+
+#include "simd.h"
+
+#if VEC_AVX2
+#include "kernels_impl.h"
+#endif
+
+#ifdef KERNELS_AVX2_PRAGMA
+#pragma GCC pop_options
+#endif
+
+// built for the baseline, as it runs before the CPU is checked
+const VecKernels* vec_kernels_avx2()
+{
+#if VEC_AVX2
+    return &VEC_ISA::kernels;
+#else
+    return NULL;
+#endif
+}
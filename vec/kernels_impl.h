@@ -0,0 +1,397 @@
+/**
+ * @file kernels_impl.h
+ * @brief The bodies of the kernels in kernels.h.
+ *
+ * Included once by each of kernels_sse.cpp and kernels_avx2.cpp, which
+ * compile it for their instruction set, after simd.h. Everything is in the
+ * VEC_ISA namespace, so the copies do not clash.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _VEC_KERNELS_IMPL_H_
+#define _VEC_KERNELS_IMPL_H_
+
+#include "kernels.h"
+#include "simd.h"
+#include "wide.h"
+
+#if !VEC_SSE
+#error "the kernels need SSE"
+#endif
+
+namespace VEC_ISA {
+
+/* the elements of an affine transformation, each in every lane */
+struct AffineLanes
+{
+    __m128 m[Affine3::SIZE];
+
+    AffineLanes(const Affine3& t, bool translate)
+    {
+        for (int i = 0; i < Affine3::SIZE; ++i)
+            m[i] = _mm_set1_ps(t.m[i]);
+
+        if (!translate)
+            m[3] = m[7] = m[11] = _mm_setzero_ps();
+    }
+
+    /* one coordinate of four points, summed in the same order as Mat4 */
+    __m128 row(int r, __m128 x, __m128 y, __m128 z) const
+    {
+        const __m128 *e = m + r*Affine3::COLS;
+        __m128 v = _mm_mul_ps(e[0], x);
+        v = vec_madd(e[1], y, v);
+        v = vec_madd(e[2], z, v);
+        return _mm_add_ps(v, e[3]);
+    }
+};
+
+/* the columns of a matrix, each element in every lane */
+struct MatrixLanes
+{
+    __m128 m[Mat4::SIZE];
+
+    MatrixLanes(const Mat4& mat)
+    {
+        for (int i = 0; i < Mat4::SIZE; ++i)
+            m[i] = _mm_set1_ps(mat.m[i]);
+    }
+
+    /* one coordinate of four points with w = 1 */
+    __m128 row(int r, __m128 x, __m128 y, __m128 z) const
+    {
+        __m128 v = _mm_mul_ps(m[r], x);
+        v = vec_madd(m[4+r], y, v);
+        v = vec_madd(m[8+r], z, v);
+        return _mm_add_ps(v, m[12+r]);
+    }
+};
+
+/* an affine transformation of boxes: the columns of the linear part, their
+   absolute values, and the translation */
+struct BoxLanes
+{
+    __m128 col[3], abs_col[3], translation;
+
+    BoxLanes(const Affine3& t)
+    {
+        __m128 c0 = _mm_loadu_ps(t.m);
+        __m128 c1 = _mm_loadu_ps(t.m+4);
+        __m128 c2 = _mm_loadu_ps(t.m+8);
+        __m128 c3 = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        col[0] = c0; abs_col[0] = _mm_andnot_ps(sign, c0);
+        col[1] = c1; abs_col[1] = _mm_andnot_ps(sign, c1);
+        col[2] = c2; abs_col[2] = _mm_andnot_ps(sign, c2);
+        translation = c3;
+    }
+
+    void transform(const AABB& in, AABB& out) const
+    {
+        if (in.is_empty()) {
+            out = AABB::Empty;
+            return;
+        }
+
+        // Arvo's method, as center and extent
+        const __m128 lo = _mm_setr_ps(in.min.x, in.min.y, in.min.z, 0);
+        const __m128 hi = _mm_setr_ps(in.max.x, in.max.y, in.max.z, 0);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 c = _mm_mul_ps(_mm_add_ps(hi, lo), half);
+        const __m128 e = _mm_mul_ps(_mm_sub_ps(hi, lo), half);
+
+        __m128 center = vec_madd(col[0], VEC_SWIZZLE(c, 0,0,0,0), translation);
+        center = vec_madd(col[1], VEC_SWIZZLE(c, 1,1,1,1), center);
+        center = vec_madd(col[2], VEC_SWIZZLE(c, 2,2,2,2), center);
+
+        __m128 extent = _mm_mul_ps(abs_col[0], VEC_SWIZZLE(e, 0,0,0,0));
+        extent = vec_madd(abs_col[1], VEC_SWIZZLE(e, 1,1,1,1), extent);
+        extent = vec_madd(abs_col[2], VEC_SWIZZLE(e, 2,2,2,2), extent);
+
+        real_t r[8];
+        _mm_storeu_ps(r,   _mm_sub_ps(center, extent));
+        _mm_storeu_ps(r+4, _mm_add_ps(center, extent));
+        out = AABB(Vec3(r[0], r[1], r[2]), Vec3(r[4], r[5], r[6]));
+    }
+};
+
+static size_t transform_affine(const Affine3& t, bool translate,
+                               const Vec3* in, Vec3* out, size_t n)
+{
+    const AffineLanes lanes(t, translate);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 x, y, z;
+        load_vec3x4(&in[i].x, x, y, z);
+        store_vec3x4(&out[i].x, lanes.row(0, x, y, z), lanes.row(1, x, y, z), lanes.row(2, x, y, z));
+    }
+
+    return i;
+}
+
+static size_t transform_coordinates(const Affine3& t,
+                                    const real_t* in_x, const real_t* in_y, const real_t* in_z,
+                                    real_t* out_x, real_t* out_y, real_t* out_z,
+                                    size_t n)
+{
+    const AffineLanes lanes(t, true);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        const __m128 x = _mm_loadu_ps(in_x + i);
+        const __m128 y = _mm_loadu_ps(in_y + i);
+        const __m128 z = _mm_loadu_ps(in_z + i);
+        _mm_storeu_ps(out_x + i, lanes.row(0, x, y, z));
+        _mm_storeu_ps(out_y + i, lanes.row(1, x, y, z));
+        _mm_storeu_ps(out_z + i, lanes.row(2, x, y, z));
+    }
+
+    return i;
+}
+
+static size_t project_points(const Mat4& m, const Vec3* in, Vec3* out, size_t n)
+{
+    const MatrixLanes lanes(m);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 x, y, z;
+        load_vec3x4(&in[i].x, x, y, z);
+
+        // as Vec4::projection, which leaves w = 0 undivided
+        __m128 w = lanes.row(3, x, y, z);
+        const __m128 w_zero = _mm_cmpeq_ps(w, zero);
+        w = _mm_or_ps(_mm_andnot_ps(w_zero, w), _mm_and_ps(w_zero, one));
+
+        store_vec3x4(&out[i].x,
+                     _mm_div_ps(lanes.row(0, x, y, z), w),
+                     _mm_div_ps(lanes.row(1, x, y, z), w),
+                     _mm_div_ps(lanes.row(2, x, y, z), w));
+    }
+
+    return i;
+}
+
+static size_t clip_points(const Mat4& m, const Vec3* in, Vec4* out, size_t n)
+{
+    const MatrixLanes lanes(m);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 x, y, z;
+        load_vec3x4(&in[i].x, x, y, z);
+
+        __m128 p0 = lanes.row(0, x, y, z);
+        __m128 p1 = lanes.row(1, x, y, z);
+        __m128 p2 = lanes.row(2, x, y, z);
+        __m128 p3 = lanes.row(3, x, y, z);
+        _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+
+        _mm_storeu_ps(&out[i].x,   p0);
+        _mm_storeu_ps(&out[i+1].x, p1);
+        _mm_storeu_ps(&out[i+2].x, p2);
+        _mm_storeu_ps(&out[i+3].x, p3);
+    }
+
+    return i;
+}
+
+static size_t transform_aabbs(const Affine3& t, const AABB* in, AABB* out, size_t n)
+{
+    const BoxLanes lanes(t);
+
+    for (size_t i = 0; i < n; ++i)
+        lanes.transform(in[i], out[i]);
+
+    return n;
+}
+
+static size_t transform_aabbs_each(const Affine3* t, const AABB* in, AABB* out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        BoxLanes(t[i]).transform(in[i], out[i]);
+
+    return n;
+}
+
+static size_t multiply_quats(const Quat* a, const Quat* b, Quat* out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + Quatx8::WIDTH <= n; i += Quatx8::WIDTH)
+        (Quatx8::load(a + i) * Quatx8::load(b + i)).store(out + i);
+
+    return i;
+}
+
+static size_t rotate_points(const Quat* q, const Vec3* in, Vec3* out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + Quatx8::WIDTH <= n; i += Quatx8::WIDTH)
+        (Quatx8::load(q + i) * Vec3x8::load(in + i)).store(out + i);
+
+    return i;
+}
+
+static size_t quats_to_matrices(const Quat* q, Mat3* out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + Quatx8::WIDTH <= n; i += Quatx8::WIDTH) {
+        Vec3x8 axes[3];
+        Quatx8::load(q + i).to_axes(axes);
+
+        // the columns of each matrix are its axes
+        Vec3 columns[3][Quatx8::WIDTH];
+        for (int c = 0; c < 3; ++c)
+            axes[c].store(columns[c]);
+
+        for (int lane = 0; lane < Quatx8::WIDTH; ++lane) {
+            Mat3& m = out[i + lane];
+            for (int c = 0; c < 3; ++c) {
+                m._m[c][0] = columns[c][lane].x;
+                m._m[c][1] = columns[c][lane].y;
+                m._m[c][2] = columns[c][lane].z;
+            }
+        }
+    }
+
+    return i;
+}
+
+static size_t quats_to_transforms(const Quat* q, const Vec3* translations,
+                                  Affine3* out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + Quatx4::WIDTH <= n; i += Quatx4::WIDTH) {
+        Vec3x4 axes[3];
+        Quatx4::load(q + i).to_axes(axes);
+        const Vec3x4 t = Vec3x4::load(translations + i);
+
+        // each row across the lanes, transposed to one row of each lane
+        __m128 rows[3][4] = {
+            { axes[0].x.v, axes[1].x.v, axes[2].x.v, t.x.v },
+            { axes[0].y.v, axes[1].y.v, axes[2].y.v, t.y.v },
+            { axes[0].z.v, axes[1].z.v, axes[2].z.v, t.z.v },
+        };
+
+        for (int r = 0; r < Affine3::ROWS; ++r) {
+            _MM_TRANSPOSE4_PS(rows[r][0], rows[r][1], rows[r][2], rows[r][3]);
+            for (int lane = 0; lane < Quatx4::WIDTH; ++lane)
+                _mm_storeu_ps(out[i + lane].rows[r], rows[r][lane]);
+        }
+    }
+
+    return i;
+}
+
+/* nlerp(), at every lane */
+static inline Quatx8 nlerp_lanes(const Quatx8& a, const Quatx8& b, const Floatx8& t)
+{
+    const Floatx8 wa = Floatx8(1) - t;
+    const Floatx8 wb = select(a.dot(b) < Floatx8(0), -t, t);
+
+    Quatx8 q(wa*a.w + wb*b.w, wa*a.x + wb*b.x, wa*a.y + wb*b.y, wa*a.z + wb*b.z);
+    return q.normalize();
+}
+
+static size_t nlerp_quats(const Quat* a, const Quat* b, const real_t* t,
+                          Quat* out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + Quatx8::WIDTH <= n; i += Quatx8::WIDTH)
+        nlerp_lanes(Quatx8::load(a + i), Quatx8::load(b + i), Floatx8::load(t + i)).store(out + i);
+
+    return i;
+}
+
+static size_t slerp_quats_fast(const Quat* a, const Quat* b, const real_t* t,
+                               Quat* out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + Quatx8::WIDTH <= n; i += Quatx8::WIDTH) {
+        const Quatx8 qa = Quatx8::load(a + i), qb = Quatx8::load(b + i);
+        const Floatx8 ft = slerp_fast_t(Floatx8::load(t + i), abs(qa.dot(qb)));
+        nlerp_lanes(qa, qb, ft).store(out + i);
+    }
+
+    return i;
+}
+
+static size_t cull(const Frustum& frustum, const AABB* boxes, size_t n,
+                   size_t* visible, size_t* count)
+{
+    assert(sizeof(AABB) == 2*sizeof(Vec3));
+    const Vec4* planes = frustum.planes;
+
+    // the planes in every lane
+    Vec3x8 normals[6];
+    Floatx8 offsets[6];
+    for (int p = 0; p < 6; ++p) {
+        normals[p] = Vec3x8(planes[p].xyz());
+        offsets[p] = planes[p].w;
+    }
+
+    const Floatx8 zero = 0;
+    size_t c = *count;
+    size_t i = 0;
+
+    for (; i + Floatx8::WIDTH <= n; i += Floatx8::WIDTH) {
+        Vec3x8 lo, hi;
+        Vec3x8::load_pairs(&boxes[i].min, lo, hi);
+
+        Maskx8 outside(false);
+
+        for (int p = 0; p < 6; ++p) {
+            // the corner farthest along the normal is the same in every lane
+            const Vec4& n = planes[p];
+            const Vec3x8 corner(n.x >= 0 ? hi.x : lo.x,
+                                n.y >= 0 ? hi.y : lo.y,
+                                n.z >= 0 ? hi.z : lo.z);
+            outside |= corner.dot(normals[p]) + offsets[p] < zero;
+        }
+
+        const Maskx8 empty = (lo.x > hi.x) | (lo.y > hi.y) | (lo.z > hi.z);
+        const int bits = (empty | !outside).bits();
+
+        // without branches, which would mispredict; c <= i + lane, so the
+        // extra writes stay within the n entries of visible
+        for (int lane = 0; lane < Floatx8::WIDTH; ++lane) {
+            visible[c] = i + lane;
+            c += (bits >> lane) & 1;
+        }
+    }
+
+    *count = c;
+    return i;
+}
+
+static const VecKernels kernels = {
+    transform_affine,
+    transform_coordinates,
+    project_points,
+    clip_points,
+    transform_aabbs,
+    transform_aabbs_each,
+    multiply_quats,
+    rotate_points,
+    quats_to_matrices,
+    quats_to_transforms,
+    nlerp_quats,
+    slerp_quats_fast,
+    cull,
+};
+
+} /* namespace VEC_ISA */
+
+#endif /* _VEC_KERNELS_IMPL_H_ */
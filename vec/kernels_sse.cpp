@@ -0,0 +1,24 @@
+/**
+ * @file kernels_sse.cpp
+ * @brief The SIMD_SSE kernels of kernels.h, built for the instruction set
+ * the whole program targets.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#include "kernels.h"
+#include "simd.h"
+
+// a program built for AVX2 takes its kernels from kernels_avx2.cpp
+#if VEC_SSE && !VEC_AVX2
+#include "kernels_impl.h"
+#endif
+
+const VecKernels* vec_kernels_sse()
+{
+#if VEC_SSE && !VEC_AVX2
+    return &VEC_ISA::kernels;
+#else
+    return NULL;
+#endif
+}
@@ -8,8 +8,44 @@
 
 #include "mat.h"
 #include "quat.h"
+#include "simd.h"
 #include <cstring>
 
+#if VEC_SSE
+
+/* the columns of a times the elements of v */
+static inline __m128 mat4_combine(const __m128 col[4], const real_t *v)
+{
+    __m128 r = _mm_mul_ps(col[0], _mm_set1_ps(v[0]));
+    r = vec_madd(col[1], _mm_set1_ps(v[1]), r);
+    r = vec_madd(col[2], _mm_set1_ps(v[2]), r);
+    r = vec_madd(col[3], _mm_set1_ps(v[3]), r);
+    return r;
+}
+
+/* 2x2 matrices, stored row by row in one register: a*b */
+static inline __m128 mat2_mul(__m128 a, __m128 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, VEC_SWIZZLE(b, 0,3,0,3)),
+                      _mm_mul_ps(VEC_SWIZZLE(a, 1,0,3,2), VEC_SWIZZLE(b, 2,1,2,1)));
+}
+
+/* adjugate(a)*b */
+static inline __m128 mat2_adj_mul(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(VEC_SWIZZLE(a, 3,3,0,0), b),
+                      _mm_mul_ps(VEC_SWIZZLE(a, 1,1,2,2), VEC_SWIZZLE(b, 2,3,0,1)));
+}
+
+/* a*adjugate(b) */
+static inline __m128 mat2_mul_adj(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, VEC_SWIZZLE(b, 3,0,3,0)),
+                      _mm_mul_ps(VEC_SWIZZLE(a, 1,0,3,2), VEC_SWIZZLE(b, 2,1,2,1)));
+}
+
+#endif /* VEC_SSE */
+
 const Mat3 Mat3::Identity = Mat3( 1, 0, 0,
                                   0, 1, 0,
                                   0, 0, 1 );
@@ -264,6 +300,24 @@ Mat4& Mat4::operator-=(const Mat4& rhs)
 }
 
 Mat4 Mat4::operator*(const Mat4& rhs) const
+{
+#if VEC_SSE
+    // each column of the product combines the columns of this matrix
+    const __m128 col[4] = { _mm_loadu_ps(m), _mm_loadu_ps(m+4),
+                            _mm_loadu_ps(m+8), _mm_loadu_ps(m+12) };
+
+    Mat4 product;
+    _mm_storeu_ps(product.m,    mat4_combine(col, rhs.m));
+    _mm_storeu_ps(product.m+4,  mat4_combine(col, rhs.m+4));
+    _mm_storeu_ps(product.m+8,  mat4_combine(col, rhs.m+8));
+    _mm_storeu_ps(product.m+12, mat4_combine(col, rhs.m+12));
+    return product;
+#else
+    return multiply_scalar(rhs);
+#endif
+}
+
+Mat4 Mat4::multiply_scalar(const Mat4& rhs) const
 {
     Mat4 product;
     for (int i=0; i<DIM; ++i)
@@ -275,6 +329,20 @@ Mat4 Mat4::operator*(const Mat4& rhs) const
 }
 
 Vec4 Mat4::operator*(const Vec4& v) const
+{
+#if VEC_SSE
+    const __m128 col[4] = { _mm_loadu_ps(m), _mm_loadu_ps(m+4),
+                            _mm_loadu_ps(m+8), _mm_loadu_ps(m+12) };
+
+    Vec4 r;
+    _mm_storeu_ps(&r.x, mat4_combine(col, &v.x));
+    return r;
+#else
+    return transform_scalar(v);
+#endif
+}
+
+Vec4 Mat4::transform_scalar(const Vec4& v) const
 {
     return Vec4( _m[0][0]*v.x + _m[1][0]*v.y + _m[2][0]*v.z + _m[3][0]*v.w,
                  _m[0][1]*v.x + _m[1][1]*v.y + _m[2][1]*v.z + _m[3][1]*v.w,
@@ -346,6 +414,80 @@ Mat4 Mat4::transpose() const
 }
 
 Mat4 Mat4::inverse() const
+{
+#if VEC_SSE
+    // Block-wise inverse through the adjugates of the 2x2 sub-matrices,
+    // computed as if the columns were rows, which gives the columns of the
+    // inverse.
+    const __m128 c0 = _mm_loadu_ps(m);
+    const __m128 c1 = _mm_loadu_ps(m+4);
+    const __m128 c2 = _mm_loadu_ps(m+8);
+    const __m128 c3 = _mm_loadu_ps(m+12);
+
+    const __m128 A = _mm_movelh_ps(c0, c1);
+    const __m128 B = _mm_movehl_ps(c1, c0);
+    const __m128 C = _mm_movelh_ps(c2, c3);
+    const __m128 D = _mm_movehl_ps(c3, c2);
+
+    // determinants of the sub-matrices, (|A| |B| |C| |D|)
+    const __m128 det_sub = _mm_sub_ps(
+        _mm_mul_ps(VEC_SHUFFLE(c0, c2, 0,2,0,2), VEC_SHUFFLE(c1, c3, 1,3,1,3)),
+        _mm_mul_ps(VEC_SHUFFLE(c0, c2, 1,3,1,3), VEC_SHUFFLE(c1, c3, 0,2,0,2)));
+
+    const __m128 det_A = VEC_SWIZZLE(det_sub, 0,0,0,0);
+    const __m128 det_B = VEC_SWIZZLE(det_sub, 1,1,1,1);
+    const __m128 det_C = VEC_SWIZZLE(det_sub, 2,2,2,2);
+    const __m128 det_D = VEC_SWIZZLE(det_sub, 3,3,3,3);
+
+    const __m128 D_C = mat2_adj_mul(D, C);
+    const __m128 A_B = mat2_adj_mul(A, B);
+
+    __m128 X = _mm_sub_ps(_mm_mul_ps(det_D, A), mat2_mul(B, D_C));
+    __m128 W = _mm_sub_ps(_mm_mul_ps(det_A, D), mat2_mul(C, A_B));
+    __m128 Y = _mm_sub_ps(_mm_mul_ps(det_B, C), mat2_mul_adj(D, A_B));
+    __m128 Z = _mm_sub_ps(_mm_mul_ps(det_C, B), mat2_mul_adj(A, D_C));
+
+    // |M| = |A||D| + |B||C| - trace((A#B)(D#C))
+    __m128 tr = _mm_mul_ps(A_B, VEC_SWIZZLE(D_C, 0,2,1,3));
+    tr = _mm_add_ps(tr, VEC_SWIZZLE(tr, 1,0,3,2));
+    tr = _mm_add_ps(tr, VEC_SWIZZLE(tr, 2,3,0,1));
+
+    const __m128 det_M = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_A, det_D),
+                                               _mm_mul_ps(det_B, det_C)), tr);
+
+    const __m128 rcp_det = _mm_div_ps(_mm_setr_ps(1, -1, -1, 1), det_M);
+
+    X = _mm_mul_ps(X, rcp_det);
+    Y = _mm_mul_ps(Y, rcp_det);
+    Z = _mm_mul_ps(Z, rcp_det);
+    W = _mm_mul_ps(W, rcp_det);
+
+    __m128 r0 = VEC_SHUFFLE(X, Y, 3,1,3,1);
+    __m128 r1 = VEC_SHUFFLE(X, Y, 2,0,2,0);
+    __m128 r2 = VEC_SHUFFLE(Z, W, 3,1,3,1);
+    __m128 r3 = VEC_SHUFFLE(Z, W, 2,0,2,0);
+
+    // The scalar code returns the transpose of the inverse, which callers
+    // rely on, so transpose to match it
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    Mat4 rv;
+    _mm_storeu_ps(rv.m,    r0);
+    _mm_storeu_ps(rv.m+4,  r1);
+    _mm_storeu_ps(rv.m+8,  r2);
+    _mm_storeu_ps(rv.m+12, r3);
+    return rv;
+#else
+    return inverse_scalar();
+#endif
+}
+
+bool Mat4::is_simd()
+{
+    return VEC_SSE != 0;
+}
+
+Mat4 Mat4::inverse_scalar() const
 {
     real_t m00 = _m[0][0], m01 = _m[0][1], m02 = _m[0][2], m03 = _m[0][3];
     real_t m10 = _m[1][0], m11 = _m[1][1], m12 = _m[1][2], m13 = _m[1][3];
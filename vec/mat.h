@@ -283,8 +283,23 @@ public:
      */
     Mat4 transpose() const;
 
+    /**
+     * Returns the transpose of the inverse matrix. Uses SSE when real_t is
+     * float and the compiler targets it.
+     */
     Mat4 inverse() const;
 
+    /**
+     * Plain C++ versions of the operations which have SIMD paths. These are
+     * the reference the SIMD paths are checked against.
+     */
+    Mat4 multiply_scalar(const Mat4& rhs) const;
+    Vec4 transform_scalar(const Vec4& v) const;
+    Mat4 inverse_scalar() const;
+
+    /** True if operator*, transform and inverse use SIMD instructions */
+    static bool is_simd();
+
 	static Mat4 perspective(real_t fovy,
 	                        real_t aspect,
 	                        real_t zNear,
@@ -0,0 +1,134 @@
+/**
+ * @file octahedral.h
+ * @brief Maps directions to two coordinates in [-1, 1] and back, for real_t
+ * and the wide types alike.
+ *
+ * A direction is scaled onto the octahedron |x| + |y| + |z| = 1, whose upper
+ * half projects onto the diamond |u| + |v| <= 1 and whose lower half folds
+ * out over its edges to fill the rest of the square (Meyer et al., "On
+ * Floating-Point Normal Vectors", EGSR 2010). Two coordinates hold a unit
+ * vector to within a fraction of the precision they are stored to, which
+ * three would spend on its length.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _VEC_OCTAHEDRAL_H_
+#define _VEC_OCTAHEDRAL_H_
+
+#include "462math.h"
+#include "simd.h"
+#include "wide.h"
+#include "fastmath.h"
+
+namespace VEC_ISA {
+
+namespace fastmath {
+
+/**
+ * The coordinates (u, v) of the direction (x, y, z), which need not be of
+ * unit length, but must not be zero.
+ */
+template<typename F>
+inline void octahedral_encode(const F& x, const F& y, const F& z, F& u, F& v)
+{
+    const F s = F(1) / (abs(x) + abs(y) + abs(z));
+    const F px = x * s;
+    const F py = y * s;
+
+    // the lower half folds over the edges of the diamond
+    const F fx = copysign(F(1) - abs(py), px);
+    const F fy = copysign(F(1) - abs(px), py);
+    u = select(z < F(0), fx, px);
+    v = select(z < F(0), fy, py);
+}
+
+/**
+ * The unit vector (x, y, z) at the coordinates (u, v), as the shaders
+ * decode them.
+ */
+template<typename F>
+inline void octahedral_decode(const F& u, const F& v, F& x, F& y, F& z)
+{
+    z = F(1) - abs(u) - abs(v);
+
+    // unfold the corners, which belong to the lower half
+    const F t = max(-z, F(0));
+    x = u - copysign(t, u);
+    y = v - copysign(t, v);
+
+    const F s = F(1) / sqrt(x * x + y * y + z * z);
+    x *= s;
+    y *= s;
+    z *= s;
+}
+
+/* a in [-1, 1] as a signed normalized 16-bit integer, to nearest */
+inline short snorm16(real_t a)
+{
+    return (short)round(min(max(a, real_t(-1)), real_t(1)) * 32767);
+}
+
+/**
+ * Stores the lanes of u and v as pairs of signed normalized 16-bit
+ * integers, u0 v0 u1 v1 and so on, rounded to nearest. Lanes outside
+ * [-1, 1] saturate.
+ */
+inline void store_snorm16(short* p, real_t u, real_t v)
+{
+    p[0] = snorm16(u);
+    p[1] = snorm16(v);
+}
+
+#if VEC_SSE
+
+inline void store_snorm16(short* p, const Floatx4& u, const Floatx4& v)
+{
+    const __m128 scale = _mm_set1_ps(32767);
+    const __m128i iu = _mm_cvtps_epi32(_mm_mul_ps(u.v, scale));
+    const __m128i iv = _mm_cvtps_epi32(_mm_mul_ps(v.v, scale));
+
+    // packing saturates to [-32768, 32767], which only -1 exceeds
+    const __m128i lo = _mm_unpacklo_epi32(iu, iv);
+    const __m128i hi = _mm_unpackhi_epi32(iu, iv);
+    const __m128i packed = _mm_max_epi16(_mm_packs_epi32(lo, hi), _mm_set1_epi16(-32767));
+    _mm_storeu_si128((__m128i*)p, packed);
+}
+
+#else
+
+inline void store_snorm16(short* p, const Floatx4& u, const Floatx4& v)
+{
+    for (int i = 0; i < 4; ++i)
+        store_snorm16(p + 2*i, u.v[i], v.v[i]);
+}
+
+#endif /* VEC_SSE */
+
+#if VEC_AVX
+
+inline void store_snorm16(short* p, const Floatx8& u, const Floatx8& v)
+{
+    store_snorm16(p, Floatx4(_mm256_castps256_ps128(u.v)), Floatx4(_mm256_castps256_ps128(v.v)));
+    store_snorm16(p + 8, Floatx4(_mm256_extractf128_ps(u.v, 1)), Floatx4(_mm256_extractf128_ps(v.v, 1)));
+}
+
+#else
+
+inline void store_snorm16(short* p, const Floatx8& u, const Floatx8& v)
+{
+    store_snorm16(p, u.lo, v.lo);
+    store_snorm16(p + 8, u.hi, v.hi);
+}
+
+#endif /* VEC_AVX */
+
+} /* namespace fastmath */
+
+using fastmath::octahedral_encode;
+using fastmath::octahedral_decode;
+using fastmath::store_snorm16;
+
+} /* namespace VEC_ISA */
+
+#endif /* _VEC_OCTAHEDRAL_H_ */
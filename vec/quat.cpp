@@ -193,3 +193,31 @@ std::ostream& operator <<( std::ostream& o, const Quat& q )
     o << "Quat(" << q.w << ", " << q.x << ", " << q.y << ", " << q.z << ")";
     return o;
 }
+
+Quat nlerp(const Quat& a, const Quat& b, real_t t)
+{
+    // q and -q are the same rotation; blend towards the one nearer a
+    const real_t wa = 1 - t;
+    const real_t wb = a.dot(b) < 0 ? -t : t;
+
+    Quat q(wa*a.w + wb*b.w, wa*a.x + wb*b.x, wa*a.y + wb*b.y, wa*a.z + wb*b.z);
+    return q.normalize();
+}
+
+Quat slerp(const Quat& a, const Quat& b, real_t t)
+{
+    real_t cosine = a.dot(b);
+    const real_t sign = cosine < 0 ? -1 : 1;
+    cosine *= sign;
+
+    // sin(angle) is too small to divide by, but nlerp is as accurate here
+    if (cosine > 0.9995)
+        return nlerp(a, b, t);
+
+    const real_t angle = acos(cosine);
+    const real_t sine = sin(angle);
+    const real_t wa = sin((1 - t) * angle) / sine;
+    const real_t wb = sign * sin(t * angle) / sine;
+
+    return Quat(wa*a.w + wb*b.w, wa*a.x + wb*b.x, wa*a.y + wb*b.y, wa*a.z + wb*b.z);
+}
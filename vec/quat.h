@@ -76,6 +76,11 @@ public:
         return !operator==(rhs);
     }
 
+    real_t dot(const Quat& rhs) const
+    {
+        return w*rhs.w + x*rhs.x + y*rhs.y + z*rhs.z;
+    }
+
     real_t norm() const
     {
         return x*x + y*y + z*z + w*w;
@@ -117,6 +122,19 @@ public:
 
 std::ostream& operator <<( std::ostream& o, const Quat& q );
 
+/**
+ * Interpolates between two rotations the shorter way around, by blending the
+ * quaternions linearly and normalizing. Cheap, but the rotation is fastest
+ * halfway between them rather than constant.
+ */
+Quat nlerp(const Quat& a, const Quat& b, real_t t);
+
+/**
+ * Interpolates between two unit quaternions the shorter way around, at a
+ * constant angular speed.
+ */
+Quat slerp(const Quat& a, const Quat& b, real_t t);
+
 inline Vec3 operator*(const Vec3& v, const Quat& q)
 {
     return q * v;
@@ -0,0 +1,139 @@
+/**
+ * @file simd.h
+ * @brief Helpers shared by the SSE code paths of the math classes.
+ *
+ * Only for use in the vec/ translation units and wide.h; nothing here is
+ * part of the interface of the math classes.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _VEC_SIMD_H_
+#define _VEC_SIMD_H_
+
+#include "462math.h"
+
+/* SSE paths for float math, which also use the integer instructions of SSE2.
+   Both are always available on x86-64. */
+#if !REAL_IS_DOUBLE && (defined(__SSE2__) || defined(_M_X64) || \
+                        (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define VEC_SSE 1
+#else
+#define VEC_SSE 0
+#endif
+
+/* AVX2 and FMA, when the compiler targets them, or in the translation units
+   which build the SIMD_AVX2 kernels, which define VEC_TARGET_AVX2 */
+#if VEC_SSE && (defined(VEC_TARGET_AVX2) || (defined(__AVX2__) && defined(__FMA__)))
+#define VEC_AVX2 1
+#else
+#define VEC_AVX2 0
+#endif
+
+/* 8-wide paths for the wide types */
+#if VEC_SSE && (VEC_AVX2 || defined(__AVX__))
+#define VEC_AVX 1
+#else
+#define VEC_AVX 0
+#endif
+
+/* fused multiply-adds */
+#if VEC_SSE && (VEC_AVX2 || defined(__FMA__))
+#define VEC_FMA 1
+#else
+#define VEC_FMA 0
+#endif
+
+#if VEC_AVX || VEC_FMA
+#include <immintrin.h>
+#elif VEC_SSE
+#include <emmintrin.h>
+#endif
+
+/* The namespace of the code which differs between instruction sets, so that
+   the copies built for each tier do not clash */
+#if VEC_AVX2
+#define VEC_ISA simd_avx2
+#elif VEC_AVX
+#define VEC_ISA simd_avx
+#elif VEC_SSE
+#define VEC_ISA simd_sse
+#else
+#define VEC_ISA simd_scalar
+#endif
+
+/*
+ * The t for which nlerp() best matches slerp(), given the absolute cosine d
+ * of the angle between the rotations (Kapoulkine, "Approximating slerp",
+ * 2015). For real_t and the wide types alike.
+ */
+template<typename F>
+static inline F slerp_fast_t(const F& t, const F& d)
+{
+    const F a = F(1.0904f) + d * (F(-3.2452f) + d * (F(3.55645f) - d * F(1.43519f)));
+    const F b = F(0.848013f) + d * (F(-1.06021f) + d * F(0.215638f));
+    const F u = t - F(0.5f);
+    const F k = a * u * u + b;
+    return t + t * u * (t - F(1)) * k;
+}
+
+#if VEC_SSE
+
+#define VEC_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps((a), (b), _MM_SHUFFLE((w), (z), (y), (x)))
+#define VEC_SWIZZLE(a, x, y, z, w) VEC_SHUFFLE((a), (a), (x), (y), (z), (w))
+
+/* a*b + c, fused when the compiler targets FMA */
+static inline __m128 vec_madd(__m128 a, __m128 b, __m128 c)
+{
+#if VEC_FMA
+    return _mm_fmadd_ps(a, b, c);
+#else
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+
+/* four Vec3s, stored xyzx yzxy zxyz, to one register per coordinate */
+static inline void load_vec3x4(const real_t* p, __m128& x, __m128& y, __m128& z)
+{
+    const __m128 a = _mm_loadu_ps(p);
+    const __m128 b = _mm_loadu_ps(p+4);
+    const __m128 c = _mm_loadu_ps(p+8);
+
+    const __m128 xy23 = VEC_SHUFFLE(b, c, 2,3,1,2);
+    const __m128 yz01 = VEC_SHUFFLE(a, b, 1,2,0,1);
+
+    x = VEC_SHUFFLE(a, xy23, 0,3,0,2);
+    y = VEC_SHUFFLE(yz01, xy23, 0,2,1,3);
+    z = VEC_SHUFFLE(yz01, VEC_SWIZZLE(c, 0,3,0,3), 1,3,0,1);
+}
+
+/* the reverse of load_vec3x4 */
+static inline void store_vec3x4(real_t* p, __m128 x, __m128 y, __m128 z)
+{
+    const __m128 xy01 = _mm_unpacklo_ps(x, y);
+    const __m128 xy23 = _mm_unpackhi_ps(x, y);
+
+    _mm_storeu_ps(p,   VEC_SHUFFLE(xy01, VEC_SHUFFLE(z, x, 0,0,1,1), 0,1,0,2));
+    _mm_storeu_ps(p+4, VEC_SHUFFLE(VEC_SHUFFLE(y, z, 1,1,1,1), xy23, 0,2,0,1));
+    _mm_storeu_ps(p+8, VEC_SHUFFLE(VEC_SHUFFLE(z, x, 2,2,3,3), VEC_SHUFFLE(y, z, 3,3,3,3), 0,2,0,2));
+}
+
+/* four Vec2s, stored xyxy xyxy, to one register per coordinate */
+static inline void load_vec2x4(const real_t* p, __m128& x, __m128& y)
+{
+    const __m128 a = _mm_loadu_ps(p);
+    const __m128 b = _mm_loadu_ps(p+4);
+    x = VEC_SHUFFLE(a, b, 0,2,0,2);
+    y = VEC_SHUFFLE(a, b, 1,3,1,3);
+}
+
+/* the reverse of load_vec2x4 */
+static inline void store_vec2x4(real_t* p, __m128 x, __m128 y)
+{
+    _mm_storeu_ps(p,   _mm_unpacklo_ps(x, y));
+    _mm_storeu_ps(p+4, _mm_unpackhi_ps(x, y));
+}
+
+#endif /* VEC_SSE */
+
+#endif /* _VEC_SIMD_H_ */
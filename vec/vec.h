@@ -32,6 +32,12 @@ struct ivec2 {
 		this->y = v.y;
 	}
 
+	ivec2& operator=(const ivec2 &v) {
+		this->x = v.x;
+		this->y = v.y;
+		return *this;
+	}
+
 	int x,y;
 };
 
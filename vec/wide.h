@@ -0,0 +1,1154 @@
+/**
+ * @file wide.h
+ * @brief Wide vector types, which hold one value per SIMD lane.
+ *
+ * Floatx4 and Floatx8 are four and eight real_ts operated on together. Vec2x4,
+ * Vec2x8, Vec3x4, Vec3x8, Quatx4 and Quatx8 store vectors and quaternions in
+ * structure-of-arrays form, one wide value per component, with the same
+ * operators as Vec2, Vec3 and Quat. A kernel written with them processes
+ * four or eight values per operation, and compiles to SSE, to AVX when the
+ * compiler targets it or in the SIMD_AVX2 kernels (see cpu.h), or to plain
+ * loops.
+ *
+ * Comparisons give masks with one boolean per lane, which select between
+ * two values lane by lane instead of branching:
+ *
+ *     const Maskx8 inside = p.dot(normal) >= d;
+ *     n = select(inside, n, -n);
+ *
+ * All loads and stores are unaligned. Each lane rounds as the same scalar
+ * expression does, so the results match scalar code exactly, unless the
+ * compiler fuses multiply-adds in one and not the other.
+ *
+ * @author Andrew Fox (arfox)
+ */
+
+#ifndef _VEC_WIDE_H_
+#define _VEC_WIDE_H_
+
+#include "462math.h"
+#include "vec.h"
+#include "quat.h"
+#include "simd.h"
+#include <cstddef>
+
+// one copy of the types per instruction set; see VEC_ISA
+namespace VEC_ISA {
+
+/* apply expr to every lane i of the scalar fallbacks */
+#define VEC_WIDE_LANES(expr) for (int i = 0; i < 4; ++i) { expr; }
+
+/**
+ * A boolean per lane of a Floatx4.
+ */
+class Maskx4
+{
+public:
+#if VEC_SSE
+    __m128 v; // each lane all ones or all zeros
+
+    explicit Maskx4(__m128 v) : v(v) {}
+#else
+    bool v[4];
+#endif
+
+    /**
+     * Default constructor. Leaves values unitialized.
+     */
+    Maskx4() {}
+
+    /**
+     * Sets every lane to b.
+     */
+    explicit Maskx4(bool b)
+    {
+#if VEC_SSE
+        const __m128 zero = _mm_setzero_ps();
+        v = b ? _mm_cmpeq_ps(zero, zero) : zero;
+#else
+        VEC_WIDE_LANES(v[i] = b)
+#endif
+    }
+
+    /**
+     * Returns the lanes as bits, lane 0 in the lowest bit.
+     */
+    int bits() const
+    {
+#if VEC_SSE
+        return _mm_movemask_ps(v);
+#else
+        return v[0] | v[1] << 1 | v[2] << 2 | v[3] << 3;
+#endif
+    }
+
+    bool any() const { return bits() != 0; }
+    bool all() const { return bits() == 0xf; }
+
+    bool operator[](int i) const
+    {
+        assert(i >= 0 && i < 4);
+        return (bits() >> i) & 1;
+    }
+};
+
+inline Maskx4 operator&(const Maskx4& a, const Maskx4& b)
+{
+#if VEC_SSE
+    return Maskx4(_mm_and_ps(a.v, b.v));
+#else
+    Maskx4 r; VEC_WIDE_LANES(r.v[i] = a.v[i] && b.v[i]) return r;
+#endif
+}
+
+inline Maskx4 operator|(const Maskx4& a, const Maskx4& b)
+{
+#if VEC_SSE
+    return Maskx4(_mm_or_ps(a.v, b.v));
+#else
+    Maskx4 r; VEC_WIDE_LANES(r.v[i] = a.v[i] || b.v[i]) return r;
+#endif
+}
+
+inline Maskx4 operator^(const Maskx4& a, const Maskx4& b)
+{
+#if VEC_SSE
+    return Maskx4(_mm_xor_ps(a.v, b.v));
+#else
+    Maskx4 r; VEC_WIDE_LANES(r.v[i] = a.v[i] != b.v[i]) return r;
+#endif
+}
+
+inline Maskx4 operator!(const Maskx4& a)
+{
+    return a ^ Maskx4(true);
+}
+
+inline Maskx4& operator&=(Maskx4& a, const Maskx4& b) { return a = a & b; }
+inline Maskx4& operator|=(Maskx4& a, const Maskx4& b) { return a = a | b; }
+
+/**
+ * Four real_ts.
+ */
+class Floatx4
+{
+public:
+    typedef Maskx4 Mask;
+
+    static const int WIDTH = 4;
+
+#if VEC_SSE
+    __m128 v;
+
+    explicit Floatx4(__m128 v) : v(v) {}
+#else
+    real_t v[4];
+#endif
+
+    /**
+     * Default constructor. Leaves values unitialized.
+     */
+    Floatx4() {}
+
+    /**
+     * Sets every lane to s.
+     */
+    Floatx4(real_t s)
+    {
+#if VEC_SSE
+        v = _mm_set1_ps(s);
+#else
+        VEC_WIDE_LANES(v[i] = s)
+#endif
+    }
+
+    Floatx4(real_t s0, real_t s1, real_t s2, real_t s3)
+    {
+#if VEC_SSE
+        v = _mm_setr_ps(s0, s1, s2, s3);
+#else
+        v[0] = s0; v[1] = s1; v[2] = s2; v[3] = s3;
+#endif
+    }
+
+    /**
+     * Loads four consecutive values.
+     */
+    static Floatx4 load(const real_t* p)
+    {
+#if VEC_SSE
+        return Floatx4(_mm_loadu_ps(p));
+#else
+        Floatx4 r; VEC_WIDE_LANES(r.v[i] = p[i]) return r;
+#endif
+    }
+
+    /**
+     * Stores the lanes to four consecutive values.
+     */
+    void store(real_t* p) const
+    {
+#if VEC_SSE
+        _mm_storeu_ps(p, v);
+#else
+        VEC_WIDE_LANES(p[i] = v[i])
+#endif
+    }
+
+    /**
+     * Returns one lane. Slow; for tails and debugging.
+     */
+    real_t operator[](int i) const
+    {
+        assert(i >= 0 && i < WIDTH);
+        real_t lanes[WIDTH];
+        store(lanes);
+        return lanes[i];
+    }
+};
+
+#if VEC_SSE
+
+#define VEC_WIDE_BINARY(op, intrinsic) \
+    inline Floatx4 operator op(const Floatx4& a, const Floatx4& b) \
+    { return Floatx4(intrinsic(a.v, b.v)); }
+#define VEC_WIDE_COMPARE(op, intrinsic) \
+    inline Maskx4 operator op(const Floatx4& a, const Floatx4& b) \
+    { return Maskx4(intrinsic(a.v, b.v)); }
+
+VEC_WIDE_BINARY(+, _mm_add_ps)
+VEC_WIDE_BINARY(-, _mm_sub_ps)
+VEC_WIDE_BINARY(*, _mm_mul_ps)
+VEC_WIDE_BINARY(/, _mm_div_ps)
+VEC_WIDE_COMPARE(<,  _mm_cmplt_ps)
+VEC_WIDE_COMPARE(<=, _mm_cmple_ps)
+VEC_WIDE_COMPARE(>,  _mm_cmpgt_ps)
+VEC_WIDE_COMPARE(>=, _mm_cmpge_ps)
+VEC_WIDE_COMPARE(==, _mm_cmpeq_ps)
+VEC_WIDE_COMPARE(!=, _mm_cmpneq_ps)
+
+inline Floatx4 operator-(const Floatx4& a)
+{
+    return Floatx4(_mm_xor_ps(a.v, _mm_set1_ps(-0.0f)));
+}
+
+inline Floatx4 min(const Floatx4& a, const Floatx4& b) { return Floatx4(_mm_min_ps(a.v, b.v)); }
+inline Floatx4 max(const Floatx4& a, const Floatx4& b) { return Floatx4(_mm_max_ps(a.v, b.v)); }
+inline Floatx4 sqrt(const Floatx4& a) { return Floatx4(_mm_sqrt_ps(a.v)); }
+inline Floatx4 abs(const Floatx4& a) { return Floatx4(_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)); }
+
+/**
+ * Returns a where m is set and b elsewhere.
+ */
+inline Floatx4 select(const Maskx4& m, const Floatx4& a, const Floatx4& b)
+{
+    return Floatx4(_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)));
+}
+
+#else
+
+#define VEC_WIDE_BINARY(op, intrinsic) \
+    inline Floatx4 operator op(const Floatx4& a, const Floatx4& b) \
+    { Floatx4 r; VEC_WIDE_LANES(r.v[i] = a.v[i] op b.v[i]) return r; }
+#define VEC_WIDE_COMPARE(op, intrinsic) \
+    inline Maskx4 operator op(const Floatx4& a, const Floatx4& b) \
+    { Maskx4 r; VEC_WIDE_LANES(r.v[i] = a.v[i] op b.v[i]) return r; }
+
+VEC_WIDE_BINARY(+, _)
+VEC_WIDE_BINARY(-, _)
+VEC_WIDE_BINARY(*, _)
+VEC_WIDE_BINARY(/, _)
+VEC_WIDE_COMPARE(<,  _)
+VEC_WIDE_COMPARE(<=, _)
+VEC_WIDE_COMPARE(>,  _)
+VEC_WIDE_COMPARE(>=, _)
+VEC_WIDE_COMPARE(==, _)
+VEC_WIDE_COMPARE(!=, _)
+
+inline Floatx4 operator-(const Floatx4& a)
+{
+    Floatx4 r; VEC_WIDE_LANES(r.v[i] = -a.v[i]) return r;
+}
+
+/* as the SSE instructions: b unless a is the lesser or greater */
+inline Floatx4 min(const Floatx4& a, const Floatx4& b)
+{
+    Floatx4 r; VEC_WIDE_LANES(r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]) return r;
+}
+
+inline Floatx4 max(const Floatx4& a, const Floatx4& b)
+{
+    Floatx4 r; VEC_WIDE_LANES(r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]) return r;
+}
+
+inline Floatx4 sqrt(const Floatx4& a)
+{
+    Floatx4 r; VEC_WIDE_LANES(r.v[i] = ::sqrt(a.v[i])) return r;
+}
+
+inline Floatx4 abs(const Floatx4& a)
+{
+    Floatx4 r; VEC_WIDE_LANES(r.v[i] = fabs(a.v[i])) return r;
+}
+
+/**
+ * Returns a where m is set and b elsewhere.
+ */
+inline Floatx4 select(const Maskx4& m, const Floatx4& a, const Floatx4& b)
+{
+    Floatx4 r; VEC_WIDE_LANES(r.v[i] = m.v[i] ? a.v[i] : b.v[i]) return r;
+}
+
+#endif /* VEC_SSE */
+
+#undef VEC_WIDE_BINARY
+#undef VEC_WIDE_COMPARE
+
+/**
+ * A boolean per lane of a Floatx8.
+ */
+class Maskx8
+{
+public:
+#if VEC_AVX
+    __m256 v; // each lane all ones or all zeros
+
+    explicit Maskx8(__m256 v) : v(v) {}
+#else
+    Maskx4 lo, hi; // lanes 0-3 and 4-7
+
+    Maskx8(const Maskx4& lo, const Maskx4& hi) : lo(lo), hi(hi) {}
+#endif
+
+    /**
+     * Default constructor. Leaves values unitialized.
+     */
+    Maskx8() {}
+
+    /**
+     * Sets every lane to b.
+     */
+    explicit Maskx8(bool b)
+#if VEC_AVX
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        v = b ? _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ) : zero;
+    }
+#else
+        : lo(b), hi(b) {}
+#endif
+
+    /**
+     * Returns the lanes as bits, lane 0 in the lowest bit.
+     */
+    int bits() const
+    {
+#if VEC_AVX
+        return _mm256_movemask_ps(v);
+#else
+        return lo.bits() | hi.bits() << 4;
+#endif
+    }
+
+    bool any() const { return bits() != 0; }
+    bool all() const { return bits() == 0xff; }
+
+    bool operator[](int i) const
+    {
+        assert(i >= 0 && i < 8);
+        return (bits() >> i) & 1;
+    }
+};
+
+#if VEC_AVX
+inline Maskx8 operator&(const Maskx8& a, const Maskx8& b) { return Maskx8(_mm256_and_ps(a.v, b.v)); }
+inline Maskx8 operator|(const Maskx8& a, const Maskx8& b) { return Maskx8(_mm256_or_ps(a.v, b.v)); }
+inline Maskx8 operator^(const Maskx8& a, const Maskx8& b) { return Maskx8(_mm256_xor_ps(a.v, b.v)); }
+#else
+inline Maskx8 operator&(const Maskx8& a, const Maskx8& b) { return Maskx8(a.lo & b.lo, a.hi & b.hi); }
+inline Maskx8 operator|(const Maskx8& a, const Maskx8& b) { return Maskx8(a.lo | b.lo, a.hi | b.hi); }
+inline Maskx8 operator^(const Maskx8& a, const Maskx8& b) { return Maskx8(a.lo ^ b.lo, a.hi ^ b.hi); }
+#endif
+
+inline Maskx8 operator!(const Maskx8& a)
+{
+    return a ^ Maskx8(true);
+}
+
+inline Maskx8& operator&=(Maskx8& a, const Maskx8& b) { return a = a & b; }
+inline Maskx8& operator|=(Maskx8& a, const Maskx8& b) { return a = a | b; }
+
+/**
+ * Eight real_ts. One AVX register when the compiler targets AVX, otherwise
+ * two Floatx4s.
+ */
+class Floatx8
+{
+public:
+    typedef Maskx8 Mask;
+
+    static const int WIDTH = 8;
+
+#if VEC_AVX
+    __m256 v;
+
+    explicit Floatx8(__m256 v) : v(v) {}
+#else
+    Floatx4 lo, hi; // lanes 0-3 and 4-7
+
+    Floatx8(const Floatx4& lo, const Floatx4& hi) : lo(lo), hi(hi) {}
+#endif
+
+    /**
+     * Default constructor. Leaves values unitialized.
+     */
+    Floatx8() {}
+
+    /**
+     * Sets every lane to s.
+     */
+    Floatx8(real_t s)
+#if VEC_AVX
+        : v(_mm256_set1_ps(s)) {}
+#else
+        : lo(s), hi(s) {}
+#endif
+
+    Floatx8(real_t s0, real_t s1, real_t s2, real_t s3,
+            real_t s4, real_t s5, real_t s6, real_t s7)
+#if VEC_AVX
+        : v(_mm256_setr_ps(s0, s1, s2, s3, s4, s5, s6, s7)) {}
+#else
+        : lo(s0, s1, s2, s3), hi(s4, s5, s6, s7) {}
+#endif
+
+    /**
+     * Loads eight consecutive values.
+     */
+    static Floatx8 load(const real_t* p)
+    {
+#if VEC_AVX
+        return Floatx8(_mm256_loadu_ps(p));
+#else
+        return Floatx8(Floatx4::load(p), Floatx4::load(p+4));
+#endif
+    }
+
+    /**
+     * Stores the lanes to eight consecutive values.
+     */
+    void store(real_t* p) const
+    {
+#if VEC_AVX
+        _mm256_storeu_ps(p, v);
+#else
+        lo.store(p);
+        hi.store(p+4);
+#endif
+    }
+
+    /**
+     * Returns one lane. Slow; for tails and debugging.
+     */
+    real_t operator[](int i) const
+    {
+        assert(i >= 0 && i < WIDTH);
+        real_t lanes[WIDTH];
+        store(lanes);
+        return lanes[i];
+    }
+};
+
+#if VEC_AVX
+
+#define VEC_WIDE_BINARY(op, intrinsic) \
+    inline Floatx8 operator op(const Floatx8& a, const Floatx8& b) \
+    { return Floatx8(intrinsic(a.v, b.v)); }
+#define VEC_WIDE_COMPARE(op, predicate) \
+    inline Maskx8 operator op(const Floatx8& a, const Floatx8& b) \
+    { return Maskx8(_mm256_cmp_ps(a.v, b.v, predicate)); }
+
+VEC_WIDE_BINARY(+, _mm256_add_ps)
+VEC_WIDE_BINARY(-, _mm256_sub_ps)
+VEC_WIDE_BINARY(*, _mm256_mul_ps)
+VEC_WIDE_BINARY(/, _mm256_div_ps)
+VEC_WIDE_COMPARE(<,  _CMP_LT_OS)
+VEC_WIDE_COMPARE(<=, _CMP_LE_OS)
+VEC_WIDE_COMPARE(>,  _CMP_GT_OS)
+VEC_WIDE_COMPARE(>=, _CMP_GE_OS)
+VEC_WIDE_COMPARE(==, _CMP_EQ_OQ)
+VEC_WIDE_COMPARE(!=, _CMP_NEQ_UQ)
+
+inline Floatx8 operator-(const Floatx8& a)
+{
+    return Floatx8(_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)));
+}
+
+inline Floatx8 min(const Floatx8& a, const Floatx8& b) { return Floatx8(_mm256_min_ps(a.v, b.v)); }
+inline Floatx8 max(const Floatx8& a, const Floatx8& b) { return Floatx8(_mm256_max_ps(a.v, b.v)); }
+inline Floatx8 sqrt(const Floatx8& a) { return Floatx8(_mm256_sqrt_ps(a.v)); }
+inline Floatx8 abs(const Floatx8& a) { return Floatx8(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)); }
+
+/**
+ * Returns a where m is set and b elsewhere.
+ */
+inline Floatx8 select(const Maskx8& m, const Floatx8& a, const Floatx8& b)
+{
+    return Floatx8(_mm256_blendv_ps(b.v, a.v, m.v));
+}
+
+#else
+
+#define VEC_WIDE_BINARY(op, intrinsic) \
+    inline Floatx8 operator op(const Floatx8& a, const Floatx8& b) \
+    { return Floatx8(a.lo op b.lo, a.hi op b.hi); }
+#define VEC_WIDE_COMPARE(op, predicate) \
+    inline Maskx8 operator op(const Floatx8& a, const Floatx8& b) \
+    { return Maskx8(a.lo op b.lo, a.hi op b.hi); }
+
+VEC_WIDE_BINARY(+, _)
+VEC_WIDE_BINARY(-, _)
+VEC_WIDE_BINARY(*, _)
+VEC_WIDE_BINARY(/, _)
+VEC_WIDE_COMPARE(<,  _)
+VEC_WIDE_COMPARE(<=, _)
+VEC_WIDE_COMPARE(>,  _)
+VEC_WIDE_COMPARE(>=, _)
+VEC_WIDE_COMPARE(==, _)
+VEC_WIDE_COMPARE(!=, _)
+
+inline Floatx8 operator-(const Floatx8& a) { return Floatx8(-a.lo, -a.hi); }
+
+inline Floatx8 min(const Floatx8& a, const Floatx8& b) { return Floatx8(min(a.lo, b.lo), min(a.hi, b.hi)); }
+inline Floatx8 max(const Floatx8& a, const Floatx8& b) { return Floatx8(max(a.lo, b.lo), max(a.hi, b.hi)); }
+inline Floatx8 sqrt(const Floatx8& a) { return Floatx8(sqrt(a.lo), sqrt(a.hi)); }
+inline Floatx8 abs(const Floatx8& a) { return Floatx8(abs(a.lo), abs(a.hi)); }
+
+/**
+ * Returns a where m is set and b elsewhere.
+ */
+inline Floatx8 select(const Maskx8& m, const Floatx8& a, const Floatx8& b)
+{
+    return Floatx8(select(m.lo, a.lo, b.lo), select(m.hi, a.hi, b.hi));
+}
+
+#endif /* VEC_AVX */
+
+#undef VEC_WIDE_BINARY
+#undef VEC_WIDE_COMPARE
+
+#define VEC_WIDE_ASSIGN(F) \
+    inline F& operator+=(F& a, const F& b) { return a = a + b; } \
+    inline F& operator-=(F& a, const F& b) { return a = a - b; } \
+    inline F& operator*=(F& a, const F& b) { return a = a * b; } \
+    inline F& operator/=(F& a, const F& b) { return a = a / b; }
+
+VEC_WIDE_ASSIGN(Floatx4)
+VEC_WIDE_ASSIGN(Floatx8)
+
+#undef VEC_WIDE_ASSIGN
+
+/* interleaved Vec2s and Vec3s to and from one wide value per coordinate */
+
+inline void load_interleaved(const real_t* p, Floatx4& x, Floatx4& y)
+{
+#if VEC_SSE
+    load_vec2x4(p, x.v, y.v);
+#else
+    VEC_WIDE_LANES(x.v[i] = p[2*i]; y.v[i] = p[2*i+1])
+#endif
+}
+
+inline void store_interleaved(real_t* p, const Floatx4& x, const Floatx4& y)
+{
+#if VEC_SSE
+    store_vec2x4(p, x.v, y.v);
+#else
+    VEC_WIDE_LANES(p[2*i] = x.v[i]; p[2*i+1] = y.v[i])
+#endif
+}
+
+inline void load_interleaved(const real_t* p, Floatx4& x, Floatx4& y, Floatx4& z)
+{
+#if VEC_SSE
+    load_vec3x4(p, x.v, y.v, z.v);
+#else
+    VEC_WIDE_LANES(x.v[i] = p[3*i]; y.v[i] = p[3*i+1]; z.v[i] = p[3*i+2])
+#endif
+}
+
+inline void store_interleaved(real_t* p, const Floatx4& x, const Floatx4& y, const Floatx4& z)
+{
+#if VEC_SSE
+    store_vec3x4(p, x.v, y.v, z.v);
+#else
+    VEC_WIDE_LANES(p[3*i] = x.v[i]; p[3*i+1] = y.v[i]; p[3*i+2] = z.v[i])
+#endif
+}
+
+inline void load_interleaved(const real_t* p, Floatx4& x, Floatx4& y, Floatx4& z, Floatx4& w)
+{
+#if VEC_SSE
+    x.v = _mm_loadu_ps(p);
+    y.v = _mm_loadu_ps(p+4);
+    z.v = _mm_loadu_ps(p+8);
+    w.v = _mm_loadu_ps(p+12);
+    _MM_TRANSPOSE4_PS(x.v, y.v, z.v, w.v);
+#else
+    VEC_WIDE_LANES(x.v[i] = p[4*i]; y.v[i] = p[4*i+1]; z.v[i] = p[4*i+2]; w.v[i] = p[4*i+3])
+#endif
+}
+
+inline void store_interleaved(real_t* p, const Floatx4& x, const Floatx4& y, const Floatx4& z, const Floatx4& w)
+{
+#if VEC_SSE
+    __m128 a = x.v, b = y.v, c = z.v, d = w.v;
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+    _mm_storeu_ps(p,    a);
+    _mm_storeu_ps(p+4,  b);
+    _mm_storeu_ps(p+8,  c);
+    _mm_storeu_ps(p+12, d);
+#else
+    VEC_WIDE_LANES(p[4*i] = x.v[i]; p[4*i+1] = y.v[i]; p[4*i+2] = z.v[i]; p[4*i+3] = w.v[i])
+#endif
+}
+
+/* lanes 0, 2, 4 and 6 and lanes 1, 3, 5 and 7 of a followed by b */
+inline void deinterleave(const Floatx4& a, const Floatx4& b, Floatx4& even, Floatx4& odd)
+{
+#if VEC_SSE
+    even.v = VEC_SHUFFLE(a.v, b.v, 0,2,0,2);
+    odd.v = VEC_SHUFFLE(a.v, b.v, 1,3,1,3);
+#else
+    const Floatx4 c = a, d = b; // a or b may be even or odd
+    even.v[0] = c.v[0]; even.v[1] = c.v[2]; even.v[2] = d.v[0]; even.v[3] = d.v[2];
+    odd.v[0] = c.v[1]; odd.v[1] = c.v[3]; odd.v[2] = d.v[1]; odd.v[3] = d.v[3];
+#endif
+}
+
+#if VEC_AVX
+
+/* two halves to one AVX register, and back */
+static inline __m256 wide_combine(__m128 lo, __m128 hi)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+
+static inline __m128 wide_lo(__m256 v) { return _mm256_castps256_ps128(v); }
+static inline __m128 wide_hi(__m256 v) { return _mm256_extractf128_ps(v, 1); }
+
+inline void load_interleaved(const real_t* p, Floatx8& x, Floatx8& y)
+{
+    __m128 x0, y0, x1, y1;
+    load_vec2x4(p, x0, y0);
+    load_vec2x4(p+8, x1, y1);
+    x.v = wide_combine(x0, x1);
+    y.v = wide_combine(y0, y1);
+}
+
+inline void store_interleaved(real_t* p, const Floatx8& x, const Floatx8& y)
+{
+    store_vec2x4(p, wide_lo(x.v), wide_lo(y.v));
+    store_vec2x4(p+8, wide_hi(x.v), wide_hi(y.v));
+}
+
+inline void load_interleaved(const real_t* p, Floatx8& x, Floatx8& y, Floatx8& z)
+{
+    __m128 x0, y0, z0, x1, y1, z1;
+    load_vec3x4(p, x0, y0, z0);
+    load_vec3x4(p+12, x1, y1, z1);
+    x.v = wide_combine(x0, x1);
+    y.v = wide_combine(y0, y1);
+    z.v = wide_combine(z0, z1);
+}
+
+inline void store_interleaved(real_t* p, const Floatx8& x, const Floatx8& y, const Floatx8& z)
+{
+    store_vec3x4(p, wide_lo(x.v), wide_lo(y.v), wide_lo(z.v));
+    store_vec3x4(p+12, wide_hi(x.v), wide_hi(y.v), wide_hi(z.v));
+}
+
+inline void load_interleaved(const real_t* p, Floatx8& x, Floatx8& y, Floatx8& z, Floatx8& w)
+{
+    Floatx4 x0, y0, z0, w0, x1, y1, z1, w1;
+    load_interleaved(p, x0, y0, z0, w0);
+    load_interleaved(p+16, x1, y1, z1, w1);
+    x.v = wide_combine(x0.v, x1.v);
+    y.v = wide_combine(y0.v, y1.v);
+    z.v = wide_combine(z0.v, z1.v);
+    w.v = wide_combine(w0.v, w1.v);
+}
+
+inline void store_interleaved(real_t* p, const Floatx8& x, const Floatx8& y, const Floatx8& z, const Floatx8& w)
+{
+    store_interleaved(p, Floatx4(wide_lo(x.v)), Floatx4(wide_lo(y.v)),
+                      Floatx4(wide_lo(z.v)), Floatx4(wide_lo(w.v)));
+    store_interleaved(p+16, Floatx4(wide_hi(x.v)), Floatx4(wide_hi(y.v)),
+                      Floatx4(wide_hi(z.v)), Floatx4(wide_hi(w.v)));
+}
+
+inline void deinterleave(const Floatx8& a, const Floatx8& b, Floatx8& even, Floatx8& odd)
+{
+    const __m256 lo = _mm256_permute2f128_ps(a.v, b.v, 0x20); // a0-3 b0-3
+    const __m256 hi = _mm256_permute2f128_ps(a.v, b.v, 0x31); // a4-7 b4-7
+    even.v = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2,0,2,0));
+    odd.v = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3,1,3,1));
+}
+
+#else
+
+inline void load_interleaved(const real_t* p, Floatx8& x, Floatx8& y)
+{
+    load_interleaved(p, x.lo, y.lo);
+    load_interleaved(p+8, x.hi, y.hi);
+}
+
+inline void store_interleaved(real_t* p, const Floatx8& x, const Floatx8& y)
+{
+    store_interleaved(p, x.lo, y.lo);
+    store_interleaved(p+8, x.hi, y.hi);
+}
+
+inline void load_interleaved(const real_t* p, Floatx8& x, Floatx8& y, Floatx8& z)
+{
+    load_interleaved(p, x.lo, y.lo, z.lo);
+    load_interleaved(p+12, x.hi, y.hi, z.hi);
+}
+
+inline void store_interleaved(real_t* p, const Floatx8& x, const Floatx8& y, const Floatx8& z)
+{
+    store_interleaved(p, x.lo, y.lo, z.lo);
+    store_interleaved(p+12, x.hi, y.hi, z.hi);
+}
+
+inline void load_interleaved(const real_t* p, Floatx8& x, Floatx8& y, Floatx8& z, Floatx8& w)
+{
+    load_interleaved(p, x.lo, y.lo, z.lo, w.lo);
+    load_interleaved(p+16, x.hi, y.hi, z.hi, w.hi);
+}
+
+inline void store_interleaved(real_t* p, const Floatx8& x, const Floatx8& y, const Floatx8& z, const Floatx8& w)
+{
+    store_interleaved(p, x.lo, y.lo, z.lo, w.lo);
+    store_interleaved(p+16, x.hi, y.hi, z.hi, w.hi);
+}
+
+inline void deinterleave(const Floatx8& a, const Floatx8& b, Floatx8& even, Floatx8& odd)
+{
+    const Floatx8 c = a, d = b; // a or b may be even or odd
+    deinterleave(c.lo, c.hi, even.lo, odd.lo);
+    deinterleave(d.lo, d.hi, even.hi, odd.hi);
+}
+
+#endif /* VEC_AVX */
+
+#undef VEC_WIDE_LANES
+
+/**
+ * WIDTH 2d vectors, one wide value per coordinate. Use Vec2x4 and Vec2x8.
+ */
+template<typename F>
+class Vec2xN
+{
+public:
+    typedef typename F::Mask Mask;
+
+    static const int WIDTH = F::WIDTH;
+
+    F x, y;
+
+    /**
+     * Default constructor. Leaves values unitialized.
+     */
+    Vec2xN() {}
+
+    Vec2xN(const F& x, const F& y)
+        : x(x), y(y) {}
+
+    /**
+     * Sets every lane to v.
+     */
+    explicit Vec2xN(const Vec2& v)
+        : x(v.x), y(v.y) {}
+
+    /**
+     * Loads WIDTH consecutive vectors.
+     */
+    static Vec2xN load(const Vec2* p)
+    {
+        Vec2xN r;
+        load_interleaved(&p->x, r.x, r.y);
+        return r;
+    }
+
+    /**
+     * Stores the lanes to WIDTH consecutive vectors.
+     */
+    void store(Vec2* p) const
+    {
+        store_interleaved(&p->x, x, y);
+    }
+
+    /**
+     * Returns one lane. Slow; for tails and debugging.
+     */
+    Vec2 operator[](int i) const
+    {
+        return Vec2(x[i], y[i]);
+    }
+
+    Vec2xN operator+(const Vec2xN& rhs) const { return Vec2xN(x + rhs.x, y + rhs.y); }
+    Vec2xN operator-(const Vec2xN& rhs) const { return Vec2xN(x - rhs.x, y - rhs.y); }
+    Vec2xN operator*(const Vec2xN& rhs) const { return Vec2xN(x * rhs.x, y * rhs.y); }
+    Vec2xN operator/(const Vec2xN& rhs) const { return Vec2xN(x / rhs.x, y / rhs.y); }
+    Vec2xN operator*(const F& s) const { return Vec2xN(x * s, y * s); }
+    Vec2xN operator/(const F& s) const { return Vec2xN(x / s, y / s); }
+    Vec2xN operator-() const { return Vec2xN(-x, -y); }
+
+    Vec2xN& operator+=(const Vec2xN& rhs) { return *this = *this + rhs; }
+    Vec2xN& operator-=(const Vec2xN& rhs) { return *this = *this - rhs; }
+    Vec2xN& operator*=(const F& s) { return *this = *this * s; }
+    Vec2xN& operator/=(const F& s) { return *this = *this / s; }
+
+    F dot(const Vec2xN& rhs) const
+    {
+        return x*rhs.x + y*rhs.y;
+    }
+
+    F magnitude() const
+    {
+        return sqrt(x*x + y*y);
+    }
+
+    F squared_magnitude() const
+    {
+        return x*x + y*y;
+    }
+
+    F distance(const Vec2xN& rhs) const
+    {
+        return (*this-rhs).magnitude();
+    }
+
+    F squared_distance(const Vec2xN& rhs) const
+    {
+        return (*this-rhs).squared_magnitude();
+    }
+
+    Vec2xN unit() const
+    {
+        return *this / magnitude();
+    }
+
+    Vec2xN& normalize()
+    {
+        return *this /= magnitude();
+    }
+
+    Vec2xN abs() const
+    {
+        return Vec2xN(::abs(x), ::abs(y));
+    }
+
+    Vec2xN maximum(const Vec2xN& rhs) const
+    {
+        return Vec2xN(max(x, rhs.x), max(y, rhs.y));
+    }
+
+    Vec2xN minimum(const Vec2xN& rhs) const
+    {
+        return Vec2xN(min(x, rhs.x), min(y, rhs.y));
+    }
+};
+
+/**
+ * WIDTH 3d vectors, one wide value per coordinate. Use Vec3x4 and Vec3x8.
+ */
+template<typename F>
+class Vec3xN
+{
+public:
+    typedef typename F::Mask Mask;
+
+    static const int WIDTH = F::WIDTH;
+
+    F x, y, z;
+
+    /**
+     * Default constructor. Leaves values unitialized.
+     */
+    Vec3xN() {}
+
+    Vec3xN(const F& x, const F& y, const F& z)
+        : x(x), y(y), z(z) {}
+
+    /**
+     * Sets every lane to v.
+     */
+    explicit Vec3xN(const Vec3& v)
+        : x(v.x), y(v.y), z(v.z) {}
+
+    /**
+     * Loads WIDTH consecutive vectors.
+     */
+    static Vec3xN load(const Vec3* p)
+    {
+        Vec3xN r;
+        load_interleaved(&p->x, r.x, r.y, r.z);
+        return r;
+    }
+
+    /**
+     * Loads 2*WIDTH consecutive vectors, alternately to even and odd, e.g.
+     * the corners of WIDTH consecutive boxes.
+     */
+    static void load_pairs(const Vec3* p, Vec3xN& even, Vec3xN& odd)
+    {
+        const Vec3xN a = load(p), b = load(p + WIDTH);
+        deinterleave(a.x, b.x, even.x, odd.x);
+        deinterleave(a.y, b.y, even.y, odd.y);
+        deinterleave(a.z, b.z, even.z, odd.z);
+    }
+
+    /**
+     * Stores the lanes to WIDTH consecutive vectors.
+     */
+    void store(Vec3* p) const
+    {
+        store_interleaved(&p->x, x, y, z);
+    }
+
+    /**
+     * Returns one lane. Slow; for tails and debugging.
+     */
+    Vec3 operator[](int i) const
+    {
+        return Vec3(x[i], y[i], z[i]);
+    }
+
+    Vec3xN operator+(const Vec3xN& rhs) const { return Vec3xN(x + rhs.x, y + rhs.y, z + rhs.z); }
+    Vec3xN operator-(const Vec3xN& rhs) const { return Vec3xN(x - rhs.x, y - rhs.y, z - rhs.z); }
+    Vec3xN operator*(const Vec3xN& rhs) const { return Vec3xN(x * rhs.x, y * rhs.y, z * rhs.z); }
+    Vec3xN operator/(const Vec3xN& rhs) const { return Vec3xN(x / rhs.x, y / rhs.y, z / rhs.z); }
+    Vec3xN operator*(const F& s) const { return Vec3xN(x * s, y * s, z * s); }
+    Vec3xN operator/(const F& s) const { return Vec3xN(x / s, y / s, z / s); }
+    Vec3xN operator-() const { return Vec3xN(-x, -y, -z); }
+
+    Vec3xN& operator+=(const Vec3xN& rhs) { return *this = *this + rhs; }
+    Vec3xN& operator-=(const Vec3xN& rhs) { return *this = *this - rhs; }
+    Vec3xN& operator*=(const F& s) { return *this = *this * s; }
+    Vec3xN& operator/=(const F& s) { return *this = *this / s; }
+
+    F dot(const Vec3xN& rhs) const
+    {
+        return x*rhs.x + y*rhs.y + z*rhs.z;
+    }
+
+    Vec3xN cross(const Vec3xN& rhs) const
+    {
+        return Vec3xN(y*rhs.z - z*rhs.y,
+                      z*rhs.x - x*rhs.z,
+                      x*rhs.y - y*rhs.x);
+    }
+
+    F magnitude() const
+    {
+        return sqrt(x*x + y*y + z*z);
+    }
+
+    F squared_magnitude() const
+    {
+        return x*x + y*y + z*z;
+    }
+
+    F distance(const Vec3xN& rhs) const
+    {
+        return (*this-rhs).magnitude();
+    }
+
+    F squared_distance(const Vec3xN& rhs) const
+    {
+        return (*this-rhs).squared_magnitude();
+    }
+
+    Vec3xN unit() const
+    {
+        return *this / magnitude();
+    }
+
+    Vec3xN& normalize()
+    {
+        return *this /= magnitude();
+    }
+
+    Vec3xN abs() const
+    {
+        return Vec3xN(::abs(x), ::abs(y), ::abs(z));
+    }
+
+    Vec3xN maximum(const Vec3xN& rhs) const
+    {
+        return Vec3xN(max(x, rhs.x), max(y, rhs.y), max(z, rhs.z));
+    }
+
+    Vec3xN minimum(const Vec3xN& rhs) const
+    {
+        return Vec3xN(min(x, rhs.x), min(y, rhs.y), min(z, rhs.z));
+    }
+};
+
+/**
+ * Returns a where m is set and b elsewhere.
+ */
+template<typename F>
+inline Vec2xN<F> select(const typename F::Mask& m, const Vec2xN<F>& a, const Vec2xN<F>& b)
+{
+    return Vec2xN<F>(select(m, a.x, b.x), select(m, a.y, b.y));
+}
+
+/**
+ * Returns a where m is set and b elsewhere.
+ */
+template<typename F>
+inline Vec3xN<F> select(const typename F::Mask& m, const Vec3xN<F>& a, const Vec3xN<F>& b)
+{
+    return Vec3xN<F>(select(m, a.x, b.x), select(m, a.y, b.y), select(m, a.z, b.z));
+}
+
+/**
+ * WIDTH quaternions, one wide value per component. Use Quatx4 and Quatx8.
+ */
+template<typename F>
+class QuatxN
+{
+public:
+    typedef typename F::Mask Mask;
+
+    static const int WIDTH = F::WIDTH;
+
+    F w, x, y, z;
+
+    /**
+     * Default constructor. Leaves values unitialized.
+     */
+    QuatxN() {}
+
+    QuatxN(const F& w, const F& x, const F& y, const F& z)
+        : w(w), x(x), y(y), z(z) {}
+
+    /**
+     * Sets every lane to q.
+     */
+    explicit QuatxN(const Quat& q)
+        : w(q.w), x(q.x), y(q.y), z(q.z) {}
+
+    /**
+     * Loads WIDTH consecutive quaternions.
+     */
+    static QuatxN load(const Quat* p)
+    {
+        QuatxN r;
+        load_interleaved(&p->w, r.w, r.x, r.y, r.z);
+        return r;
+    }
+
+    /**
+     * Stores the lanes to WIDTH consecutive quaternions.
+     */
+    void store(Quat* p) const
+    {
+        store_interleaved(&p->w, w, x, y, z);
+    }
+
+    /**
+     * Returns one lane. Slow; for tails and debugging.
+     */
+    Quat operator[](int i) const
+    {
+        return Quat(w[i], x[i], y[i], z[i]);
+    }
+
+    QuatxN operator*(const QuatxN& rhs) const
+    {
+        return QuatxN(w * rhs.w - x * rhs.x - y * rhs.y - z * rhs.z,
+                      w * rhs.x + x * rhs.w + y * rhs.z - z * rhs.y,
+                      w * rhs.y + y * rhs.w + z * rhs.x - x * rhs.z,
+                      w * rhs.z + z * rhs.w + x * rhs.y - y * rhs.x);
+    }
+
+    /**
+     * Rotates vectors, as Quat * Vec3.
+     */
+    Vec3xN<F> operator*(const Vec3xN<F>& v) const
+    {
+        const Vec3xN<F> qvec(x, y, z);
+        const Vec3xN<F> uv = qvec.cross(v);
+        const Vec3xN<F> uuv = qvec.cross(uv);
+        return v + uv * (w + w) + uuv * F(2);
+    }
+
+    F dot(const QuatxN& rhs) const
+    {
+        return w*rhs.w + x*rhs.x + y*rhs.y + z*rhs.z;
+    }
+
+    F norm() const
+    {
+        return x*x + y*y + z*z + w*w;
+    }
+
+    F magnitude() const
+    {
+        return sqrt(norm());
+    }
+
+    QuatxN& normalize()
+    {
+        const F mag = magnitude();
+        w = w / mag;
+        x = x / mag;
+        y = y / mag;
+        z = z / mag;
+        return *this;
+    }
+
+    /**
+     * Returns the X, Y and Z axes rotated by these quaternions, which are
+     * the columns of their rotation matrices, as Quat::to_axes.
+     */
+    void to_axes(Vec3xN<F> axes[3]) const
+    {
+        const F x2 = x + x, y2 = y + y, z2 = z + z;
+        const F xw2 = x2 * w, yw2 = y2 * w, zw2 = z2 * w;
+        const F xx2 = x2 * x, xy2 = y2 * x, xz2 = z2 * x;
+        const F yy2 = y2 * y, yz2 = z2 * y, zz2 = z2 * z;
+        const F one = 1;
+
+        axes[0] = Vec3xN<F>(one - (yy2 + zz2), xy2 + zw2, xz2 - yw2);
+        axes[1] = Vec3xN<F>(xy2 - zw2, one - (xx2 + zz2), yz2 + xw2);
+        axes[2] = Vec3xN<F>(xz2 + yw2, yz2 - xw2, one - (xx2 + yy2));
+    }
+};
+
+/**
+ * Returns a where m is set and b elsewhere.
+ */
+template<typename F>
+inline QuatxN<F> select(const typename F::Mask& m, const QuatxN<F>& a, const QuatxN<F>& b)
+{
+    return QuatxN<F>(select(m, a.w, b.w), select(m, a.x, b.x),
+                     select(m, a.y, b.y), select(m, a.z, b.z));
+}
+
+typedef Vec2xN<Floatx4> Vec2x4;
+typedef Vec2xN<Floatx8> Vec2x8;
+typedef Vec3xN<Floatx4> Vec3x4;
+typedef Vec3xN<Floatx8> Vec3x8;
+typedef QuatxN<Floatx4> Quatx4;
+typedef QuatxN<Floatx8> Quatx8;
+
+} /* namespace VEC_ISA */
+
+using namespace VEC_ISA;
+
+#endif /* _VEC_WIDE_H_ */